@@ -0,0 +1,339 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+namespace detail {
+
+  // A small per-thread number, handed out once per thread, used to spread
+  // readers over striped counters.
+  inline std::size_t reader_stripe_seed() noexcept {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t seed = next.fetch_add(1, std::memory_order_relaxed);
+    return seed;
+  }
+
+} // namespace detail
+
+template <class Sig,
+          class AllocFamily = std::allocator<std::byte>,
+          std::size_t SboBytes = 3 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class atomic_function;
+
+// A hot-swappable callable for read-mostly callbacks: handlers and feature
+// toggles that are called from many threads and replaced now and then.
+//
+//   call      Wait-free: one increment on the calling thread's reader stripe,
+//             one load of the current node, the call, one decrement. No lock,
+//             no retry loop, and threads on different stripes share no
+//             written cache line.
+//   store     Builds the new callable in a node from the slot's allocator
+//             (a function_with_allocator, so small callables live inline),
+//             then publishes it with one exchange under a writer mutex that
+//             calls never take. The old node is retired.
+//   reclaim   Epoch based, as in signal: a call registers in the counter of
+//             the current epoch's parity on its stripe, and the writer
+//             advances the epoch only when the other parity has drained on
+//             every stripe. A node retired at epoch e is unreachable once the
+//             epoch reaches e + 2 and is then destroyed and returned to the
+//             allocator. Reclamation never waits; it runs on later stores or
+//             via collect(). synchronize() waits for everything retired.
+//
+// A call may store into or reset the slot it was called through; the running
+// callable stays alive until the call returns.
+//
+// Contract: no call may be in progress when the slot is destroyed, and
+// synchronize() must not be called from inside a call; the allocator must
+// outlive the slot.
+template <class R, class... Args, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+class atomic_function<R(Args...), AllocFamily, SboBytes, SboAlign> {
+  struct node;
+  struct stripe;
+
+public:
+  using allocator_type = AllocFamily;
+  using traits         = std::allocator_traits<allocator_type>;
+  using slot_type      = function_with_allocator<R(Args...), AllocFamily, SboBytes, SboAlign>;
+
+  struct config {
+    // Reader stripes, rounded up to a power of two. 0: twice the hardware
+    // concurrency. Threads beyond the stripe count share stripes (still
+    // correct, just contended).
+    std::size_t reader_stripes = 0;
+  };
+
+  explicit atomic_function(const allocator_type& a = allocator_type{}, config cfg = {}) noexcept
+      : alloc_(a) {
+    std::size_t n = cfg.reader_stripes;
+    if (n == 0) n = 2 * static_cast<std::size_t>(std::thread::hardware_concurrency());
+    n = std::bit_ceil(n ? n : 1);
+
+    stripe_alloc sa(alloc_);
+#if defined(__cpp_exceptions)
+    try {
+      stripes_ = stripe_traits::allocate(sa, n);
+    } catch (...) {
+      stripes_ = nullptr;
+    }
+#else
+    stripes_ = stripe_traits::allocate(sa, n);
+#endif
+    if (!stripes_) return;
+    for (std::size_t i = 0; i < n; ++i) std::construct_at(stripes_ + i);
+    stripe_mask_ = n - 1;
+  }
+
+  ~atomic_function() noexcept {
+    if (node* n = current_.load(std::memory_order_relaxed)) destroy_node(n);
+    while (node* n = retired_head_) {
+      retired_head_ = n->next;
+      destroy_node(n);
+    }
+    if (stripes_) {
+      stripe_alloc sa(alloc_);
+      std::destroy_n(stripes_, stripe_mask_ + 1);
+      stripe_traits::deallocate(sa, stripes_, stripe_mask_ + 1);
+    }
+  }
+
+  atomic_function(const atomic_function&) = delete;
+  atomic_function& operator=(const atomic_function&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // False if the reader stripes could not be allocated; nothing can be stored.
+  [[nodiscard]] bool valid() const noexcept { return stripes_ != nullptr; }
+
+  [[nodiscard]] std::size_t reader_stripes() const noexcept { return stripes_ ? stripe_mask_ + 1 : 0; }
+
+  // A snapshot under concurrency.
+  [[nodiscard]] bool has_value() const noexcept { return current_.load(std::memory_order_acquire) != nullptr; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  // Retired callables not yet destroyed (writer-side snapshot).
+  [[nodiscard]] std::size_t retired() const noexcept { return retired_count_.load(std::memory_order_relaxed); }
+
+  // Calls the current callable. Precondition: has_value(). Exceptions from the
+  // callable propagate.
+  R operator()(Args... args) const {
+    read_guard guard(*this);
+    return current_.load(std::memory_order_seq_cst)->fn(std::forward<Args>(args)...);
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::empty if nothing is stored. Exceptions from the callable
+  //         propagate.
+  std::expected<R, ec> try_invoke(Args... args) const {
+    read_guard guard(*this);
+    const node* n = current_.load(std::memory_order_seq_cst);
+    if (!n) return std::unexpected(ec::empty);
+    if constexpr (std::is_void_v<R>) {
+      n->fn(std::forward<Args>(args)...);
+      return {};
+    } else {
+      return n->fn(std::forward<Args>(args)...);
+    }
+  }
+
+  // Publishes f; calls that start afterwards see it.
+  // Errors: ec::alloc_failed (also for an invalid slot), or whatever
+  //         function_with_allocator::try_emplace reports.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec> try_store(F&& f) noexcept {
+    if (!stripes_) return std::unexpected(ec::alloc_failed);
+
+    auto made = make_node();
+    if (!made) return std::unexpected(made.error());
+    node* n = *made;
+    if (auto r = n->fn.try_emplace(std::forward<F>(f)); !r) {
+      destroy_node(n);
+      return std::unexpected(r.error());
+    }
+
+    std::scoped_lock lock(mtx_);
+    retire(current_.exchange(n, std::memory_order_seq_cst));
+    reclaim();
+    return {};
+  }
+
+  // Errors: ec::empty if nothing is stored.
+  [[nodiscard]] std::expected<void, ec> try_reset() noexcept {
+    std::scoped_lock lock(mtx_);
+    node* old = current_.exchange(nullptr, std::memory_order_seq_cst);
+    if (!old) return std::unexpected(ec::empty);
+    retire(old);
+    reclaim();
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape
+  // --------------------------------------------------------------------------
+
+  // False on failure; the previous callable stays in place.
+  template <class F>
+  bool store(F&& f) noexcept { return try_store(std::forward<F>(f)).has_value(); }
+
+  void reset() noexcept { (void)try_reset(); }
+
+  // Destroys retired callables whose grace period has passed. Never waits.
+  void collect() noexcept {
+    std::scoped_lock lock(mtx_);
+    reclaim();
+  }
+
+  // Waits until every retired callable has been destroyed: after it returns,
+  // no call is still running anything replaced before it was entered.
+  void synchronize() noexcept {
+    for (;;) {
+      {
+        std::scoped_lock lock(mtx_);
+        reclaim();
+        if (!retired_head_) return;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  struct node {
+    slot_type fn;
+    node* next{nullptr};        // retired list; writer only
+    std::uint64_t retired_at{0};
+
+    explicit node(const allocator_type& a) noexcept : fn(a) {}
+  };
+
+  // One cache line per stripe: readers on different stripes never write to
+  // the same line.
+  struct alignas(64) stripe {
+    std::atomic<std::size_t> readers[2]{};
+  };
+
+  using node_alloc    = typename traits::template rebind_alloc<node>;
+  using node_traits   = std::allocator_traits<node_alloc>;
+  using stripe_alloc  = typename traits::template rebind_alloc<stripe>;
+  using stripe_traits = std::allocator_traits<stripe_alloc>;
+
+  // Registers in the current epoch's parity on this thread's stripe, without
+  // re-checking the epoch: a stale parity is still one the writer must see
+  // drained before the second of its two advances, so a call that could have
+  // loaded a retired node always holds back its reclamation. The increment
+  // and the node load are seq_cst, ordered against the writer's exchange and
+  // its drain checks.
+  class read_guard {
+  public:
+    explicit read_guard(const atomic_function& f) noexcept
+        : counter_(&f.stripes_[detail::reader_stripe_seed() & f.stripe_mask_]
+                        .readers[f.epoch_.load(std::memory_order_relaxed) & 1]) {
+      counter_->fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    ~read_guard() noexcept { counter_->fetch_sub(1, std::memory_order_release); }
+
+    read_guard(const read_guard&) = delete;
+    read_guard& operator=(const read_guard&) = delete;
+
+  private:
+    std::atomic<std::size_t>* counter_;
+  };
+
+  std::expected<node*, ec> make_node() noexcept {
+    node_alloc na(alloc_);
+    node* n = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      n = node_traits::allocate(na, 1);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    n = node_traits::allocate(na, 1);
+    if (!n) return std::unexpected(ec::alloc_failed);
+#endif
+    std::construct_at(n, std::as_const(alloc_));
+    return n;
+  }
+
+  void destroy_node(node* n) noexcept {
+    node_alloc na(alloc_);
+    std::destroy_at(n);
+    node_traits::deallocate(na, n, 1);
+  }
+
+  // Requires mtx_.
+  void retire(node* n) noexcept {
+    if (!n) return;
+    n->retired_at = epoch_.load(std::memory_order_seq_cst);
+    n->next = nullptr;
+    if (retired_tail_) {
+      retired_tail_->next = n;
+    } else {
+      retired_head_ = n;
+    }
+    retired_tail_ = n;
+    retired_count_.store(retired_count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  // Requires mtx_. Retired nodes are in epoch order, so reclamation stops at
+  // the first one still in grace.
+  void reclaim() noexcept {
+    try_advance_epoch();
+    try_advance_epoch();
+
+    const std::uint64_t e = epoch_.load(std::memory_order_relaxed);
+    while (node* n = retired_head_) {
+      if (n->retired_at + 2 > e) break;
+      retired_head_ = n->next;
+      if (!retired_head_) retired_tail_ = nullptr;
+      destroy_node(n);
+      retired_count_.store(retired_count_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+  }
+
+  void try_advance_epoch() noexcept {
+    if (!retired_head_) return;
+    const std::uint64_t e = epoch_.load(std::memory_order_relaxed);
+    const unsigned other = static_cast<unsigned>((e + 1) & 1);
+    for (std::size_t i = 0; i <= stripe_mask_; ++i) {
+      if (stripes_[i].readers[other].load(std::memory_order_seq_cst) != 0) return;
+    }
+    epoch_.store(e + 1, std::memory_order_seq_cst);
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+
+  // Reader side: read-only between stores.
+  alignas(64) std::atomic<node*> current_{nullptr};
+  std::atomic<std::uint64_t> epoch_{0};
+  stripe* stripes_{nullptr};
+  std::size_t stripe_mask_{0};
+
+  // Writer side.
+  alignas(64) std::mutex mtx_;
+  node* retired_head_{nullptr};
+  node* retired_tail_{nullptr};
+  std::atomic<std::size_t> retired_count_{0};
+};
+
+} // namespace ndof
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "maybe_atomic.hpp"
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class T, class Alloc, class... Args>
+//   void construct_with_optional_alloc(T*, const Alloc&, Args&&...) noexcept(...)
+
+enum class command_buffer_mode {
+  single_threaded, // record and execute on one thread, no atomics
+  spsc             // one producer thread records, one consumer thread executes
+};
+
+// Command pattern: type-erased void() commands recorded back to back into one
+// byte ring from the buffer's allocator. No per-command allocation.
+//
+// Each record is [header: ops*, bytes][pad][callable], where the callable is
+// placed with std::align exactly as aligned_storage::allocate places its
+// payload, and records are rounded to the header size so the next header is
+// always aligned. A record never wraps: if it does not fit before the end of
+// the ring, a skip marker covers the tail and the record starts at offset 0.
+//
+//   execute()  runs and destroys recorded commands in order (bulk; the
+//              consumer position is published once per call).
+//   replay()   runs recorded commands again without consuming them.
+//   clear()    drops everything recorded; O(1) unless some recorded command
+//              has a non-trivial destructor, which then has to run.
+//
+// In command_buffer_mode::spsc, try_push() may run on one producer thread
+// concurrently with execute()/replay()/clear() on one consumer thread.
+//
+// Contract: the allocator must outlive the buffer.
+template <class AllocFamily = std::allocator<std::byte>,
+          command_buffer_mode Mode = command_buffer_mode::single_threaded>
+class command_buffer {
+  static constexpr bool spsc = Mode == command_buffer_mode::spsc;
+
+public:
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  static constexpr std::size_t all = std::numeric_limits<std::size_t>::max();
+
+  // Capacity is rounded up to a power of two of at least 64 bytes.
+  explicit command_buffer(std::size_t capacity_bytes, const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a) {
+    const std::size_t cap = std::bit_ceil(std::max<std::size_t>(capacity_bytes, 64));
+#if defined(__cpp_exceptions)
+    try {
+      base_ = traits::allocate(alloc_, cap);
+    } catch (...) {
+      base_ = nullptr;
+    }
+#else
+    base_ = traits::allocate(alloc_, cap);
+#endif
+    if (base_) mask_ = cap - 1;
+  }
+
+  ~command_buffer() noexcept {
+    if (!base_) return;
+    clear();
+    traits::deallocate(alloc_, base_, mask_ + 1);
+  }
+
+  command_buffer(const command_buffer&) = delete;
+  command_buffer& operator=(const command_buffer&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // False if construction could not allocate the ring; every push then fails
+  // with ec::alloc_failed.
+  [[nodiscard]] bool valid() const noexcept { return base_ != nullptr; }
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return base_ ? mask_ + 1 : 0; }
+
+  // Bytes in use, including headers and padding (a snapshot in spsc mode).
+  [[nodiscard]] std::size_t size_bytes() const noexcept {
+    return static_cast<std::size_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return size_bytes() == 0; }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Records f. Producer side.
+  // Errors: ec::alloc_failed if the ring has no room for f (or is invalid),
+  //         ec::construction_failed if constructing f's copy threw.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec> try_push(F&& f) noexcept {
+    using U = std::remove_cvref_t<F>;
+    static_assert(std::is_invocable_v<U&>, "A command must be callable as void().");
+
+    if (!base_) return std::unexpected(ec::alloc_failed);
+
+    const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t at = static_cast<std::size_t>(tail & mask_);
+
+    std::size_t skip = 0;
+    std::size_t bytes = record_bytes<U>(at);
+    if (bytes == 0) {
+      skip = capacity() - at;
+      bytes = record_bytes<U>(0);
+      if (bytes == 0) return std::unexpected(ec::alloc_failed);
+    }
+
+    if (!has_room(tail, skip + bytes)) return std::unexpected(ec::alloc_failed);
+
+    std::byte* rec = base_ + (skip ? 0 : at);
+    void* obj = payload(rec, alignof(U));
+#if defined(__cpp_exceptions)
+    try {
+      construct_with_optional_alloc(static_cast<U*>(obj), alloc_, std::forward<F>(f));
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    construct_with_optional_alloc(static_cast<U*>(obj), alloc_, std::forward<F>(f));
+#endif
+
+    if (skip) std::construct_at(reinterpret_cast<header*>(base_ + at), header{nullptr, skip});
+    std::construct_at(reinterpret_cast<header*>(rec), header{&ops_for<U>, bytes});
+    if constexpr (!std::is_trivially_destructible_v<U>) {
+      needs_destroy_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    tail_.store(tail + skip + bytes, std::memory_order_release);
+    return {};
+  }
+
+  // Runs and destroys up to max recorded commands, oldest first. Consumer side.
+  // Returns the number run. If a command throws, it is still destroyed and
+  // consumed, and the exception propagates.
+  std::size_t execute(std::size_t max = all) {
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    const std::uint64_t tail = tail_.load(std::memory_order_acquire);
+
+    struct publish {
+      command_buffer& self;
+      std::uint64_t& head;
+      ~publish() { self.head_.store(head, std::memory_order_release); }
+    } publish_on_exit{*this, head};
+
+    std::size_t n = 0;
+    while (head != tail && n < max) {
+      std::byte* rec = base_ + (head & mask_);
+      const header h = *reinterpret_cast<const header*>(rec);
+      if (!h.ops) {
+        head += h.bytes;
+        continue;
+      }
+
+      // Consumes the record even if invoke() throws.
+      struct consume {
+        command_buffer& self;
+        std::uint64_t& head;
+        std::byte* rec;
+        const header& h;
+        ~consume() {
+          self.destroy(rec, h);
+          head += h.bytes;
+        }
+      } consume_on_exit{*this, head, rec, h};
+
+      ++n;
+      h.ops->invoke(payload(rec, h.ops->align));
+    }
+    return n;
+  }
+
+  // Runs every recorded command again, in order, without consuming any.
+  // Consumer side. Returns the number run.
+  std::size_t replay() {
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+    const std::uint64_t tail = tail_.load(std::memory_order_acquire);
+
+    std::size_t n = 0;
+    while (head != tail) {
+      std::byte* rec = base_ + (head & mask_);
+      const header h = *reinterpret_cast<const header*>(rec);
+      if (h.ops) {
+        h.ops->invoke(payload(rec, h.ops->align));
+        ++n;
+      }
+      head += h.bytes;
+    }
+    return n;
+  }
+
+  // Drops every recorded command. Consumer side.
+  void clear() noexcept {
+    const std::uint64_t tail = tail_.load(std::memory_order_acquire);
+    std::uint64_t head = head_.load(std::memory_order_relaxed);
+
+    if (needs_destroy_.load(std::memory_order_relaxed) != 0) {
+      while (head != tail) {
+        std::byte* rec = base_ + (head & mask_);
+        const header h = *reinterpret_cast<const header*>(rec);
+        if (h.ops) destroy(rec, h);
+        head += h.bytes;
+      }
+    }
+    head_.store(tail, std::memory_order_release);
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  template <class F>
+  [[nodiscard]] bool push(F&& f) noexcept {
+    return try_push(std::forward<F>(f)).has_value();
+  }
+
+private:
+  struct ops_t {
+    void (*invoke)(void*);
+    void (*destroy)(void*) noexcept; // null if trivially destructible
+    std::size_t align;
+  };
+
+  struct header {
+    const ops_t* ops; // null: skip marker covering the rest of the ring
+    std::size_t bytes;
+  };
+
+  static constexpr std::size_t granule = sizeof(header);
+  static_assert(std::has_single_bit(granule) && alignof(header) <= granule);
+
+  template <class U>
+  static void invoke_impl(void* p) {
+    std::invoke(*static_cast<U*>(p));
+  }
+
+  template <class U>
+  static void destroy_impl(void* p) noexcept {
+    std::destroy_at(static_cast<U*>(p));
+  }
+
+  template <class U>
+  static constexpr ops_t ops_for = {
+    &invoke_impl<U>,
+    std::is_trivially_destructible_v<U> ? nullptr : &destroy_impl<U>,
+    alignof(U)
+  };
+
+  static void* payload(std::byte* rec, std::size_t align) noexcept {
+    const auto p = reinterpret_cast<std::uintptr_t>(rec + sizeof(header));
+    return reinterpret_cast<void*>((p + align - 1) & ~(std::uintptr_t{align} - 1));
+  }
+
+  // Record size for U at ring offset at, or 0 if it does not fit before the end.
+  template <class U>
+  std::size_t record_bytes(std::size_t at) const noexcept {
+    const std::size_t cap = capacity();
+    if (cap - at < sizeof(header)) return 0;
+    void* p = base_ + at + sizeof(header);
+    std::size_t space = cap - at - sizeof(header);
+    if (!std::align(alignof(U), sizeof(U), p, space)) return 0;
+    const auto end = static_cast<std::size_t>(static_cast<std::byte*>(p) + sizeof(U) - base_);
+    return ((end + granule - 1) & ~(granule - 1)) - at;
+  }
+
+  bool has_room(std::uint64_t tail, std::size_t n) noexcept {
+    if (tail + n - head_cache_ <= capacity()) return true;
+    head_cache_ = head_.load(std::memory_order_acquire);
+    return tail + n - head_cache_ <= capacity();
+  }
+
+  void destroy(std::byte* rec, const header& h) noexcept {
+    if (!h.ops->destroy) return;
+    h.ops->destroy(payload(rec, h.ops->align));
+    needs_destroy_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  std::byte* base_{nullptr};
+  std::size_t mask_{0};
+
+  // Consumer-owned position, producer-owned position and the producer's
+  // cached copy of the consumer position; on separate cache lines in spsc mode.
+  static constexpr std::size_t line = spsc ? 64 : alignof(std::uint64_t);
+
+  alignas(line) detail::maybe_atomic<std::uint64_t, spsc> head_{0};
+  alignas(line) detail::maybe_atomic<std::uint64_t, spsc> tail_{0};
+  std::uint64_t head_cache_{0};
+  detail::maybe_atomic<std::size_t, spsc> needs_destroy_{0};
+};
+
+} // namespace ndof
@@ -0,0 +1,882 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class any_with_allocator
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+// Mediator: a sharded publish/subscribe bus. Events are any_with_allocator
+// values published to integer topics; subscribers are function_with_allocator
+// objects.
+//
+//   shards     Each topic hashes to one shard. A shard owns an intrusive MPSC
+//              queue of event blocks and the subscriber table for its topics.
+//              Exactly one dispatcher drains a shard at a time, so events of
+//              one topic are delivered in the order they were enqueued.
+//   batching   Events travel in blocks of config::batch records, allocated
+//              once and recycled through a pool. A publisher (one per producer
+//              thread) fills one block per shard and enqueues it whole: one
+//              atomic exchange per batch, no lock, no copy of the events.
+//              event_bus::try_publish() enqueues a block of one.
+//   dispatch   One dispatcher thread per shard by default. A dispatcher serves
+//              its home shard first and, when that is empty, takes over any
+//              other shard with queued blocks (stealing a whole shard keeps
+//              per-topic order). Idle dispatchers sleep on an atomic wait.
+//              With config::manual, no threads start; poll() dispatches on the
+//              calling thread.
+//
+// Subscribers may subscribe and unsubscribe (themselves included) while being
+// dispatched. The subscriber table of a shard belongs to whoever drains it;
+// an edit from any other thread never waits for that: it is queued under a
+// short per-shard lock and applied by the drainer before its next block (or
+// at once, if no one is draining). So an unsubscribe from another thread can
+// still see the block in progress delivered to the subscriber, and
+// dispatchers whose subscribers edit each other's shards never wait on one
+// another. Exceptions from subscribers are caught and counted (failures());
+// the event still goes to the remaining subscribers.
+//
+// Contract: publishers are destroyed before the bus; the destructor delivers
+// every event already enqueued, then joins. The allocator must outlive the bus.
+template <class AllocFamily = std::allocator<std::byte>,
+          std::size_t SboBytes = 6 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class event_bus {
+  struct record;
+  struct block;
+  struct sub_node;
+  struct shard;
+
+public:
+  using allocator_type  = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits          = std::allocator_traits<allocator_type>;
+  using topic_type      = std::uint64_t;
+  using event_type      = any_with_allocator<allocator_type, SboBytes, SboAlign>;
+  using subscriber_type = function_with_allocator<void(const event_type&), allocator_type, SboBytes, SboAlign>;
+
+  struct config {
+    std::size_t dispatchers   = 0;    // 0: std::thread::hardware_concurrency()
+    std::size_t shards        = 0;    // 0: one per dispatcher
+    std::size_t batch         = 64;   // events per block
+    std::size_t max_blocks    = 4096; // blocks in flight, bus-wide; bounds memory
+    std::size_t topic_buckets = 64;   // subscriber hash buckets per shard (power of two)
+    bool manual               = false; // no dispatcher threads; call poll()
+  };
+
+  // Names one subscriber. Stale handles are detected.
+  class subscription {
+  public:
+    subscription() noexcept = default;
+
+    [[nodiscard]] bool has_value() const noexcept { return node_ != nullptr; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+  private:
+    friend class event_bus;
+
+    subscription(sub_node* n, std::uint32_t generation, std::size_t shard) noexcept
+        : node_(n), generation_(generation), shard_(shard) {}
+
+    sub_node* node_{nullptr};
+    std::uint32_t generation_{0};
+    std::size_t shard_{0};
+  };
+
+  class publisher;
+
+  explicit event_bus(const config& cfg = config{}, const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a) {
+    if (!init(cfg)) teardown();
+  }
+
+  ~event_bus() noexcept { teardown(); }
+
+  event_bus(const event_bus&) = delete;
+  event_bus& operator=(const event_bus&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // False if construction could not allocate its shards or start a
+  // dispatcher; every operation then fails with ec::alloc_failed.
+  [[nodiscard]] bool valid() const noexcept { return shards_ != nullptr; }
+
+  [[nodiscard]] std::size_t shard_count() const noexcept { return shard_count_; }
+  [[nodiscard]] std::size_t dispatcher_count() const noexcept { return running_; }
+
+  // Subscriber calls that threw.
+  [[nodiscard]] std::uint64_t failures() const noexcept { return failures_.load(std::memory_order_relaxed); }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Calls f(const event_type&) for every event published to topic.
+  // Errors: ec::alloc_failed, or whatever function_with_allocator::try_emplace reports.
+  template <class F>
+  [[nodiscard]] std::expected<subscription, ec> try_subscribe(topic_type topic, F&& f) noexcept {
+    if (!valid()) return std::unexpected(ec::alloc_failed);
+    const std::size_t si = shard_of(topic);
+    shard& s = shards_[si];
+
+    auto n = take_node(s);
+    if (!n) return std::unexpected(n.error());
+    sub_node* x = *n;
+    auto r = x->fn.try_emplace(std::forward<F>(f));
+    if (!r) {
+      give_node(s, x);
+      return std::unexpected(r.error());
+    }
+    x->topic = topic;
+
+    std::uint32_t generation = 0;
+    {
+      std::lock_guard lock(s.edit_mutex);
+      x->subscribed = true;
+      generation = x->generation;
+      mark_edited(s, x);
+    }
+    settle(s);
+    return subscription(x, generation, si);
+  }
+
+  // Calls f(const T&) for every event of type T published to topic; events of
+  // other types are skipped.
+  template <class T, class F>
+  [[nodiscard]] std::expected<subscription, ec> try_subscribe(topic_type topic, F&& f) noexcept {
+    using U = std::remove_cvref_t<F>;
+#if defined(__cpp_exceptions)
+    try {
+      return try_subscribe(topic, typed<T, U>{U(std::forward<F>(f))});
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    return try_subscribe(topic, typed<T, U>{U(std::forward<F>(f))});
+#endif
+  }
+
+  // Errors: ec::empty if sub is empty or already unsubscribed.
+  [[nodiscard]] std::expected<void, ec> try_unsubscribe(subscription sub) noexcept {
+    if (!sub.node_ || !valid()) return std::unexpected(ec::empty);
+    shard& s = shards_[sub.shard_];
+
+    sub_node* x = sub.node_;
+    {
+      std::lock_guard lock(s.edit_mutex);
+      if (x->generation != sub.generation_ || !x->subscribed) return std::unexpected(ec::empty);
+      x->subscribed = false;
+      ++x->generation;
+      mark_edited(s, x);
+    }
+    settle(s);
+    return {};
+  }
+
+  // Publishes one event of type T constructed from args.
+  // Errors: ec::alloc_failed if max_blocks are in flight (or allocation
+  //         fails); whatever any_with_allocator::try_emplace reports otherwise.
+  template <class T, class... Args>
+  [[nodiscard]] std::expected<void, ec> try_publish(topic_type topic, Args&&... args) noexcept {
+    if (!valid()) return std::unexpected(ec::alloc_failed);
+    auto b = take_block();
+    if (!b) return std::unexpected(b.error());
+    record& rec = (*b)->records()[0];
+    auto r = rec.event.template try_emplace<T>(std::forward<Args>(args)...);
+    if (!r) {
+      give_block(*b);
+      return std::unexpected(r.error());
+    }
+    rec.topic = topic;
+    (*b)->count = 1;
+    enqueue(shard_of(topic), *b);
+    return {};
+  }
+
+  // Dispatches on the calling thread whatever is queued in shards no one else
+  // is draining. Returns the number of events delivered. Meant for
+  // config::manual, harmless otherwise.
+  std::size_t poll() noexcept {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < shard_count_; ++i) n += serve(shards_[i], max_blocks_);
+    return n;
+  }
+
+  // Returns once every event published before the call has been delivered.
+  // Each shard is waited for up to its own enqueue count: a shard delivers in
+  // enqueue order, so reaching that count means everything before it is
+  // through, however busy the other shards are. In manual mode it polls.
+  void wait_idle() noexcept {
+    if (!valid()) return;
+    if (running_ == 0) {
+      for (std::size_t i = 0; i < shard_count_; ++i) {
+        shard& s = shards_[i];
+        const std::uint64_t target = s.enqueued.load(std::memory_order_seq_cst);
+        while (s.delivered.load(std::memory_order_acquire) < target) {
+          if (poll() == 0) std::this_thread::yield();
+        }
+      }
+      return;
+    }
+    idle_waiters_.fetch_add(1, std::memory_order_seq_cst);
+    for (std::size_t i = 0; i < shard_count_; ++i) {
+      shard& s = shards_[i];
+      const std::uint64_t target = s.enqueued.load(std::memory_order_seq_cst);
+      for (;;) {
+        const std::uint64_t d = s.delivered.load(std::memory_order_seq_cst);
+        if (d >= target) break;
+        s.delivered.wait(d, std::memory_order_seq_cst);
+      }
+    }
+    idle_waiters_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape
+  // --------------------------------------------------------------------------
+
+  // Empty subscription on failure.
+  template <class F>
+  [[nodiscard]] subscription subscribe(topic_type topic, F&& f) noexcept {
+    auto r = try_subscribe(topic, std::forward<F>(f));
+    return r ? *r : subscription{};
+  }
+
+  template <class T, class F>
+  [[nodiscard]] subscription subscribe(topic_type topic, F&& f) noexcept {
+    auto r = try_subscribe<T>(topic, std::forward<F>(f));
+    return r ? *r : subscription{};
+  }
+
+  void unsubscribe(subscription sub) noexcept { (void)try_unsubscribe(sub); }
+
+  template <class T, class... Args>
+  [[nodiscard]] bool publish(topic_type topic, Args&&... args) noexcept {
+    return try_publish<T>(topic, std::forward<Args>(args)...).has_value();
+  }
+
+private:
+  // --------------------------------------------------------------------------
+  // Storage
+  // --------------------------------------------------------------------------
+
+  struct record {
+    topic_type topic{0};
+    event_type event;
+
+    explicit record(const allocator_type& a) noexcept : event(a) {}
+  };
+
+  // Header followed by `batch` records, one allocation.
+  struct block {
+    std::atomic<block*> next{nullptr};
+    std::size_t count{0};
+
+    record* records() noexcept {
+      return std::launder(reinterpret_cast<record*>(reinterpret_cast<std::byte*>(this) + offset()));
+    }
+
+    static constexpr std::size_t offset() noexcept {
+      return (sizeof(block) + alignof(record) - 1) & ~(alignof(record) - 1);
+    }
+  };
+
+  struct sub_node {
+    // Owner only.
+    sub_node* next{nullptr};
+    sub_node** prev{nullptr}; // null while not in a bucket
+    sub_node* grave_next{nullptr};
+    topic_type topic{0};
+    subscriber_type fn;
+
+    // Under the shard's edit_mutex.
+    sub_node* edit_next{nullptr};
+    std::uint32_t generation{0};
+    bool subscribed{false}; // what the owner is to make of it
+    bool edited{false};     // on the shard's edit list
+
+    explicit sub_node(const allocator_type& a) noexcept : fn(a) {}
+  };
+
+  struct alignas(64) shard {
+    // Producer end of the MPSC queue.
+    std::atomic<block*> back{nullptr};
+    std::atomic<std::size_t> queued{0};
+    std::atomic<std::uint64_t> enqueued{0}; // events
+
+    // Subscription edits waiting for the owner, and recycled nodes.
+    std::mutex edit_mutex;
+    std::atomic<bool> dirty{false};
+    sub_node* edits{nullptr};
+    sub_node* free_nodes{nullptr};
+
+    // Everything below belongs to whoever holds `owned`.
+    alignas(64) std::atomic<bool> owned{false};
+    std::atomic<std::uint64_t> delivered{0}; // events; written by the owner
+    block* front{nullptr};
+    block stub;
+    sub_node** buckets{nullptr};
+    sub_node* graveyard{nullptr};
+    bool draining{false};
+  };
+
+  template <class T, class F>
+  struct typed {
+    mutable F f;
+
+    void operator()(const event_type& e) const {
+      if (const T* p = e.template get_if<T>()) f(*p);
+    }
+  };
+
+  static_assert(alignof(record) <= alignof(std::max_align_t), "SboAlign above max_align_t is not supported.");
+
+  std::size_t words_per_block() const noexcept {
+    return (block::offset() + batch_ * sizeof(record) + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+  }
+
+  static std::uint64_t mix(topic_type t) noexcept {
+    t ^= t >> 30;
+    t *= 0xbf58476d1ce4e5b9ull;
+    t ^= t >> 27;
+    t *= 0x94d049bb133111ebull;
+    return t ^ (t >> 31);
+  }
+
+  std::size_t shard_of(topic_type t) const noexcept { return static_cast<std::size_t>(mix(t) % shard_count_); }
+  std::size_t bucket_of(topic_type t) const noexcept { return static_cast<std::size_t>(mix(t) >> 32) & bucket_mask_; }
+
+  template <class U>
+  std::expected<U*, ec> allocate_array(std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    if (n > utraits::max_size(ua)) return std::unexpected(ec::alloc_failed);
+    U* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = utraits::allocate(ua, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = utraits::allocate(ua, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  template <class U>
+  void deallocate_array(U* p, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    utraits::deallocate(ua, p, n);
+  }
+
+  // --------------------------------------------------------------------------
+  // Block pool
+  // --------------------------------------------------------------------------
+
+  std::expected<block*, ec> take_block() noexcept {
+    {
+      std::lock_guard lock(pool_mutex_);
+      if (block* b = pool_) {
+        pool_ = b->next.load(std::memory_order_relaxed);
+        return b;
+      }
+      if (blocks_ == max_blocks_) return std::unexpected(ec::alloc_failed);
+      ++blocks_;
+    }
+    auto raw = allocate_array<std::max_align_t>(words_per_block());
+    if (!raw) {
+      std::lock_guard lock(pool_mutex_);
+      --blocks_;
+      return std::unexpected(raw.error());
+    }
+    block* b = ::new (static_cast<void*>(*raw)) block{};
+    for (std::size_t i = 0; i < batch_; ++i) std::construct_at(b->records() + i, alloc_);
+    return b;
+  }
+
+  // Drops the block's events and returns it to the pool.
+  void give_block(block* b) noexcept {
+    record* r = b->records();
+    for (std::size_t i = 0; i < b->count; ++i) r[i].event.reset();
+    b->count = 0;
+    std::lock_guard lock(pool_mutex_);
+    b->next.store(pool_, std::memory_order_relaxed);
+    pool_ = b;
+  }
+
+  void free_block(block* b) noexcept {
+    std::destroy_n(b->records(), batch_);
+    std::destroy_at(b);
+    deallocate_array(reinterpret_cast<std::max_align_t*>(b), words_per_block());
+  }
+
+  // --------------------------------------------------------------------------
+  // Shard queues (intrusive Vyukov MPSC; the consumer is the shard's owner)
+  // --------------------------------------------------------------------------
+
+  static void push(shard& s, block* b) noexcept {
+    b->next.store(nullptr, std::memory_order_relaxed);
+    block* prev = s.back.exchange(b, std::memory_order_acq_rel);
+    prev->next.store(b, std::memory_order_release);
+  }
+
+  // Null if empty, or if a push is halfway through (queued says it is coming).
+  static block* pop(shard& s) noexcept {
+    block* front = s.front;
+    block* next = front->next.load(std::memory_order_acquire);
+    if (front == &s.stub) {
+      if (!next) return nullptr;
+      s.front = next;
+      front = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      s.front = next;
+      return front;
+    }
+    if (front != s.back.load(std::memory_order_acquire)) return nullptr;
+    push(s, &s.stub);
+    next = front->next.load(std::memory_order_acquire);
+    if (next) {
+      s.front = next;
+      return front;
+    }
+    return nullptr;
+  }
+
+  void enqueue(std::size_t si, block* b) noexcept {
+    shard& s = shards_[si];
+    s.enqueued.fetch_add(b->count, std::memory_order_seq_cst);
+    push(s, b);
+    s.queued.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+      wake_.fetch_add(1, std::memory_order_seq_cst);
+      wake_.notify_one();
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // Ownership and dispatch
+  // --------------------------------------------------------------------------
+
+  // The shard this thread is draining, if any.
+  static shard*& current() noexcept {
+    static thread_local shard* s = nullptr;
+    return s;
+  }
+
+  static bool try_own(shard& s) noexcept {
+    return !s.owned.load(std::memory_order_relaxed) && !s.owned.exchange(true, std::memory_order_acquire);
+  }
+
+  static void disown(shard& s) noexcept { s.owned.store(false, std::memory_order_release); }
+
+  // Applies s's queued edits if this thread owns s or can take it without
+  // waiting; otherwise the owner applies them before its next block.
+  void settle(shard& s) noexcept {
+    if (current() == &s) {
+      apply_edits(s);
+      return;
+    }
+    if (!try_own(s)) return;
+    shard* outer = std::exchange(current(), &s);
+    apply_edits(s);
+    current() = outer;
+    disown(s);
+  }
+
+  // Drains up to max_blocks blocks from s if no one else is. Returns events delivered.
+  std::size_t serve(shard& s, std::size_t max_blocks) noexcept {
+    if (s.queued.load(std::memory_order_acquire) == 0 || !try_own(s)) return 0;
+    current() = &s;
+
+    std::size_t n = 0;
+    for (std::size_t k = 0; k < max_blocks; ++k) {
+      block* b = pop(s);
+      if (!b) break;
+      s.queued.fetch_sub(1, std::memory_order_relaxed);
+      apply_edits(s);
+      s.draining = true;
+      deliver(s, b);
+      s.draining = false;
+      bury(s);
+      n += b->count;
+      give_block(b);
+    }
+
+    current() = nullptr;
+    if (n) s.delivered.fetch_add(n, std::memory_order_seq_cst);
+    disown(s);
+    if (n && idle_waiters_.load(std::memory_order_seq_cst) > 0) s.delivered.notify_all();
+    return n;
+  }
+
+  void deliver(shard& s, block* b) noexcept {
+    record* r = b->records();
+    for (std::size_t i = 0; i < b->count; ++i) {
+      const topic_type t = r[i].topic;
+      for (sub_node* x = s.buckets[bucket_of(t)]; x; x = x->next) {
+        if (!x->prev || x->topic != t) continue;
+#if defined(__cpp_exceptions)
+        try {
+          x->fn(r[i].event);
+        } catch (...) {
+          failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+#else
+        x->fn(r[i].event);
+#endif
+      }
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // Subscriber nodes (recycled, never freed before the bus)
+  // --------------------------------------------------------------------------
+
+  std::expected<sub_node*, ec> take_node(shard& s) noexcept {
+    {
+      std::lock_guard lock(s.edit_mutex);
+      if (sub_node* x = s.free_nodes) {
+        s.free_nodes = x->next;
+        return x;
+      }
+    }
+    auto p = allocate_array<sub_node>(1);
+    if (!p) return std::unexpected(p.error());
+    return std::construct_at(*p, alloc_);
+  }
+
+  static void give_node(shard& s, sub_node* x) noexcept {
+    std::lock_guard lock(s.edit_mutex);
+    x->next = s.free_nodes;
+    s.free_nodes = x;
+  }
+
+  // Caller holds s.edit_mutex.
+  static void mark_edited(shard& s, sub_node* x) noexcept {
+    if (!x->edited) {
+      x->edited = true;
+      x->edit_next = s.edits;
+      s.edits = x;
+    }
+    s.dirty.store(true, std::memory_order_release);
+  }
+
+  // Owner only. Links and unlinks nodes as their last edit says. Dropped
+  // subscribers are destroyed outside the lock: their destructors may call
+  // back into the bus.
+  void apply_edits(shard& s) noexcept {
+    if (!s.dirty.load(std::memory_order_acquire)) return;
+    sub_node* dropped = nullptr;
+    {
+      std::lock_guard lock(s.edit_mutex);
+      s.dirty.store(false, std::memory_order_relaxed);
+      sub_node* x = std::exchange(s.edits, nullptr);
+      while (x) {
+        sub_node* next = x->edit_next;
+        x->edited = false;
+        if (x->subscribed) {
+          if (!x->prev) link(s.buckets[bucket_of(x->topic)], x);
+        } else {
+          if (x->prev) unlink(x);
+          x->grave_next = dropped;
+          dropped = x;
+        }
+        x = next;
+      }
+    }
+    while (sub_node* x = dropped) {
+      dropped = x->grave_next;
+      if (s.draining) {
+        // The node may be mid-call or mid-walk; keep it intact until the block ends.
+        x->grave_next = s.graveyard;
+        s.graveyard = x;
+      } else {
+        retire(s, x);
+      }
+    }
+  }
+
+  static void link(sub_node*& head, sub_node* x) noexcept {
+    x->next = head;
+    if (head) head->prev = &x->next;
+    x->prev = &head;
+    head = x;
+  }
+
+  // Leaves x->next alone so a walk standing on x can continue.
+  static void unlink(sub_node* x) noexcept {
+    *x->prev = x->next;
+    if (x->next) x->next->prev = x->prev;
+    x->prev = nullptr;
+  }
+
+  static void retire(shard& s, sub_node* x) noexcept {
+    x->fn.reset();
+    give_node(s, x);
+  }
+
+  static void bury(shard& s) noexcept {
+    while (sub_node* x = s.graveyard) {
+      s.graveyard = x->grave_next;
+      retire(s, x);
+    }
+  }
+
+  void free_nodes(sub_node* x) noexcept {
+    while (x) {
+      sub_node* next = x->next;
+      std::destroy_at(x);
+      deallocate_array(x, 1);
+      x = next;
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // Lifetime
+  // --------------------------------------------------------------------------
+
+  bool init(const config& cfg) noexcept {
+    std::size_t d = cfg.dispatchers ? cfg.dispatchers : std::thread::hardware_concurrency();
+    d = std::max<std::size_t>(d, 1);
+    const std::size_t shards = cfg.shards ? cfg.shards : d;
+    batch_ = std::max<std::size_t>(cfg.batch, 1);
+    max_blocks_ = std::max<std::size_t>(cfg.max_blocks, 1);
+    bucket_mask_ = std::bit_ceil(std::max<std::size_t>(cfg.topic_buckets, 1)) - 1;
+
+    auto s = allocate_array<shard>(shards);
+    if (!s) return false;
+    for (std::size_t i = 0; i < shards; ++i) {
+      shard* sh = std::construct_at(*s + i);
+      sh->back.store(&sh->stub, std::memory_order_relaxed);
+      sh->front = &sh->stub;
+    }
+    shards_ = *s;
+    shard_count_ = shards;
+
+    for (std::size_t i = 0; i < shards; ++i) {
+      auto b = allocate_array<sub_node*>(bucket_mask_ + 1);
+      if (!b) return false;
+      std::uninitialized_value_construct_n(*b, bucket_mask_ + 1);
+      shards_[i].buckets = *b;
+    }
+
+    if (cfg.manual) return true;
+
+    auto t = allocate_array<std::thread>(d);
+    if (!t) return false;
+    threads_ = *t;
+    thread_count_ = d;
+    std::uninitialized_default_construct_n(threads_, d);
+    for (std::size_t i = 0; i < d; ++i) {
+#if defined(__cpp_exceptions)
+      try {
+        threads_[i] = std::thread([this, i] { run(i); });
+      } catch (...) {
+        return false;
+      }
+#else
+      threads_[i] = std::thread([this, i] { run(i); });
+#endif
+      ++running_;
+    }
+    return true;
+  }
+
+  void teardown() noexcept {
+    stop_.store(true, std::memory_order_seq_cst);
+    wake_.fetch_add(1, std::memory_order_seq_cst);
+    wake_.notify_all();
+    for (std::size_t i = 0; i < running_; ++i) threads_[i].join();
+    running_ = 0;
+    if (threads_) {
+      std::destroy_n(threads_, thread_count_);
+      deallocate_array(threads_, thread_count_);
+      threads_ = nullptr;
+    }
+
+    if (!shards_) return;
+    while (poll() != 0) {}
+
+    for (std::size_t i = 0; i < shard_count_; ++i) {
+      shard& s = shards_[i];
+      if (s.buckets) {
+        apply_edits(s);
+        for (std::size_t k = 0; k <= bucket_mask_; ++k) free_nodes(s.buckets[k]);
+        deallocate_array(s.buckets, bucket_mask_ + 1);
+      }
+      free_nodes(s.free_nodes);
+      std::destroy_at(&s);
+    }
+    deallocate_array(shards_, shard_count_);
+    shards_ = nullptr;
+
+    while (block* b = pool_) {
+      pool_ = b->next.load(std::memory_order_relaxed);
+      free_block(b);
+    }
+  }
+
+  bool has_work() const noexcept {
+    for (std::size_t i = 0; i < shard_count_; ++i) {
+      if (shards_[i].queued.load(std::memory_order_seq_cst) > 0) return true;
+    }
+    return false;
+  }
+
+  // Home shards first (i, i + dispatchers, ...), then any other shard.
+  bool run_turn(std::size_t self) noexcept {
+    for (std::size_t k = self; k < shard_count_; k += thread_count_) {
+      if (serve(shards_[k], turn_blocks)) return true;
+    }
+    for (std::size_t k = 0; k < shard_count_; ++k) {
+      const std::size_t v = (self + k) % shard_count_;
+      if (serve(shards_[v], turn_blocks)) return true;
+    }
+    return false;
+  }
+
+  void run(std::size_t self) noexcept {
+    for (;;) {
+      if (run_turn(self)) continue;
+      if (stop_.load(std::memory_order_acquire) && !has_work()) break;
+      idle();
+    }
+  }
+
+  void idle() noexcept {
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    const std::uint32_t e = wake_.load(std::memory_order_seq_cst);
+    if (!stop_.load(std::memory_order_seq_cst) && !has_work()) wake_.wait(e, std::memory_order_seq_cst);
+    sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  // Blocks a dispatcher drains from one shard before looking elsewhere.
+  static constexpr std::size_t turn_blocks = 4;
+
+  [[no_unique_address]] allocator_type alloc_{};
+  shard* shards_{nullptr};
+  std::size_t shard_count_{0};
+  std::size_t bucket_mask_{0};
+  std::size_t batch_{1};
+  std::size_t max_blocks_{1};
+
+  std::thread* threads_{nullptr};
+  std::size_t thread_count_{0};
+  std::size_t running_{0};
+
+  std::mutex pool_mutex_;
+  block* pool_{nullptr};
+  std::size_t blocks_{0};
+
+  alignas(64) std::atomic<std::uint32_t> idle_waiters_{0};
+  std::atomic<std::uint64_t> failures_{0};
+  alignas(64) std::atomic<std::uint32_t> wake_{0};
+  std::atomic<std::uint32_t> sleepers_{0};
+  std::atomic<bool> stop_{false};
+};
+
+// Batches events per shard for one producer thread. Events reach the bus when
+// a shard's block fills, on try_flush(), and on destruction.
+template <class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+class event_bus<AllocFamily, SboBytes, SboAlign>::publisher {
+public:
+  explicit publisher(event_bus& bus) noexcept : bus_(bus) {
+    if (!bus_.valid()) return;
+    auto p = bus_.template allocate_array<block*>(bus_.shard_count_);
+    if (!p) return;
+    open_ = *p;
+    std::uninitialized_value_construct_n(open_, bus_.shard_count_);
+  }
+
+  ~publisher() noexcept {
+    if (!open_) return;
+    (void)try_flush();
+    bus_.deallocate_array(open_, bus_.shard_count_);
+  }
+
+  publisher(const publisher&) = delete;
+  publisher& operator=(const publisher&) = delete;
+
+  // False if the per-shard table could not be allocated.
+  [[nodiscard]] bool valid() const noexcept { return open_ != nullptr; }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Adds one event of type T to topic's shard batch.
+  // Errors: as event_bus::try_publish.
+  template <class T, class... Args>
+  [[nodiscard]] std::expected<void, ec> try_publish(topic_type topic, Args&&... args) noexcept {
+    if (!open_) return std::unexpected(ec::alloc_failed);
+    const std::size_t si = bus_.shard_of(topic);
+    block*& b = open_[si];
+    if (!b) {
+      auto nb = bus_.take_block();
+      if (!nb) return std::unexpected(nb.error());
+      b = *nb;
+    }
+
+    record& rec = b->records()[b->count];
+    auto r = rec.event.template try_emplace<T>(std::forward<Args>(args)...);
+    if (!r) return std::unexpected(r.error());
+    rec.topic = topic;
+    if (++b->count == bus_.batch_) {
+      bus_.enqueue(si, b);
+      b = nullptr;
+    }
+    return {};
+  }
+
+  // Enqueues every partly filled batch.
+  std::expected<void, ec> try_flush() noexcept {
+    if (!open_) return std::unexpected(ec::alloc_failed);
+    for (std::size_t i = 0; i < bus_.shard_count_; ++i) {
+      block*& b = open_[i];
+      if (!b) continue;
+      if (b->count) bus_.enqueue(i, b);
+      else bus_.give_block(b);
+      b = nullptr;
+    }
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  template <class T, class... Args>
+  [[nodiscard]] bool publish(topic_type topic, Args&&... args) noexcept {
+    return try_publish<T>(topic, std::forward<Args>(args)...).has_value();
+  }
+
+  void flush() noexcept { (void)try_flush(); }
+
+private:
+  event_bus& bus_;
+  block** open_{nullptr};
+};
+
+} // namespace ndof
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+
+namespace ndof::detail {
+
+  struct null_mutex {
+    void lock() noexcept {}
+    void unlock() noexcept {}
+  };
+
+  // std::atomic<T> or a plain T behind the same interface, so one code path
+  // serves both the concurrent and the single-threaded mode of a component.
+  template <class T, bool Atomic>
+  class maybe_atomic {
+  public:
+    constexpr maybe_atomic(T v = T{}) noexcept : v_(v) {}
+    T load(std::memory_order = std::memory_order_seq_cst) const noexcept { return v_; }
+    void store(T v, std::memory_order = std::memory_order_seq_cst) noexcept { v_ = v; }
+    T fetch_add(T d, std::memory_order = std::memory_order_seq_cst) noexcept { T old = v_; v_ += d; return old; }
+    T fetch_sub(T d, std::memory_order = std::memory_order_seq_cst) noexcept { T old = v_; v_ -= d; return old; }
+
+  private:
+    T v_;
+  };
+
+  template <class T>
+  class maybe_atomic<T, true> {
+  public:
+    constexpr maybe_atomic(T v = T{}) noexcept : v_(v) {}
+    T load(std::memory_order o = std::memory_order_seq_cst) const noexcept { return v_.load(o); }
+    void store(T v, std::memory_order o = std::memory_order_seq_cst) noexcept { v_.store(v, o); }
+    T fetch_add(T d, std::memory_order o = std::memory_order_seq_cst) noexcept { return v_.fetch_add(d, o); }
+    T fetch_sub(T d, std::memory_order o = std::memory_order_seq_cst) noexcept { return v_.fetch_sub(d, o); }
+
+  private:
+    std::atomic<T> v_;
+  };
+
+} // namespace ndof::detail
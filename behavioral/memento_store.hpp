@@ -0,0 +1,711 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define NDOF_MEMENTO_MPROTECT 1
+#else
+#define NDOF_MEMENTO_MPROTECT 0
+#endif
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+
+enum class memento_tracking {
+  write_barrier, // writers call paged_arena::touch() / write() before modifying
+  mprotect       // clean pages are write-protected; the first write to a page
+                 // faults once and marks it dirty (POSIX only)
+};
+
+namespace detail {
+
+#if NDOF_MEMENTO_MPROTECT
+
+  // What the fault handler needs to know about one write-protected arena.
+  struct tracked_region {
+    std::byte* base{nullptr};
+    std::size_t bytes{0};
+    unsigned page_shift{0};
+    std::atomic<std::uint64_t>* dirty{nullptr};
+  };
+
+  struct region_registry {
+    static constexpr std::size_t slots = 64;
+
+    std::atomic<tracked_region*> regions[slots]{};
+    struct sigaction previous_segv{};
+    struct sigaction previous_bus{};
+    std::once_flag installed;
+    bool ok{false};
+  };
+
+  inline region_registry& region_registry_instance() noexcept {
+    static region_registry r;
+    return r;
+  }
+
+  // Marks the faulting page dirty and unprotects it; the write then retries.
+  // Faults outside every arena go to the previously installed handler.
+  inline void memento_fault(int sig, siginfo_t* info, void* uctx) {
+    auto* addr = static_cast<std::byte*>(info->si_addr);
+    region_registry& reg = region_registry_instance();
+    for (auto& slot : reg.regions) {
+      tracked_region* r = slot.load(std::memory_order_acquire);
+      if (!r || addr < r->base || addr >= r->base + r->bytes) continue;
+      const std::size_t page = static_cast<std::size_t>(addr - r->base) >> r->page_shift;
+      r->dirty[page / 64].fetch_or(std::uint64_t{1} << (page % 64), std::memory_order_relaxed);
+      ::mprotect(r->base + (page << r->page_shift), std::size_t{1} << r->page_shift, PROT_READ | PROT_WRITE);
+      return;
+    }
+
+    const struct sigaction& prev = sig == SIGSEGV ? reg.previous_segv : reg.previous_bus;
+    if ((prev.sa_flags & SA_SIGINFO) && prev.sa_sigaction) {
+      prev.sa_sigaction(sig, info, uctx);
+    } else if (prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) {
+      prev.sa_handler(sig);
+    } else {
+      ::signal(sig, SIG_DFL); // the access faults again and terminates as usual
+    }
+  }
+
+  // Installs the handler on first use. False if it could not be installed or
+  // every slot is taken.
+  inline bool register_region(tracked_region* r) noexcept {
+    region_registry& reg = region_registry_instance();
+    std::call_once(reg.installed, [&reg] {
+      struct sigaction sa{};
+      sa.sa_sigaction = &memento_fault;
+      sa.sa_flags = SA_SIGINFO | SA_RESTART;
+      sigemptyset(&sa.sa_mask);
+      reg.ok = ::sigaction(SIGSEGV, &sa, &reg.previous_segv) == 0
+            && ::sigaction(SIGBUS, &sa, &reg.previous_bus) == 0;
+    });
+    if (!reg.ok) return false;
+    for (auto& slot : reg.regions) {
+      tracked_region* expected = nullptr;
+      if (slot.compare_exchange_strong(expected, r, std::memory_order_acq_rel)) return true;
+    }
+    return false;
+  }
+
+  inline void unregister_region(tracked_region* r) noexcept {
+    for (auto& slot : region_registry_instance().regions) {
+      tracked_region* expected = r;
+      if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) return;
+    }
+  }
+
+#endif // NDOF_MEMENTO_MPROTECT
+
+} // namespace detail
+
+template <class AllocFamily>
+class memento_store;
+
+// Bump arena over one contiguous region split into fixed-size pages, with a
+// dirty bit per page. State that memento_store snapshots lives here, through
+// arena_allocator. Memory is reclaimed only by memento_store::try_restore()
+// rolling the bump pointer back.
+//
+//   write_barrier  The region comes from AllocFamily. Code that modifies state
+//                  in place calls touch(p, n) or write(obj) first; memory handed
+//                  out by try_allocate() is marked dirty automatically.
+//   mprotect       The region is mmap'ed with the system page size. After a
+//                  snapshot, clean pages are read-only and a SIGSEGV/SIGBUS
+//                  handler marks a page dirty on its first write. No barriers
+//                  needed. Up to 64 such arenas per process.
+//
+// Not thread-safe: one writer at a time. Contract: the allocator must outlive
+// the arena; nothing allocated from the arena may be used after it is gone.
+template <class AllocFamily = std::allocator<std::byte>>
+class paged_arena {
+public:
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  struct config {
+    std::size_t capacity_bytes = std::size_t{64} << 20;
+    std::size_t page_size      = 4096; // power of two; raised to the system page size for mprotect
+    memento_tracking tracking  = memento_tracking::write_barrier;
+  };
+
+  explicit paged_arena(const config& cfg = config{}, const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a), mode_(cfg.tracking) {
+    if (!init(cfg)) teardown();
+  }
+
+  ~paged_arena() noexcept { teardown(); }
+
+  paged_arena(const paged_arena&) = delete;
+  paged_arena& operator=(const paged_arena&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // False if the region or the dirty bitmap could not be set up (or mprotect
+  // tracking is unavailable); every allocation then fails.
+  [[nodiscard]] bool valid() const noexcept { return base_ != nullptr; }
+
+  [[nodiscard]] memento_tracking tracking() const noexcept { return mode_; }
+  [[nodiscard]] std::size_t page_size() const noexcept { return std::size_t{1} << page_shift_; }
+  [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+  [[nodiscard]] std::size_t used_bytes() const noexcept { return top_; }
+  [[nodiscard]] std::size_t used_pages() const noexcept { return (top_ + page_size() - 1) >> page_shift_; }
+
+  [[nodiscard]] bool contains(const void* p) const noexcept {
+    auto* b = static_cast<const std::byte*>(p);
+    return base_ && b >= base_ && b < base_ + capacity_;
+  }
+
+  [[nodiscard]] bool dirty(std::size_t page) const noexcept {
+    return dirty_[page / 64].load(std::memory_order_relaxed) & (std::uint64_t{1} << (page % 64));
+  }
+
+  // Write barrier: marks every page overlapping [p, p + n) dirty. Cheap when
+  // already dirty. Harmless (and unnecessary) in mprotect mode.
+  void touch(const void* p, std::size_t n) noexcept {
+    if (n == 0 || !contains(p)) return;
+    const auto off = static_cast<std::size_t>(static_cast<const std::byte*>(p) - base_);
+    const std::size_t last = std::min(off + n, capacity_) - 1;
+    for (std::size_t page = off >> page_shift_; page <= (last >> page_shift_); ++page) mark(page);
+  }
+
+  // touch(&obj, sizeof(T)), returning obj for the write: arena.write(x).count = 3.
+  template <class T>
+  T& write(T& obj) noexcept {
+    touch(std::addressof(obj), sizeof(T));
+    return obj;
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::alloc_failed if the region is exhausted (or invalid).
+  [[nodiscard]] std::expected<void*, ec> try_allocate(std::size_t bytes, std::size_t align) noexcept {
+    if (!base_) return std::unexpected(ec::alloc_failed);
+    const std::size_t at = (top_ + align - 1) & ~(align - 1);
+    if (at < top_ || at > capacity_ || bytes > capacity_ - at) return std::unexpected(ec::alloc_failed);
+    top_ = at + bytes;
+    touch(base_ + at, bytes);
+    return static_cast<void*>(base_ + at);
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns nullptr on failure
+  // --------------------------------------------------------------------------
+
+  [[nodiscard]] void* allocate(std::size_t bytes, std::size_t align) noexcept {
+    auto r = try_allocate(bytes, align);
+    return r ? *r : nullptr;
+  }
+
+private:
+  template <class>
+  friend class memento_store;
+
+  std::byte* page_ptr(std::size_t page) const noexcept { return base_ + (page << page_shift_); }
+
+  void mark(std::size_t page) noexcept {
+    const std::uint64_t bit = std::uint64_t{1} << (page % 64);
+    const std::uint64_t old = dirty_[page / 64].fetch_or(bit, std::memory_order_relaxed);
+#if NDOF_MEMENTO_MPROTECT
+    if (!(old & bit) && mode_ == memento_tracking::mprotect) set_writable(page, page + 1, true);
+#else
+    (void)old;
+#endif
+  }
+
+  void clear(std::size_t page) noexcept {
+    dirty_[page / 64].fetch_and(~(std::uint64_t{1} << (page % 64)), std::memory_order_relaxed);
+  }
+
+  // Pages [first, last) become read-only (clean) or writable. No-op for barriers.
+  void set_writable(std::size_t first, std::size_t last, bool writable) noexcept {
+#if NDOF_MEMENTO_MPROTECT
+    if (mode_ != memento_tracking::mprotect || first >= last) return;
+    ::mprotect(page_ptr(first), (last - first) << page_shift_, writable ? PROT_READ | PROT_WRITE : PROT_READ);
+#else
+    (void)first;
+    (void)last;
+    (void)writable;
+#endif
+  }
+
+  template <class U>
+  std::expected<U*, ec> allocate_array(std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    if (n > utraits::max_size(ua)) return std::unexpected(ec::alloc_failed);
+    U* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = utraits::allocate(ua, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = utraits::allocate(ua, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  template <class U>
+  void deallocate_array(U* p, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    utraits::deallocate(ua, p, n);
+  }
+
+  bool init(const config& cfg) noexcept {
+    std::size_t page = std::bit_ceil(std::max<std::size_t>(cfg.page_size, 64));
+#if NDOF_MEMENTO_MPROTECT
+    if (mode_ == memento_tracking::mprotect) {
+      page = std::max(page, static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)));
+    }
+#else
+    if (mode_ == memento_tracking::mprotect) return false;
+#endif
+    page_shift_ = static_cast<unsigned>(std::countr_zero(page));
+    if (cfg.capacity_bytes > std::numeric_limits<std::size_t>::max() - page) return false;
+    capacity_ = (std::max<std::size_t>(cfg.capacity_bytes, 1) + page - 1) & ~(page - 1);
+    pages_ = capacity_ >> page_shift_;
+
+    words_ = (pages_ + 63) / 64;
+    auto d = allocate_array<std::atomic<std::uint64_t>>(words_);
+    if (!d) return false;
+    dirty_ = *d;
+    for (std::size_t i = 0; i < words_; ++i) std::construct_at(dirty_ + i, 0);
+
+#if NDOF_MEMENTO_MPROTECT
+    if (mode_ == memento_tracking::mprotect) {
+      void* p = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) return false;
+      base_ = static_cast<std::byte*>(p);
+      region_ = {base_, capacity_, page_shift_, dirty_};
+      if (!detail::register_region(&region_)) return false;
+      registered_ = true;
+      return true;
+    }
+#endif
+    // Over-allocate by one page and align by hand: the region must be page aligned.
+    auto raw = allocate_array<std::byte>(capacity_ + page);
+    if (!raw) return false;
+    raw_ = *raw;
+    const auto addr = reinterpret_cast<std::uintptr_t>(raw_);
+    base_ = raw_ + (((addr + page - 1) & ~(std::uintptr_t{page} - 1)) - addr);
+    return true;
+  }
+
+  void teardown() noexcept {
+#if NDOF_MEMENTO_MPROTECT
+    if (registered_) detail::unregister_region(&region_);
+    registered_ = false;
+    if (mode_ == memento_tracking::mprotect && base_) ::munmap(base_, capacity_);
+#endif
+    if (raw_) deallocate_array(raw_, capacity_ + page_size());
+    raw_ = nullptr;
+    base_ = nullptr;
+    if (dirty_) {
+      std::destroy_n(dirty_, words_);
+      deallocate_array(dirty_, words_);
+      dirty_ = nullptr;
+    }
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  memento_tracking mode_{memento_tracking::write_barrier};
+  std::byte* raw_{nullptr};
+  std::byte* base_{nullptr};
+  std::size_t capacity_{0};
+  std::size_t pages_{0};
+  unsigned page_shift_{12};
+  std::size_t top_{0};
+  std::atomic<std::uint64_t>* dirty_{nullptr};
+  std::size_t words_{0};
+#if NDOF_MEMENTO_MPROTECT
+  detail::tracked_region region_{};
+  bool registered_{false};
+#endif
+};
+
+// Standard allocator over a paged_arena, for putting snapshotted state in it:
+// std::vector<int, arena_allocator<int>> v(arena_allocator<int>(arena)).
+// deallocate() is a no-op; allocate() throws std::bad_alloc when the arena is
+// exhausted (returns nullptr without exceptions).
+template <class T, class AllocFamily = std::allocator<std::byte>>
+class arena_allocator {
+public:
+  using value_type = T;
+
+  explicit arena_allocator(paged_arena<AllocFamily>& arena) noexcept : arena_(&arena) {}
+
+  template <class U>
+  arena_allocator(const arena_allocator<U, AllocFamily>& other) noexcept : arena_(other.arena()) {}
+
+  [[nodiscard]] T* allocate(std::size_t n) {
+    auto r = n <= std::numeric_limits<std::size_t>::max() / sizeof(T)
+           ? arena_->try_allocate(n * sizeof(T), alignof(T))
+           : std::expected<void*, ec>(std::unexpected(ec::alloc_failed));
+    if (!r) {
+#if defined(__cpp_exceptions)
+      throw std::bad_alloc();
+#else
+      return nullptr;
+#endif
+    }
+    return static_cast<T*>(*r);
+  }
+
+  void deallocate(T*, std::size_t) noexcept {}
+
+  [[nodiscard]] paged_arena<AllocFamily>* arena() const noexcept { return arena_; }
+
+  template <class U>
+  friend bool operator==(const arena_allocator& a, const arena_allocator<U, AllocFamily>& b) noexcept {
+    return a.arena_ == b.arena();
+  }
+
+private:
+  paged_arena<AllocFamily>* arena_;
+};
+
+// Memento pattern over a paged_arena: incremental, page-granular snapshots.
+//
+//   snapshot   The first snapshot copies every used page. Later ones copy only
+//              the pages dirtied since the previous snapshot (or restore), then
+//              mark them clean. Each copy is a version of its page, kept
+//              newest-first in a per-page list from the store's allocator.
+//   restore    try_restore(id) rewrites only the pages that can differ between
+//              the arena and snapshot id: the dirty pages plus those captured
+//              by the snapshots between the current one and id. Each gets its
+//              newest version no later than id (zeros if it had none). The bump
+//              pointer comes back too, so undo and redo are both O(changed
+//              pages).
+//   branching  Taking a snapshot after restoring to an older one discards the
+//              snapshots after it, like an undo history.
+//
+// One store per arena. The state must live entirely inside the arena and must
+// not be in use (no live iterators or references into it) across a restore.
+//
+// Contract: the arena and the allocator must outlive the store.
+template <class AllocFamily = std::allocator<std::byte>>
+class memento_store {
+public:
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+  using arena_type     = paged_arena<AllocFamily>;
+  using snapshot_id    = std::size_t;
+
+  static constexpr snapshot_id npos = std::numeric_limits<snapshot_id>::max();
+
+  explicit memento_store(arena_type& arena, const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a), arena_(arena) {}
+
+  ~memento_store() noexcept {
+    discard_from(0);
+    if (snaps_) deallocate_array(snaps_, snap_capacity_);
+    if (heads_) deallocate_array(heads_, arena_.pages_);
+  }
+
+  memento_store(const memento_store&) = delete;
+  memento_store& operator=(const memento_store&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  [[nodiscard]] std::size_t snapshot_count() const noexcept { return snap_count_; }
+
+  // The snapshot the arena was last captured as or restored to (npos if none).
+  [[nodiscard]] snapshot_id current() const noexcept { return snap_count_ ? current_ : npos; }
+
+  // Bytes held in page copies.
+  [[nodiscard]] std::size_t memory_bytes() const noexcept { return versions_ * arena_.page_size(); }
+
+  // Pages captured by snapshot id (0 for unknown ids).
+  [[nodiscard]] std::size_t pages_in(snapshot_id id) const noexcept {
+    return id < snap_count_ ? snaps_[id].count : 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::alloc_failed (nothing is captured and the dirty state is kept).
+  [[nodiscard]] std::expected<snapshot_id, ec> try_snapshot() noexcept {
+    if (!arena_.valid()) return std::unexpected(ec::alloc_failed);
+    if (!heads_) {
+      auto h = allocate_array<version*>(arena_.pages_);
+      if (!h) return std::unexpected(h.error());
+      heads_ = *h;
+      std::uninitialized_value_construct_n(heads_, arena_.pages_);
+    }
+    // After a restore to an older snapshot, the new one replaces those after
+    // it. They are discarded only once the capture has succeeded.
+    const snapshot_id id = snap_count_ ? current_ + 1 : 0;
+    if (id == snap_capacity_) {
+      auto g = grow_snaps();
+      if (!g) return std::unexpected(g.error());
+    }
+
+    const std::size_t used = arena_.used_pages();
+    const bool first = snap_count_ == 0;
+    std::size_t n = 0;
+    for_each_dirty(used, first, [&n](std::size_t) { ++n; });
+
+    std::size_t* pages = nullptr;
+    if (n) {
+      auto p = allocate_array<std::size_t>(n);
+      if (!p) return std::unexpected(p.error());
+      pages = *p;
+    }
+
+    // Copies are staged newest-first on their own list and linked into the
+    // page lists at the end.
+    version* staged = nullptr;
+    std::size_t k = 0;
+    bool failed = false;
+    for_each_dirty(used, first, [&](std::size_t page) {
+      if (failed) return;
+      auto v = allocate_version();
+      if (!v) {
+        failed = true;
+        return;
+      }
+      (*v)->id = id;
+      std::memcpy((*v)->bytes(), arena_.page_ptr(page), arena_.page_size());
+      (*v)->next = staged;
+      staged = *v;
+      pages[k++] = page;
+    });
+    if (failed) {
+      while (staged) {
+        version* next = staged->next;
+        free_version(staged);
+        staged = next;
+      }
+      if (pages) deallocate_array(pages, n);
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    discard_from(id);
+    for (std::size_t i = n; i-- > 0;) {
+      version* v = staged;
+      staged = v->next;
+      v->next = heads_[pages[i]];
+      heads_[pages[i]] = v;
+    }
+
+    for (std::size_t i = 0; i < n; ++i) arena_.clear(pages[i]);
+    if (first) {
+      arena_.set_writable(0, used, false);
+    } else {
+      protect_runs(pages, n);
+    }
+
+    snaps_[id] = snapshot_record{arena_.top_, pages, n};
+    ++snap_count_;
+    current_ = id;
+    return id;
+  }
+
+  // Errors: ec::empty if id is not a snapshot.
+  [[nodiscard]] std::expected<void, ec> try_restore(snapshot_id id) noexcept {
+    if (id >= snap_count_) return std::unexpected(ec::empty);
+
+    const std::size_t lo = std::min(id, current_);
+    const std::size_t hi = std::max(id, current_);
+    for_each_dirty(arena_.pages_, false, [&](std::size_t page) { restore_page(page, id); });
+    for (std::size_t s = lo + 1; s <= hi; ++s) {
+      for (std::size_t i = 0; i < snaps_[s].count; ++i) {
+        const std::size_t page = snaps_[s].pages[i];
+        if (!arena_.dirty(page)) {
+          arena_.mark(page); // unprotects it under mprotect tracking
+          restore_page(page, id);
+        }
+      }
+    }
+
+    // Everything rewritten is dirty now; clean it and protect it again.
+    for (std::size_t w = 0; w < arena_.words_; ++w) {
+      std::uint64_t bits = arena_.dirty_[w].exchange(0, std::memory_order_relaxed);
+      while (bits) {
+        const std::size_t page = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+        bits &= bits - 1;
+        arena_.set_writable(page, page + 1, false);
+      }
+    }
+
+    arena_.top_ = snaps_[id].top;
+    current_ = id;
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape
+  // --------------------------------------------------------------------------
+
+  // npos on failure.
+  [[nodiscard]] snapshot_id snapshot() noexcept {
+    auto r = try_snapshot();
+    return r ? *r : npos;
+  }
+
+  bool restore(snapshot_id id) noexcept { return try_restore(id).has_value(); }
+
+private:
+  struct version {
+    version* next;
+    snapshot_id id;
+
+    std::byte* bytes() noexcept { return reinterpret_cast<std::byte*>(this) + offset(); }
+
+    static constexpr std::size_t offset() noexcept {
+      return (sizeof(version) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+  };
+
+  struct snapshot_record {
+    std::size_t top;
+    std::size_t* pages;
+    std::size_t count;
+  };
+
+  std::size_t words_per_version() const noexcept {
+    return (version::offset() + arena_.page_size() + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+  }
+
+  template <class U>
+  std::expected<U*, ec> allocate_array(std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    if (n > utraits::max_size(ua)) return std::unexpected(ec::alloc_failed);
+    U* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = utraits::allocate(ua, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = utraits::allocate(ua, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  template <class U>
+  void deallocate_array(U* p, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    utraits::deallocate(ua, p, n);
+  }
+
+  std::expected<version*, ec> allocate_version() noexcept {
+    auto raw = allocate_array<std::max_align_t>(words_per_version());
+    if (!raw) return std::unexpected(raw.error());
+    ++versions_;
+    return ::new (static_cast<void*>(*raw)) version{nullptr, 0};
+  }
+
+  void pop_version(std::size_t page) noexcept {
+    version* v = heads_[page];
+    heads_[page] = v->next;
+    free_version(v);
+  }
+
+  void free_version(version* v) noexcept {
+    std::destroy_at(v);
+    deallocate_array(reinterpret_cast<std::max_align_t*>(v), words_per_version());
+    --versions_;
+  }
+
+  // Every page below limit that is dirty (or all of them when all is set).
+  template <class F>
+  void for_each_dirty(std::size_t limit, bool all, F&& f) const noexcept {
+    if (all) {
+      for (std::size_t page = 0; page < limit; ++page) f(page);
+      return;
+    }
+    for (std::size_t w = 0; w * 64 < limit; ++w) {
+      std::uint64_t bits = arena_.dirty_[w].load(std::memory_order_relaxed);
+      while (bits) {
+        const std::size_t page = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+        bits &= bits - 1;
+        if (page < limit) f(page);
+      }
+    }
+  }
+
+  // Newest version of page no later than id, or zeros.
+  void restore_page(std::size_t page, snapshot_id id) noexcept {
+    version* v = heads_[page];
+    while (v && v->id > id) v = v->next;
+    if (v) std::memcpy(arena_.page_ptr(page), v->bytes(), arena_.page_size());
+    else std::memset(arena_.page_ptr(page), 0, arena_.page_size());
+  }
+
+  // Write-protects the given (ascending) pages, one call per contiguous run.
+  void protect_runs(const std::size_t* pages, std::size_t n) noexcept {
+    for (std::size_t i = 0; i < n;) {
+      std::size_t j = i + 1;
+      while (j < n && pages[j] == pages[j - 1] + 1) ++j;
+      arena_.set_writable(pages[i], pages[j - 1] + 1, false);
+      i = j;
+    }
+  }
+
+  // Drops snapshots [from, snap_count_) and their page versions. They are the
+  // newest, so their versions sit at the heads of the page lists.
+  void discard_from(std::size_t from) noexcept {
+    for (std::size_t s = snap_count_; s-- > from;) {
+      for (std::size_t i = 0; i < snaps_[s].count; ++i) pop_version(snaps_[s].pages[i]);
+      if (snaps_[s].pages) deallocate_array(snaps_[s].pages, snaps_[s].count);
+    }
+    if (from < snap_count_) snap_count_ = from;
+  }
+
+  std::expected<void, ec> grow_snaps() noexcept {
+    const std::size_t cap = snap_capacity_ ? snap_capacity_ * 2 : 8;
+    auto s = allocate_array<snapshot_record>(cap);
+    if (!s) return std::unexpected(s.error());
+    if (snaps_) {
+      std::memcpy(static_cast<void*>(*s), snaps_, snap_count_ * sizeof(snapshot_record));
+      deallocate_array(snaps_, snap_capacity_);
+    }
+    snaps_ = *s;
+    snap_capacity_ = cap;
+    return {};
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  arena_type& arena_;
+  version** heads_{nullptr};
+  snapshot_record* snaps_{nullptr};
+  std::size_t snap_count_{0};
+  std::size_t snap_capacity_{0};
+  snapshot_id current_{0};
+  std::size_t versions_{0};
+};
+
+} // namespace ndof
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+namespace detail {
+
+  // Stand-in continuation used to tell middleware handlers from plain ones.
+  struct pipeline_probe {
+    std::expected<void, ec> operator()() const noexcept;
+  };
+
+  template <class H, class Request>
+  inline constexpr bool pipeline_middleware_v = std::is_invocable_v<H&, Request&, pipeline_probe&>;
+
+  // Normalizes a plain handler's result to "continue?" or an error.
+  template <class H, class Request>
+  std::expected<bool, ec> pipeline_call(H& h, Request& req) {
+    using result = std::remove_cvref_t<std::invoke_result_t<H&, Request&>>;
+    if constexpr (std::is_void_v<result>) {
+      h(req);
+      return true;
+    } else if constexpr (std::is_same_v<result, bool>) {
+      return h(req);
+    } else if constexpr (std::is_same_v<result, std::expected<void, ec>>) {
+      auto r = h(req);
+      if (!r) return std::unexpected(r.error());
+      return true;
+    } else {
+      static_assert(std::is_same_v<result, std::expected<bool, ec>>,
+                    "Handlers return void, bool, std::expected<void, ec> or std::expected<bool, ec>.");
+      return h(req);
+    }
+  }
+
+} // namespace detail
+
+// Chain of responsibility / middleware pipeline over a Request.
+//
+//   static    Handlers... are stored by value and fused at compile time: stage
+//             I calls stage I + 1 directly, so the whole static chain inlines
+//             into try_run() with no type-erased hop.
+//   dynamic   Runtime plugins appended with try_push_back() run after the
+//             static chain. Each is a function_with_allocator from the
+//             pipeline's allocator (small plugins live inline), stored in
+//             chunks that double in size and never move. Only this tail pays
+//             for an indirect call.
+//
+// A handler is either
+//   plain       h(Request&) returning void or std::expected<void, ec> (go on),
+//               bool or std::expected<bool, ec> (false: stop, successfully);
+//   middleware  h(Request&, next) returning std::expected<void, ec>, where
+//               next() runs the rest of the pipeline and returns its result.
+//               Not calling next short-circuits. Static middleware takes
+//               next as auto&; plugins take it as next_type&.
+// An error from any handler stops the pipeline and is returned by try_run().
+// Exceptions from handlers propagate.
+//
+// try_run() may run concurrently with itself if the handlers allow it, but
+// not with try_push_back() or clear_plugins().
+//
+// Contract: the allocator must outlive the pipeline.
+template <class Request,
+          class AllocFamily,
+          std::size_t SboBytes,
+          std::size_t SboAlign,
+          class... Handlers>
+class basic_pipeline {
+public:
+  using request_type   = Request;
+  using allocator_type = AllocFamily;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  // Continuation handed to dynamic middleware.
+  class next_type {
+  public:
+    std::expected<void, ec> operator()() { return self_.run_dynamic(req_, chunk_, index_); }
+
+  private:
+    friend class basic_pipeline;
+
+    next_type(basic_pipeline& self, Request& req, void* chunk, std::size_t index) noexcept
+        : self_(self), req_(req), chunk_(chunk), index_(index) {}
+
+    basic_pipeline& self_;
+    Request& req_;
+    void* chunk_;
+    std::size_t index_;
+  };
+
+  using plugin_type = function_with_allocator<std::expected<void, ec>(Request&, next_type&),
+                                              allocator_type, SboBytes, SboAlign>;
+
+  static constexpr std::size_t static_size = sizeof...(Handlers);
+
+  explicit basic_pipeline(Handlers... hs)
+      noexcept((std::is_nothrow_move_constructible_v<Handlers> && ...))
+      : handlers_(std::move(hs)...) {}
+
+  basic_pipeline(std::allocator_arg_t, const allocator_type& a, Handlers... hs)
+      noexcept((std::is_nothrow_move_constructible_v<Handlers> && ...))
+      : alloc_(a), handlers_(std::move(hs)...) {}
+
+  ~basic_pipeline() noexcept { clear_plugins(); }
+
+  basic_pipeline(const basic_pipeline&) = delete;
+  basic_pipeline& operator=(const basic_pipeline&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  [[nodiscard]] std::size_t plugin_count() const noexcept { return plugins_; }
+
+  template <std::size_t I>
+  [[nodiscard]] auto& handler() noexcept { return std::get<I>(handlers_); }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Runs the static chain, then the plugins, until one stops or fails.
+  [[nodiscard]] std::expected<void, ec> try_run(Request& req) {
+    return stage<0>(req);
+  }
+
+  // Appends a plugin (plain or middleware, as above).
+  // Errors: ec::alloc_failed, ec::construction_failed, or whatever
+  //         function_with_allocator::try_emplace reports.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec> try_push_back(F&& f) noexcept {
+    using U = std::remove_cvref_t<F>;
+    static_assert(std::is_invocable_v<U&, Request&, next_type&> || std::is_invocable_v<U&, Request&>,
+                  "A plugin takes (Request&) or (Request&, next).");
+
+    if (!tail_ || tail_->used == tail_->capacity) {
+      auto r = grow();
+      if (!r) return r;
+    }
+    plugin_type& slot = tail_->slots()[tail_->used];
+#if defined(__cpp_exceptions)
+    try {
+      auto r = slot.try_emplace(plugin<U>{U(std::forward<F>(f))});
+      if (!r) return std::unexpected(r.error());
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    auto r = slot.try_emplace(plugin<U>{U(std::forward<F>(f))});
+    if (!r) return std::unexpected(r.error());
+#endif
+    ++tail_->used;
+    ++plugins_;
+    return {};
+  }
+
+  // Drops every plugin and releases their storage.
+  void clear_plugins() noexcept {
+    while (chunk* c = head_) {
+      head_ = c->next;
+      release(c);
+    }
+    tail_ = nullptr;
+    plugins_ = 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  bool run(Request& req) { return try_run(req).has_value(); }
+
+  template <class F>
+  [[nodiscard]] bool push_back(F&& f) noexcept {
+    return try_push_back(std::forward<F>(f)).has_value();
+  }
+
+private:
+  static constexpr std::size_t first_chunk = 4;
+
+  template <std::size_t I>
+  std::expected<void, ec> stage(Request& req) {
+    if constexpr (I == sizeof...(Handlers)) {
+      return run_dynamic(req, head_, 0);
+    } else {
+      auto& h = std::get<I>(handlers_);
+      if constexpr (detail::pipeline_middleware_v<std::remove_reference_t<decltype(h)>, Request>) {
+        auto next = [this, &req]() -> std::expected<void, ec> { return stage<I + 1>(req); };
+        return h(req, next);
+      } else {
+        auto r = detail::pipeline_call(h, req);
+        if (!r) return std::unexpected(r.error());
+        if (!*r) return {};
+        return stage<I + 1>(req);
+      }
+    }
+  }
+
+  // Adapts a plain or middleware plugin to plugin_type's signature.
+  template <class F>
+  struct plugin {
+    mutable F f;
+
+    std::expected<void, ec> operator()(Request& req, next_type& next) const {
+      if constexpr (std::is_invocable_v<F&, Request&, next_type&>) {
+        return f(req, next);
+      } else {
+        auto r = detail::pipeline_call(f, req);
+        if (!r) return std::unexpected(r.error());
+        if (!*r) return {};
+        return next();
+      }
+    }
+  };
+
+  struct chunk {
+    chunk* next;
+    std::size_t capacity;
+    std::size_t used;
+
+    plugin_type* slots() noexcept {
+      return std::launder(reinterpret_cast<plugin_type*>(reinterpret_cast<std::byte*>(this) + offset()));
+    }
+
+    static constexpr std::size_t offset() noexcept {
+      return (sizeof(chunk) + alignof(plugin_type) - 1) & ~(alignof(plugin_type) - 1);
+    }
+
+    static constexpr std::size_t bytes_for(std::size_t n) noexcept { return offset() + n * sizeof(plugin_type); }
+  };
+
+  using chunk_alloc_type = typename traits::template rebind_alloc<std::max_align_t>;
+  using chunk_traits     = std::allocator_traits<chunk_alloc_type>;
+
+  static constexpr std::size_t words_for(std::size_t n) noexcept {
+    return (chunk::bytes_for(n) + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+  }
+
+  // Runs plugins from (c, i) onward.
+  std::expected<void, ec> run_dynamic(Request& req, void* at, std::size_t i) {
+    auto* c = static_cast<chunk*>(at);
+    while (c && i == c->used) {
+      c = c->next;
+      i = 0;
+    }
+    if (!c) return {};
+    next_type next(*this, req, c, i + 1);
+    return c->slots()[i](req, next);
+  }
+
+  std::expected<void, ec> grow() noexcept {
+    static_assert(alignof(plugin_type) <= alignof(std::max_align_t));
+    const std::size_t n = tail_ ? tail_->capacity * 2 : first_chunk;
+    chunk_alloc_type ca(alloc_);
+    std::max_align_t* raw = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      raw = chunk_traits::allocate(ca, words_for(n));
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    raw = chunk_traits::allocate(ca, words_for(n));
+    if (!raw) return std::unexpected(ec::alloc_failed);
+#endif
+    chunk* c = ::new (static_cast<void*>(raw)) chunk{nullptr, n, 0};
+    for (std::size_t i = 0; i < n; ++i) std::construct_at(c->slots() + i, std::as_const(alloc_));
+    if (tail_) tail_->next = c;
+    else head_ = c;
+    tail_ = c;
+    return {};
+  }
+
+  void release(chunk* c) noexcept {
+    const std::size_t n = c->capacity;
+    std::destroy_n(c->slots(), n);
+    std::destroy_at(c);
+    chunk_alloc_type ca(alloc_);
+    chunk_traits::deallocate(ca, reinterpret_cast<std::max_align_t*>(c), words_for(n));
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  [[no_unique_address]] std::tuple<Handlers...> handlers_;
+  chunk* head_{nullptr};
+  chunk* tail_{nullptr};
+  std::size_t plugins_{0};
+};
+
+template <class Request, class... Handlers>
+using pipeline = basic_pipeline<Request, std::allocator<std::byte>, 3 * sizeof(void*),
+                                alignof(std::max_align_t), Handlers...>;
+
+// make_pipeline<Request>(h1, h2, ...) deduces the handler types (lambdas).
+template <class Request, class... Hs>
+[[nodiscard]] pipeline<Request, std::decay_t<Hs>...> make_pipeline(Hs&&... hs) {
+  return pipeline<Request, std::decay_t<Hs>...>(std::forward<Hs>(hs)...);
+}
+
+template <class Request, class AllocFamily, class... Hs>
+[[nodiscard]] basic_pipeline<Request, AllocFamily, 3 * sizeof(void*), alignof(std::max_align_t), std::decay_t<Hs>...>
+make_pipeline(std::allocator_arg_t, const AllocFamily& a, Hs&&... hs) {
+  return basic_pipeline<Request, AllocFamily, 3 * sizeof(void*), alignof(std::max_align_t), std::decay_t<Hs>...>(
+      std::allocator_arg, a, std::forward<Hs>(hs)...);
+}
+
+} // namespace ndof
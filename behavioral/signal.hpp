@@ -0,0 +1,439 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "maybe_atomic.hpp"
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+enum class signal_mode {
+  concurrent,     // emit from any thread; connect/disconnect never block an emit
+  single_threaded // no atomics, no mutex; emit, connect and disconnect on one thread
+};
+
+namespace detail {
+
+  // emit() and operator() with the parameter list of Sig, for signal to
+  // derive from (a member cannot name the pack of its class's Sig otherwise).
+  template <class Derived, class Sig>
+  struct signal_emitter;
+
+  template <class Derived, class R, class... Args>
+  struct signal_emitter<Derived, R(Args...)> {
+    void emit(Args... args) { static_cast<Derived&>(*this).template call_slots<Args...>(args...); }
+    void operator()(Args... args) { static_cast<Derived&>(*this).template call_slots<Args...>(args...); }
+  };
+
+  template <class Derived, class R, class... Args>
+  struct signal_emitter<Derived, R(Args...) noexcept> {
+    void emit(Args... args) { static_cast<Derived&>(*this).template call_slots<Args...>(args...); }
+    void operator()(Args... args) { static_cast<Derived&>(*this).template call_slots<Args...>(args...); }
+  };
+
+} // namespace detail
+
+// Observer pattern: an allocator-aware signal whose slots are
+// function_with_allocator<Sig> objects, so small callables live inline.
+//
+//   storage   Slots sit contiguously in chunks from the signal's allocator.
+//             Chunks double in size and never move; a slot's position is
+//             reused only after the slot is reclaimed.
+//   emit      Walks the chunks without taking a lock. In concurrent mode the
+//             only shared writes are one counter increment/decrement per emit.
+//   connect / disconnect
+//             Serialized by a writer mutex that emit never takes. A
+//             disconnected slot is retired, skipped by new emits, and destroyed
+//             once every emit that might still be running it has finished
+//             (a two-epoch grace period, checked without waiting). Reclamation
+//             runs on later connects/disconnects, or explicitly via collect().
+//
+// Slots may connect or disconnect (themselves included) from inside an emit.
+// In signal_mode::single_threaded the same rules hold without atomics.
+//
+// Contract: no emit may be in progress when the signal is destroyed; the
+// allocator must outlive the signal.
+template <class Sig,
+          class AllocFamily = std::allocator<std::byte>,
+          signal_mode Mode = signal_mode::concurrent,
+          std::size_t SboBytes = 3 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class signal : public detail::signal_emitter<signal<Sig, AllocFamily, Mode, SboBytes, SboAlign>, Sig> {
+  static constexpr bool concurrent = Mode == signal_mode::concurrent;
+
+  friend struct detail::signal_emitter<signal, Sig>;
+
+  struct slot;
+
+public:
+  using allocator_type = AllocFamily;
+  using traits         = std::allocator_traits<allocator_type>;
+  using slot_type      = function_with_allocator<Sig, AllocFamily, SboBytes, SboAlign>;
+
+  static constexpr std::size_t default_initial_capacity = 8;
+
+  // Names one connected slot. Stale handles (already disconnected) are
+  // detected, so disconnecting twice is harmless.
+  class connection {
+  public:
+    connection() noexcept = default;
+
+    [[nodiscard]] bool has_value() const noexcept { return slot_ != nullptr; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    friend bool operator==(const connection&, const connection&) noexcept = default;
+
+  private:
+    friend class signal;
+
+    connection(slot* s, std::uint32_t generation) noexcept : slot_(s), generation_(generation) {}
+
+    slot* slot_{nullptr};
+    std::uint32_t generation_{0};
+  };
+
+  explicit signal(const allocator_type& a = allocator_type{},
+                  std::size_t initial_capacity = default_initial_capacity) noexcept
+      : alloc_(a), next_capacity_(initial_capacity ? initial_capacity : 1) {}
+
+  ~signal() noexcept {
+    chunk* c = head_.load(std::memory_order_relaxed);
+    while (c) {
+      chunk* next = c->next.load(std::memory_order_relaxed);
+      release_chunk(c);
+      c = next;
+    }
+  }
+
+  signal(const signal&) = delete;
+  signal& operator=(const signal&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // Connected slots (a snapshot under concurrency).
+  [[nodiscard]] std::size_t size() const noexcept { return live_.load(std::memory_order_relaxed); }
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+  // emit(Args... args), and operator() alike, with Args from Sig = R(Args...):
+  // calls every connected slot with args, in connection order for slots
+  // connected to fresh positions. Each slot gets the same arguments: by-value
+  // parameters are copied per slot, references are passed through (so a
+  // slot may write to an int& out-parameter). A move-only by-value parameter,
+  // or an rvalue reference, is passed as an rvalue to each slot in turn; the
+  // first slot that moves from it leaves the rest a moved-from value.
+  // Slots connected during the emit may or may not be called by it; slots
+  // disconnected during it may still be called by it. Exceptions from a slot
+  // propagate and end the emit.
+  using detail::signal_emitter<signal, Sig>::emit;
+  using detail::signal_emitter<signal, Sig>::operator();
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::alloc_failed, or whatever function_with_allocator::try_emplace reports.
+  template <class F>
+  [[nodiscard]] std::expected<connection, ec> try_connect(F&& f) noexcept {
+    std::scoped_lock lock(mtx_);
+    reclaim();
+
+    auto where = take_slot();
+    if (!where) return std::unexpected(where.error());
+    slot& s = *where->s;
+
+    auto r = s.fn.try_emplace(std::forward<F>(f));
+    if (!r) {
+      // A fresh position was never published; a reclaimed one goes back.
+      if (!where->fresh_in) {
+        s.next = free_;
+        free_ = &s;
+      }
+      return std::unexpected(r.error());
+    }
+
+    s.state.store(state_live, std::memory_order_release);
+    if (chunk* c = where->fresh_in) {
+      c->used.store(c->used.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    live_.store(live_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return connection(&s, s.generation);
+  }
+
+  // Errors: ec::empty if the connection is empty or already disconnected.
+  [[nodiscard]] std::expected<void, ec> try_disconnect(connection con) noexcept {
+    if (!con) return std::unexpected(ec::empty);
+    std::scoped_lock lock(mtx_);
+    slot& s = *con.slot_;
+    if (s.generation != con.generation_ || s.state.load(std::memory_order_relaxed) != state_live) {
+      return std::unexpected(ec::empty);
+    }
+    retire(s);
+    reclaim();
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape
+  // --------------------------------------------------------------------------
+
+  // Empty connection on failure.
+  template <class F>
+  [[nodiscard]] connection connect(F&& f) noexcept {
+    auto r = try_connect(std::forward<F>(f));
+    return r ? *r : connection{};
+  }
+
+  void disconnect(connection con) noexcept { (void)try_disconnect(con); }
+
+  void disconnect_all() noexcept {
+    std::scoped_lock lock(mtx_);
+    for (chunk* c = head_.load(std::memory_order_relaxed); c; c = c->next.load(std::memory_order_relaxed)) {
+      const std::size_t n = c->used.load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < n; ++i) {
+        if (c->slots[i].state.load(std::memory_order_relaxed) == state_live) retire(c->slots[i]);
+      }
+    }
+    reclaim();
+  }
+
+  // Destroys retired slots whose grace period has passed. Never waits.
+  void collect() noexcept {
+    std::scoped_lock lock(mtx_);
+    reclaim();
+  }
+
+private:
+  // An argument as each slot receives it (see emit()).
+  template <class T, class U>
+  static constexpr decltype(auto) pass(U& arg) noexcept {
+    if constexpr (std::is_lvalue_reference_v<T> || std::is_copy_constructible_v<T>) {
+      return static_cast<U&>(arg);
+    } else {
+      return static_cast<U&&>(arg);
+    }
+  }
+
+  template <class... Args>
+  void call_slots(std::type_identity_t<Args>&... args) {
+    read_guard guard(*this);
+    for (chunk* c = head_.load(std::memory_order_acquire); c; c = c->next.load(std::memory_order_acquire)) {
+      const std::size_t n = c->used.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < n; ++i) {
+        const slot& s = c->slots[i];
+        if (s.state.load() == state_live) (void)s.fn(pass<Args>(args)...);
+      }
+    }
+  }
+
+  static constexpr std::uint8_t state_free    = 0;
+  static constexpr std::uint8_t state_live    = 1;
+  static constexpr std::uint8_t state_retired = 2;
+
+  struct slot {
+    detail::maybe_atomic<std::uint8_t, concurrent> state{state_free};
+    std::uint32_t generation{0};
+    slot* next{nullptr};        // free or retired list; writer only
+    std::uint64_t retired_at{0};
+    slot_type fn;
+
+    explicit slot(const allocator_type& a) noexcept : fn(a) {}
+  };
+
+  struct chunk {
+    detail::maybe_atomic<chunk*, concurrent> next{nullptr};
+    detail::maybe_atomic<std::size_t, concurrent> used{0}; // high-water mark of published slots
+    std::size_t capacity{0};
+    slot* slots{nullptr};
+  };
+
+  using chunk_alloc  = typename traits::template rebind_alloc<chunk>;
+  using chunk_traits = std::allocator_traits<chunk_alloc>;
+  using slot_alloc   = typename traits::template rebind_alloc<slot>;
+  using slot_traits  = std::allocator_traits<slot_alloc>;
+  using mutex_type   = std::conditional_t<concurrent, std::mutex, detail::null_mutex>;
+
+  // Concurrent mode: an emit registers in the reader count of the current
+  // epoch's parity. The writer advances the epoch only when the other parity
+  // has drained, so a slot retired at epoch e is unreachable once the epoch
+  // reaches e + 2. Single-threaded mode: just an emit nesting depth.
+  class read_guard {
+  public:
+    explicit read_guard(signal& sig) noexcept : sig_(sig) {
+      if constexpr (concurrent) {
+        for (;;) {
+          const std::uint64_t e = sig_.sync_.epoch.load(std::memory_order_seq_cst);
+          parity_ = static_cast<unsigned>(e & 1);
+          sig_.sync_.readers[parity_].fetch_add(1, std::memory_order_seq_cst);
+          if (sig_.sync_.epoch.load(std::memory_order_seq_cst) == e) break;
+          sig_.sync_.readers[parity_].fetch_sub(1, std::memory_order_release);
+        }
+      } else {
+        ++sig_.sync_.depth;
+      }
+    }
+
+    ~read_guard() noexcept {
+      if constexpr (concurrent) {
+        sig_.sync_.readers[parity_].fetch_sub(1, std::memory_order_release);
+      } else if (--sig_.sync_.depth == 0 && sig_.retired_head_) {
+        sig_.reclaim();
+      }
+    }
+
+    read_guard(const read_guard&) = delete;
+    read_guard& operator=(const read_guard&) = delete;
+
+  private:
+    signal& sig_;
+    unsigned parity_{0};
+  };
+
+  struct position {
+    slot* s;
+    chunk* fresh_in; // chunk whose high-water mark s extends, or null if reclaimed
+  };
+
+  // Requires mtx_. A reclaimed slot if there is one, else the next fresh
+  // position, allocating a new chunk if the last one is full.
+  std::expected<position, ec> take_slot() noexcept {
+    if (slot* s = free_) {
+      free_ = s->next;
+      s->next = nullptr;
+      return position{s, nullptr};
+    }
+    if (tail_ && tail_->used.load(std::memory_order_relaxed) < tail_->capacity) {
+      return position{tail_->slots + tail_->used.load(std::memory_order_relaxed), tail_};
+    }
+
+    chunk_alloc ca(alloc_);
+    slot_alloc sa(alloc_);
+    const std::size_t n = next_capacity_;
+    chunk* c = nullptr;
+    slot* slots = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      c = chunk_traits::allocate(ca, 1);
+      slots = slot_traits::allocate(sa, n);
+    } catch (...) {
+      if (c) chunk_traits::deallocate(ca, c, 1);
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    c = chunk_traits::allocate(ca, 1);
+    if (!c) return std::unexpected(ec::alloc_failed);
+    slots = slot_traits::allocate(sa, n);
+    if (!slots) {
+      chunk_traits::deallocate(ca, c, 1);
+      return std::unexpected(ec::alloc_failed);
+    }
+#endif
+    for (std::size_t i = 0; i < n; ++i) std::construct_at(slots + i, alloc_);
+    std::construct_at(c);
+    c->capacity = n;
+    c->slots = slots;
+
+    // Publish: the chunk is fully built before it becomes reachable.
+    if (tail_) {
+      tail_->next.store(c, std::memory_order_release);
+    } else {
+      head_.store(c, std::memory_order_release);
+    }
+    tail_ = c;
+    next_capacity_ = 2 * n;
+    return position{slots, c};
+  }
+
+  // Requires mtx_.
+  void retire(slot& s) noexcept {
+    s.state.store(state_retired, std::memory_order_seq_cst);
+    if constexpr (concurrent) s.retired_at = sync_.epoch.load(std::memory_order_seq_cst);
+    s.next = nullptr;
+    if (retired_tail_) {
+      retired_tail_->next = &s;
+    } else {
+      retired_head_ = &s;
+    }
+    retired_tail_ = &s;
+    live_.store(live_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+  }
+
+  // Requires mtx_ (or, single-threaded, no emit in progress). Retired slots
+  // are in epoch order, so reclamation stops at the first one still in grace.
+  void reclaim() noexcept {
+    if constexpr (concurrent) {
+      try_advance_epoch();
+      try_advance_epoch();
+    } else {
+      if (sync_.depth != 0) return;
+    }
+
+    while (slot* s = retired_head_) {
+      if constexpr (concurrent) {
+        if (s->retired_at + 2 > sync_.epoch.load(std::memory_order_relaxed)) break;
+      }
+      retired_head_ = s->next;
+      if (!retired_head_) retired_tail_ = nullptr;
+
+      s->fn.reset();
+      ++s->generation;
+      s->state.store(state_free, std::memory_order_relaxed);
+      s->next = free_;
+      free_ = s;
+    }
+  }
+
+  void try_advance_epoch() noexcept {
+    if (!retired_head_) return;
+    const std::uint64_t e = sync_.epoch.load(std::memory_order_relaxed);
+    if (sync_.readers[(e + 1) & 1].load(std::memory_order_seq_cst) == 0) {
+      sync_.epoch.store(e + 1, std::memory_order_seq_cst);
+    }
+  }
+
+  void release_chunk(chunk* c) noexcept {
+    chunk_alloc ca(alloc_);
+    slot_alloc sa(alloc_);
+    std::destroy_n(c->slots, c->capacity);
+    slot_traits::deallocate(sa, c->slots, c->capacity);
+    std::destroy_at(c);
+    chunk_traits::deallocate(ca, c, 1);
+  }
+
+  struct epoch_state {
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<std::size_t> readers[2]{};
+  };
+
+  struct depth_state {
+    std::size_t depth{0};
+  };
+
+  [[no_unique_address]] allocator_type alloc_{};
+
+  // Reader side.
+  detail::maybe_atomic<chunk*, concurrent> head_{nullptr};
+  std::conditional_t<concurrent, epoch_state, depth_state> sync_{};
+
+  // Writer side.
+  [[no_unique_address]] mutex_type mtx_;
+  chunk* tail_{nullptr};
+  slot* free_{nullptr};
+  slot* retired_head_{nullptr};
+  slot* retired_tail_{nullptr};
+  std::size_t next_capacity_{default_initial_capacity};
+  detail::maybe_atomic<std::size_t, concurrent> live_{0};
+};
+
+} // namespace ndof
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "simd_strategy.hpp"
+
+#if NDOF_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace ndof {
+
+// Reference kernels for simd_strategy: sum and dot product over float spans.
+//
+// Each variant is compiled for its instruction set with a per-function target
+// attribute, so the header builds without -mavx2 / -mavx512f and the choice
+// is made at run time. Variants reassociate the additions differently, so
+// results agree to rounding, not bit for bit. dot() reads min(a.size(),
+// b.size()) elements.
+namespace kernels {
+
+  namespace detail {
+
+    inline float sum_scalar(std::span<const float> x) noexcept {
+      float acc[4] = {0.f, 0.f, 0.f, 0.f};
+      std::size_t i = 0;
+      for (; i + 4 <= x.size(); i += 4) {
+        acc[0] += x[i];
+        acc[1] += x[i + 1];
+        acc[2] += x[i + 2];
+        acc[3] += x[i + 3];
+      }
+      for (; i < x.size(); ++i) acc[0] += x[i];
+      return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+
+    inline float dot_scalar(std::span<const float> a, std::span<const float> b) noexcept {
+      const std::size_t n = a.size() < b.size() ? a.size() : b.size();
+      float acc[4] = {0.f, 0.f, 0.f, 0.f};
+      std::size_t i = 0;
+      for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+      }
+      for (; i < n; ++i) acc[0] += a[i] * b[i];
+      return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+
+#if NDOF_SIMD_X86
+
+    __attribute__((target("sse4.2"))) inline float hsum128(__m128 v) noexcept {
+      __m128 shuf = _mm_movehdup_ps(v);
+      __m128 sums = _mm_add_ps(v, shuf);
+      shuf = _mm_movehl_ps(shuf, sums);
+      return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+    }
+
+    __attribute__((target("avx2,fma"))) inline float hsum256(__m256 v) noexcept {
+      return hsum128(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+    }
+
+    // Through memory: GCC 12's 512-to-256 casts and _mm512_reduce_add_ps trip
+    // -Wuninitialized inside its own headers. Runs once per call.
+    __attribute__((target("avx512f"))) inline float hsum512(__m512 v) noexcept {
+      alignas(64) float lanes[16];
+      _mm512_store_ps(lanes, v);
+      return hsum256(_mm256_add_ps(_mm256_load_ps(lanes), _mm256_load_ps(lanes + 8)));
+    }
+
+    __attribute__((target("sse4.2"))) inline float sum_sse42(std::span<const float> x) noexcept {
+      const float* p = x.data();
+      const std::size_t n = x.size();
+      __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+      std::size_t i = 0;
+      for (; i + 8 <= n; i += 8) {
+        a0 = _mm_add_ps(a0, _mm_loadu_ps(p + i));
+        a1 = _mm_add_ps(a1, _mm_loadu_ps(p + i + 4));
+      }
+      float s = hsum128(_mm_add_ps(a0, a1));
+      for (; i < n; ++i) s += p[i];
+      return s;
+    }
+
+    __attribute__((target("sse4.2"))) inline float dot_sse42(std::span<const float> a,
+                                                              std::span<const float> b) noexcept {
+      const float* pa = a.data();
+      const float* pb = b.data();
+      const std::size_t n = a.size() < b.size() ? a.size() : b.size();
+      __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+      std::size_t i = 0;
+      for (; i + 8 <= n; i += 8) {
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(pa + i), _mm_loadu_ps(pb + i)));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(pa + i + 4), _mm_loadu_ps(pb + i + 4)));
+      }
+      float s = hsum128(_mm_add_ps(a0, a1));
+      for (; i < n; ++i) s += pa[i] * pb[i];
+      return s;
+    }
+
+    __attribute__((target("avx2,fma"))) inline float sum_avx2(std::span<const float> x) noexcept {
+      const float* p = x.data();
+      const std::size_t n = x.size();
+      __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+      __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+      std::size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        a0 = _mm256_add_ps(a0, _mm256_loadu_ps(p + i));
+        a1 = _mm256_add_ps(a1, _mm256_loadu_ps(p + i + 8));
+        a2 = _mm256_add_ps(a2, _mm256_loadu_ps(p + i + 16));
+        a3 = _mm256_add_ps(a3, _mm256_loadu_ps(p + i + 24));
+      }
+      for (; i + 8 <= n; i += 8) a0 = _mm256_add_ps(a0, _mm256_loadu_ps(p + i));
+      float s = hsum256(_mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3)));
+      for (; i < n; ++i) s += p[i];
+      return s;
+    }
+
+    __attribute__((target("avx2,fma"))) inline float dot_avx2(std::span<const float> a,
+                                                               std::span<const float> b) noexcept {
+      const float* pa = a.data();
+      const float* pb = b.data();
+      const std::size_t n = a.size() < b.size() ? a.size() : b.size();
+      __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+      __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+      std::size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(pa + i), _mm256_loadu_ps(pb + i), a0);
+        a1 = _mm256_fmadd_ps(_mm256_loadu_ps(pa + i + 8), _mm256_loadu_ps(pb + i + 8), a1);
+        a2 = _mm256_fmadd_ps(_mm256_loadu_ps(pa + i + 16), _mm256_loadu_ps(pb + i + 16), a2);
+        a3 = _mm256_fmadd_ps(_mm256_loadu_ps(pa + i + 24), _mm256_loadu_ps(pb + i + 24), a3);
+      }
+      for (; i + 8 <= n; i += 8) a0 = _mm256_fmadd_ps(_mm256_loadu_ps(pa + i), _mm256_loadu_ps(pb + i), a0);
+      float s = hsum256(_mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3)));
+      for (; i < n; ++i) s += pa[i] * pb[i];
+      return s;
+    }
+
+    __attribute__((target("avx512f"))) inline float sum_avx512(std::span<const float> x) noexcept {
+      const float* p = x.data();
+      const std::size_t n = x.size();
+      __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+      std::size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        a0 = _mm512_add_ps(a0, _mm512_loadu_ps(p + i));
+        a1 = _mm512_add_ps(a1, _mm512_loadu_ps(p + i + 16));
+      }
+      if (i + 16 <= n) {
+        a0 = _mm512_add_ps(a0, _mm512_loadu_ps(p + i));
+        i += 16;
+      }
+      // Masked load for the tail: no scalar loop.
+      const auto rest = static_cast<unsigned>(n - i);
+      a1 = _mm512_add_ps(a1, _mm512_maskz_loadu_ps(static_cast<__mmask16>((1u << rest) - 1), p + i));
+      return hsum512(_mm512_add_ps(a0, a1));
+    }
+
+    __attribute__((target("avx512f"))) inline float dot_avx512(std::span<const float> a,
+                                                                std::span<const float> b) noexcept {
+      const float* pa = a.data();
+      const float* pb = b.data();
+      const std::size_t n = a.size() < b.size() ? a.size() : b.size();
+      __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+      std::size_t i = 0;
+      for (; i + 32 <= n; i += 32) {
+        a0 = _mm512_fmadd_ps(_mm512_loadu_ps(pa + i), _mm512_loadu_ps(pb + i), a0);
+        a1 = _mm512_fmadd_ps(_mm512_loadu_ps(pa + i + 16), _mm512_loadu_ps(pb + i + 16), a1);
+      }
+      if (i + 16 <= n) {
+        a0 = _mm512_fmadd_ps(_mm512_loadu_ps(pa + i), _mm512_loadu_ps(pb + i), a0);
+        i += 16;
+      }
+      const auto m = static_cast<__mmask16>((1u << static_cast<unsigned>(n - i)) - 1);
+      a1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, pa + i), _mm512_maskz_loadu_ps(m, pb + i), a1);
+      return hsum512(_mm512_add_ps(a0, a1));
+    }
+
+#endif // NDOF_SIMD_X86
+
+  } // namespace detail
+
+  using sum_strategy = simd_strategy<float(std::span<const float>)>;
+  using dot_strategy = simd_strategy<float(std::span<const float>, std::span<const float>)>;
+
+  [[nodiscard]] inline sum_strategy::variants sum_variants() noexcept {
+#if NDOF_SIMD_X86
+    return {.scalar = &detail::sum_scalar,
+            .sse42  = &detail::sum_sse42,
+            .avx2   = &detail::sum_avx2,
+            .avx512 = &detail::sum_avx512};
+#else
+    return {.scalar = &detail::sum_scalar};
+#endif
+  }
+
+  [[nodiscard]] inline dot_strategy::variants dot_variants() noexcept {
+#if NDOF_SIMD_X86
+    return {.scalar = &detail::dot_scalar,
+            .sse42  = &detail::dot_sse42,
+            .avx2   = &detail::dot_avx2,
+            .avx512 = &detail::dot_avx512};
+#else
+    return {.scalar = &detail::dot_scalar};
+#endif
+  }
+
+  // Bound once during static initialization; kernels::sum(x) is a direct
+  // call through the chosen function pointer.
+  inline sum_strategy sum{sum_variants()};
+  inline dot_strategy dot{dot_variants()};
+
+} // namespace kernels
+
+} // namespace ndof
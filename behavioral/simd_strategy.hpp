@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NDOF_SIMD_X86 1
+#else
+#define NDOF_SIMD_X86 0
+#endif
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+
+// Instruction-set tiers, ordered: a CPU at one level runs every lower one.
+enum class simd_level : std::uint8_t {
+  scalar,
+  sse42,
+  avx2,   // AVX2 + FMA
+  avx512  // AVX-512F
+};
+
+inline constexpr std::size_t simd_level_count = 4;
+
+// Highest level this CPU (and OS) supports. Non-x86 builds report scalar.
+[[nodiscard]] inline simd_level detect_simd_level() noexcept {
+#if NDOF_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return simd_level::avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return simd_level::avx2;
+  if (__builtin_cpu_supports("sse4.2")) return simd_level::sse42;
+#endif
+  return simd_level::scalar;
+}
+
+// detect_simd_level(), computed once.
+[[nodiscard]] inline simd_level cpu_simd_level() noexcept {
+  static const simd_level level = detect_simd_level();
+  return level;
+}
+
+[[nodiscard]] constexpr const char* to_string(simd_level l) noexcept {
+  switch (l) {
+    case simd_level::scalar: return "scalar";
+    case simd_level::sse42:  return "sse4.2";
+    case simd_level::avx2:   return "avx2";
+    case simd_level::avx512: return "avx512";
+  }
+  return "?";
+}
+
+template <class Sig>
+class simd_strategy;
+
+// Strategy pattern over instruction-set variants of one kernel.
+//
+// Holds up to one plain function pointer per simd_level. Construction binds
+// the best variant the CPU supports into a single function pointer, so a
+// call is one indirect call with no per-call feature test. try_force() rebinds
+// to a chosen variant (tests, benchmarks, A/B comparisons).
+//
+// Not thread-safe to rebind: bind at startup, or force before sharing.
+template <class R, class... Args>
+class simd_strategy<R(Args...)> {
+public:
+  using function_type = R (*)(Args...);
+
+  struct variants {
+    function_type scalar{nullptr};
+    function_type sse42{nullptr};
+    function_type avx2{nullptr};
+    function_type avx512{nullptr};
+  };
+
+  // cpu caps the levels considered; defaults to what this machine supports.
+  explicit simd_strategy(const variants& v, simd_level cpu = cpu_simd_level()) noexcept
+      : table_{v.scalar, v.sse42, v.avx2, v.avx512}, cpu_(cpu) {
+    bind_best();
+  }
+
+  // False if no variant at or below the CPU's level was provided.
+  [[nodiscard]] bool valid() const noexcept { return fn_ != nullptr; }
+
+  // Level of the bound variant.
+  [[nodiscard]] simd_level level() const noexcept { return level_; }
+
+  // True if l has a variant and the CPU can run it.
+  [[nodiscard]] bool available(simd_level l) const noexcept {
+    return table_[index(l)] != nullptr && l <= cpu_;
+  }
+
+  [[nodiscard]] function_type get() const noexcept { return fn_; }
+
+  // Precondition: valid().
+  R operator()(Args... args) const { return fn_(std::forward<Args>(args)...); }
+
+  // Binds the highest available variant.
+  void bind_best() noexcept {
+    fn_ = nullptr;
+    level_ = simd_level::scalar;
+    for (std::size_t i = index(cpu_) + 1; i-- > 0;) {
+      if (table_[i]) {
+        fn_ = table_[i];
+        level_ = static_cast<simd_level>(i);
+        return;
+      }
+    }
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Binds the variant for l.
+  // Errors: ec::empty if none was provided for l,
+  //         ec::type_mismatch if the CPU does not support l.
+  [[nodiscard]] std::expected<void, ec> try_force(simd_level l) noexcept {
+    if (!table_[index(l)]) return std::unexpected(ec::empty);
+    if (l > cpu_) return std::unexpected(ec::type_mismatch);
+    fn_ = table_[index(l)];
+    level_ = l;
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  [[nodiscard]] bool force(simd_level l) noexcept { return try_force(l).has_value(); }
+
+private:
+  static constexpr std::size_t index(simd_level l) noexcept { return static_cast<std::size_t>(l); }
+
+  function_type fn_{nullptr};
+  std::array<function_type, simd_level_count> table_{};
+  simd_level cpu_{simd_level::scalar};
+  simd_level level_{simd_level::scalar};
+};
+
+} // namespace ndof
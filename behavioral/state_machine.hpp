@@ -0,0 +1,450 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+enum class state_machine_mode {
+  fixed,      // transitions come from the table only
+  extensible  // plus one runtime transition per (state, event), consulted when
+              // the table does not handle the event
+};
+
+// Default action and guard.
+struct no_action {
+  constexpr void operator()() const noexcept {}
+};
+
+struct no_guard {
+  constexpr bool operator()() const noexcept { return true; }
+};
+
+// One row of a transition table. From, Event and To are types (states are
+// usually empty tags). Action and Guard are default-constructible callables,
+// invoked as (Context&, const Event&), (Context&) or () - whichever they accept.
+// Guard returns bool. Action returns void or std::expected<void, ec>; an error
+// leaves the machine in From and is returned from try_process().
+template <class From, class Event, class To, class Action = no_action, class Guard = no_guard>
+struct transition {
+  using from   = From;
+  using event  = Event;
+  using to     = To;
+  using action = Action;
+  using guard  = Guard;
+};
+
+template <class... Transitions>
+struct transition_table {};
+
+namespace detail {
+
+  template <class... Ts>
+  struct fsm_list {
+    static constexpr std::size_t size = sizeof...(Ts);
+  };
+
+  template <class List, class... Ts>
+  struct fsm_unique {
+    using type = List;
+  };
+
+  template <class... Us, class T, class... Ts>
+  struct fsm_unique<fsm_list<Us...>, T, Ts...>
+      : fsm_unique<std::conditional_t<(std::is_same_v<T, Us> || ...), fsm_list<Us...>, fsm_list<Us..., T>>, Ts...> {};
+
+  // Position of T in the list, or the list's size if absent.
+  template <class T, class List>
+  struct fsm_index;
+
+  template <class T, class... Ts>
+  struct fsm_index<T, fsm_list<Ts...>> {
+    static constexpr std::size_t value = [] {
+      constexpr bool match[] = {std::is_same_v<T, Ts>..., false};
+      std::size_t i = 0;
+      while (i < sizeof...(Ts) && !match[i]) ++i;
+      return i;
+    }();
+  };
+
+  template <std::size_t I, class List>
+  struct fsm_at;
+
+  template <std::size_t I, class T, class... Ts>
+  struct fsm_at<I, fsm_list<T, Ts...>> : fsm_at<I - 1, fsm_list<Ts...>> {};
+
+  template <class T, class... Ts>
+  struct fsm_at<0, fsm_list<T, Ts...>> {
+    using type = T;
+  };
+
+  // Calls a default-constructed F with the widest argument list it accepts.
+  template <class F, class Context, class Event>
+  constexpr decltype(auto) fsm_call(Context& ctx, const Event& ev) {
+    F f{};
+    if constexpr (std::is_invocable_v<F&, Context&, const Event&>) {
+      return f(ctx, ev);
+    } else if constexpr (std::is_invocable_v<F&, Context&>) {
+      return f(ctx);
+    } else {
+      static_assert(std::is_invocable_v<F&>,
+                    "Actions and guards take (Context&, const Event&), (Context&) or ().");
+      return f();
+    }
+  }
+
+  // Same, for a callable object held at runtime.
+  template <class F, class Context, class Event>
+  constexpr decltype(auto) fsm_invoke(F& f, Context& ctx, const Event& ev) {
+    if constexpr (std::is_invocable_v<F&, Context&, const Event&>) {
+      return f(ctx, ev);
+    } else if constexpr (std::is_invocable_v<F&, Context&>) {
+      return f(ctx);
+    } else {
+      static_assert(std::is_invocable_v<F&>,
+                    "Runtime transitions take (Context&, const Event&), (Context&) or ().");
+      return f();
+    }
+  }
+
+} // namespace detail
+
+template <class Context,
+          class Table,
+          state_machine_mode Mode = state_machine_mode::fixed,
+          class AllocFamily = std::allocator<std::byte>,
+          std::size_t SboBytes = 3 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class state_machine;
+
+// Table-driven finite state machine.
+//
+//   table     States and events are collected from the transitions at compile
+//             time and numbered densely; the initial state is the From of the
+//             first transition. The (state, event) table is a constexpr array
+//             of function pointers, one per pair that has transitions and null
+//             otherwise. Each entry tries its pair's transitions in
+//             declaration order, with guards and actions inlined into it.
+//   process   try_process(ev) is one table load and one call. The event's
+//             column is fixed at compile time; events absent from the table
+//             do not compile.
+//   runtime   In state_machine_mode::extensible, try_add<From, Event, To>(f)
+//             installs a function_with_allocator transition in a dense
+//             (state, event) array allocated on first use. It runs only when
+//             the table does not handle the event. f may return void, bool
+//             (false: not handled) or std::expected<void, ec>.
+//
+// Actions that throw leave the machine in its source state; the exception
+// propagates. Not thread-safe: one machine per connection or parser.
+//
+// Contract (extensible mode): the allocator must outlive the machine.
+template <class Context,
+          class... Transitions,
+          state_machine_mode Mode,
+          class AllocFamily,
+          std::size_t SboBytes,
+          std::size_t SboAlign>
+class state_machine<Context, transition_table<Transitions...>, Mode, AllocFamily, SboBytes, SboAlign> {
+  static_assert(sizeof...(Transitions) > 0, "A state machine needs at least one transition.");
+
+  static constexpr bool extensible = Mode == state_machine_mode::extensible;
+
+  using states = typename detail::fsm_unique<detail::fsm_list<>,
+                                             typename Transitions::from...,
+                                             typename Transitions::to...>::type;
+  using events = typename detail::fsm_unique<detail::fsm_list<>, typename Transitions::event...>::type;
+
+public:
+  using context_type   = Context;
+  using allocator_type = AllocFamily;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  static constexpr std::size_t state_count = states::size;
+  static constexpr std::size_t event_count = events::size;
+
+  using state_index_type = std::conditional_t<(state_count <= 0xFF), std::uint8_t, std::uint16_t>;
+
+  template <class State>
+  static constexpr std::size_t state_index_of = detail::fsm_index<State, states>::value;
+
+  template <class Event>
+  static constexpr std::size_t event_index_of = detail::fsm_index<Event, events>::value;
+
+  // True if the table (not counting runtime transitions) has a transition
+  // for Event out of State.
+  template <class State, class Event>
+  static constexpr bool handles =
+      ((std::is_same_v<typename Transitions::from, State> && std::is_same_v<typename Transitions::event, Event>) || ...);
+
+  explicit state_machine(Context ctx = Context{}, const allocator_type& a = allocator_type{})
+      noexcept(std::is_nothrow_move_constructible_v<Context>)
+      : ctx_(std::move(ctx)), dynamic_(a) {}
+
+  state_machine(const state_machine&) = delete;
+  state_machine& operator=(const state_machine&) = delete;
+
+  [[nodiscard]] Context& context() noexcept { return ctx_; }
+  [[nodiscard]] const Context& context() const noexcept { return ctx_; }
+
+  [[nodiscard]] std::size_t state_index() const noexcept { return state_; }
+
+  template <class State>
+  [[nodiscard]] bool is() const noexcept {
+    static_assert(state_index_of<State> < state_count, "State does not appear in the transition table.");
+    return state_ == state_index_of<State>;
+  }
+
+  // Back to the initial state; the context is left alone.
+  void reset() noexcept { state_ = 0; }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::empty if no transition handles ev in the current state (or
+  //         every guard rejected it); whatever the action returned otherwise.
+  template <class Event>
+  [[nodiscard]] std::expected<void, ec> try_process(const Event& ev) {
+    constexpr std::size_t e = event_index_of<Event>;
+    static_assert(e < event_count, "Event does not appear in the transition table.");
+
+    static constexpr auto table = make_table(std::make_index_sequence<state_count * event_count>{});
+
+    const std::size_t at = state_ * event_count + e;
+    if (const handler h = table[at]) {
+      auto r = h(*this, &ev);
+      if constexpr (!extensible) return r;
+      else if (r || r.error() != ec::empty) return r;
+    }
+    if constexpr (extensible) {
+      return dynamic_.run(at, ctx_, &ev, state_);
+    } else {
+      return std::unexpected(ec::empty);
+    }
+  }
+
+  // Installs (or replaces) the runtime transition for Event out of From.
+  // Errors: ec::alloc_failed, or whatever function_with_allocator::try_emplace reports.
+  template <class From, class Event, class To, class F>
+    requires extensible
+  [[nodiscard]] std::expected<void, ec> try_add(F&& f) noexcept {
+    static_assert(state_index_of<From> < state_count && state_index_of<To> < state_count,
+                  "Runtime transitions connect states from the transition table.");
+    static_assert(event_index_of<Event> < event_count, "Event does not appear in the transition table.");
+
+    using U = std::remove_cvref_t<F>;
+    constexpr std::size_t at = state_index_of<From> * event_count + event_index_of<Event>;
+    constexpr auto to = static_cast<state_index_type>(state_index_of<To>);
+#if defined(__cpp_exceptions)
+    try {
+      return dynamic_.add(at, to, runtime_action<Event, U>{U(std::forward<F>(f))});
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    return dynamic_.add(at, to, runtime_action<Event, U>{U(std::forward<F>(f))});
+#endif
+  }
+
+  // Errors: ec::empty if no runtime transition was installed for the pair.
+  template <class From, class Event>
+    requires extensible
+  [[nodiscard]] std::expected<void, ec> try_remove() noexcept {
+    static_assert(state_index_of<From> < state_count, "State does not appear in the transition table.");
+    static_assert(event_index_of<Event> < event_count, "Event does not appear in the transition table.");
+    return dynamic_.remove(state_index_of<From> * event_count + event_index_of<Event>);
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  template <class Event>
+  bool process(const Event& ev) {
+    return try_process(ev).has_value();
+  }
+
+  template <class From, class Event, class To, class F>
+    requires extensible
+  [[nodiscard]] bool add(F&& f) noexcept {
+    return try_add<From, Event, To>(std::forward<F>(f)).has_value();
+  }
+
+private:
+  using handler = std::expected<void, ec> (*)(state_machine&, const void*);
+
+  template <class T>
+  static constexpr std::size_t from_of = state_index_of<typename T::from>;
+
+  // Tries transition T; true if it handled the event (successfully or not).
+  template <class T, class Event>
+  static bool try_one(state_machine& m, const Event& ev, std::expected<void, ec>& out) {
+    if (!detail::fsm_call<typename T::guard>(m.ctx_, ev)) return false;
+
+    using result = decltype(detail::fsm_call<typename T::action>(m.ctx_, ev));
+    if constexpr (std::is_void_v<result>) {
+      detail::fsm_call<typename T::action>(m.ctx_, ev);
+    } else {
+      static_assert(std::is_same_v<std::remove_cvref_t<result>, std::expected<void, ec>>,
+                    "Actions return void or std::expected<void, ec>.");
+      out = detail::fsm_call<typename T::action>(m.ctx_, ev);
+      if (!out) return true;
+    }
+    m.state_ = static_cast<state_index_type>(state_index_of<typename T::to>);
+    return true;
+  }
+
+  template <std::size_t S, std::size_t E>
+  static std::expected<void, ec> handle(state_machine& m, const void* p) {
+    using Event = typename detail::fsm_at<E, events>::type;
+    const Event& ev = *static_cast<const Event*>(p);
+
+    std::expected<void, ec> out{};
+    const bool handled = ([&] {
+      if constexpr (from_of<Transitions> == S && std::is_same_v<typename Transitions::event, Event>) {
+        return try_one<Transitions>(m, ev, out);
+      } else {
+        return false;
+      }
+    }() || ...);
+    if (!handled) return std::unexpected(ec::empty);
+    return out;
+  }
+
+  template <std::size_t S, std::size_t E>
+  static constexpr bool has_row =
+      ((from_of<Transitions> == S && std::is_same_v<typename Transitions::event,
+                                                    typename detail::fsm_at<E, events>::type>) || ...);
+
+  template <std::size_t... I>
+  static constexpr std::array<handler, sizeof...(I)> make_table(std::index_sequence<I...>) noexcept {
+    return {{(has_row<I / event_count, I % event_count> ? &handle<I / event_count, I % event_count> : nullptr)...}};
+  }
+
+  // --------------------------------------------------------------------------
+  // Runtime transitions (extensible mode)
+  // --------------------------------------------------------------------------
+
+  using runtime_fn = std::expected<void, ec>(Context&, const void*);
+
+  template <class Event, class F>
+  struct runtime_action {
+    mutable F f;
+
+    std::expected<void, ec> operator()(Context& ctx, const void* p) const {
+      const Event& ev = *static_cast<const Event*>(p);
+      using result = decltype(detail::fsm_invoke(f, ctx, ev));
+      if constexpr (std::is_void_v<result>) {
+        detail::fsm_invoke(f, ctx, ev);
+        return {};
+      } else if constexpr (std::is_same_v<std::remove_cvref_t<result>, bool>) {
+        if (!detail::fsm_invoke(f, ctx, ev)) return std::unexpected(ec::empty);
+        return {};
+      } else {
+        static_assert(std::is_same_v<std::remove_cvref_t<result>, std::expected<void, ec>>,
+                      "Runtime transitions return void, bool or std::expected<void, ec>.");
+        return detail::fsm_invoke(f, ctx, ev);
+      }
+    }
+  };
+
+  struct no_runtime {
+    explicit no_runtime(const allocator_type&) noexcept {}
+  };
+
+  // Dense (state, event) array of runtime transitions, allocated on first add.
+  class runtime_table {
+  public:
+    using fn_type = function_with_allocator<runtime_fn, allocator_type, SboBytes, SboAlign>;
+
+    explicit runtime_table(const allocator_type& a) noexcept : alloc_(a) {}
+
+    ~runtime_table() noexcept {
+      if (!rows_) return;
+      row_alloc_type ra = row_alloc();
+      std::destroy_n(rows_, rows);
+      row_traits::deallocate(ra, rows_, rows);
+    }
+
+    runtime_table(const runtime_table&) = delete;
+    runtime_table& operator=(const runtime_table&) = delete;
+
+    template <class A>
+    std::expected<void, ec> add(std::size_t at, state_index_type to, A&& action) noexcept {
+      if (!rows_) {
+        auto r = allocate_rows();
+        if (!r) return r;
+      }
+      row& x = rows_[at];
+      auto r = x.fn.try_emplace(std::forward<A>(action));
+      if (!r) return std::unexpected(r.error());
+      x.to = to;
+      return {};
+    }
+
+    std::expected<void, ec> remove(std::size_t at) noexcept {
+      if (!rows_ || !rows_[at].fn) return std::unexpected(ec::empty);
+      rows_[at].fn.reset();
+      return {};
+    }
+
+    std::expected<void, ec> run(std::size_t at, Context& ctx, const void* ev, state_index_type& state) {
+      if (!rows_ || !rows_[at].fn) return std::unexpected(ec::empty);
+      row& x = rows_[at];
+      auto r = x.fn(ctx, ev);
+      if (r) state = x.to;
+      return r;
+    }
+
+  private:
+    static constexpr std::size_t rows = state_count * event_count;
+
+    struct row {
+      fn_type fn;
+      state_index_type to{0};
+
+      explicit row(const allocator_type& a) noexcept : fn(a) {}
+    };
+
+    using row_alloc_type = typename traits::template rebind_alloc<row>;
+    using row_traits     = std::allocator_traits<row_alloc_type>;
+
+    row_alloc_type row_alloc() const noexcept { return row_alloc_type(alloc_); }
+
+    std::expected<void, ec> allocate_rows() noexcept {
+      row_alloc_type ra = row_alloc();
+#if defined(__cpp_exceptions)
+      try {
+        rows_ = row_traits::allocate(ra, rows);
+      } catch (...) {
+        return std::unexpected(ec::alloc_failed);
+      }
+#else
+      rows_ = row_traits::allocate(ra, rows);
+      if (!rows_) return std::unexpected(ec::alloc_failed);
+#endif
+      for (std::size_t i = 0; i < rows; ++i) std::construct_at(rows_ + i, alloc_);
+      return {};
+    }
+
+    [[no_unique_address]] allocator_type alloc_{};
+    row* rows_{nullptr};
+  };
+
+  Context ctx_;
+  state_index_type state_{0};
+  [[no_unique_address]] std::conditional_t<extensible, runtime_table, no_runtime> dynamic_;
+};
+
+} // namespace ndof
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+namespace detail {
+
+  // Coroutine frames from an allocator family. Frames are allocated in units
+  // of the default new alignment (a pmr resource asked for bytes would only
+  // guarantee byte alignment). A stateful allocator is copied behind the
+  // frame so that deallocation, which only sees the pointer and size, can
+  // find it; a stateless one is rebuilt on the spot.
+  template <class AllocFamily>
+  struct coroutine_frame {
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) unit {
+      std::byte bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+    };
+
+    using unit_alloc  = typename std::allocator_traits<AllocFamily>::template rebind_alloc<unit>;
+    using unit_traits = std::allocator_traits<unit_alloc>;
+
+    static constexpr bool stateless =
+        unit_traits::is_always_equal::value && std::is_default_constructible_v<unit_alloc>;
+
+    static constexpr std::size_t alloc_offset(std::size_t n) noexcept {
+      return (n + alignof(unit_alloc) - 1) & ~(alignof(unit_alloc) - 1);
+    }
+
+    static constexpr std::size_t units(std::size_t n) noexcept {
+      const std::size_t bytes = stateless ? n : alloc_offset(n) + sizeof(unit_alloc);
+      return (bytes + sizeof(unit) - 1) / sizeof(unit);
+    }
+
+    // Null on failure.
+    static void* allocate(std::size_t n, const AllocFamily& a) noexcept {
+      unit_alloc ua(a);
+      unit* p = nullptr;
+#if defined(__cpp_exceptions)
+      try {
+        p = unit_traits::allocate(ua, units(n));
+      } catch (...) {
+        return nullptr;
+      }
+#else
+      p = unit_traits::allocate(ua, units(n));
+      if (!p) return nullptr;
+#endif
+      if constexpr (!stateless) {
+        std::construct_at(reinterpret_cast<unit_alloc*>(reinterpret_cast<std::byte*>(p) + alloc_offset(n)),
+                          std::move(ua));
+      }
+      return p;
+    }
+
+    static void deallocate(void* frame, std::size_t n) noexcept {
+      unit* p = static_cast<unit*>(frame);
+      if constexpr (stateless) {
+        unit_alloc ua;
+        unit_traits::deallocate(ua, p, units(n));
+      } else {
+        auto* stored = std::launder(reinterpret_cast<unit_alloc*>(static_cast<std::byte*>(frame) + alloc_offset(n)));
+        unit_alloc ua(std::move(*stored));
+        std::destroy_at(stored);
+        unit_traits::deallocate(ua, p, units(n));
+      }
+    }
+  };
+
+  // A promise has return_value or return_void, never both.
+  template <class T>
+  struct task_result {
+    std::expected<T, ec> result_{std::unexpect, ec::empty};
+
+    void return_value(std::expected<T, ec> r) noexcept(std::is_nothrow_move_constructible_v<T>) {
+      result_ = std::move(r);
+    }
+  };
+
+  template <>
+  struct task_result<void> {
+    std::expected<void, ec> result_{std::unexpect, ec::empty};
+
+    void return_void() noexcept { result_.emplace(); }
+  };
+
+} // namespace detail
+
+template <class T = void, class AllocFamily = std::allocator<std::byte>>
+class task;
+
+// A lazily started coroutine whose frame comes from an allocator family, not
+// the global heap.
+//
+//   frames     Allocated from AllocFamily through the promise's operator new.
+//              A coroutine chooses its allocator by taking
+//              (std::allocator_arg_t, const AllocFamily&, ...) as its first
+//              parameters (after the object, for member coroutines);
+//              otherwise a default-constructed AllocFamily is used. A failed
+//              frame allocation does not throw: the call returns a task that
+//              reports ec::alloc_failed when awaited or started.
+//   results    co_await on a task yields std::expected<T, ec>. The body may
+//              co_return a T, a std::expected<T, ec> or a std::unexpected(ec).
+//              Exceptions escaping the body are rethrown at the co_await.
+//   continuations
+//              One function_with_allocator per frame, called at final suspend
+//              and returning the coroutine to transfer to. An awaiting
+//              coroutine stores a handle-returning thunk (inline in the SBO),
+//              so completion resumes it by symmetric transfer and deep await
+//              chains do not grow the stack (in optimized builds, where the
+//              transfer compiles to a tail call). try_start() stores a callback
+//              instead, which receives the result.
+//
+// A task owns its frame until it is awaited to completion, destroyed, or
+// handed to try_start(). Awaiting starts it on the awaiting thread.
+//
+// Contract: the allocator must outlive every frame allocated from it; a task
+// is awaited at most once.
+template <class T, class AllocFamily>
+class task {
+public:
+  using value_type        = T;
+  using allocator_type    = AllocFamily;
+  using result_type       = std::expected<T, ec>;
+  using continuation_type = function_with_allocator<std::coroutine_handle<>(), AllocFamily>;
+
+  class promise_type;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  // An empty task: awaiting it yields ec::empty.
+  task() noexcept = default;
+
+  task(task&& other) noexcept
+      : h_(std::exchange(other.h_, nullptr)), error_(std::exchange(other.error_, ec::empty)) {}
+
+  task& operator=(task&& other) noexcept {
+    if (this != &other) {
+      if (h_) h_.destroy();
+      h_ = std::exchange(other.h_, nullptr);
+      error_ = std::exchange(other.error_, ec::empty);
+    }
+    return *this;
+  }
+
+  ~task() noexcept {
+    if (h_) h_.destroy();
+  }
+
+  task(const task&) = delete;
+  task& operator=(const task&) = delete;
+
+  // False for an empty task or one whose frame could not be allocated.
+  [[nodiscard]] bool valid() const noexcept { return static_cast<bool>(h_); }
+  explicit operator bool() const noexcept { return valid(); }
+
+  [[nodiscard]] bool done() const noexcept { return !h_ || h_.done(); }
+
+  // Starts the task (if not started) and resumes the awaiting coroutine with
+  // its result when it completes.
+  auto operator co_await() & noexcept { return awaiter{this}; }
+  auto operator co_await() && noexcept { return awaiter{this}; }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Detaches the task and runs it on this thread until its first suspension;
+  // on_done(result_type&&) runs when it completes, on whichever thread
+  // completes it, after the frame has been freed. on_done must not throw, and
+  // an exception escaping the body terminates, as with thread_pool tasks.
+  // Errors: ec::empty for an empty task, ec::alloc_failed if its frame could
+  //         not be allocated, or whatever function_with_allocator::try_emplace
+  //         reports for on_done; on_done is not called on failure.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec> try_start(F&& on_done) noexcept {
+    static_assert(std::is_nothrow_move_constructible_v<std::decay_t<F>>,
+                  "on_done must be nothrow move constructible.");
+    if (!h_) return std::unexpected(error_);
+    promise_type& p = h_.promise();
+    auto r = p.continuation_.try_emplace(callback<std::decay_t<F>>{std::forward<F>(on_done), &p});
+    if (!r) return std::unexpected(r.error());
+    p.detached_ = true;
+    std::exchange(h_, nullptr).resume();
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  template <class F>
+  [[nodiscard]] bool start(F&& on_done) noexcept {
+    return try_start(std::forward<F>(on_done)).has_value();
+  }
+
+private:
+  explicit task(handle_type h) noexcept : h_(h) {}
+  explicit task(ec e) noexcept : error_(e) {}
+
+  struct resume_thunk {
+    std::coroutine_handle<> h;
+    std::coroutine_handle<> operator()() const noexcept { return h; }
+  };
+
+  // Moves on_done and the result out of the frame and frees the frame (this
+  // object included) before calling on_done: whoever on_done wakes may
+  // release the allocator at once.
+  template <class F>
+  struct callback {
+    mutable F f;
+    promise_type* p;
+    std::coroutine_handle<> operator()() const noexcept {
+      F done(std::move(f));
+      result_type r(std::move(p->result_));
+      handle_type::from_promise(*p).destroy();
+      done(std::move(r));
+      return std::noop_coroutine();
+    }
+  };
+
+  struct awaiter {
+    task* self;
+
+    bool await_ready() const noexcept { return !self->h_ || self->h_.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+      promise_type& p = self->h_.promise();
+      // A thunk of one handle always fits the SBO, so this cannot fail.
+      (void)p.continuation_.try_emplace(resume_thunk{awaiting});
+      return self->h_;
+    }
+
+    result_type await_resume() {
+      if (!self->h_) return std::unexpected(self->error_);
+      promise_type& p = self->h_.promise();
+#if defined(__cpp_exceptions)
+      if (p.exception_) std::rethrow_exception(p.exception_);
+#endif
+      return std::move(p.result_);
+    }
+  };
+
+  handle_type h_{nullptr};
+  ec error_{ec::empty}; // reported when there is no frame
+};
+
+template <class T, class AllocFamily>
+class task<T, AllocFamily>::promise_type : public detail::task_result<T> {
+  using frame = detail::coroutine_frame<AllocFamily>;
+
+public:
+  promise_type() noexcept
+    requires std::is_default_constructible_v<AllocFamily>
+  {}
+
+  template <class... Args>
+  promise_type(std::allocator_arg_t, const AllocFamily& a, const Args&...) noexcept : continuation_(a) {}
+
+  template <class This, class... Args>
+  promise_type(const This&, std::allocator_arg_t, const AllocFamily& a, const Args&...) noexcept
+      : continuation_(a) {}
+
+  static void* operator new(std::size_t n) noexcept
+    requires std::is_default_constructible_v<AllocFamily>
+  {
+    return frame::allocate(n, AllocFamily{});
+  }
+
+  // Frames are always freed through the usual operator delete below. The
+  // placement forms are inlined so that GCC does not pair an out-of-line call
+  // to them with it and warn (-Wmismatched-new-delete, unoptimized builds).
+  template <class... Args>
+  [[gnu::always_inline]] static void* operator new(std::size_t n, std::allocator_arg_t, const AllocFamily& a,
+                                                   const Args&...) noexcept {
+    return frame::allocate(n, a);
+  }
+
+  template <class This, class... Args>
+  [[gnu::always_inline]] static void* operator new(std::size_t n, const This&, std::allocator_arg_t,
+                                                   const AllocFamily& a, const Args&...) noexcept {
+    return frame::allocate(n, a);
+  }
+
+  static void operator delete(void* p, std::size_t n) noexcept { frame::deallocate(p, n); }
+
+  static task get_return_object_on_allocation_failure() noexcept { return task(ec::alloc_failed); }
+
+  task get_return_object() noexcept { return task(handle_type::from_promise(*this)); }
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+
+  auto final_suspend() const noexcept {
+    struct final_awaiter {
+      bool await_ready() const noexcept { return false; }
+
+      // A detached frame is freed by its callback, before on_done runs; the
+      // frame must not be touched after the call.
+      std::coroutine_handle<> await_suspend(handle_type h) noexcept {
+        promise_type& p = h.promise();
+        return p.continuation_ ? p.continuation_() : std::noop_coroutine();
+      }
+
+      void await_resume() const noexcept {}
+    };
+    return final_awaiter{};
+  }
+
+  void unhandled_exception() noexcept {
+#if defined(__cpp_exceptions)
+    if (detached_) std::terminate();
+    exception_ = std::current_exception();
+#else
+    std::terminate();
+#endif
+  }
+
+private:
+  friend class task;
+
+  continuation_type continuation_;
+#if defined(__cpp_exceptions)
+  std::exception_ptr exception_;
+#endif
+  bool detached_{false};
+};
+
+// Runs t to completion on this thread, blocking while it is suspended on work
+// completed elsewhere.
+// Errors: whatever t reports, or task::try_start's errors.
+template <class T, class AllocFamily>
+[[nodiscard]] std::expected<T, ec> sync_wait(task<T, AllocFamily> t) noexcept {
+  // Signalled under the lock, so this frame cannot return (and take the
+  // mutex and condition variable with it) while the callback still uses them.
+  // One pointer captured: the callback fits the continuation's SBO.
+  struct state {
+    std::optional<std::expected<T, ec>> out;
+    std::mutex mtx;
+    std::condition_variable cv;
+  } s;
+  auto started = t.try_start([&s](std::expected<T, ec>&& r) noexcept {
+    std::scoped_lock lock(s.mtx);
+    s.out.emplace(std::move(r));
+    s.cv.notify_one();
+  });
+  if (!started) return std::unexpected(started.error());
+  std::unique_lock lock(s.mtx);
+  s.cv.wait(lock, [&s] { return s.out.has_value(); });
+  return std::move(*s.out);
+}
+
+} // namespace ndof
@@ -0,0 +1,532 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+// Work-stealing thread pool. Tasks are function_with_allocator<void() noexcept>
+// objects held inline in fixed rings, so submitting a task that fits SboBytes
+// never allocates.
+//
+//   per worker  A Chase-Lev deque over a ring of task slots: the owner pushes
+//               and pops at the bottom (LIFO), thieves take from the top (FIFO).
+//   injection   A mutex-guarded ring for submissions from outside the pool and
+//               for a worker whose own ring is full.
+//   idle        Workers spin through their deque, the injection ring and one
+//               steal attempt per victim, then sleep on an atomic wait.
+//
+// A task runs in place in its slot; the slot is reused only after the task has
+// run and been destroyed. Tasks must not throw (a throwing task terminates).
+// A task may return std::expected<void, ec>; under a task_group the first error
+// is reported by wait().
+//
+// Contract: no submissions once destruction has begun; the destructor runs
+// every task already submitted, then joins. The allocator must outlive the pool.
+template <class AllocFamily = std::allocator<std::byte>,
+          std::size_t SboBytes = 6 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class thread_pool {
+public:
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+  using task_type      = function_with_allocator<void() noexcept, allocator_type, SboBytes, SboAlign>;
+
+  struct config {
+    std::size_t threads          = 0;    // 0: std::thread::hardware_concurrency()
+    std::size_t deque_capacity   = 256;  // task slots per worker (rounded up to a power of two)
+    std::size_t inject_capacity  = 1024; // task slots shared by outside submitters
+  };
+
+  class task_group;
+
+  explicit thread_pool(const config& cfg = config{}, const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a) {
+    (void)init(cfg);
+  }
+
+  ~thread_pool() noexcept { teardown(); }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // False if construction could not allocate its rings or start a worker;
+  // every submit then fails with ec::alloc_failed.
+  [[nodiscard]] bool valid() const noexcept { return running_ > 0; }
+
+  [[nodiscard]] std::size_t thread_count() const noexcept { return running_; }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Queues f. From a worker of this pool, f goes to that worker's deque.
+  // Errors: ec::alloc_failed if every ring f could go to is full (or f does
+  //         not fit the SBO and the allocator fails); whatever
+  //         function_with_allocator::try_emplace reports otherwise.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec> try_submit(F&& f) noexcept {
+    return enqueue(wrap(std::forward<F>(f), nullptr));
+  }
+
+  // Queues f as part of group; group.wait() returns once it has run.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec> try_submit(task_group& group, F&& f) noexcept {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    auto r = enqueue(wrap(std::forward<F>(f), &group));
+    if (!r) group.finish(ec::ok);
+    return r;
+  }
+
+  // Calls f(i) for every i in [first, last), split into chunks of grain
+  // indices (0: about eight chunks per thread), and waits. The calling thread
+  // helps. Chunks that cannot be queued run inline, so every index is visited
+  // unless f reports an error. Returns the first error a call reported.
+  template <class F>
+  [[nodiscard]] std::expected<void, ec>
+  parallel_for(std::size_t first, std::size_t last, F&& f, std::size_t grain = 0) noexcept {
+    if (first >= last) return {};
+    const std::size_t n = last - first;
+    if (grain == 0) grain = std::max<std::size_t>(1, n / (8 * std::max<std::size_t>(running_, 1)));
+
+    task_group group(*this);
+    for (std::size_t lo = first; lo < last; lo += std::min(grain, last - lo)) {
+      const std::size_t hi = lo + std::min(grain, last - lo);
+      auto chunk = [&f, &group, lo, hi]() noexcept -> std::expected<void, ec> {
+        for (std::size_t i = lo; i < hi && !group.failed(); ++i) {
+          if constexpr (std::is_void_v<std::invoke_result_t<F&, std::size_t>>) {
+            std::invoke(f, i);
+          } else {
+            auto r = std::invoke(f, i);
+            if (!r) return std::unexpected(r.error());
+          }
+        }
+        return {};
+      };
+      if (!try_submit(group, chunk)) {
+        auto r = chunk();
+        if (!r) group.record(r.error());
+      }
+    }
+    return group.wait();
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  template <class F>
+  [[nodiscard]] bool submit(F&& f) noexcept {
+    return try_submit(std::forward<F>(f)).has_value();
+  }
+
+private:
+  static constexpr std::uint8_t slot_empty = 0;
+  static constexpr std::uint8_t slot_full  = 1;
+
+  struct slot {
+    std::atomic<std::uint8_t> state{slot_empty};
+    task_type task;
+
+    explicit slot(const allocator_type& a) noexcept : task(a) {}
+  };
+
+  // Bounded Chase-Lev deque over a ring of slots. A slot whose task is still
+  // running (claimed but not yet released) makes the ring look full to push().
+  struct alignas(64) worker {
+    alignas(64) std::atomic<std::int64_t> top{0};
+    alignas(64) std::atomic<std::int64_t> bottom{0};
+    slot* slots{nullptr};
+    std::size_t mask{0};
+    std::uint64_t rng{0};
+    std::thread thread;
+  };
+
+  struct ring {
+    std::mutex mtx;
+    slot* slots{nullptr};
+    std::size_t mask{0};
+    std::uint64_t head{0};
+    std::uint64_t tail{0};
+  };
+
+  // Carries f and, if any, the group to notify. Const-callable so that
+  // function_with_allocator accepts mutable callables too.
+  template <class F>
+  struct task_wrapper {
+    mutable F f;
+    task_group* group;
+
+    void operator()() const noexcept {
+      if constexpr (std::is_void_v<std::invoke_result_t<F&>>) {
+        std::invoke(f);
+        if (group) group->finish(ec::ok);
+      } else {
+        auto r = std::invoke(f);
+        if (group) group->finish(r ? ec::ok : r.error());
+      }
+    }
+  };
+
+  template <class F>
+  static task_wrapper<std::decay_t<F>> wrap(F&& f, task_group* g) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>) {
+    return {std::forward<F>(f), g};
+  }
+
+  // The worker running on this thread, if it belongs to this pool.
+  struct current_worker {
+    const thread_pool* pool{nullptr};
+    std::size_t index{0};
+  };
+
+  static current_worker& current() noexcept {
+    static thread_local current_worker c;
+    return c;
+  }
+
+  std::expected<void, ec> init(const config& cfg) noexcept {
+    std::size_t threads = cfg.threads ? cfg.threads : std::thread::hardware_concurrency();
+    threads = std::max<std::size_t>(threads, 1);
+    const std::size_t deque_cap  = std::bit_ceil(std::max<std::size_t>(cfg.deque_capacity, 2));
+    const std::size_t inject_cap = std::bit_ceil(std::max<std::size_t>(cfg.inject_capacity, 2));
+
+    auto w = allocate_array<worker>(threads);
+    if (!w) return std::unexpected(w.error());
+    workers_ = *w;
+    worker_count_ = threads;
+    for (std::size_t i = 0; i < threads; ++i) std::construct_at(workers_ + i);
+
+    auto inj = make_slots(inject_cap);
+    if (!inj) return std::unexpected(inj.error());
+    inject_.slots = *inj;
+    inject_.mask  = inject_cap - 1;
+
+    for (std::size_t i = 0; i < threads; ++i) {
+      auto s = make_slots(deque_cap);
+      if (!s) return std::unexpected(s.error());
+      workers_[i].slots = *s;
+      workers_[i].mask  = deque_cap - 1;
+      workers_[i].rng   = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+
+    for (std::size_t i = 0; i < threads; ++i) {
+#if defined(__cpp_exceptions)
+      try {
+        workers_[i].thread = std::thread([this, i] { run(i); });
+      } catch (...) {
+        return std::unexpected(ec::alloc_failed);
+      }
+#else
+      workers_[i].thread = std::thread([this, i] { run(i); });
+#endif
+      ++running_;
+    }
+    return {};
+  }
+
+  void teardown() noexcept {
+    stop_.store(true, std::memory_order_seq_cst);
+    wake_.fetch_add(1, std::memory_order_seq_cst);
+    wake_.notify_all();
+    for (std::size_t i = 0; i < running_; ++i) workers_[i].thread.join();
+    running_ = 0;
+
+    if (!workers_) return;
+    for (std::size_t i = 0; i < worker_count_; ++i) {
+      if (workers_[i].slots) free_slots(workers_[i].slots, workers_[i].mask + 1);
+    }
+    if (inject_.slots) free_slots(inject_.slots, inject_.mask + 1);
+    std::destroy_n(workers_, worker_count_);
+    deallocate_array(workers_, worker_count_);
+    workers_ = nullptr;
+  }
+
+  template <class U>
+  std::expected<U*, ec> allocate_array(std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    if (n > utraits::max_size(ua)) return std::unexpected(ec::alloc_failed);
+    U* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = utraits::allocate(ua, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = utraits::allocate(ua, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  template <class U>
+  void deallocate_array(U* p, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    utraits::deallocate(ua, p, n);
+  }
+
+  std::expected<slot*, ec> make_slots(std::size_t n) noexcept {
+    auto s = allocate_array<slot>(n);
+    if (!s) return s;
+    for (std::size_t i = 0; i < n; ++i) std::construct_at(*s + i, alloc_);
+    return s;
+  }
+
+  void free_slots(slot* s, std::size_t n) noexcept {
+    std::destroy_n(s, n);
+    deallocate_array(s, n);
+  }
+
+  // --------------------------------------------------------------------------
+  // Queues
+  // --------------------------------------------------------------------------
+
+  template <class W>
+  std::expected<void, ec> enqueue(W&& task) noexcept {
+    if (!valid()) return std::unexpected(ec::alloc_failed);
+
+    const current_worker& me = current();
+    std::expected<void, ec> r = std::unexpected(ec::alloc_failed);
+    if (me.pool == this) r = push_local(workers_[me.index], std::forward<W>(task));
+    if (!r && r.error() == ec::alloc_failed) r = push_inject(std::forward<W>(task));
+    if (!r) return r;
+
+    // Pairs with the sleeper registration in idle(): either the sleeper sees
+    // this task on its last look, or this sees the sleeper and wakes it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+      wake_.fetch_add(1, std::memory_order_seq_cst);
+      wake_.notify_one();
+    }
+    return {};
+  }
+
+  // Owner only.
+  template <class W>
+  std::expected<void, ec> push_local(worker& w, W&& task) noexcept {
+    const std::int64_t b = w.bottom.load(std::memory_order_relaxed);
+    const std::int64_t t = w.top.load(std::memory_order_acquire);
+    if (b - t > static_cast<std::int64_t>(w.mask)) return std::unexpected(ec::alloc_failed);
+
+    slot& s = w.slots[static_cast<std::size_t>(b) & w.mask];
+    if (s.state.load(std::memory_order_acquire) != slot_empty) return std::unexpected(ec::alloc_failed);
+
+    auto r = s.task.try_emplace(std::forward<W>(task));
+    if (!r) return std::unexpected(r.error());
+    s.state.store(slot_full, std::memory_order_relaxed);
+    w.bottom.store(b + 1, std::memory_order_release);
+    return {};
+  }
+
+  // Owner only. Claims the newest slot, or null.
+  slot* pop_local(worker& w) noexcept {
+    const std::int64_t b = w.bottom.load(std::memory_order_relaxed) - 1;
+    w.bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = w.top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      w.bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    slot* s = &w.slots[static_cast<std::size_t>(b) & w.mask];
+    if (t == b) {
+      // Last task: race thieves for it.
+      if (!w.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        s = nullptr;
+      }
+      w.bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  // Any thread. Claims the oldest slot, or null.
+  static slot* steal(worker& w) noexcept {
+    std::int64_t t = w.top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b = w.bottom.load(std::memory_order_acquire);
+    if (t >= b) return nullptr;
+    slot* s = &w.slots[static_cast<std::size_t>(t) & w.mask];
+    if (!w.top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return s;
+  }
+
+  template <class W>
+  std::expected<void, ec> push_inject(W&& task) noexcept {
+    std::scoped_lock lock(inject_.mtx);
+    if (inject_.tail - inject_.head > inject_.mask) return std::unexpected(ec::alloc_failed);
+    slot& s = inject_.slots[inject_.tail & inject_.mask];
+    if (s.state.load(std::memory_order_acquire) != slot_empty) return std::unexpected(ec::alloc_failed);
+
+    auto r = s.task.try_emplace(std::forward<W>(task));
+    if (!r) return std::unexpected(r.error());
+    s.state.store(slot_full, std::memory_order_relaxed);
+    ++inject_.tail;
+    inject_size_.fetch_add(1, std::memory_order_release);
+    return {};
+  }
+
+  slot* pop_inject() noexcept {
+    if (inject_size_.load(std::memory_order_acquire) == 0) return nullptr;
+    std::scoped_lock lock(inject_.mtx);
+    if (inject_.head == inject_.tail) return nullptr;
+    slot* s = &inject_.slots[inject_.head++ & inject_.mask];
+    inject_size_.fetch_sub(1, std::memory_order_relaxed);
+    return s;
+  }
+
+  // Runs a claimed slot's task in place and hands the slot back.
+  static void run_slot(slot* s) noexcept {
+    (void)std::as_const(s->task)();
+    s->task.reset();
+    s->state.store(slot_empty, std::memory_order_release);
+  }
+
+  // One unit of work for the calling thread: own deque, injection ring, then
+  // one steal attempt per other worker. False if nothing was found.
+  bool run_one(std::size_t self, bool is_worker) noexcept {
+    if (is_worker) {
+      if (slot* s = pop_local(workers_[self])) { run_slot(s); return true; }
+    }
+    if (slot* s = pop_inject()) { run_slot(s); return true; }
+
+    std::uint64_t& x = is_worker ? workers_[self].rng : outside_rng();
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    const std::size_t start = static_cast<std::size_t>(x % worker_count_);
+    for (std::size_t k = 0; k < worker_count_; ++k) {
+      const std::size_t v = (start + k) % worker_count_;
+      if (is_worker && v == self) continue;
+      if (slot* s = steal(workers_[v])) { run_slot(s); return true; }
+    }
+    return false;
+  }
+
+  static std::uint64_t& outside_rng() noexcept {
+    static thread_local std::uint64_t x = 0x2545F4914F6CDD1Dull;
+    return x;
+  }
+
+  bool has_work() const noexcept {
+    if (inject_size_.load(std::memory_order_seq_cst) > 0) return true;
+    for (std::size_t i = 0; i < worker_count_; ++i) {
+      if (workers_[i].bottom.load(std::memory_order_seq_cst) > workers_[i].top.load(std::memory_order_seq_cst)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(std::size_t self) noexcept {
+    current() = {this, self};
+    for (;;) {
+      if (run_one(self, true)) continue;
+      if (stop_.load(std::memory_order_acquire) && !has_work()) break;
+      idle();
+    }
+    current() = {};
+  }
+
+  void idle() noexcept {
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    const std::uint32_t e = wake_.load(std::memory_order_seq_cst);
+    if (!stop_.load(std::memory_order_seq_cst) && !has_work()) wake_.wait(e, std::memory_order_seq_cst);
+    sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  worker* workers_{nullptr};
+  std::size_t worker_count_{0};
+  std::size_t running_{0};
+  ring inject_;
+  alignas(64) std::atomic<std::size_t> inject_size_{0};
+  alignas(64) std::atomic<std::uint32_t> wake_{0};
+  std::atomic<std::uint32_t> sleepers_{0};
+  std::atomic<bool> stop_{false};
+  // Bumped whenever a task_group's last task finishes; groups wait on it.
+  alignas(64) std::atomic<std::uint32_t> groups_done_{0};
+};
+
+// Tracks a set of tasks submitted through thread_pool::try_submit(group, f).
+// wait() helps run queued tasks, then blocks until every task in the group has
+// run, and returns the first error any of them reported. Waits on destruction.
+template <class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+class thread_pool<AllocFamily, SboBytes, SboAlign>::task_group {
+  friend class thread_pool;
+
+public:
+  explicit task_group(thread_pool& pool) noexcept : pool_(pool) {}
+  ~task_group() noexcept { (void)wait(); }
+
+  task_group(const task_group&) = delete;
+  task_group& operator=(const task_group&) = delete;
+
+  [[nodiscard]] std::expected<void, ec> wait() noexcept {
+    const current_worker& me = current();
+    const bool is_worker = me.pool == &pool_;
+    for (;;) {
+      std::size_t left = pending_.load(std::memory_order_acquire);
+      if (left == 0) break;
+      if (pool_.run_one(me.index, is_worker)) continue;
+      // Nothing to help with: the remaining tasks are running elsewhere. Sleep
+      // on the pool's word, which outlives the group; see finish().
+      const std::uint32_t e = pool_.groups_done_.load(std::memory_order_seq_cst);
+      if (pending_.load(std::memory_order_seq_cst) == 0) break;
+      pool_.groups_done_.wait(e, std::memory_order_seq_cst);
+    }
+    const ec e = error_.load(std::memory_order_acquire);
+    if (e != ec::ok) return std::unexpected(e);
+    return {};
+  }
+
+  [[nodiscard]] bool failed() const noexcept {
+    return error_.load(std::memory_order_relaxed) != ec::ok;
+  }
+
+private:
+  void record(ec e) noexcept {
+    ec expected_ok = ec::ok;
+    error_.compare_exchange_strong(expected_ok, e, std::memory_order_acq_rel);
+  }
+
+  // Once pending_ reaches zero, wait() may return and the group may be gone:
+  // nothing of it is touched after the decrement. The wake-up goes through
+  // the pool instead.
+  void finish(ec e) noexcept {
+    if (e != ec::ok) record(e);
+    thread_pool& pool = pool_;
+    if (pending_.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+      pool.groups_done_.fetch_add(1, std::memory_order_seq_cst);
+      pool.groups_done_.notify_all();
+    }
+  }
+
+  thread_pool& pool_;
+  std::atomic<std::size_t> pending_{0};
+  std::atomic<ec> error_{ec::ok};
+};
+
+} // namespace ndof
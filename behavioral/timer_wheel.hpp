@@ -0,0 +1,425 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+// Hashed hierarchical timer wheel (Varghese & Lauck), for very many timers
+// with small callbacks.
+//
+//   wheels    11 levels of 64 slots cover the whole 64-bit tick range. A timer
+//             sits at the level of the highest 6-bit group in which its expiry
+//             differs from now, and cascades one level down each time now
+//             enters its slot. Each level keeps a 64-bit occupancy mask, so
+//             advance() jumps straight to the next occupied slot.
+//   nodes     Slab-allocated from the wheel's allocator, recycled through a
+//             free list; callbacks are function_with_allocator<void()> stored
+//             inline in the node. Schedule and cancel are O(1) list operations.
+//   expiry    A level-0 slot is detached as one batch and its callbacks run
+//             back to back. Timers fire in expiry order; timers sharing a tick
+//             fire in no particular order.
+//
+// Callbacks may schedule and cancel timers, their own included. If a callback
+// throws, the timers remaining in its batch fire first on the next advance().
+//
+// Not thread-safe: a wheel belongs to one event loop. Contract: the allocator
+// must outlive the wheel.
+template <class AllocFamily = std::allocator<std::byte>,
+          std::size_t SboBytes = 3 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class timer_wheel {
+  struct node;
+
+public:
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+  using tick_type      = std::uint64_t;
+  using callback_type  = function_with_allocator<void(), allocator_type, SboBytes, SboAlign>;
+
+  static constexpr std::size_t default_slab_nodes = 1024;
+
+  // Names one scheduled timer. Stale ids (fired or cancelled) are detected.
+  class timer_id {
+  public:
+    timer_id() noexcept = default;
+
+    [[nodiscard]] bool has_value() const noexcept { return node_ != nullptr; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    friend bool operator==(const timer_id&, const timer_id&) noexcept = default;
+
+  private:
+    friend class timer_wheel;
+
+    timer_id(node* n, std::uint32_t generation) noexcept : node_(n), generation_(generation) {}
+
+    node* node_{nullptr};
+    std::uint32_t generation_{0};
+  };
+
+  explicit timer_wheel(tick_type start = 0,
+                       const allocator_type& a = allocator_type{},
+                       std::size_t slab_nodes = default_slab_nodes) noexcept
+      : alloc_(a), now_(start), slab_nodes_(slab_nodes ? slab_nodes : 1) {}
+
+  ~timer_wheel() noexcept {
+    while (slab* s = slabs_) {
+      slabs_ = s->next;
+      release_slab(s);
+    }
+  }
+
+  timer_wheel(const timer_wheel&) = delete;
+  timer_wheel& operator=(const timer_wheel&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  [[nodiscard]] tick_type now() const noexcept { return now_; }
+
+  // Scheduled timers that have not fired or been cancelled.
+  [[nodiscard]] std::size_t size() const noexcept { return armed_; }
+  [[nodiscard]] bool empty() const noexcept { return armed_ == 0; }
+
+  // Bytes held in node slabs.
+  [[nodiscard]] std::size_t memory_bytes() const noexcept { return slab_count_ * slab_bytes(); }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Fires f on the advance() that reaches now() + delay (delay 0 counts as 1).
+  // Errors: ec::alloc_failed, or whatever function_with_allocator::try_emplace reports.
+  template <class F>
+  [[nodiscard]] std::expected<timer_id, ec> try_schedule(tick_type delay, F&& f) noexcept {
+    const tick_type d = delay ? delay : 1;
+    const tick_type when = d > std::numeric_limits<tick_type>::max() - now_
+                         ? std::numeric_limits<tick_type>::max() : now_ + d;
+    return try_schedule_at(when, std::forward<F>(f));
+  }
+
+  // Fires f on the advance() that reaches when (at the next tick if when <= now()).
+  template <class F>
+  [[nodiscard]] std::expected<timer_id, ec> try_schedule_at(tick_type when, F&& f) noexcept {
+    auto n = take_node();
+    if (!n) return std::unexpected(n.error());
+    node* x = *n;
+
+    auto r = x->callback.try_emplace(std::forward<F>(f));
+    if (!r) {
+      give_back(x);
+      return std::unexpected(r.error());
+    }
+
+    x->expiry = when > now_ ? when : now_ + 1;
+    place(x);
+    ++armed_;
+    return timer_id(x, x->generation);
+  }
+
+  // Errors: ec::empty if id is empty, already fired or already cancelled.
+  [[nodiscard]] std::expected<void, ec> try_cancel(timer_id id) noexcept {
+    node* x = id.node_;
+    if (!x || x->generation != id.generation_ || !x->linked()) return std::unexpected(ec::empty);
+    unlink(x);
+    --armed_;
+    recycle(x);
+    return {};
+  }
+
+  // Moves now() to to (never backwards), firing every timer that expires on
+  // the way, in expiry order. Returns the number of callbacks run.
+  std::size_t advance(tick_type to) {
+    std::size_t fired = fire(overdue_);
+
+    while (now_ < to) {
+      if (armed_ == 0) {
+        now_ = to;
+        break;
+      }
+      const tick_type next = next_event();
+      if (next > to) {
+        now_ = to;
+        break;
+      }
+      now_ = next;
+      cascade();
+
+      const std::size_t i = now_ & slot_mask;
+      if (levels_[0].occupied & (std::uint64_t{1} << i)) {
+        node* batch = detach(0, i);
+        fired += fire(batch);
+      }
+    }
+    return fired;
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape
+  // --------------------------------------------------------------------------
+
+  // Empty id on failure.
+  template <class F>
+  [[nodiscard]] timer_id schedule(tick_type delay, F&& f) noexcept {
+    auto r = try_schedule(delay, std::forward<F>(f));
+    return r ? *r : timer_id{};
+  }
+
+  void cancel(timer_id id) noexcept { (void)try_cancel(id); }
+
+private:
+  static constexpr unsigned slot_bits  = 6;
+  static constexpr std::size_t slots   = std::size_t{1} << slot_bits;
+  static constexpr std::size_t slot_mask = slots - 1;
+  static constexpr std::size_t level_count = (64 + slot_bits - 1) / slot_bits;
+
+  // Intrusive list links: prev points at whichever pointer points at this node
+  // (a slot head or the previous node's next), so unlink needs no slot lookup.
+  struct node {
+    node* next{nullptr};
+    node** prev{nullptr};
+    tick_type expiry{0};
+    std::uint32_t generation{0};
+    std::uint8_t level{0};
+    std::uint8_t slot{0};
+    callback_type callback;
+
+    explicit node(const allocator_type& a) noexcept : callback(a) {}
+
+    bool linked() const noexcept { return prev != nullptr; }
+  };
+
+  struct level {
+    std::uint64_t occupied{0};
+    std::array<node*, slots> heads{};
+  };
+
+  struct slab {
+    slab* next;
+    node* nodes;
+  };
+
+  std::size_t slab_bytes() const noexcept { return sizeof(slab) + slab_nodes_ * sizeof(node); }
+
+  // --------------------------------------------------------------------------
+  // Wheels
+  // --------------------------------------------------------------------------
+
+  // Level 0 for a timer due now (during a cascade).
+  static unsigned level_of(tick_type expiry, tick_type now) noexcept {
+    return static_cast<unsigned>((std::bit_width((expiry ^ now) | 1) - 1) / slot_bits);
+  }
+
+  void place(node* x) noexcept {
+    const unsigned l = level_of(x->expiry, now_);
+    const auto i = static_cast<std::size_t>((x->expiry >> (l * slot_bits)) & slot_mask);
+    push_front(&levels_[l].heads[i], x);
+    levels_[l].occupied |= std::uint64_t{1} << i;
+    x->level = static_cast<std::uint8_t>(l);
+    x->slot  = static_cast<std::uint8_t>(i);
+  }
+
+  static void push_front(node** head, node* x) noexcept {
+    x->next = *head;
+    if (x->next) x->next->prev = &x->next;
+    x->prev = head;
+    *head = x;
+  }
+
+  void unlink(node* x) noexcept {
+    *x->prev = x->next;
+    if (x->next) x->next->prev = x->prev;
+    if (x->prev == &levels_[x->level].heads[x->slot] && !x->next) {
+      levels_[x->level].occupied &= ~(std::uint64_t{1} << x->slot);
+    }
+    x->next = nullptr;
+    x->prev = nullptr;
+  }
+
+  // Takes the whole list out of a slot. Its nodes stay linked to each other,
+  // with the first node's prev pointing at the returned head's holder.
+  node* detach(unsigned l, std::size_t i) noexcept {
+    node* head = levels_[l].heads[i];
+    levels_[l].heads[i] = nullptr;
+    levels_[l].occupied &= ~(std::uint64_t{1} << i);
+    return head;
+  }
+
+  // Earliest tick after now_ at which some occupied slot becomes current.
+  // Every occupied slot lies strictly ahead of now_ within its level's rotation.
+  tick_type next_event() const noexcept {
+    tick_type best = std::numeric_limits<tick_type>::max();
+    for (unsigned l = 0; l < level_count; ++l) {
+      const unsigned shift = l * slot_bits;
+      const auto cur = static_cast<unsigned>((now_ >> shift) & slot_mask);
+      const std::uint64_t ahead = cur == slot_mask ? 0 : levels_[l].occupied & (~std::uint64_t{0} << (cur + 1));
+      if (!ahead) continue;
+      const auto i = static_cast<tick_type>(std::countr_zero(ahead));
+      const unsigned rot_shift = shift + slot_bits;
+      const tick_type base = rot_shift >= 64 ? 0 : (now_ >> rot_shift) << rot_shift;
+      const tick_type t = base + (i << shift);
+      if (t < best) best = t;
+    }
+    return best;
+  }
+
+  // At now_, re-place the timers of every higher-level slot that just became
+  // current; they land on lower levels (or level 0 if due now).
+  void cascade() noexcept {
+    for (unsigned l = level_count - 1; l >= 1; --l) {
+      const unsigned shift = l * slot_bits;
+      if (now_ & ((tick_type{1} << shift) - 1)) continue;
+      const auto i = static_cast<std::size_t>((now_ >> shift) & slot_mask);
+      if (!(levels_[l].occupied & (std::uint64_t{1} << i))) continue;
+
+      node* x = detach(l, i);
+      while (x) {
+        node* next = x->next;
+        place(x);
+        x = next;
+      }
+    }
+  }
+
+  // Runs a detached batch. Each node is unlinked before its callback runs, so
+  // callbacks may cancel other members of the batch. On an exception the rest
+  // of the batch is parked in overdue_.
+  std::size_t fire(node*& batch) {
+    if (!batch) return 0;
+    node* list = batch;
+    batch = nullptr;
+    list->prev = &list;
+
+    struct park {
+      timer_wheel& self;
+      node*& list;
+      ~park() {
+        if (!list) return;
+        self.overdue_ = list;
+        list->prev = &self.overdue_;
+      }
+    } park_on_exit{*this, list};
+
+    std::size_t n = 0;
+    while (node* x = list) {
+      list = x->next;
+      if (list) list->prev = &list;
+      x->next = nullptr;
+      x->prev = nullptr;
+      --armed_;
+
+      struct release {
+        timer_wheel& self;
+        node* x;
+        ~release() { self.recycle(x); }
+      } release_on_exit{*this, x};
+
+      ++n;
+      x->callback();
+    }
+    return n;
+  }
+
+  // --------------------------------------------------------------------------
+  // Node slabs
+  // --------------------------------------------------------------------------
+
+  std::expected<node*, ec> take_node() noexcept {
+    if (!free_) {
+      auto r = grow();
+      if (!r) return std::unexpected(r.error());
+    }
+    node* x = free_;
+    free_ = x->next;
+    x->next = nullptr;
+    return x;
+  }
+
+  // An unused node goes back as is; a fired or cancelled one drops its
+  // callback and invalidates outstanding ids.
+  void give_back(node* x) noexcept {
+    x->next = free_;
+    free_ = x;
+  }
+
+  void recycle(node* x) noexcept {
+    x->callback.reset();
+    ++x->generation;
+    give_back(x);
+  }
+
+  std::expected<void, ec> grow() noexcept {
+    using slab_alloc  = typename traits::template rebind_alloc<slab>;
+    using slab_traits = std::allocator_traits<slab_alloc>;
+    using node_alloc  = typename traits::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_alloc>;
+
+    slab_alloc sa(alloc_);
+    node_alloc na(alloc_);
+    slab* s = nullptr;
+    node* nodes = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      s = slab_traits::allocate(sa, 1);
+      nodes = node_traits::allocate(na, slab_nodes_);
+    } catch (...) {
+      if (s) slab_traits::deallocate(sa, s, 1);
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    s = slab_traits::allocate(sa, 1);
+    if (!s) return std::unexpected(ec::alloc_failed);
+    nodes = node_traits::allocate(na, slab_nodes_);
+    if (!nodes) {
+      slab_traits::deallocate(sa, s, 1);
+      return std::unexpected(ec::alloc_failed);
+    }
+#endif
+    std::construct_at(s, slab{slabs_, nodes});
+    slabs_ = s;
+    ++slab_count_;
+    for (std::size_t i = slab_nodes_; i-- > 0;) {
+      give_back(std::construct_at(nodes + i, alloc_));
+    }
+    return {};
+  }
+
+  void release_slab(slab* s) noexcept {
+    using slab_alloc  = typename traits::template rebind_alloc<slab>;
+    using slab_traits = std::allocator_traits<slab_alloc>;
+    using node_alloc  = typename traits::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_alloc>;
+
+    slab_alloc sa(alloc_);
+    node_alloc na(alloc_);
+    std::destroy_n(s->nodes, slab_nodes_);
+    node_traits::deallocate(na, s->nodes, slab_nodes_);
+    std::destroy_at(s);
+    slab_traits::deallocate(sa, s, 1);
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  tick_type now_{0};
+  std::size_t armed_{0};
+  std::array<level, level_count> levels_{};
+  node* overdue_{nullptr};
+  node* free_{nullptr};
+  slab* slabs_{nullptr};
+  std::size_t slab_count_{0};
+  std::size_t slab_nodes_{default_slab_nodes};
+};
+
+} // namespace ndof
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class... Ts> struct type_list
+//   template<class T> constexpr const void* type_id() noexcept
+
+namespace detail {
+
+  template <class T, class... Ts>
+  inline constexpr std::size_t visit_index = [] {
+    constexpr bool hits[] = {std::is_same_v<T, Ts>..., false};
+    for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+      if (hits[i]) return i;
+    }
+    return sizeof...(Ts);
+  }();
+
+  // A closed_cloneable hierarchy (or one of its bases): dense tag on the object.
+  template <class T>
+  concept visit_closed = requires(const T& t) {
+    { t.type_index() } -> std::integral;
+    T::npos;
+  };
+
+  // any_with_allocator (or anything shaped like it).
+  template <class T>
+  concept visit_any = requires(T& t) {
+    { t.held_type_id() } -> std::same_as<const void*>;
+    { t.data() } -> std::same_as<void*>;
+  };
+
+  // Normalizes a visitor's result to std::expected<Result, ec>.
+  template <class Result, class V, class E>
+  std::expected<Result, ec> visitor_call(V& v, E& e) {
+    using R = std::remove_cvref_t<std::invoke_result_t<V&, E&>>;
+    if constexpr (std::is_same_v<R, std::expected<Result, ec>>) {
+      return v(e);
+    } else if constexpr (std::is_void_v<Result>) {
+      v(e);
+      return {};
+    } else {
+      static_assert(std::is_convertible_v<R, Result>,
+                    "A visitor returns Result, std::expected<Result, ec>, or anything when Result is void.");
+      return v(e);
+    }
+  }
+
+} // namespace detail
+
+template <class Result, class Visitors, class Elements>
+class visitor_table;
+
+// Visitor pattern with double dispatch through one compile-time 2D table.
+//
+// Visitors and element types are closed lists; each gets a dense id (its
+// position). The table holds one thunk per (visitor, element) pair, so
+//
+//   table.try_visit(visitor, element)
+//
+// is one indexed load plus one call: no dynamic_cast chain, no accept()/visit()
+// virtual pair, and neither side needs a vtable. A visitor is any object with
+// operator()(E&) overloads (a generic catch-all works); a pair it cannot take
+// dispatches to a thunk reporting ec::type_mismatch.
+//
+// Elements are passed as
+//   E&                    one of Elements..., dense id known statically;
+//   closed_cloneable root the object's one-byte tag; used as the column when
+//                         Elements... follow the hierarchy's order, remapped
+//                         through a small constexpr array otherwise;
+//   any_with_allocator    the held type, looked up in a tiny hash table built
+//                         once per visitor_table (one probe in the common case).
+//
+// Visitors return Result, std::expected<Result, ec>, or anything if Result is
+// void. Exceptions from visitors propagate.
+template <class Result, class... Vs, class... Es>
+class visitor_table<Result, type_list<Vs...>, type_list<Es...>> {
+public:
+  static_assert(sizeof...(Vs) > 0 && sizeof...(Es) > 0, "A visitor table needs visitors and elements.");
+
+  using result_type = std::expected<Result, ec>;
+  using thunk_type  = result_type (*)(void*, void*);
+
+  static constexpr std::size_t visitor_count = sizeof...(Vs);
+  static constexpr std::size_t element_count = sizeof...(Es);
+
+  template <class V>
+  static constexpr std::size_t visitor_id = detail::visit_index<V, Vs...>;
+
+  template <class E>
+  static constexpr std::size_t element_id = detail::visit_index<E, Es...>;
+
+  // Type-erased visitor: object pointer and table row.
+  class visitor_ref {
+  public:
+    template <class V>
+    requires (visitor_id<V> < visitor_count)
+    visitor_ref(V& v) noexcept : self_(std::addressof(v)), row_(visitor_id<V> * columns) {}
+
+  private:
+    friend class visitor_table;
+    void* self_;
+    std::size_t row_;
+  };
+
+  // Type-erased element: object pointer, the table to use for it and its column.
+  class element_ref {
+  public:
+    template <class T>
+    requires (!std::is_const_v<T> && !std::is_same_v<T, element_ref>)
+    element_ref(T& x) noexcept {
+      if constexpr (element_id<T> < element_count) {
+        self_ = std::addressof(x);
+        table_ = direct_table.data();
+        column_ = element_id<T>;
+      } else if constexpr (detail::visit_any<T>) {
+        self_ = x.data();
+        table_ = direct_table.data();
+        column_ = self_ ? any_column(x.held_type_id()) : empty_column;
+      } else if constexpr (detail::visit_closed<T>) {
+        self_ = std::addressof(x);
+        table_ = closed_table<T>.data();
+        column_ = closed_column<T>(static_cast<std::size_t>(x.type_index()));
+      } else {
+        static_assert(element_id<T> < element_count,
+                      "Elements are one of Es..., a closed_cloneable root, or an any_with_allocator.");
+      }
+    }
+
+    // Dense element id, or element_count if the element is not in the list.
+    [[nodiscard]] std::size_t id() const noexcept { return column_ < element_count ? column_ : element_count; }
+
+  private:
+    friend class visitor_table;
+    void* self_{nullptr};
+    const thunk_type* table_{nullptr};
+    std::size_t column_{0};
+  };
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::type_mismatch if the element's type is not listed or the
+  //         visitor has no overload for it, ec::empty for an empty any,
+  //         or whatever the visitor returns.
+  static result_type try_visit(visitor_ref v, element_ref e) {
+    return e.table_[v.row_ + e.column_](v.self_, e.self_);
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns false on failure
+  // --------------------------------------------------------------------------
+
+  // Result is discarded.
+  static bool visit(visitor_ref v, element_ref e) { return try_visit(v, e).has_value(); }
+
+  template <class R = Result>
+  requires (!std::is_void_v<R>)
+  static R visit_or(visitor_ref v, element_ref e, R fallback) {
+    auto r = try_visit(v, e);
+    return r ? std::move(*r) : std::move(fallback);
+  }
+
+private:
+  // Two extra columns per row: unlisted type, empty any.
+  static constexpr std::size_t mismatch_column = element_count;
+  static constexpr std::size_t empty_column    = element_count + 1;
+  static constexpr std::size_t columns         = element_count + 2;
+
+  // Source is the static type the element pointer was taken as: void when it
+  // already points at the E, the closed root otherwise.
+  template <class Source, class V, class E>
+  static result_type thunk(void* v, void* e) {
+    if constexpr (!std::is_invocable_v<V&, E&>) {
+      return std::unexpected(ec::type_mismatch);
+    } else if constexpr (std::is_void_v<Source>) {
+      return detail::visitor_call<Result>(*static_cast<V*>(v), *static_cast<E*>(e));
+    } else if constexpr (std::derived_from<E, Source>) {
+      return detail::visitor_call<Result>(*static_cast<V*>(v), static_cast<E&>(*static_cast<Source*>(e)));
+    } else {
+      return std::unexpected(ec::type_mismatch);
+    }
+  }
+
+  static result_type mismatch(void*, void*) { return std::unexpected(ec::type_mismatch); }
+  static result_type empty(void*, void*) { return std::unexpected(ec::empty); }
+
+  template <class Source, class V>
+  static constexpr void fill_row(std::array<thunk_type, visitor_count * columns>& t) {
+    constexpr std::size_t row = visitor_id<V> * columns;
+    ((t[row + element_id<Es>] = &thunk<Source, V, Es>), ...);
+    t[row + mismatch_column] = &mismatch;
+    t[row + empty_column] = &empty;
+  }
+
+  template <class Source>
+  static constexpr std::array<thunk_type, visitor_count * columns> make_table() {
+    std::array<thunk_type, visitor_count * columns> t{};
+    (fill_row<Source, Vs>(t), ...);
+    return t;
+  }
+
+  static constexpr std::array<thunk_type, visitor_count * columns> direct_table = make_table<void>();
+
+  template <class Root>
+  static constexpr std::array<thunk_type, visitor_count * columns> closed_table = make_table<Root>();
+
+  // Hierarchy tag -> column. Sized by the largest tag among Es...; other tags
+  // are not listed and map to the mismatch column.
+  template <class Root>
+  static constexpr std::size_t closed_tag_of(std::size_t i) noexcept {
+    constexpr std::size_t tags[] = {static_cast<std::size_t>(Root::template index_of<Es>)...};
+    return tags[i];
+  }
+
+  template <class Root>
+  static constexpr auto closed_remap = [] {
+    constexpr std::size_t npos = static_cast<std::size_t>(Root::npos);
+    constexpr std::size_t size = [] {
+      std::size_t n = 0;
+      for (std::size_t i = 0; i < element_count; ++i) {
+        if (closed_tag_of<Root>(i) != npos) n = std::max(n, closed_tag_of<Root>(i) + 1);
+      }
+      return n;
+    }();
+    std::array<std::uint16_t, size> m{};
+    m.fill(static_cast<std::uint16_t>(mismatch_column));
+    for (std::size_t i = 0; i < element_count; ++i) {
+      if (closed_tag_of<Root>(i) != npos) m[closed_tag_of<Root>(i)] = static_cast<std::uint16_t>(i);
+    }
+    return m;
+  }();
+
+  template <class Root>
+  static constexpr bool closed_identity = [] {
+    for (std::size_t i = 0; i < element_count; ++i) {
+      if (closed_tag_of<Root>(i) != i) return false;
+    }
+    return true;
+  }();
+
+  // Same order as the hierarchy: the tag is the column, no remap load on the
+  // path to the call.
+  template <class Root>
+  static std::size_t closed_column(std::size_t tag) noexcept {
+    if constexpr (closed_identity<Root>) {
+      return tag < element_count ? tag : mismatch_column;
+    } else {
+      constexpr auto& m = closed_remap<Root>;
+      return tag < m.size() ? m[tag] : mismatch_column;
+    }
+  }
+
+  // Open-addressed type_id -> column map for any_with_allocator elements.
+  struct any_index {
+    static constexpr std::size_t size = std::bit_ceil(2 * element_count);
+    static constexpr unsigned shift = 64 - static_cast<unsigned>(std::countr_zero(size));
+
+    const void* keys[size]{};
+    std::uint16_t columns_[size]{};
+
+    // Fibonacci hashing on the address.
+    static std::size_t slot(const void* key) noexcept {
+      const auto k = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+      return static_cast<std::size_t>((k * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+
+    any_index() noexcept {
+      const void* ids[] = {type_id<Es>()...};
+      for (std::size_t i = 0; i < element_count; ++i) {
+        std::size_t s = slot(ids[i]);
+        while (keys[s]) s = (s + 1) & (size - 1);
+        keys[s] = ids[i];
+        columns_[s] = static_cast<std::uint16_t>(i);
+      }
+    }
+
+    std::size_t find(const void* key) const noexcept {
+      for (std::size_t s = slot(key);; s = (s + 1) & (size - 1)) {
+        if (keys[s] == key) return columns_[s];
+        if (!keys[s]) return mismatch_column;
+      }
+    }
+  };
+
+  static std::size_t any_column(const void* tid) noexcept {
+    static const any_index index;
+    return index.find(tid);
+  }
+};
+
+} // namespace ndof
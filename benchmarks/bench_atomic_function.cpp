@@ -0,0 +1,111 @@
+// File: benchmarks/bench_atomic_function.cpp
+//
+// Reader scaling of a hot-swappable int(int) callback: every thread calls it
+// in a loop, and thread 0 also publishes a new callable every 4096 calls.
+//   - ndof::atomic_function (wait-free calls, epoch reclamation)
+//   - std::function behind a std::mutex
+//   - std::function behind a std::shared_mutex (shared lock per call)
+//   - std::atomic<std::shared_ptr<const std::function>> (load per call)
+// Run with ThreadRange to see how each call path scales with readers.
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/atomic_function.hpp"
+
+namespace {
+
+constexpr std::size_t swap_every = 4096;
+
+struct handler {
+    int k;
+    int operator()(int x) const noexcept { return x + k; }
+};
+
+void BM_atomic_function(benchmark::State& state) {
+    static ndof::atomic_function<int(int)> f;
+    if (state.thread_index() == 0) (void)f.store(handler{1});
+    int x = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        x = f(x & 1023);
+        benchmark::DoNotOptimize(x);
+        if (state.thread_index() == 0 && ++i % swap_every == 0) (void)f.store(handler{static_cast<int>(i & 7)});
+    }
+}
+
+void BM_mutex_function(benchmark::State& state) {
+    static std::mutex m;
+    static std::function<int(int)> f;
+    if (state.thread_index() == 0) f = handler{1};
+    int x = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        {
+            std::scoped_lock lock(m);
+            x = f(x & 1023);
+        }
+        benchmark::DoNotOptimize(x);
+        if (state.thread_index() == 0 && ++i % swap_every == 0) {
+            std::function<int(int)> next = handler{static_cast<int>(i & 7)};
+            std::scoped_lock lock(m);
+            f.swap(next);
+        }
+    }
+}
+
+void BM_shared_mutex_function(benchmark::State& state) {
+    static std::shared_mutex m;
+    static std::function<int(int)> f;
+    if (state.thread_index() == 0) f = handler{1};
+    int x = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        {
+            std::shared_lock lock(m);
+            x = f(x & 1023);
+        }
+        benchmark::DoNotOptimize(x);
+        if (state.thread_index() == 0 && ++i % swap_every == 0) {
+            std::function<int(int)> next = handler{static_cast<int>(i & 7)};
+            std::unique_lock lock(m);
+            f.swap(next);
+        }
+    }
+}
+
+void BM_atomic_shared_ptr(benchmark::State& state) {
+    using ptr = std::shared_ptr<const std::function<int(int)>>;
+    static std::atomic<ptr> f;
+    if (state.thread_index() == 0) f.store(std::make_shared<const std::function<int(int)>>(handler{1}));
+    int x = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        x = (*f.load())(x & 1023);
+        benchmark::DoNotOptimize(x);
+        if (state.thread_index() == 0 && ++i % swap_every == 0) {
+            f.store(std::make_shared<const std::function<int(int)>>(handler{static_cast<int>(i & 7)}));
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_atomic_function)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_mutex_function)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_shared_mutex_function)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_atomic_shared_ptr)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+// File: benchmarks/bench_command_buffer.cpp
+//
+// Record-then-execute of 1024 small commands per frame:
+//   - ndof::command_buffer (one ring, no per-command allocation)
+//   - std::vector<std::function<void()>> as the baseline
+// Half of the commands capture 40 bytes, past std::function's inline buffer.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "behavioral/command_buffer.hpp"
+
+namespace {
+
+constexpr std::size_t k_commands = 1024;
+
+void BM_command_buffer_frame(benchmark::State& state) {
+    ndof::command_buffer<> cb(128 * 1024);
+    std::uint64_t sink = 0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < k_commands; ++i) {
+            if (i & 1) {
+                (void)cb.push([&sink, pad = std::array<std::uint64_t, 5>{i}] { sink += pad[0]; });
+            } else {
+                (void)cb.push([&sink, i] { sink += i; });
+            }
+        }
+        benchmark::DoNotOptimize(cb.execute());
+    }
+    benchmark::DoNotOptimize(sink);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(k_commands));
+}
+
+void BM_vector_of_std_function_frame(benchmark::State& state) {
+    std::vector<std::function<void()>> queue;
+    queue.reserve(k_commands);
+    std::uint64_t sink = 0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < k_commands; ++i) {
+            if (i & 1) {
+                queue.emplace_back([&sink, pad = std::array<std::uint64_t, 5>{i}] { sink += pad[0]; });
+            } else {
+                queue.emplace_back([&sink, i] { sink += i; });
+            }
+        }
+        for (auto& f : queue) f();
+        queue.clear();
+    }
+    benchmark::DoNotOptimize(sink);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(k_commands));
+}
+
+} // namespace
+
+BENCHMARK(BM_command_buffer_frame);
+BENCHMARK(BM_vector_of_std_function_frame);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,145 @@
+// File: benchmarks/bench_decorate.cpp
+//
+// A callable wrapped in 3 decorators (argument check, call counter, result
+// adjust), stored as a type-erased ndof::function_with_allocator<int(int)>:
+//   - nested: each layer is its own function_with_allocator capturing the
+//     inner one (one storage block, ops table and indirect call per layer)
+//   - fused: ndof::decorate(f, d1, d2, d3) in a single function_with_allocator
+// Call benchmarks measure one invocation; build benchmarks construct and
+// destroy the stack and report heap allocations per build.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "structural/decorator/decorate.hpp"
+
+namespace {
+
+std::size_t g_allocations = 0;
+
+template <class T>
+struct counting_allocator {
+    using value_type = T;
+    counting_allocator() = default;
+    template <class U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+    T* allocate(std::size_t n) {
+        ++g_allocations;
+        return std::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T* p, std::size_t n) noexcept { std::allocator<T>{}.deallocate(p, n); }
+    friend bool operator==(counting_allocator, counting_allocator) noexcept { return true; }
+};
+
+using fn = ndof::function_with_allocator<int(int), counting_allocator<std::byte>>;
+
+struct target {
+    int operator()(int x) const noexcept { return x * 3; }
+};
+
+struct checked {
+    int operator()(auto& next, int x) const { return x < 0 ? 0 : next(x); }
+};
+
+struct counted {
+    std::uint64_t* calls;
+    int operator()(auto& next, int x) const {
+        ++*calls;
+        return next(x);
+    }
+};
+
+struct adjusted {
+    int operator()(auto& next, int x) const { return next(x) + 1; }
+};
+
+// Nested wrappers: the layer holds the inner type-erased function.
+template <class D>
+struct layer {
+    mutable fn inner;
+    D d;
+    int operator()(int x) const {
+        auto next = [this](int y) { return inner(y); };
+        return d(next, x);
+    }
+};
+
+template <class D>
+fn wrap(fn inner, D d) {
+    fn out;
+    (void)out.try_emplace(layer<D>{std::move(inner), d});
+    return out;
+}
+
+fn build_nested(std::uint64_t* calls) {
+    fn f;
+    (void)f.try_emplace(target{});
+    return wrap(wrap(wrap(std::move(f), checked{}), counted{calls}), adjusted{});
+}
+
+void build_fused(fn& f, std::uint64_t* calls) {
+    (void)ndof::try_emplace_decorated(f, target{}, checked{}, counted{calls}, adjusted{});
+}
+
+void BM_decorate_nested_call(benchmark::State& state) {
+    std::uint64_t calls = 0;
+    fn f = build_nested(&calls);
+    int x = 1;
+    for (auto _ : state) {
+        x = f(x & 1023);
+        benchmark::DoNotOptimize(x);
+    }
+}
+
+void BM_decorate_fused_call(benchmark::State& state) {
+    std::uint64_t calls = 0;
+    fn f;
+    build_fused(f, &calls);
+    int x = 1;
+    for (auto _ : state) {
+        x = f(x & 1023);
+        benchmark::DoNotOptimize(x);
+    }
+}
+
+void BM_decorate_nested_build(benchmark::State& state) {
+    std::uint64_t calls = 0;
+    const std::size_t before = g_allocations;
+    for (auto _ : state) {
+        fn f = build_nested(&calls);
+        benchmark::DoNotOptimize(f);
+    }
+    state.counters["allocs_per_build"] =
+        static_cast<double>(g_allocations - before) / static_cast<double>(state.iterations());
+}
+
+void BM_decorate_fused_build(benchmark::State& state) {
+    std::uint64_t calls = 0;
+    const std::size_t before = g_allocations;
+    for (auto _ : state) {
+        fn f;
+        build_fused(f, &calls);
+        benchmark::DoNotOptimize(f);
+    }
+    state.counters["allocs_per_build"] =
+        static_cast<double>(g_allocations - before) / static_cast<double>(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_decorate_nested_call);
+BENCHMARK(BM_decorate_fused_call);
+BENCHMARK(BM_decorate_nested_build);
+BENCHMARK(BM_decorate_fused_build);
+
+BENCHMARK_MAIN();
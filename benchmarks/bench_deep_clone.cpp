@@ -0,0 +1,165 @@
+// File: benchmarks/bench_deep_clone.cpp
+//
+// Deep clone of a DAG with shared sub-nodes, 10^5 .. 10^6 nodes:
+//   - ndof::try_deep_clone into a pmr arena and into std::allocator
+//   - the by-hand baseline: std::unordered_map memo + one clone() per node
+// followed by a walk over the cloned graph to show the locality difference.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/ICloneable.hpp"
+#include "creational/deep_clone.hpp"
+
+namespace {
+
+// Binary-heap shaped tree (left/right) plus one random cross edge per node,
+// so most nodes are shared by two parents.
+struct Node : ICloneable<Node> {
+    Node* left{nullptr};
+    Node* right{nullptr};
+    Node* shared{nullptr};
+    std::uint64_t payload{0};
+
+    Node() = default;
+    Node(const Node&) = default;
+
+    void for_each_ref(ndof::ref_visitor<Node> v) const noexcept {
+        v(left);
+        v(right);
+        v(shared);
+    }
+};
+
+struct graph {
+    std::vector<Node> nodes;
+
+    explicit graph(std::size_t n) : nodes(n) {
+        std::mt19937_64 rng(42);
+        for (std::size_t i = 0; i < n; ++i) {
+            nodes[i].payload = i;
+            if (2 * i + 1 < n) nodes[i].left  = &nodes[2 * i + 1];
+            if (2 * i + 2 < n) nodes[i].right = &nodes[2 * i + 2];
+            nodes[i].shared = &nodes[rng() % n];
+        }
+    }
+
+    const Node& root() const { return nodes.front(); }
+};
+
+const graph& graph_of(std::size_t n) {
+    static std::unordered_map<std::size_t, std::unique_ptr<graph>> cache;
+    auto& g = cache[n];
+    if (!g) g = std::make_unique<graph>(n);
+    return *g;
+}
+
+// Iterative DFS that touches every node once; shared nodes are revisited, as a
+// typical rule evaluator would.
+std::uint64_t walk(const Node* root, std::size_t budget) {
+    std::vector<const Node*> stack{root};
+    std::uint64_t sum = 0;
+    while (!stack.empty() && budget--) {
+        const Node* n = stack.back();
+        stack.pop_back();
+        sum += n->payload;
+        if (n->left)  stack.push_back(n->left);
+        if (n->right) stack.push_back(n->right);
+    }
+    return sum;
+}
+
+// The by-hand approach this facility replaces.
+using owned_node = decltype(std::declval<const Node&>().clone());
+
+std::vector<owned_node> clone_by_hand(const Node& root) {
+    std::unordered_map<const Node*, Node*> memo;
+    std::vector<owned_node> owned;
+    std::vector<const Node*> todo{&root};
+
+    while (!todo.empty()) {
+        const Node* n = todo.back();
+        todo.pop_back();
+        if (memo.contains(n)) continue;
+        owned.push_back(n->clone());
+        memo.emplace(n, owned.back().get());
+        for (const Node* c : {n->left, n->right, n->shared}) {
+            if (c && !memo.contains(c)) todo.push_back(c);
+        }
+    }
+    for (auto& c : owned) {
+        if (c->left)   c->left   = memo[c->left];
+        if (c->right)  c->right  = memo[c->right];
+        if (c->shared) c->shared = memo[c->shared];
+    }
+    return owned;
+}
+
+void BM_deep_clone_arena(benchmark::State& state) {
+    const graph& g = graph_of(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        std::pmr::monotonic_buffer_resource arena;
+        auto r = ndof::try_deep_clone(g.root(), std::pmr::polymorphic_allocator<std::byte>(&arena));
+        if (!r) state.SkipWithError("deep clone failed");
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_deep_clone_std_allocator(benchmark::State& state) {
+    const graph& g = graph_of(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto r = ndof::try_deep_clone(g.root(), std::allocator<std::byte>{});
+        if (!r) state.SkipWithError("deep clone failed");
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_clone_by_hand(benchmark::State& state) {
+    const graph& g = graph_of(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto r = clone_by_hand(g.root());
+        benchmark::DoNotOptimize(r);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_walk_after_deep_clone(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    auto r = ndof::try_deep_clone(graph_of(n).root(), std::allocator<std::byte>{});
+    if (!r) {
+        state.SkipWithError("deep clone failed");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(walk(&(*r)[0], n));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_walk_after_clone_by_hand(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    auto r = clone_by_hand(graph_of(n).root());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(walk(r.front().get(), n));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_deep_clone_arena)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_deep_clone_std_allocator)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_clone_by_hand)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_walk_after_deep_clone)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_walk_after_clone_by_hand)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+// File: benchmarks/bench_event_bus.cpp
+//
+// Publish-to-delivery throughput: P producer threads publish 2^16 small
+// events each over 256 topics, one counting subscriber per topic, and the
+// iteration ends when every event has been delivered.
+//   - ndof::event_bus (sharded queues, batched publishers, stealing dispatchers)
+//   - a mutex-protected std::unordered_map<topic, std::vector<std::function>>
+//     mediator delivering std::any events synchronously, as the baseline
+// Items are events delivered.
+
+#include <benchmark/benchmark.h>
+
+#include <any>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "structural/proxy/any_with_allocator.hpp"
+#include "behavioral/event_bus.hpp"
+
+namespace {
+
+constexpr std::uint64_t k_topics = 256;
+constexpr std::uint64_t k_events_per_producer = 1 << 16;
+
+struct quote {
+    std::uint64_t id;
+    double price;
+};
+
+void BM_event_bus(benchmark::State& state) {
+    const auto producers = static_cast<std::size_t>(state.range(0));
+    using bus_type = ndof::event_bus<>;
+    bus_type bus;
+    std::atomic<std::uint64_t> delivered{0};
+    for (std::uint64_t t = 0; t < k_topics; ++t) {
+        (void)bus.subscribe<quote>(t, [&delivered](const quote& q) {
+            if (q.price >= 0) delivered.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&bus, p] {
+                bus_type::publisher pub(bus);
+                for (std::uint64_t i = 0; i < k_events_per_producer; ++i) {
+                    while (!pub.publish<quote>(i % k_topics, quote{i, double(p)})) std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        bus.wait_idle();
+    }
+    benchmark::DoNotOptimize(delivered.load());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(producers * k_events_per_producer));
+}
+
+struct locked_mediator {
+    std::mutex mutex;
+    std::unordered_map<std::uint64_t, std::vector<std::function<void(const std::any&)>>> topics;
+
+    void publish(std::uint64_t topic, std::any event) {
+        std::lock_guard lock(mutex);
+        auto it = topics.find(topic);
+        if (it == topics.end()) return;
+        for (auto& f : it->second) f(event);
+    }
+};
+
+void BM_locked_map_mediator(benchmark::State& state) {
+    const auto producers = static_cast<std::size_t>(state.range(0));
+    locked_mediator m;
+    std::atomic<std::uint64_t> delivered{0};
+    for (std::uint64_t t = 0; t < k_topics; ++t) {
+        m.topics[t].push_back([&delivered](const std::any& e) {
+            if (const auto* q = std::any_cast<quote>(&e); q && q->price >= 0) {
+                delivered.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (std::size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&m, p] {
+                for (std::uint64_t i = 0; i < k_events_per_producer; ++i) m.publish(i % k_topics, quote{i, double(p)});
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+    benchmark::DoNotOptimize(delivered.load());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(producers * k_events_per_producer));
+}
+
+} // namespace
+
+BENCHMARK(BM_event_bus)->Arg(1)->Arg(4)->UseRealTime();
+BENCHMARK(BM_locked_map_mediator)->Arg(1)->Arg(4)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,143 @@
+// File: benchmarks/bench_flat_composite.cpp
+//
+// Bottom-up aggregation and top-down propagation over a random recursive tree
+// of 10^6 nodes (each node's parent drawn uniformly from the nodes before it):
+//   - ndof::flat_composite with a double hot field: linear scans
+//   - the classic pointer composite (children vectors, nodes allocated in
+//     shuffled order, as after a long-lived process has churned its heap),
+//     walked recursively
+// Items are nodes visited per pass.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "structural/composite/flat_composite.hpp"
+
+namespace {
+
+constexpr std::size_t k_nodes = 1'000'000;
+
+// parent[i] < i; node 0 is the root.
+std::vector<std::uint32_t> random_parents() {
+    std::mt19937 rng(11);
+    std::vector<std::uint32_t> parent(k_nodes, 0);
+    for (std::size_t i = 1; i < k_nodes; ++i) parent[i] = static_cast<std::uint32_t>(rng() % i);
+    return parent;
+}
+
+struct cold {
+    std::string name;
+    std::uint64_t id;
+};
+
+using flat = ndof::flat_composite<cold, double>;
+
+std::unique_ptr<flat> build_flat() {
+    auto parent = random_parents();
+    auto tree = std::make_unique<flat>();
+    (void)tree->try_reserve(k_nodes);
+    // Inserted in preorder, so every insert_child is an append: no gap moves
+    // and an O(depth) size fix-up.
+    std::vector<std::vector<std::uint32_t>> kids(k_nodes);
+    for (std::size_t i = 1; i < k_nodes; ++i) kids[parent[i]].push_back(static_cast<std::uint32_t>(i));
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack{{0u, flat::npos}};
+    while (!stack.empty()) {
+        auto [n, at_parent] = stack.back();
+        stack.pop_back();
+        const auto pos = at_parent == flat::npos ? tree->append_root(cold{"node", n}, 1.0)
+                                                 : tree->insert_child(at_parent, cold{"node", n}, 1.0);
+        for (auto it = kids[n].rbegin(); it != kids[n].rend(); ++it) stack.push_back({*it, pos});
+    }
+    tree->compact();
+    return tree;
+}
+
+struct pnode {
+    double value{1.0};
+    cold payload;
+    std::vector<pnode*> children;
+};
+
+struct pointer_tree {
+    std::vector<std::unique_ptr<pnode>> owned;
+    pnode* root{nullptr};
+
+    pointer_tree() {
+        auto parent = random_parents();
+        std::vector<std::uint32_t> order(k_nodes);
+        for (std::size_t i = 0; i < k_nodes; ++i) order[i] = static_cast<std::uint32_t>(i);
+        std::shuffle(order.begin(), order.end(), std::mt19937(5));
+        std::vector<pnode*> by_id(k_nodes);
+        owned.resize(k_nodes);
+        for (auto id : order) {
+            owned[id] = std::make_unique<pnode>();
+            owned[id]->payload = cold{"node", id};
+            by_id[id] = owned[id].get();
+        }
+        for (std::size_t i = 1; i < k_nodes; ++i) by_id[parent[i]]->children.push_back(by_id[i]);
+        root = by_id[0];
+    }
+};
+
+double sum_up(pnode* n) {
+    double s = n->value;
+    for (pnode* c : n->children) s += sum_up(c);
+    return s;
+}
+
+void scale_down(pnode* n, double f) {
+    n->value = n->value * 0.5 + f;
+    for (pnode* c : n->children) scale_down(c, n->value);
+}
+
+void BM_flat_bottom_up(benchmark::State& state) {
+    static auto tree = build_flat();
+    auto hot = tree->hots();
+    for (auto _ : state) {
+        std::fill(hot.begin(), hot.end(), 1.0);
+        tree->bottom_up([](double& p, const double& c) { p += c; });
+        benchmark::DoNotOptimize(hot[0]);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+void BM_pointer_bottom_up(benchmark::State& state) {
+    static pointer_tree tree;
+    for (auto _ : state) benchmark::DoNotOptimize(sum_up(tree.root));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+void BM_flat_top_down(benchmark::State& state) {
+    static auto tree = build_flat();
+    for (auto _ : state) {
+        tree->top_down([](const double& p, double& c) { c = c * 0.5 + p; });
+        benchmark::DoNotOptimize(tree->hot(0));
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+void BM_pointer_top_down(benchmark::State& state) {
+    static pointer_tree tree;
+    for (auto _ : state) {
+        scale_down(tree.root, 0.0);
+        benchmark::DoNotOptimize(tree.root->value);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+} // namespace
+
+BENCHMARK(BM_flat_bottom_up)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_pointer_bottom_up)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_flat_top_down)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_pointer_top_down)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
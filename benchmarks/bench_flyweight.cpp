@@ -0,0 +1,125 @@
+// File: benchmarks/bench_flyweight.cpp
+//
+// Interning a 10^7-item stream of strings drawn from 10^5 distinct values
+// (Zipf-like skew, as in tag/attribute names):
+//   - ndof::intern_table: build + memory reported vs. storing every string
+//   - lock-free lookups of already interned values, 1..N threads
+//   - baseline: std::unordered_set<std::string> behind a std::mutex
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "structural/flyweight/flyweight.hpp"
+
+namespace {
+
+constexpr std::size_t k_items    = 10'000'000;
+constexpr std::size_t k_distinct = 100'000;
+
+struct string_hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+using table_type = ndof::intern_table<std::string, string_hash, std::equal_to<>>;
+
+// Distinct values are long enough to defeat SSO, so duplicates cost real memory.
+const std::vector<std::string>& vocabulary() {
+    static const std::vector<std::string> v = [] {
+        std::vector<std::string> out;
+        out.reserve(k_distinct);
+        for (std::size_t i = 0; i < k_distinct; ++i) {
+            out.push_back("attribute/namespace/value-" + std::to_string(i));
+        }
+        return out;
+    }();
+    return v;
+}
+
+// Indices into vocabulary(), skewed toward low ids.
+const std::vector<std::uint32_t>& stream() {
+    static const std::vector<std::uint32_t> s = [] {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::vector<std::uint32_t> out(k_items);
+        for (auto& i : out) {
+            i = static_cast<std::uint32_t>(std::pow(u(rng), 3.0) * (k_distinct - 1));
+        }
+        return out;
+    }();
+    return s;
+}
+
+void BM_intern_build(benchmark::State& state) {
+    const auto& voc = vocabulary();
+    const auto& ids = stream();
+    std::size_t table_bytes = 0;
+    for (auto _ : state) {
+        table_type t;
+        std::vector<ndof::flyweight<std::string>> handles;
+        handles.reserve(ids.size());
+        for (auto id : ids) handles.push_back(t.intern(std::string_view(voc[id])));
+        benchmark::DoNotOptimize(handles.data());
+        table_bytes = t.memory_bytes() + t.size() * voc.front().capacity()
+                    + handles.size() * sizeof(handles.front());
+    }
+    // Bytes needed to hold every item as its own std::string.
+    const std::size_t naive_bytes = ids.size() * (sizeof(std::string) + voc.front().capacity() + 1);
+    state.counters["interned_MB"] = static_cast<double>(table_bytes) / (1 << 20);
+    state.counters["naive_MB"]    = static_cast<double>(naive_bytes) / (1 << 20);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(ids.size()));
+}
+
+table_type& shared_table() {
+    static table_type t;
+    static const bool filled = [] {
+        for (const auto& s : vocabulary()) (void)t.intern(std::string_view(s));
+        return true;
+    }();
+    (void)filled;
+    return t;
+}
+
+void BM_intern_lookup(benchmark::State& state) {
+    auto& t = shared_table();
+    const auto& voc = vocabulary();
+    const auto& ids = stream();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(t.intern(std::string_view(voc[ids[i++ % ids.size()]])));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_mutex_unordered_set_lookup(benchmark::State& state) {
+    static std::mutex mtx;
+    static std::unordered_set<std::string, string_hash, std::equal_to<>> set(vocabulary().begin(),
+                                                                             vocabulary().end());
+    const auto& voc = vocabulary();
+    const auto& ids = stream();
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 7919;
+    for (auto _ : state) {
+        std::scoped_lock lock(mtx);
+        benchmark::DoNotOptimize(&*set.emplace(voc[ids[i++ % ids.size()]]).first);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_intern_build)->Unit(benchmark::kMillisecond)->Iterations(1);
+BENCHMARK(BM_intern_lookup)->ThreadRange(1, 64);
+BENCHMARK(BM_mutex_unordered_set_lookup)->ThreadRange(1, 64);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,105 @@
+// File: benchmarks/bench_memento_store.cpp
+//
+// Checkpoint + undo of a 64 MiB and 256 MiB state where 64 pages (256 KiB)
+// change between checkpoints:
+//   - ndof::memento_store over a paged_arena, write-barrier and mprotect
+//     tracking (incremental: only dirty pages are copied either way)
+//   - full deep copy of the state into a checkpoint buffer and back, the
+//     baseline
+// Each iteration dirties the pages, takes a checkpoint, dirties them again
+// and restores the checkpoint. Bytes are the state size per iteration.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "behavioral/memento_store.hpp"
+
+namespace {
+
+constexpr std::size_t k_page = 4096;
+
+struct xorshift {
+    std::uint64_t s = 0x9E3779B97F4A7C15ull;
+    std::uint64_t operator()() noexcept {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    }
+};
+
+template <ndof::memento_tracking Tracking>
+void BM_memento_incremental(benchmark::State& state) {
+    const auto bytes = static_cast<std::size_t>(state.range(0)) << 20;
+    const auto dirty = static_cast<std::size_t>(state.range(1));
+    ndof::paged_arena<> arena({.capacity_bytes = bytes, .page_size = k_page, .tracking = Tracking});
+    ndof::memento_store<> store(arena);
+    auto* data = static_cast<std::byte*>(arena.allocate(bytes, k_page));
+    if (!data) {
+        state.SkipWithError("arena allocation failed");
+        return;
+    }
+    std::memset(data, 1, bytes);
+    const auto base = store.snapshot();
+    const std::size_t pages = bytes / k_page;
+    xorshift rng;
+
+    auto scribble = [&] {
+        for (std::size_t i = 0; i < dirty; ++i) {
+            std::byte& b = data[(rng() % pages) * k_page + rng() % k_page];
+            if constexpr (Tracking == ndof::memento_tracking::write_barrier) arena.write(b) = std::byte{2};
+            else b = std::byte{2};
+        }
+    };
+
+    for (auto _ : state) {
+        scribble();
+        const auto id = store.snapshot();
+        scribble();
+        store.restore(id);
+        benchmark::DoNotOptimize(data);
+        // Drop the checkpoint again so history does not grow across iterations.
+        state.PauseTiming();
+        store.restore(base);
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+}
+
+void BM_memento_deep_copy(benchmark::State& state) {
+    const auto bytes = static_cast<std::size_t>(state.range(0)) << 20;
+    const auto dirty = static_cast<std::size_t>(state.range(1));
+    std::vector<std::byte> data(bytes, std::byte{1});
+    std::vector<std::byte> checkpoint(bytes);
+    const std::size_t pages = bytes / k_page;
+    xorshift rng;
+
+    auto scribble = [&] {
+        for (std::size_t i = 0; i < dirty; ++i) data[(rng() % pages) * k_page + rng() % k_page] = std::byte{2};
+    };
+
+    for (auto _ : state) {
+        scribble();
+        std::memcpy(checkpoint.data(), data.data(), bytes);
+        scribble();
+        std::memcpy(data.data(), checkpoint.data(), bytes);
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_memento_incremental, ndof::memento_tracking::write_barrier)
+    ->Args({64, 64})->Args({256, 64})->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_memento_incremental, ndof::memento_tracking::mprotect)
+    ->Args({64, 64})->Args({256, 64})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_memento_deep_copy)->Args({64, 64})->Args({256, 64})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,105 @@
+// File: benchmarks/bench_pipeline.cpp
+//
+// A five-stage request chain (counter, auth check, middleware, two field
+// writers):
+//   - ndof::pipeline with all five handlers static (fused, one call chain)
+//   - ndof::pipeline with the last two handlers as function_with_allocator
+//     plugins (dynamic tail)
+//   - std::function handlers, each hop calling the next through std::function,
+//     as the baseline
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/pipeline.hpp"
+
+namespace {
+
+struct request {
+    std::uint64_t id = 0;
+    std::uint64_t seen = 0;
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+    int depth = 0;
+};
+
+auto count_stage = [](request& r) { ++r.seen; };
+auto auth_stage  = [](request& r) { return (r.id & 1023) != 1023; };
+auto scope_stage = [](request& r, auto& next) -> std::expected<void, ndof::ec> {
+    ++r.depth;
+    auto res = next();
+    --r.depth;
+    return res;
+};
+auto write_a = [](request& r) { r.a += r.id; };
+auto write_b = [](request& r) { r.b ^= r.id; };
+
+void BM_pipeline_static(benchmark::State& state) {
+    auto p = ndof::make_pipeline<request>(count_stage, auth_stage, scope_stage, write_a, write_b);
+    request r;
+    for (auto _ : state) {
+        ++r.id;
+        benchmark::DoNotOptimize(p.try_run(r));
+    }
+    benchmark::DoNotOptimize(r);
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_pipeline_dynamic_tail(benchmark::State& state) {
+    auto p = ndof::make_pipeline<request>(count_stage, auth_stage, scope_stage);
+    (void)p.push_back(write_a);
+    (void)p.push_back(write_b);
+    request r;
+    for (auto _ : state) {
+        ++r.id;
+        benchmark::DoNotOptimize(p.try_run(r));
+    }
+    benchmark::DoNotOptimize(r);
+    state.SetItemsProcessed(state.iterations());
+}
+
+using std_next    = std::function<bool(request&)>;
+using std_handler = std::function<bool(request&, const std_next&)>;
+
+void BM_std_function_chain(benchmark::State& state) {
+    std::vector<std_handler> handlers{
+        [](request& r, const std_next& n) { ++r.seen; return n(r); },
+        [](request& r, const std_next& n) { return (r.id & 1023) != 1023 ? n(r) : true; },
+        [](request& r, const std_next& n) { ++r.depth; bool ok = n(r); --r.depth; return ok; },
+        [](request& r, const std_next& n) { r.a += r.id; return n(r); },
+        [](request& r, const std_next& n) { r.b ^= r.id; return n(r); },
+    };
+    std::vector<std_next> nexts(handlers.size() + 1);
+    nexts.back() = [](request&) { return true; };
+    for (std::size_t i = handlers.size(); i-- > 0;) {
+        nexts[i] = [&handlers, &nexts, i](request& r) { return handlers[i](r, nexts[i + 1]); };
+    }
+
+    request r;
+    for (auto _ : state) {
+        ++r.id;
+        benchmark::DoNotOptimize(nexts[0](r));
+    }
+    benchmark::DoNotOptimize(r);
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_pipeline_static);
+BENCHMARK(BM_pipeline_dynamic_tail);
+BENCHMARK(BM_std_function_chain);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+// File: benchmarks/bench_signal.cpp
+//
+// Emit latency of ndof::signal at 1, 10 and 1000 connected slots:
+//   - signal_mode::concurrent (epoch-protected, lock-free emit)
+//   - signal_mode::single_threaded (no atomics)
+//   - std::vector<std::function<void(int)>> as the baseline
+// Every slot is a small capturing lambda that fits the SBO buffer.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/signal.hpp"
+
+namespace {
+
+template <ndof::signal_mode Mode>
+void BM_signal_emit(benchmark::State& state) {
+    ndof::signal<void(int), std::allocator<std::byte>, Mode> sig;
+    std::uint64_t sink = 0;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        (void)sig.connect([&sink, i](int x) { sink += static_cast<std::uint64_t>(x + i); });
+    }
+    int x = 0;
+    for (auto _ : state) {
+        sig.emit(++x);
+    }
+    benchmark::DoNotOptimize(sink);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_vector_of_std_function_emit(benchmark::State& state) {
+    std::vector<std::function<void(int)>> slots;
+    std::uint64_t sink = 0;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        slots.emplace_back([&sink, i](int x) { sink += static_cast<std::uint64_t>(x + i); });
+    }
+    int x = 0;
+    for (auto _ : state) {
+        ++x;
+        for (auto& f : slots) f(x);
+    }
+    benchmark::DoNotOptimize(sink);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_signal_emit, ndof::signal_mode::concurrent)->Arg(1)->Arg(10)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_signal_emit, ndof::signal_mode::single_threaded)->Arg(1)->Arg(10)->Arg(1000);
+BENCHMARK(BM_vector_of_std_function_emit)->Arg(1)->Arg(10)->Arg(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,82 @@
+// File: benchmarks/bench_simd_strategy.cpp
+//
+// Every variant of the reference kernels (ndof::kernels::sum / dot), forced
+// one at a time through simd_strategy::force, on the same inputs from 1 Ki
+// to 1 Mi floats. Variants this CPU cannot run are reported as
+// skipped. "best" is the variant bound at startup.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "behavioral/simd_kernels.hpp"
+
+namespace {
+
+std::vector<float> make_input(std::size_t n, std::uint32_t seed) {
+    std::vector<float> v(n);
+    for (auto& x : v) {
+        seed = seed * 1664525u + 1013904223u;
+        x = static_cast<float>(seed >> 8) / 16777216.0f - 0.5f;
+    }
+    return v;
+}
+
+template <class Strategy>
+bool select(benchmark::State& state, Strategy& s, int level) {
+    if (level < 0) {
+        s.bind_best();
+        state.SetLabel(ndof::to_string(s.level()));
+        return true;
+    }
+    if (!s.force(static_cast<ndof::simd_level>(level))) {
+        state.SkipWithError("variant not supported on this CPU");
+        return false;
+    }
+    return true;
+}
+
+void BM_sum(benchmark::State& state, int level) {
+    const auto x = make_input(static_cast<std::size_t>(state.range(0)), 1);
+    if (!select(state, ndof::kernels::sum, level)) return;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ndof::kernels::sum(x));
+    }
+    ndof::kernels::sum.bind_best();
+    state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<std::int64_t>(sizeof(float)));
+}
+
+void BM_dot(benchmark::State& state, int level) {
+    const auto a = make_input(static_cast<std::size_t>(state.range(0)), 1);
+    const auto b = make_input(static_cast<std::size_t>(state.range(0)), 2);
+    if (!select(state, ndof::kernels::dot, level)) return;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ndof::kernels::dot(a, b));
+    }
+    ndof::kernels::dot.bind_best();
+    state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<std::int64_t>(2 * sizeof(float)));
+}
+
+void register_all() {
+    for (int level = -1; level < static_cast<int>(ndof::simd_level_count); ++level) {
+        const std::string name = level < 0 ? "best" : ndof::to_string(static_cast<ndof::simd_level>(level));
+        benchmark::RegisterBenchmark(("BM_sum/" + name).c_str(), BM_sum, level)->Range(1 << 10, 1 << 20)->RangeMultiplier(64);
+        benchmark::RegisterBenchmark(("BM_dot/" + name).c_str(), BM_dot, level)->Range(1 << 10, 1 << 20)->RangeMultiplier(64);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    register_all();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,109 @@
+// File: benchmarks/bench_state_machine.cpp
+//
+// A header/body line parser driven one byte at a time over a 64 KiB buffer:
+//   - ndof::state_machine (constexpr (state, event) table, inlined actions)
+//   - a dense (state, byte class) table of std::function as the baseline
+// Items are bytes processed.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/state_machine.hpp"
+
+namespace {
+
+struct key {};
+struct value {};
+
+struct colon { char c; };
+struct newline { char c; };
+struct other { char c; };
+
+struct parse_ctx {
+    std::uint64_t key_hash = 0;
+    std::uint64_t value_sum = 0;
+    std::uint64_t fields = 0;
+};
+
+struct hash_key {
+    void operator()(parse_ctx& c, const other& e) const noexcept { c.key_hash = c.key_hash * 31 + static_cast<unsigned char>(e.c); }
+};
+struct sum_value {
+    void operator()(parse_ctx& c, const other& e) const noexcept { c.value_sum += static_cast<unsigned char>(e.c); }
+};
+struct end_field {
+    void operator()(parse_ctx& c) const noexcept { ++c.fields; }
+};
+
+using parser_table = ndof::transition_table<
+    ndof::transition<key, other, key, hash_key>,
+    ndof::transition<key, colon, value>,
+    ndof::transition<value, other, value, sum_value>,
+    ndof::transition<value, colon, value>,
+    ndof::transition<value, newline, key, end_field>,
+    ndof::transition<key, newline, key>>;
+
+std::vector<char> make_input() {
+    std::vector<char> in;
+    while (in.size() < 64 * 1024) {
+        for (char c : std::string_view("content-length: 1234\nhost: example.org\n")) in.push_back(c);
+    }
+    return in;
+}
+
+void BM_state_machine_parse(benchmark::State& state) {
+    const auto in = make_input();
+    ndof::state_machine<parse_ctx, parser_table> m;
+    for (auto _ : state) {
+        for (char c : in) {
+            if (c == ':') (void)m.try_process(colon{c});
+            else if (c == '\n') (void)m.try_process(newline{c});
+            else (void)m.try_process(other{c});
+        }
+    }
+    benchmark::DoNotOptimize(m.context().fields);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+
+void BM_std_function_table_parse(benchmark::State& state) {
+    const auto in = make_input();
+    parse_ctx ctx;
+    std::size_t current = 0;
+    // [state][class]: class 0 = other, 1 = colon, 2 = newline.
+    std::array<std::array<std::function<void(char)>, 3>, 2> table{{
+        {{[&](char c) { ctx.key_hash = ctx.key_hash * 31 + static_cast<unsigned char>(c); },
+          [&](char) { current = 1; },
+          [&](char) {}}},
+        {{[&](char c) { ctx.value_sum += static_cast<unsigned char>(c); },
+          [&](char) {},
+          [&](char) { ++ctx.fields; current = 0; }}},
+    }};
+    for (auto _ : state) {
+        for (char c : in) {
+            const std::size_t cls = c == ':' ? 1 : c == '\n' ? 2 : 0;
+            table[current][cls](c);
+        }
+    }
+    benchmark::DoNotOptimize(ctx.fields);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+
+} // namespace
+
+BENCHMARK(BM_state_machine_parse);
+BENCHMARK(BM_std_function_table_parse);
+
+BENCHMARK_MAIN();
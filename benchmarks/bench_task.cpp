@@ -0,0 +1,92 @@
+// File: benchmarks/bench_task.cpp
+//
+// One parent ndof::task awaiting 16 child tasks, run with sync_wait, with
+// coroutine frames from:
+//   - std::allocator (the global heap, as a plain coroutine type would)
+//   - std::pmr::unsynchronized_pool_resource (frames recycled by size class)
+//   - std::pmr::monotonic_buffer_resource over a stack buffer, released
+//     after every run
+// Reports global-heap allocations per task alongside the time.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/task.hpp"
+#include "structural/proxy/tests/global_new_counter.hpp"
+
+namespace {
+
+constexpr int children = 16;
+
+using pmr_alloc = std::pmr::polymorphic_allocator<std::byte>;
+
+ndof::task<int> heap_child(int x) { co_return x + 1; }
+
+ndof::task<int> heap_parent() {
+    int s = 0;
+    for (int i = 0; i < children; ++i) s += *co_await heap_child(i);
+    co_return s;
+}
+
+ndof::task<int, pmr_alloc> pmr_child(std::allocator_arg_t, pmr_alloc, int x) { co_return x + 1; }
+
+ndof::task<int, pmr_alloc> pmr_parent(std::allocator_arg_t, pmr_alloc a) {
+    int s = 0;
+    for (int i = 0; i < children; ++i) s += *co_await pmr_child(std::allocator_arg, a, i);
+    co_return s;
+}
+
+void report(benchmark::State& state, std::size_t before) {
+    state.counters["heap_allocs_per_task"] = static_cast<double>(ndof::test::global_new_calls() - before) /
+                                             static_cast<double>(state.iterations() * (children + 1));
+}
+
+void BM_task_std_allocator(benchmark::State& state) {
+    const std::size_t before = ndof::test::global_new_calls();
+    for (auto _ : state) {
+        auto r = ndof::sync_wait(heap_parent());
+        benchmark::DoNotOptimize(r);
+    }
+    report(state, before);
+}
+
+void BM_task_pmr_pool(benchmark::State& state) {
+    std::pmr::unsynchronized_pool_resource pool;
+    (void)ndof::sync_wait(pmr_parent(std::allocator_arg, &pool)); // warm the size classes
+    const std::size_t before = ndof::test::global_new_calls();
+    for (auto _ : state) {
+        auto r = ndof::sync_wait(pmr_parent(std::allocator_arg, &pool));
+        benchmark::DoNotOptimize(r);
+    }
+    report(state, before);
+}
+
+void BM_task_pmr_monotonic(benchmark::State& state) {
+    alignas(std::max_align_t) static std::array<std::byte, 1 << 16> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    const std::size_t before = ndof::test::global_new_calls();
+    for (auto _ : state) {
+        auto r = ndof::sync_wait(pmr_parent(std::allocator_arg, &arena));
+        benchmark::DoNotOptimize(r);
+        arena.release();
+    }
+    report(state, before);
+}
+
+} // namespace
+
+BENCHMARK(BM_task_std_allocator);
+BENCHMARK(BM_task_pmr_pool);
+BENCHMARK(BM_task_pmr_monotonic);
+
+BENCHMARK_MAIN();
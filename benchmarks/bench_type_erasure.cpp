@@ -0,0 +1,322 @@
+// File: benchmarks/bench_type_erasure.cpp
+//
+// The type-erasure primitives against their std counterparts, per operation:
+// construct, copy, move, invoke (any: access) and destroy, each timed over a
+// batch of 64 objects (items_per_second counts objects).
+//
+//   callables   ndof::function_with_allocator<int(int), Alloc, SboBytes>
+//               vs std::function<int(int)> and std::move_only_function<int(int)>
+//   values      ndof::any_with_allocator<Alloc, SboBytes> vs std::any
+//
+// Matrix: SboBytes 16 / 32 / 64; payloads of 16, 32, 64 and 128 bytes, so
+// every SBO size sees payloads on both sides of its limit; and std::allocator,
+// std::pmr::unsynchronized_pool_resource and std::pmr::monotonic_buffer_resource
+// for the ndof types (the std types have no allocator support). Copies into
+// an ndof object use its allocator (try_copy_from), not the allocator's
+// select_on_container_copy_construction. heap_allocs_per_op counts calls to
+// the global operator new (every form; see tests/global_new_counter.cpp).
+//
+// basic_proxy (structural/proxy/proxy.hpp) is not in the matrix: it is still
+// a sketch and does not compile.
+//
+// Export for regression tracking:
+//   bench_type_erasure --benchmark_out=type_erasure.json --benchmark_out_format=json
+// (the bench_type_erasure_json target does this).
+
+#include <benchmark/benchmark.h>
+
+#include <any>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "structural/proxy/any_with_allocator.hpp"
+#include "structural/proxy/tests/global_new_counter.hpp"
+
+namespace {
+
+constexpr std::size_t batch = 64;
+
+// A payload of exactly N bytes: callable as int(int), nothrow to copy and move.
+template <std::size_t N>
+struct payload {
+    unsigned char bytes[N];
+
+    explicit payload(int seed) noexcept {
+        std::memset(bytes, 0, N);
+        bytes[0] = static_cast<unsigned char>(seed);
+    }
+
+    int operator()(int x) const noexcept { return x + bytes[0]; }
+};
+
+enum class op { construct, copy, move, invoke, destroy };
+
+const char* op_name(op o) {
+    switch (o) {
+        case op::construct: return "construct";
+        case op::copy: return "copy";
+        case op::move: return "move";
+        case op::invoke: return "invoke";
+        case op::destroy: return "destroy";
+    }
+    return "";
+}
+
+// Where an allocator-aware object's memory comes from.
+enum class source { std_alloc, pool, monotonic };
+
+std::pmr::unsynchronized_pool_resource& pool_resource() {
+    static std::pmr::unsynchronized_pool_resource r;
+    return r;
+}
+
+std::pmr::monotonic_buffer_resource& monotonic_resource() {
+    static std::pmr::monotonic_buffer_resource r(1 << 20);
+    return r;
+}
+
+// Between batches, once nothing allocated from it is alive.
+void recycle(source s) {
+    if (s == source::monotonic) monotonic_resource().release();
+}
+
+// ----------------------------------------------------------------------------
+// Subjects: how to make, copy, move and use each wrapper.
+// ----------------------------------------------------------------------------
+
+template <class Alloc>
+Alloc allocator_for(source s) {
+    if constexpr (std::is_same_v<Alloc, std::pmr::polymorphic_allocator<std::byte>>) {
+        switch (s) {
+            case source::pool: return Alloc(&pool_resource());
+            case source::monotonic: return Alloc(&monotonic_resource());
+            case source::std_alloc: break;
+        }
+        return Alloc(std::pmr::new_delete_resource());
+    } else {
+        return Alloc{};
+    }
+}
+
+template <class Alloc, std::size_t Sbo, std::size_t N>
+struct fwa_subject {
+    using type = ndof::function_with_allocator<int(int), Alloc, Sbo>;
+    static constexpr bool copyable = true;
+
+    static void make(type* p, source s, int i) {
+        const Alloc a = allocator_for<Alloc>(s);
+        std::construct_at(p, a);
+        (void)p->try_emplace(payload<N>(i));
+    }
+    static void copy(type* p, const type& from, source s) {
+        const Alloc a = allocator_for<Alloc>(s);
+        std::construct_at(p, a);
+        (void)p->try_copy_from(from);
+    }
+    static void move(type* p, type& from) { std::construct_at(p, std::move(from)); }
+    static int use(type& f, int x) { return f(x); }
+};
+
+template <class Alloc, std::size_t Sbo, std::size_t N>
+struct any_subject {
+    using type = ndof::any_with_allocator<Alloc, Sbo>;
+    static constexpr bool copyable = true;
+
+    static void make(type* p, source s, int i) {
+        const Alloc a = allocator_for<Alloc>(s);
+        std::construct_at(p, a);
+        (void)p->template try_emplace<payload<N>>(i);
+    }
+    static void copy(type* p, const type& from, source s) {
+        const Alloc a = allocator_for<Alloc>(s);
+        std::construct_at(p, a);
+        (void)p->try_copy_from(from);
+    }
+    static void move(type* p, type& from) { std::construct_at(p, std::move(from)); }
+    static int use(type& a, int x) { return (*a.template get_if<payload<N>>())(x); }
+};
+
+template <std::size_t N>
+struct std_function_subject {
+    using type = std::function<int(int)>;
+    static constexpr bool copyable = true;
+
+    static void make(type* p, source, int i) { std::construct_at(p, payload<N>(i)); }
+    static void copy(type* p, const type& from, source) { std::construct_at(p, from); }
+    static void move(type* p, type& from) { std::construct_at(p, std::move(from)); }
+    static int use(type& f, int x) { return f(x); }
+};
+
+template <std::size_t N>
+struct std_move_only_function_subject {
+    using type = std::move_only_function<int(int)>;
+    static constexpr bool copyable = false;
+
+    static void make(type* p, source, int i) { std::construct_at(p, payload<N>(i)); }
+    static void copy(type*, const type&, source) {}
+    static void move(type* p, type& from) { std::construct_at(p, std::move(from)); }
+    static int use(type& f, int x) { return f(x); }
+};
+
+template <std::size_t N>
+struct std_any_subject {
+    using type = std::any;
+    static constexpr bool copyable = true;
+
+    static void make(type* p, source, int i) { std::construct_at(p, std::in_place_type<payload<N>>, i); }
+    static void copy(type* p, const type& from, source) { std::construct_at(p, from); }
+    static void move(type* p, type& from) { std::construct_at(p, std::move(from)); }
+    static int use(type& a, int x) { return (*std::any_cast<payload<N>>(&a))(x); }
+};
+
+// Raw storage for a batch of S::type.
+template <class S>
+struct slots {
+    using T = typename S::type;
+    alignas(T) std::byte raw[batch * sizeof(T)];
+
+    T* at(std::size_t i) { return std::launder(reinterpret_cast<T*>(raw + i * sizeof(T))); }
+    void make_all(source s) {
+        for (std::size_t i = 0; i < batch; ++i) S::make(at(i), s, static_cast<int>(i));
+    }
+    void destroy_all() {
+        for (std::size_t i = 0; i < batch; ++i) std::destroy_at(at(i));
+    }
+};
+
+template <class S>
+void run(benchmark::State& state, op o, source s) {
+    auto src = std::make_unique<slots<S>>();
+    auto dst = std::make_unique<slots<S>>();
+    std::size_t allocations = 0;
+    int x = 0;
+
+    // Copy sources come from the global heap: their lifetime spans batches,
+    // and the monotonic resource is released after each one.
+    if (o == op::copy || o == op::invoke) src->make_all(o == op::copy ? source::std_alloc : s);
+
+    for (auto _ : state) {
+        switch (o) {
+            case op::construct: {
+                const std::size_t before = ndof::test::global_new_calls();
+                dst->make_all(s);
+                allocations += ndof::test::global_new_calls() - before;
+                state.PauseTiming();
+                dst->destroy_all();
+                recycle(s);
+                state.ResumeTiming();
+                break;
+            }
+            case op::copy: {
+                const std::size_t before = ndof::test::global_new_calls();
+                for (std::size_t i = 0; i < batch; ++i) S::copy(dst->at(i), *src->at(i), s);
+                allocations += ndof::test::global_new_calls() - before;
+                state.PauseTiming();
+                dst->destroy_all();
+                recycle(s);
+                state.ResumeTiming();
+                break;
+            }
+            case op::move: {
+                state.PauseTiming();
+                src->make_all(s);
+                state.ResumeTiming();
+                const std::size_t before = ndof::test::global_new_calls();
+                for (std::size_t i = 0; i < batch; ++i) S::move(dst->at(i), *src->at(i));
+                allocations += ndof::test::global_new_calls() - before;
+                state.PauseTiming();
+                src->destroy_all();
+                dst->destroy_all();
+                recycle(s);
+                state.ResumeTiming();
+                break;
+            }
+            case op::invoke: {
+                for (std::size_t i = 0; i < batch; ++i) x = S::use(*src->at(i), x & 1023);
+                benchmark::DoNotOptimize(x);
+                break;
+            }
+            case op::destroy: {
+                state.PauseTiming();
+                dst->make_all(s);
+                state.ResumeTiming();
+                dst->destroy_all();
+                state.PauseTiming();
+                recycle(s);
+                state.ResumeTiming();
+                break;
+            }
+        }
+    }
+
+    if (o == op::copy || o == op::invoke) src->destroy_all();
+    recycle(s);
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * batch));
+    state.counters["heap_allocs_per_op"] =
+        static_cast<double>(allocations) / static_cast<double>(state.iterations() * batch);
+}
+
+template <class S>
+void register_ops(const std::string& name, source s) {
+    for (op o : {op::construct, op::copy, op::move, op::invoke, op::destroy}) {
+        if (o == op::copy && !S::copyable) continue;
+        benchmark::RegisterBenchmark((name + "/" + op_name(o)).c_str(), run<S>, o, s);
+    }
+}
+
+template <std::size_t N>
+std::string payload_tag() {
+    return "/payload:" + std::to_string(N);
+}
+
+template <std::size_t Sbo, std::size_t N>
+void register_ndof() {
+    using std_alloc = std::allocator<std::byte>;
+    using pmr_alloc = std::pmr::polymorphic_allocator<std::byte>;
+    const std::string fwa = "fwa<sbo=" + std::to_string(Sbo) + ">" + payload_tag<N>();
+    const std::string any = "any_with_allocator<sbo=" + std::to_string(Sbo) + ">" + payload_tag<N>();
+
+    register_ops<fwa_subject<std_alloc, Sbo, N>>(fwa + "/alloc:std", source::std_alloc);
+    register_ops<fwa_subject<pmr_alloc, Sbo, N>>(fwa + "/alloc:pmr_pool", source::pool);
+    register_ops<fwa_subject<pmr_alloc, Sbo, N>>(fwa + "/alloc:pmr_monotonic", source::monotonic);
+    register_ops<any_subject<std_alloc, Sbo, N>>(any + "/alloc:std", source::std_alloc);
+    register_ops<any_subject<pmr_alloc, Sbo, N>>(any + "/alloc:pmr_pool", source::pool);
+    register_ops<any_subject<pmr_alloc, Sbo, N>>(any + "/alloc:pmr_monotonic", source::monotonic);
+}
+
+template <std::size_t N>
+void register_payload() {
+    register_ndof<16, N>();
+    register_ndof<32, N>();
+    register_ndof<64, N>();
+    register_ops<std_function_subject<N>>("std::function" + payload_tag<N>(), source::std_alloc);
+    register_ops<std_move_only_function_subject<N>>("std::move_only_function" + payload_tag<N>(), source::std_alloc);
+    register_ops<std_any_subject<N>>("std::any" + payload_tag<N>(), source::std_alloc);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    register_payload<16>();
+    register_payload<32>();
+    register_payload<64>();
+    register_payload<128>();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
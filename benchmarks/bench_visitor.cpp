@@ -0,0 +1,224 @@
+// File: benchmarks/bench_visitor.cpp
+//
+// Double dispatch over 4096 nodes of 8 kinds in random order:
+//   - ndof::visitor_table over a closed_cloneable hierarchy (tag -> table)
+//   - ndof::visitor_table over any_with_allocator elements (type id -> table)
+//   - classic virtual accept()/visit() pair, the baseline
+//   - dynamic_cast chain, the other baseline
+// Every visit adds a kind-dependent function of the node's payload, so all
+// variants do the same work. Items are nodes visited.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/any_with_allocator.hpp"
+#include "creational/closed_cloneable.hpp"
+#include "behavioral/visitor.hpp"
+
+namespace {
+
+constexpr std::size_t k_nodes = 4096;
+constexpr int k_kinds = 8;
+
+std::vector<int> kinds() {
+    std::mt19937 rng(7);
+    std::vector<int> k(k_nodes);
+    for (auto& x : k) x = static_cast<int>(rng() % k_kinds);
+    return k;
+}
+
+template <int I>
+constexpr std::uint64_t weigh(std::uint64_t v) noexcept {
+    return v * (I + 1) + I;
+}
+
+// ---- closed hierarchy + visitor_table --------------------------------------
+
+template <int I>
+struct ck;
+
+struct cnode : ndof::closed_cloneable<cnode, ndof::type_list<ck<0>, ck<1>, ck<2>, ck<3>,
+                                                            ck<4>, ck<5>, ck<6>, ck<7>>> {
+    std::uint64_t v{0};
+};
+
+template <int I>
+struct ck : ndof::closed_leaf<ck<I>, cnode> {};
+
+struct closed_eval {
+    std::uint64_t acc{0};
+    template <int I>
+    void operator()(ck<I>& n) noexcept { acc += weigh<I>(n.v); }
+};
+
+using closed_table = ndof::visitor_table<void, ndof::type_list<closed_eval>,
+                                         ndof::type_list<ck<0>, ck<1>, ck<2>, ck<3>,
+                                                         ck<4>, ck<5>, ck<6>, ck<7>>>;
+
+void BM_visitor_table_closed(benchmark::State& state) {
+    std::tuple<std::vector<ck<0>>, std::vector<ck<1>>, std::vector<ck<2>>, std::vector<ck<3>>,
+               std::vector<ck<4>>, std::vector<ck<5>>, std::vector<ck<6>>, std::vector<ck<7>>> storage;
+    std::apply([](auto&... v) { (v.reserve(k_nodes), ...); }, storage);
+    std::vector<cnode*> nodes;
+    std::uint64_t payload = 0;
+    for (int k : kinds()) {
+        [&]<int... Is>(std::integer_sequence<int, Is...>) {
+            ((k == Is ? (void)(nodes.push_back(&std::get<Is>(storage).emplace_back()), nodes.back()->v = payload++)
+                      : void()), ...);
+        }(std::make_integer_sequence<int, k_kinds>{});
+    }
+
+    closed_eval eval;
+    for (auto _ : state) {
+        for (cnode* n : nodes) (void)closed_table::try_visit(eval, *n);
+        benchmark::DoNotOptimize(eval.acc);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+// ---- any_with_allocator + visitor_table ------------------------------------
+
+template <int I>
+struct ak {
+    std::uint64_t v;
+};
+
+struct any_eval {
+    std::uint64_t acc{0};
+    template <int I>
+    void operator()(ak<I>& n) noexcept { acc += weigh<I>(n.v); }
+};
+
+using any_table = ndof::visitor_table<void, ndof::type_list<any_eval>,
+                                      ndof::type_list<ak<0>, ak<1>, ak<2>, ak<3>,
+                                                      ak<4>, ak<5>, ak<6>, ak<7>>>;
+
+void BM_visitor_table_any(benchmark::State& state) {
+    std::vector<ndof::any_with_allocator<>> nodes(k_nodes);
+    std::uint64_t payload = 0;
+    std::size_t i = 0;
+    for (int k : kinds()) {
+        [&]<int... Is>(std::integer_sequence<int, Is...>) {
+            ((k == Is ? (void)nodes[i].template emplace_ptr<ak<Is>>(ak<Is>{payload}) : void()), ...);
+        }(std::make_integer_sequence<int, k_kinds>{});
+        ++payload;
+        ++i;
+    }
+
+    any_eval eval;
+    for (auto _ : state) {
+        for (auto& n : nodes) (void)any_table::try_visit(eval, n);
+        benchmark::DoNotOptimize(eval.acc);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+// ---- virtual accept/visit and dynamic_cast baselines ------------------------
+
+template <int I>
+struct vk;
+
+struct vvisitor {
+    virtual ~vvisitor() = default;
+    virtual void visit(vk<0>&) = 0;
+    virtual void visit(vk<1>&) = 0;
+    virtual void visit(vk<2>&) = 0;
+    virtual void visit(vk<3>&) = 0;
+    virtual void visit(vk<4>&) = 0;
+    virtual void visit(vk<5>&) = 0;
+    virtual void visit(vk<6>&) = 0;
+    virtual void visit(vk<7>&) = 0;
+};
+
+struct vnode {
+    virtual ~vnode() = default;
+    virtual void accept(vvisitor& v) = 0;
+    std::uint64_t v{0};
+};
+
+template <int I>
+struct vk final : vnode {
+    void accept(vvisitor& x) override { x.visit(*this); }
+};
+
+struct virtual_eval final : vvisitor {
+    std::uint64_t acc{0};
+    void visit(vk<0>& n) override { acc += weigh<0>(n.v); }
+    void visit(vk<1>& n) override { acc += weigh<1>(n.v); }
+    void visit(vk<2>& n) override { acc += weigh<2>(n.v); }
+    void visit(vk<3>& n) override { acc += weigh<3>(n.v); }
+    void visit(vk<4>& n) override { acc += weigh<4>(n.v); }
+    void visit(vk<5>& n) override { acc += weigh<5>(n.v); }
+    void visit(vk<6>& n) override { acc += weigh<6>(n.v); }
+    void visit(vk<7>& n) override { acc += weigh<7>(n.v); }
+};
+
+// Same layout as the closed nodes: one vector per kind, visited in random order.
+struct virtual_nodes {
+    std::tuple<std::vector<vk<0>>, std::vector<vk<1>>, std::vector<vk<2>>, std::vector<vk<3>>,
+               std::vector<vk<4>>, std::vector<vk<5>>, std::vector<vk<6>>, std::vector<vk<7>>> storage;
+    std::vector<vnode*> nodes;
+
+    virtual_nodes() {
+        std::apply([](auto&... v) { (v.reserve(k_nodes), ...); }, storage);
+        std::uint64_t payload = 0;
+        for (int k : kinds()) {
+            [&]<int... Is>(std::integer_sequence<int, Is...>) {
+                ((k == Is ? (void)nodes.push_back(&std::get<Is>(storage).emplace_back()) : void()), ...);
+            }(std::make_integer_sequence<int, k_kinds>{});
+            nodes.back()->v = payload++;
+        }
+    }
+};
+
+void BM_visitor_virtual(benchmark::State& state) {
+    virtual_nodes vn;
+    virtual_eval eval;
+    vvisitor& visitor = eval;
+    for (auto _ : state) {
+        for (vnode* n : vn.nodes) n->accept(visitor);
+        benchmark::DoNotOptimize(eval.acc);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+void BM_visitor_dynamic_cast(benchmark::State& state) {
+    virtual_nodes vn;
+    std::uint64_t acc = 0;
+    for (auto _ : state) {
+        for (vnode* p : vn.nodes) {
+            if (auto* a = dynamic_cast<vk<0>*>(p)) acc += weigh<0>(a->v);
+            else if (auto* b = dynamic_cast<vk<1>*>(p)) acc += weigh<1>(b->v);
+            else if (auto* c = dynamic_cast<vk<2>*>(p)) acc += weigh<2>(c->v);
+            else if (auto* d = dynamic_cast<vk<3>*>(p)) acc += weigh<3>(d->v);
+            else if (auto* e = dynamic_cast<vk<4>*>(p)) acc += weigh<4>(e->v);
+            else if (auto* f = dynamic_cast<vk<5>*>(p)) acc += weigh<5>(f->v);
+            else if (auto* g = dynamic_cast<vk<6>*>(p)) acc += weigh<6>(g->v);
+            else if (auto* h = dynamic_cast<vk<7>*>(p)) acc += weigh<7>(h->v);
+        }
+        benchmark::DoNotOptimize(acc);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * k_nodes));
+}
+
+} // namespace
+
+BENCHMARK(BM_visitor_table_closed);
+BENCHMARK(BM_visitor_table_any);
+BENCHMARK(BM_visitor_virtual);
+BENCHMARK(BM_visitor_dynamic_cast);
+
+BENCHMARK_MAIN();
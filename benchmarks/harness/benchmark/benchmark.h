@@ -0,0 +1,713 @@
+// File: benchmarks/harness/benchmark/benchmark.h
+//
+// A small, header-only stand-in for Google Benchmark, used when no system
+// installation is found (and fetching is off). It implements the subset of
+// the API the benchmarks in this tree use:
+//
+//   State         range-for / KeepRunning, range(), iterations(),
+//                 thread_index(), threads(), Pause/ResumeTiming,
+//                 SetItemsProcessed, SetBytesProcessed, SetLabel,
+//                 SkipWithError, counters
+//   registration  BENCHMARK, BENCHMARK_TEMPLATE, RegisterBenchmark, and
+//                 Arg, Args, Range, RangeMultiplier, ThreadRange, Threads,
+//                 Iterations, MinTime, Unit, UseRealTime
+//   flags         --benchmark_filter, --benchmark_min_time,
+//                 --benchmark_format, --benchmark_out,
+//                 --benchmark_out_format, --benchmark_list_tests
+//
+// Iteration counts grow until a run lasts --benchmark_min_time, as in Google
+// Benchmark, and the JSON output uses the same field names, so its
+// comparison tools read either. No repetitions, aggregates or complexity fits.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace benchmark {
+
+using IterationCount = std::int64_t;
+
+enum TimeUnit { kNanosecond, kMicrosecond, kMillisecond, kSecond };
+
+class Counter {
+public:
+  enum Flags {
+    kDefaults      = 0,
+    kIsRate        = 1 << 0, // divided by the measured seconds
+    kAvgThreads    = 1 << 1, // divided by the thread count
+    kAvgIterations = 1 << 2, // divided by the iteration count
+  };
+
+  Counter(double v = 0.0, Flags f = kDefaults) : value(v), flags(f) {}
+
+  operator double const&() const { return value; }
+  operator double&() { return value; }
+
+  double value;
+  Flags flags;
+};
+
+using UserCounters = std::map<std::string, Counter>;
+
+#if defined(__GNUC__) || defined(__clang__)
+template <class T>
+inline __attribute__((always_inline)) void DoNotOptimize(T const& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <class T>
+inline __attribute__((always_inline)) void DoNotOptimize(T& value) {
+  asm volatile("" : "+m,r"(value) : : "memory");
+}
+
+template <class T>
+inline __attribute__((always_inline)) void DoNotOptimize(T&& value) {
+  asm volatile("" : "+m,r"(value) : : "memory");
+}
+
+inline __attribute__((always_inline)) void ClobberMemory() { asm volatile("" : : : "memory"); }
+#else
+namespace internal {
+  inline void use_char_pointer(char const volatile*) {}
+}
+
+template <class T>
+inline void DoNotOptimize(T const& value) {
+  internal::use_char_pointer(&reinterpret_cast<char const volatile&>(value));
+  std::atomic_signal_fence(std::memory_order_acq_rel);
+}
+
+inline void ClobberMemory() { std::atomic_signal_fence(std::memory_order_acq_rel); }
+#endif
+
+namespace internal {
+
+  // Seconds of CPU time used by the calling thread.
+  inline double thread_cpu_seconds() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + 1e-9 * static_cast<double>(ts.tv_nsec);
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+  }
+
+  inline double wall_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  struct thread_manager {
+    explicit thread_manager(int n) : barrier(n) {}
+    std::barrier<> barrier;
+  };
+
+} // namespace internal
+
+class State {
+public:
+  struct Value {};
+
+  class StateIterator {
+  public:
+    StateIterator() = default;
+    explicit StateIterator(State* s) : state_(s), remaining_(s->max_iterations_) {}
+
+    Value operator*() const { return {}; }
+    StateIterator& operator++() {
+      --remaining_;
+      return *this;
+    }
+    bool operator!=(const StateIterator&) const {
+      if (remaining_ != 0) [[likely]] return true;
+      state_->FinishKeepRunning();
+      return false;
+    }
+
+  private:
+    State* state_{nullptr};
+    IterationCount remaining_{0};
+  };
+
+  State(IterationCount max_iterations, std::vector<std::int64_t> ranges, int thread_index, int threads,
+        internal::thread_manager* manager)
+      : max_iterations_(max_iterations), ranges_(std::move(ranges)), thread_index_(thread_index),
+        threads_(threads), manager_(manager) {}
+
+  StateIterator begin() {
+    StartKeepRunning();
+    return StateIterator(this);
+  }
+  StateIterator end() { return StateIterator(); }
+
+  bool KeepRunning() {
+    if (!started_) StartKeepRunning();
+    if (done_ < max_iterations_ && !error_) {
+      ++done_;
+      return true;
+    }
+    if (!finished_) {
+      done_ = max_iterations_;
+      FinishKeepRunning();
+    }
+    return false;
+  }
+
+  void PauseTiming() {
+    if (!running_) return;
+    real_ += internal::wall_seconds() - real_start_;
+    cpu_ += internal::thread_cpu_seconds() - cpu_start_;
+    running_ = false;
+  }
+
+  void ResumeTiming() {
+    if (running_) return;
+    real_start_ = internal::wall_seconds();
+    cpu_start_ = internal::thread_cpu_seconds();
+    running_ = true;
+  }
+
+  void SkipWithError(const std::string& msg) {
+    if (!error_) error_message_ = msg;
+    error_ = true;
+  }
+
+  void SetItemsProcessed(std::int64_t n) { items_ = n; }
+  void SetBytesProcessed(std::int64_t n) { bytes_ = n; }
+  void SetLabel(const std::string& label) { label_ = label; }
+
+  std::int64_t range(std::size_t i = 0) const { return ranges_.at(i); }
+  IterationCount iterations() const { return finished_ ? max_iterations_ : done_; }
+  IterationCount max_iterations() const { return max_iterations_; }
+  int thread_index() const { return thread_index_; }
+  int threads() const { return threads_; }
+
+  UserCounters counters;
+
+private:
+  friend struct internal_access;
+
+  void StartKeepRunning() {
+    started_ = true;
+    manager_->barrier.arrive_and_wait();
+    ResumeTiming();
+  }
+
+  void FinishKeepRunning() {
+    PauseTiming();
+    finished_ = true;
+    manager_->barrier.arrive_and_wait();
+  }
+
+  IterationCount max_iterations_;
+  IterationCount done_{0};
+  std::vector<std::int64_t> ranges_;
+  int thread_index_;
+  int threads_;
+  internal::thread_manager* manager_;
+
+  bool started_{false};
+  bool finished_{false};
+  bool running_{false};
+  double real_start_{0}, cpu_start_{0};
+  double real_{0}, cpu_{0};
+
+  std::int64_t items_{0};
+  std::int64_t bytes_{0};
+  std::string label_;
+  bool error_{false};
+  std::string error_message_;
+};
+
+namespace internal {
+
+  class Benchmark {
+  public:
+    Benchmark(std::string name, std::function<void(State&)> fn) : name_(std::move(name)), fn_(std::move(fn)) {}
+
+    Benchmark* Arg(std::int64_t x) {
+      args_.push_back({x});
+      return this;
+    }
+
+    Benchmark* Args(const std::vector<std::int64_t>& xs) {
+      args_.push_back(xs);
+      return this;
+    }
+
+    Benchmark* RangeMultiplier(int m) {
+      multiplier_ = std::max(m, 2);
+      return this;
+    }
+
+    // lo, then powers of the multiplier in (lo, hi), then hi.
+    Benchmark* Range(std::int64_t lo, std::int64_t hi) {
+      args_.push_back({lo});
+      std::int64_t v = 1;
+      while (v <= lo) v *= multiplier_;
+      for (; v < hi; v *= multiplier_) args_.push_back({v});
+      if (hi != lo) args_.push_back({hi});
+      return this;
+    }
+
+    Benchmark* Threads(int n) {
+      threads_.push_back(std::max(n, 1));
+      return this;
+    }
+
+    Benchmark* ThreadRange(int lo, int hi) {
+      for (int t = std::max(lo, 1); t < hi; t *= 2) threads_.push_back(t);
+      threads_.push_back(std::max(hi, 1));
+      return this;
+    }
+
+    Benchmark* Iterations(IterationCount n) {
+      iterations_ = n;
+      return this;
+    }
+
+    Benchmark* MinTime(double seconds) {
+      min_time_ = seconds;
+      return this;
+    }
+
+    Benchmark* Unit(TimeUnit u) {
+      unit_ = u;
+      return this;
+    }
+
+    Benchmark* UseRealTime() {
+      real_time_ = true;
+      return this;
+    }
+
+  private:
+    friend struct runner;
+
+    std::string name_;
+    std::function<void(State&)> fn_;
+    std::vector<std::vector<std::int64_t>> args_;
+    std::vector<int> threads_;
+    int multiplier_{8};
+    IterationCount iterations_{0};
+    double min_time_{0};
+    TimeUnit unit_{kNanosecond};
+    bool real_time_{false};
+  };
+
+  inline std::vector<std::unique_ptr<Benchmark>>& registry() {
+    static std::vector<std::unique_ptr<Benchmark>> r;
+    return r;
+  }
+
+  inline Benchmark* RegisterBenchmarkInternal(std::string name, std::function<void(State&)> fn) {
+    registry().push_back(std::make_unique<Benchmark>(std::move(name), std::move(fn)));
+    return registry().back().get();
+  }
+
+  struct flags {
+    std::string filter = ".";
+    double min_time = 0.5;
+    std::string format = "console";
+    std::string out;
+    std::string out_format = "json";
+    bool list = false;
+  };
+
+  inline flags& get_flags() {
+    static flags f;
+    return f;
+  }
+
+  inline std::string& executable() {
+    static std::string e;
+    return e;
+  }
+
+  struct run_result {
+    std::string name;
+    std::string label;
+    std::string error_message;
+    bool error{false};
+    int threads{1};
+    IterationCount iterations{0};
+    double real_seconds{0}; // averaged over threads
+    double cpu_seconds{0};  // summed over threads
+    double items{0};
+    double bytes{0};
+    UserCounters counters;
+    TimeUnit unit{kNanosecond};
+    bool real_time{false};
+  };
+
+} // namespace internal
+
+// What Google Benchmark calls it; the runner needs a State's private results.
+struct internal_access {
+  static double real(const State& s) { return s.real_; }
+  static double cpu(const State& s) { return s.cpu_; }
+  static std::int64_t items(const State& s) { return s.items_; }
+  static std::int64_t bytes(const State& s) { return s.bytes_; }
+  static const std::string& label(const State& s) { return s.label_; }
+  static bool error(const State& s) { return s.error_; }
+  static const std::string& error_message(const State& s) { return s.error_message_; }
+};
+
+namespace internal {
+
+  inline double unit_multiplier(TimeUnit u) {
+    switch (u) {
+      case kNanosecond: return 1e9;
+      case kMicrosecond: return 1e6;
+      case kMillisecond: return 1e3;
+      case kSecond: return 1;
+    }
+    return 1e9;
+  }
+
+  inline const char* unit_name(TimeUnit u) {
+    switch (u) {
+      case kNanosecond: return "ns";
+      case kMicrosecond: return "us";
+      case kMillisecond: return "ms";
+      case kSecond: return "s";
+    }
+    return "ns";
+  }
+
+  // 12.3k, 4.56M, ...
+  inline std::string human(double v) {
+    static const char* const suffix[] = {"", "k", "M", "G", "T"};
+    int i = 0;
+    double a = v < 0 ? -v : v;
+    while (a >= 1000.0 && i < 4) {
+      a /= 1000.0;
+      v /= 1000.0;
+      ++i;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof buf, a < 10 ? "%.3g%s" : "%.4g%s", v, suffix[i]);
+    return buf;
+  }
+
+  inline std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof buf, "\\u%04x", c);
+        out += buf;
+      } else {
+        out += c;
+      }
+    }
+    return out;
+  }
+
+  struct runner {
+    struct instance {
+      const Benchmark* b;
+      std::vector<std::int64_t> args;
+      int threads;
+      std::string name;
+    };
+
+    static std::vector<instance> expand(const Benchmark& b) {
+      std::vector<instance> out;
+      std::vector<std::vector<std::int64_t>> args = b.args_;
+      if (args.empty()) args.push_back({});
+      std::vector<int> threads = b.threads_;
+      const bool named_threads = !threads.empty();
+      if (threads.empty()) threads.push_back(1);
+
+      for (const auto& a : args) {
+        for (int t : threads) {
+          std::string name = b.name_;
+          for (std::int64_t x : a) name += "/" + std::to_string(x);
+          if (b.iterations_ > 0) name += "/iterations:" + std::to_string(b.iterations_);
+          if (b.min_time_ > 0) name += "/min_time:" + std::to_string(b.min_time_);
+          if (b.real_time_) name += "/real_time";
+          if (named_threads) name += "/threads:" + std::to_string(t);
+          out.push_back({&b, a, t, std::move(name)});
+        }
+      }
+      return out;
+    }
+
+    static run_result run_once(const instance& in, IterationCount iters) {
+      thread_manager manager(in.threads);
+      std::vector<std::unique_ptr<State>> states;
+      for (int t = 0; t < in.threads; ++t) {
+        states.push_back(std::make_unique<State>(iters, in.args, t, in.threads, &manager));
+      }
+
+      std::vector<std::thread> pool;
+      for (int t = 1; t < in.threads; ++t) {
+        pool.emplace_back([&, t] { in.b->fn_(*states[t]); });
+      }
+      in.b->fn_(*states[0]);
+      for (auto& th : pool) th.join();
+
+      run_result r;
+      r.name = in.name;
+      r.threads = in.threads;
+      r.unit = in.b->unit_;
+      r.real_time = in.b->real_time_;
+      for (const auto& s : states) {
+        r.iterations += s->iterations();
+        r.real_seconds += internal_access::real(*s);
+        r.cpu_seconds += internal_access::cpu(*s);
+        r.items += static_cast<double>(internal_access::items(*s));
+        r.bytes += static_cast<double>(internal_access::bytes(*s));
+        if (internal_access::error(*s) && !r.error) {
+          r.error = true;
+          r.error_message = internal_access::error_message(*s);
+        }
+        if (r.label.empty()) r.label = internal_access::label(*s);
+        for (const auto& [k, c] : s->counters) {
+          auto [it, fresh] = r.counters.emplace(k, c);
+          if (!fresh) it->second.value += c.value;
+        }
+      }
+      r.real_seconds /= in.threads;
+      return r;
+    }
+
+    static run_result run(const instance& in) {
+      const double min_time = in.b->min_time_ > 0 ? in.b->min_time_ : get_flags().min_time;
+      IterationCount iters = in.b->iterations_ > 0 ? in.b->iterations_ : 1;
+
+      for (;;) {
+        run_result r = run_once(in, iters);
+        const double seconds = in.b->real_time_ ? r.real_seconds : r.cpu_seconds;
+        if (in.b->iterations_ > 0 || r.error || seconds >= min_time || iters >= 1'000'000'000) {
+          finish(r, seconds);
+          return r;
+        }
+        // Same growth rule as Google Benchmark: aim 40% past min_time, at
+        // most 10x per step while the sample is too short to trust.
+        double multiplier = min_time * 1.4 / std::max(seconds, 1e-9);
+        if (seconds / min_time <= 0.1) multiplier = std::min(multiplier, 10.0);
+        const auto next = static_cast<IterationCount>(multiplier * static_cast<double>(iters));
+        iters = std::min<IterationCount>(std::max(next, iters + 1), 1'000'000'000);
+      }
+    }
+
+    static void finish(run_result& r, double seconds) {
+      for (auto& [k, c] : r.counters) {
+        if (c.flags & Counter::kIsRate) c.value /= std::max(seconds, 1e-12);
+        if (c.flags & Counter::kAvgThreads) c.value /= r.threads;
+        if (c.flags & Counter::kAvgIterations) c.value /= std::max<double>(static_cast<double>(r.iterations), 1.0);
+      }
+      if (r.items > 0) r.counters.emplace("items_per_second", Counter(r.items / std::max(seconds, 1e-12)));
+      if (r.bytes > 0) r.counters.emplace("bytes_per_second", Counter(r.bytes / std::max(seconds, 1e-12)));
+    }
+
+    static double per_iter(const run_result& r, double seconds) {
+      return r.iterations ? seconds * unit_multiplier(r.unit) / static_cast<double>(r.iterations) : 0.0;
+    }
+
+    static void print_header(std::FILE* f, std::size_t width) {
+      const std::string rule(width + 45, '-');
+      std::fprintf(f, "%s\n%-*s %13s %15s %12s\n%s\n", rule.c_str(), static_cast<int>(width), "Benchmark", "Time",
+                   "CPU", "Iterations", rule.c_str());
+    }
+
+    static void print_row(std::FILE* f, const run_result& r, std::size_t width) {
+      if (r.error) {
+        std::fprintf(f, "%-*s ERROR OCCURRED: '%s'\n", static_cast<int>(width), r.name.c_str(), r.error_message.c_str());
+        return;
+      }
+      std::fprintf(f, "%-*s %10.4g %-2s %12.4g %-2s %12lld", static_cast<int>(width), r.name.c_str(),
+                   per_iter(r, r.real_seconds), unit_name(r.unit), per_iter(r, r.cpu_seconds), unit_name(r.unit),
+                   static_cast<long long>(r.iterations));
+      for (const auto& [k, c] : r.counters) {
+        const bool rate = k == "items_per_second" || k == "bytes_per_second" || (c.flags & Counter::kIsRate);
+        std::fprintf(f, " %s=%s%s", k.c_str(), human(c.value).c_str(), rate ? "/s" : "");
+      }
+      if (!r.label.empty()) std::fprintf(f, " %s", r.label.c_str());
+      std::fprintf(f, "\n");
+    }
+
+    static void print_json(std::FILE* f, const std::vector<run_result>& results) {
+      char date[64] = "";
+      const std::time_t now = std::time(nullptr);
+      std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+      std::fprintf(f, "{\n  \"context\": {\n");
+      std::fprintf(f, "    \"date\": \"%s\",\n", date);
+      std::fprintf(f, "    \"executable\": \"%s\",\n", json_escape(executable()).c_str());
+      std::fprintf(f, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+      std::fprintf(f, "    \"library\": \"ndof in-tree harness\"\n  },\n  \"benchmarks\": [");
+      for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        std::fprintf(f, "%s\n    {\n", i ? "," : "");
+        std::fprintf(f, "      \"name\": \"%s\",\n", json_escape(r.name).c_str());
+        std::fprintf(f, "      \"run_name\": \"%s\",\n", json_escape(r.name).c_str());
+        std::fprintf(f, "      \"run_type\": \"iteration\",\n");
+        std::fprintf(f, "      \"repetitions\": 1,\n      \"repetition_index\": 0,\n");
+        std::fprintf(f, "      \"threads\": %d,\n", r.threads);
+        if (r.error) {
+          std::fprintf(f, "      \"error_occurred\": true,\n");
+          std::fprintf(f, "      \"error_message\": \"%s\",\n", json_escape(r.error_message).c_str());
+        }
+        std::fprintf(f, "      \"iterations\": %lld,\n", static_cast<long long>(r.iterations));
+        std::fprintf(f, "      \"real_time\": %.17g,\n", per_iter(r, r.real_seconds));
+        std::fprintf(f, "      \"cpu_time\": %.17g,\n", per_iter(r, r.cpu_seconds));
+        for (const auto& [k, c] : r.counters) {
+          std::fprintf(f, "      \"%s\": %.17g,\n", json_escape(k).c_str(), c.value);
+        }
+        if (!r.label.empty()) std::fprintf(f, "      \"label\": \"%s\",\n", json_escape(r.label).c_str());
+        std::fprintf(f, "      \"time_unit\": \"%s\"\n    }", unit_name(r.unit));
+      }
+      std::fprintf(f, "\n  ]\n}\n");
+    }
+  };
+
+} // namespace internal
+
+template <class Fn, class... Args>
+internal::Benchmark* RegisterBenchmark(const std::string& name, Fn&& fn, Args&&... args) {
+  return internal::RegisterBenchmarkInternal(
+      name, [fn = std::forward<Fn>(fn), ... args = std::forward<Args>(args)](State& st) { fn(st, args...); });
+}
+
+// Consumes the --benchmark_* flags it knows, leaving the rest in argv.
+inline void Initialize(int* argc, char** argv) {
+  auto& f = internal::get_flags();
+  if (*argc > 0) internal::executable() = argv[0];
+
+  auto value = [](const char* arg, const char* name) -> const char* {
+    const std::size_t n = std::strlen(name);
+    if (std::strncmp(arg, name, n) == 0 && arg[n] == '=') return arg + n + 1;
+    return nullptr;
+  };
+
+  int kept = 1;
+  for (int i = 1; i < *argc; ++i) {
+    const char* a = argv[i];
+    if (const char* v = value(a, "--benchmark_filter")) {
+      f.filter = v;
+    } else if (const char* v = value(a, "--benchmark_min_time")) {
+      f.min_time = std::strtod(v, nullptr); // "0.5" or "0.5s"
+    } else if (const char* v = value(a, "--benchmark_format")) {
+      f.format = v;
+    } else if (const char* v = value(a, "--benchmark_out")) {
+      f.out = v;
+    } else if (const char* v = value(a, "--benchmark_out_format")) {
+      f.out_format = v;
+    } else if (const char* v = value(a, "--benchmark_list_tests")) {
+      f.list = std::strcmp(v, "true") == 0 || std::strcmp(v, "1") == 0;
+    } else if (std::strcmp(a, "--benchmark_list_tests") == 0) {
+      f.list = true;
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  *argc = kept;
+}
+
+// True (and a message) if anything besides the program name is left.
+inline bool ReportUnrecognizedArguments(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    std::fprintf(stderr, "%s: error: unrecognized command-line flag: %s\n", argv[0], argv[i]);
+  }
+  return argc > 1;
+}
+
+inline std::size_t RunSpecifiedBenchmarks() {
+  using internal::runner;
+  const auto& f = internal::get_flags();
+  const std::string pattern = (f.filter.empty() || f.filter == "all") ? "." : f.filter;
+  const std::regex re(pattern);
+
+  std::vector<runner::instance> selected;
+  for (const auto& b : internal::registry()) {
+    for (auto& in : runner::expand(*b)) {
+      if (std::regex_search(in.name, re)) selected.push_back(std::move(in));
+    }
+  }
+
+  if (f.list) {
+    for (const auto& in : selected) std::printf("%s\n", in.name.c_str());
+    return selected.size();
+  }
+
+  if (f.format != "json") {
+    std::printf("Running %s\nRun on (%u X CPU); in-tree benchmark harness\n", internal::executable().c_str(),
+                std::thread::hardware_concurrency());
+  }
+
+  std::size_t width = 10;
+  for (const auto& in : selected) width = std::max(width, in.name.size());
+  if (f.format != "json") runner::print_header(stdout, width);
+
+  std::vector<internal::run_result> results;
+  for (const auto& in : selected) {
+    results.push_back(runner::run(in));
+    if (f.format != "json") {
+      runner::print_row(stdout, results.back(), width);
+      std::fflush(stdout);
+    }
+  }
+  if (f.format == "json") runner::print_json(stdout, results);
+
+  if (!f.out.empty()) {
+    if (std::FILE* out = std::fopen(f.out.c_str(), "w")) {
+      if (f.out_format == "console") {
+        runner::print_header(out, width);
+        for (const auto& r : results) runner::print_row(out, r, width);
+      } else {
+        runner::print_json(out, results);
+      }
+      std::fclose(out);
+    } else {
+      std::fprintf(stderr, "could not open %s\n", f.out.c_str());
+    }
+  }
+  return results.size();
+}
+
+inline void Shutdown() {}
+
+} // namespace benchmark
+
+#define BENCHMARK_PRIVATE_CONCAT2(a, b) a##b
+#define BENCHMARK_PRIVATE_CONCAT(a, b) BENCHMARK_PRIVATE_CONCAT2(a, b)
+#define BENCHMARK_PRIVATE_NAME() BENCHMARK_PRIVATE_CONCAT(benchmark_uniq_, __COUNTER__)
+
+#define BENCHMARK(...)                                                              \
+  [[maybe_unused]] static ::benchmark::internal::Benchmark* BENCHMARK_PRIVATE_NAME() = \
+      ::benchmark::internal::RegisterBenchmarkInternal(#__VA_ARGS__, __VA_ARGS__)
+
+#define BENCHMARK_TEMPLATE(n, ...)                                                  \
+  [[maybe_unused]] static ::benchmark::internal::Benchmark* BENCHMARK_PRIVATE_NAME() = \
+      ::benchmark::internal::RegisterBenchmarkInternal(#n "<" #__VA_ARGS__ ">", n<__VA_ARGS__>)
+
+#define BENCHMARK_MAIN()                                          \
+  int main(int argc, char** argv) {                               \
+    ::benchmark::Initialize(&argc, argv);                         \
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1; \
+    ::benchmark::RunSpecifiedBenchmarks();                        \
+    ::benchmark::Shutdown();                                      \
+    return 0;                                                     \
+  }                                                               \
+  int main(int, char**)
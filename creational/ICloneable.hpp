@@ -1,8 +1,18 @@
+#pragma once
+
 #include <print>
 #include <memory_resource>
 #include <memory>
 #include <type_traits>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <new>
+
+// Assumes these already exist in namespace ndof (see structural/proxy):
+//   enum class ec
+//   struct bytes   // { std::byte* data; std::size_t size; std::size_t align; }
 
 // TODO: we use std::convertible_to in constructor requires clause. Can we delete this concept?
 template<typename Alloc1, typename Alloc2>
@@ -90,27 +100,12 @@ public:
         && std::convertible_to<PassedAlloc, Alloc>
     std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>> 
     clone(this U const& self, PassedAlloc passed_alloc) {
-        using alloc_traits = std::allocator_traits<Alloc>;
-        using ReboundAlloc = typename alloc_traits::template rebind_alloc<U>;
-        using ReboundDeleter = AllocDeleter<ReboundAlloc>;
-
         // Convert passed allocator to Alloc (rebound to T) for do_clone
         Alloc alloc(std::move(passed_alloc));
-        
-        // Delegate to virtual do_clone for polymorphic construction
-        std::unique_ptr<T, Deleter> r = self.do_clone(alloc);
-        
-        // Transfer ownership with rebound deleter
-        Deleter old_deleter = r.get_deleter();
-        T* obj = r.release();
-        
-        // Rebind the allocator from T to U (no-op if U == T)
-        ReboundAlloc rebound_alloc(old_deleter.alloc);
-        
-        return std::unique_ptr<U, ReboundDeleter>(
-            obj,
-            ReboundDeleter(rebound_alloc)
-        );
+
+        // Delegate to virtual do_clone for polymorphic construction.
+        // The unique_ptr converting move rebinds the deleter from T to U (no-op if U == T).
+        return self.do_clone(alloc);
     }
 
     // Clone using the stored allocator.
@@ -120,27 +115,75 @@ public:
     requires std::is_base_of_v<U, T>
     std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>> 
     clone(this U const& self) {
-        using alloc_traits = std::allocator_traits<Alloc>;
-        using ReboundAlloc = typename alloc_traits::template rebind_alloc<U>;
-        using ReboundDeleter = AllocDeleter<ReboundAlloc>;
-
-        // Delegate to virtual do_clone using the stored allocator
-        std::unique_ptr<T, Deleter> r = self.do_clone(self.allocator_);
-        
-        // Transfer ownership with rebound deleter
-        Deleter old_deleter = r.get_deleter();
-        T* obj = r.release();
-        
-        // Rebind the allocator from T to U (no-op if U == T)
-        ReboundAlloc rebound_alloc(old_deleter.alloc);
-        
-        return std::unique_ptr<U, ReboundDeleter>(
-            obj, 
-            ReboundDeleter(rebound_alloc)
-        );
+        // Delegate to virtual do_clone using the stored allocator.
+        // The unique_ptr converting move rebinds the deleter from T to U (no-op if U == T).
+        return self.do_clone(self.allocator_);
+    }
+
+    // noexcept version of clone(alloc). Allocation failure maps to ec::alloc_failed,
+    // any other exception thrown while copying maps to ec::construction_failed.
+    template<typename U, typename PassedAlloc>
+    requires std::is_base_of_v<U, T>
+        && std::convertible_to<PassedAlloc, Alloc>
+    [[nodiscard]] std::expected<std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>>, ndof::ec>
+    try_clone(this U const& self, PassedAlloc passed_alloc) noexcept {
+#if defined(__cpp_exceptions)
+        try {
+            return self.clone(std::move(passed_alloc));
+        } catch (const std::bad_alloc&) {
+            return std::unexpected(ndof::ec::alloc_failed);
+        } catch (...) {
+            return std::unexpected(ndof::ec::construction_failed);
+        }
+#else
+        return self.clone(std::move(passed_alloc));
+#endif
+    }
+
+    // noexcept version of clone() using the stored allocator.
+    template<typename U>
+    requires std::is_base_of_v<U, T>
+    [[nodiscard]] std::expected<std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>>, ndof::ec>
+    try_clone(this U const& self) noexcept {
+        return self.try_clone(self.allocator_);
+    }
+
+    // Size and alignment of the dynamic type, i.e., of the object clone_into() constructs.
+    // Use these to size caller-provided or SBO storage before cloning into it.
+    [[nodiscard]] std::size_t clone_size() const noexcept { return do_clone_layout().size; }
+    [[nodiscard]] std::size_t clone_align() const noexcept { return do_clone_layout().align; }
+
+    // Placement clone: copy-constructs the dynamic type into dst without allocating.
+    // This is the hook any_with_allocator and function_with_allocator look for (has_clone_into_v),
+    // so a held prototype is cloned straight into the destination's SBO or heap block.
+    // U may be a base of T (as with clone()) or a type derived from T; in the latter case the
+    // dynamic type is at least U, so the downcast of the result is valid.
+    // Errors: ec::alloc_failed if dst is too small or misaligned for the dynamic type,
+    //         ec::construction_failed if the copy constructor throws.
+    // Contract: on success the caller owns the object and must std::destroy_at() it.
+    template<typename U>
+    requires (std::is_base_of_v<U, T> || std::is_base_of_v<T, U>)
+    [[nodiscard]] std::expected<U*, ndof::ec> clone_into(this U const& self, ndof::bytes dst) noexcept {
+        auto [data, size, align] = dst;
+        const clone_layout layout = self.do_clone_layout();
+
+        if (!data || size < layout.size || align < layout.align
+            || reinterpret_cast<std::uintptr_t>(data) % layout.align != 0) {
+            return std::unexpected(ndof::ec::alloc_failed);
+        }
+
+        auto r = self.do_clone_into(static_cast<void*>(data));
+        if (!r) return std::unexpected(r.error());
+
+        return static_cast<U*>(*r);
     }
 
 protected:
+    struct clone_layout {
+        std::size_t size;
+        std::size_t align;
+    };
+
     // TODO: Need to be consistent with noexcept policy across all code
     // Requires formalizing that policy
     virtual std::unique_ptr<T, Deleter> do_clone(Alloc alloc) const {
@@ -148,13 +191,33 @@ protected:
 
         T* ptr = alloc_traits::allocate(alloc, 1);
         try {
-            alloc_traits::construct(alloc, ptr, *this);
+            alloc_traits::construct(alloc, ptr, static_cast<const T&>(*this));
             return std::unique_ptr<T, Deleter>(ptr, Deleter(alloc));
         } catch (...) {
             alloc_traits::deallocate(alloc, ptr, 1);
             throw;
         }
     }
+
+    // Derived types that override do_clone() must override these two as well,
+    // reporting and constructing their own type.
+    virtual clone_layout do_clone_layout() const noexcept {
+        return {sizeof(T), alignof(T)};
+    }
+
+    // dst is non-null and satisfies do_clone_layout().
+    virtual std::expected<T*, ndof::ec> do_clone_into(void* dst) const noexcept {
+        const T& src = static_cast<const T&>(*this);
+#if defined(__cpp_exceptions)
+        try {
+            return std::construct_at(static_cast<T*>(dst), src);
+        } catch (...) {
+            return std::unexpected(ndof::ec::construction_failed);
+        }
+#else
+        return std::construct_at(static_cast<T*>(dst), src);
+#endif
+    }
 };
 
 template<typename T>
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "ICloneable.hpp"
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   struct bytes
+
+// A prototype that can report its dynamic layout and placement-clone itself,
+// i.e., anything derived from ICloneable.
+template <class U>
+concept placement_cloneable = requires(const U& u, bytes dst) {
+  { u.clone_size() } noexcept -> std::convertible_to<std::size_t>;
+  { u.clone_align() } noexcept -> std::convertible_to<std::size_t>;
+  { u.clone_into(dst) } noexcept -> std::same_as<std::expected<U*, ec>>;
+};
+
+// Owns a set of clones that were placement-constructed back to back in a single
+// allocation. Layout of the block:
+//
+//   [ U* table (count entries) ][ pad ][ clone 0 ][ pad ][ clone 1 ] ...
+//
+// The table gives random access to heterogeneous clones (each may have a
+// different dynamic type and size). All clones are destroyed together, in
+// reverse construction order, followed by one deallocation.
+// Contract: the allocator must outlive the block.
+template <class U, class AllocFamily = std::allocator<std::byte>>
+class clone_block {
+public:
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+  using value_type     = U;
+
+  clone_block() noexcept(std::is_nothrow_default_constructible_v<allocator_type>) = default;
+
+  explicit clone_block(const allocator_type& a) noexcept : alloc_(a) {}
+
+  ~clone_block() noexcept { reset(); }
+
+  clone_block(const clone_block&) = delete;
+  clone_block& operator=(const clone_block&) = delete;
+
+  clone_block(clone_block&& other) noexcept
+      : alloc_(std::move(other.alloc_)),
+        raw_(std::exchange(other.raw_, nullptr)),
+        raw_n_(std::exchange(other.raw_n_, 0)),
+        table_(std::exchange(other.table_, nullptr)),
+        count_(std::exchange(other.count_, 0)) {}
+
+  clone_block& operator=(clone_block&& other) noexcept {
+    if (this == &other) return *this;
+    reset();
+    alloc_ = std::move(other.alloc_);
+    raw_   = std::exchange(other.raw_, nullptr);
+    raw_n_ = std::exchange(other.raw_n_, 0);
+    table_ = std::exchange(other.table_, nullptr);
+    count_ = std::exchange(other.count_, 0);
+    return *this;
+  }
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+  [[nodiscard]] std::size_t size() const noexcept { return count_; }
+
+  // Total bytes held by the single backing allocation (0 when empty).
+  [[nodiscard]] std::size_t allocated_bytes() const noexcept { return raw_n_; }
+
+  [[nodiscard]] std::span<U* const> objects() const noexcept { return {table_, count_}; }
+
+  [[nodiscard]] U& operator[](std::size_t i) const noexcept { return *table_[i]; }
+
+  // Iterates the clone pointers in construction (i.e., address) order.
+  [[nodiscard]] U* const* begin() const noexcept { return table_; }
+  [[nodiscard]] U* const* end() const noexcept { return table_ + count_; }
+
+  void reset() noexcept {
+    if (!raw_) return;
+    destroy_first(count_);
+    deallocate_raw();
+  }
+
+  // --------------------------------------------------------------------------
+  // Construction. Used by try_clone_n / try_clone_all.
+  // --------------------------------------------------------------------------
+
+  // Clones each prototype yielded by get(i), i in [0, count), into one block.
+  // get(i) must return const U& and must be callable twice per index:
+  // once to size the block, once to fill it.
+  template <class Get>
+  static std::expected<clone_block, ec>
+  try_build(std::size_t count, Get&& get, const allocator_type& a) noexcept {
+    clone_block out(a);
+    if (count == 0) return out;
+
+    if (count > std::numeric_limits<std::size_t>::max() / sizeof(U*)) {
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    // Pass 1: compute the packed layout, relative to an origin aligned to max_align.
+    std::size_t end       = count * sizeof(U*);
+    std::size_t max_align = alignof(U*);
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto& proto = get(i);
+      const std::size_t sz = proto.clone_size();
+      const std::size_t al = proto.clone_align();
+      if (!fits(end, sz, al)) return std::unexpected(ec::alloc_failed);
+      end = align_up(end, al) + sz;
+      max_align = std::max(max_align, al);
+    }
+
+    // One allocation for the table and every clone.
+    const std::size_t slack = max_align - 1;
+    if (end > std::numeric_limits<std::size_t>::max() - slack) {
+      return std::unexpected(ec::alloc_failed);
+    }
+    const std::size_t need = end + slack;
+
+    std::byte* raw = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      raw = traits::allocate(out.alloc_, need);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    raw = traits::allocate(out.alloc_, need);
+    if (!raw) return std::unexpected(ec::alloc_failed);
+#endif
+
+    void* p = raw;
+    std::size_t space = need;
+    auto* origin = static_cast<std::byte*>(std::align(max_align, end, p, space));
+    if (!origin) {
+      traits::deallocate(out.alloc_, raw, need);
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    out.raw_   = raw;
+    out.raw_n_ = need;
+    out.table_ = reinterpret_cast<U**>(origin);
+
+    // Pass 2: placement-clone into the slots computed above.
+    std::size_t off = count * sizeof(U*);
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto& proto = get(i);
+      const std::size_t sz = proto.clone_size();
+      const std::size_t al = proto.clone_align();
+      off = align_up(off, al);
+
+      auto r = proto.clone_into(bytes{origin + off, sz, al});
+      if (!r) {
+        out.destroy_first(i);
+        out.deallocate_raw();
+        return std::unexpected(r.error());
+      }
+      std::construct_at(out.table_ + i, *r);
+      out.count_ = i + 1;
+      off += sz;
+    }
+    return out;
+  }
+
+private:
+  static constexpr std::size_t align_up(std::size_t n, std::size_t a) noexcept {
+    return (n + (a - 1)) & ~(a - 1);
+  }
+
+  // True if align_up(end, al) + sz does not overflow and al is a power of two.
+  static constexpr bool fits(std::size_t end, std::size_t sz, std::size_t al) noexcept {
+    constexpr std::size_t max = std::numeric_limits<std::size_t>::max();
+    if (al == 0 || (al & (al - 1)) != 0) return false;
+    if (end > max - (al - 1)) return false;
+    return sz <= max - align_up(end, al);
+  }
+
+  // Closed hierarchies (see closed_cloneable) have no virtual destructor and
+  // destroy their clones through destroy_dynamic().
+  static void destroy_clone(U* p) noexcept {
+    if constexpr (requires { U::destroy_dynamic(p); }) {
+      U::destroy_dynamic(p);
+    } else {
+      std::destroy_at(p);
+    }
+  }
+
+  void destroy_first(std::size_t n) noexcept {
+    while (n > 0) {
+      --n;
+      destroy_clone(table_[n]);
+    }
+  }
+
+  void deallocate_raw() noexcept {
+    traits::deallocate(alloc_, raw_, raw_n_);
+    raw_   = nullptr;
+    raw_n_ = 0;
+    table_ = nullptr;
+    count_ = 0;
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  std::byte* raw_{nullptr};
+  std::size_t raw_n_{0};
+  U** table_{nullptr};
+  std::size_t count_{0};
+};
+
+namespace detail {
+  // Range elements may be prototypes or pointer-likes to prototypes.
+  template <class E>
+  constexpr decltype(auto) as_prototype(const E& e) noexcept {
+    if constexpr (placement_cloneable<E>) {
+      return (e);
+    } else {
+      return *e;
+    }
+  }
+
+  template <class R>
+  using prototype_of_t = std::remove_cvref_t<decltype(as_prototype(*std::ranges::begin(std::declval<R&>())))>;
+}
+
+// ----------------------------------------------------------------------------
+// Core API: always std::expected
+// ----------------------------------------------------------------------------
+
+// count copies of one prototype, packed contiguously in a single allocation.
+template <placement_cloneable U, class AllocFamily>
+[[nodiscard]] std::expected<clone_block<U, AllocFamily>, ec>
+try_clone_n(const U& proto, std::size_t count, const AllocFamily& alloc) noexcept {
+  using block_type = clone_block<U, AllocFamily>;
+  return block_type::try_build(
+      count,
+      [&proto](std::size_t) noexcept -> const U& { return proto; },
+      typename block_type::allocator_type(alloc));
+}
+
+// One clone of every prototype in the range (heterogeneous dynamic types),
+// packed contiguously in a single allocation, typically from an arena
+// (e.g., std::pmr::monotonic_buffer_resource via polymorphic_allocator).
+// Elements may be prototypes or pointer-likes to prototypes.
+template <std::ranges::random_access_range R, class AllocFamily>
+requires placement_cloneable<detail::prototype_of_t<R>>
+[[nodiscard]] std::expected<clone_block<detail::prototype_of_t<R>, AllocFamily>, ec>
+try_clone_all(R&& protos, const AllocFamily& alloc) noexcept {
+  using U          = detail::prototype_of_t<R>;
+  using block_type = clone_block<U, AllocFamily>;
+  auto first = std::ranges::begin(protos);
+  return block_type::try_build(
+      static_cast<std::size_t>(std::ranges::size(protos)),
+      [first](std::size_t i) noexcept -> const U& {
+        return detail::as_prototype(first[static_cast<std::ranges::range_difference_t<R>>(i)]);
+      },
+      typename block_type::allocator_type(alloc));
+}
+
+// ----------------------------------------------------------------------------
+// Convenience API: stable shape, returns an empty block on failure
+// ----------------------------------------------------------------------------
+
+template <placement_cloneable U, class AllocFamily = std::allocator<std::byte>>
+[[nodiscard]] clone_block<U, AllocFamily>
+clone_n(const U& proto, std::size_t count, const AllocFamily& alloc = AllocFamily{}) noexcept {
+  auto r = try_clone_n(proto, count, alloc);
+  using block_type = clone_block<U, AllocFamily>;
+  return r ? std::move(*r) : block_type(typename block_type::allocator_type(alloc));
+}
+
+template <std::ranges::random_access_range R, class AllocFamily = std::allocator<std::byte>>
+requires placement_cloneable<detail::prototype_of_t<R>>
+[[nodiscard]] clone_block<detail::prototype_of_t<R>, AllocFamily>
+clone_all(R&& protos, const AllocFamily& alloc = AllocFamily{}) noexcept {
+  auto r = try_clone_all(std::forward<R>(protos), alloc);
+  using block_type = clone_block<detail::prototype_of_t<R>, AllocFamily>;
+  return r ? std::move(*r) : block_type(typename block_type::allocator_type(alloc));
+}
+
+} // namespace ndof
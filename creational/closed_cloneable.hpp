@@ -0,0 +1,329 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   struct bytes
+//   template<class... Ts> struct type_list
+
+// Clone support for closed hierarchies: every concrete type is known up front,
+// so the dynamic type is a small index into a compile-time table instead of a
+// vptr. Neither Root nor the leaves need a single virtual function.
+//
+//   struct Circle; struct Square;
+//   struct Shape : ndof::closed_cloneable<Shape, ndof::type_list<Circle, Square>> { ... };
+//   struct Circle : ndof::closed_leaf<Circle, Shape> { ... };
+//   struct Square : ndof::closed_leaf<Square, Shape> { ... };
+//
+// Same API and allocator-rebinding semantics as ICloneable (clone, try_clone,
+// clone_size/clone_align/clone_into), with two differences that follow from
+// having no virtual destructor:
+//   - clones are owned through AllocDeleter, which destroys and deallocates
+//     the dynamic type via the table (never through a static base pointer);
+//   - placement clones from clone_into() are destroyed with destroy_dynamic().
+//
+// The stored tag is one byte for up to 254 types.
+template <class Root, class Types, class InputAlloc = std::allocator<Root>>
+class closed_cloneable;
+
+template <class Self, class Parent>
+class closed_leaf;
+
+template <class Root, class... Ts, class InputAlloc>
+class closed_cloneable<Root, type_list<Ts...>, InputAlloc> {
+  template <class, class> friend class closed_leaf;
+  friend Root;
+
+public:
+  static_assert(sizeof...(Ts) > 0, "A closed hierarchy needs at least one concrete type.");
+
+  using Alloc    = typename std::allocator_traits<InputAlloc>::template rebind_alloc<Root>;
+  using tag_type = std::conditional_t<(sizeof...(Ts) < std::numeric_limits<std::uint8_t>::max()),
+                                      std::uint8_t, std::uint16_t>;
+
+  static constexpr tag_type npos = std::numeric_limits<tag_type>::max();
+
+  // Position of V in Ts..., or npos if V is not one of the concrete types.
+  template <class V>
+  static constexpr tag_type index_of = [] {
+    constexpr bool hits[] = {std::same_as<V, Ts>...};
+    for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+      if (hits[i]) return static_cast<tag_type>(i);
+    }
+    return npos;
+  }();
+
+  // Allocator-aware deleter, shaped like ICloneable::AllocDeleter. Destroys and
+  // deallocates the dynamic type found through the tag, so a unique_ptr<Root>
+  // frees a Circle with the Circle's size and allocator rebinding.
+  template <typename A>
+  struct AllocDeleter {
+    using allocator_type = A;
+    using alloc_traits   = std::allocator_traits<A>;
+
+    allocator_type alloc{};
+
+    AllocDeleter() = default;
+    explicit AllocDeleter(allocator_type a) : alloc(std::move(a)) {}
+
+    template <typename OtherAlloc>
+    requires std::same_as<
+        typename std::allocator_traits<OtherAlloc>::template rebind_alloc<typename alloc_traits::value_type>,
+        A>
+    AllocDeleter(const AllocDeleter<OtherAlloc>& other) : alloc(other.alloc) {}
+
+    void operator()(typename alloc_traits::value_type* p) const noexcept {
+      if (!p) return;
+      const Root* r = p;
+      Alloc a(alloc);
+      ops_of(*r).destroy_deallocate(a, const_cast<Root*>(r));
+    }
+  };
+
+  using Deleter = AllocDeleter<Alloc>;
+
+  // npos for an object that is not a closed_leaf (a Root built directly).
+  [[nodiscard]] tag_type type_index() const noexcept { return tag_; }
+
+  template <class V>
+  [[nodiscard]] bool holds() const noexcept { return tag_ == index_of<V>; }
+
+  template <class V>
+  [[nodiscard]] V* get_if() noexcept {
+    return holds<V>() ? static_cast<V*>(static_cast<Root*>(this)) : nullptr;
+  }
+
+  template <class V>
+  [[nodiscard]] const V* get_if() const noexcept {
+    return holds<V>() ? static_cast<const V*>(static_cast<const Root*>(this)) : nullptr;
+  }
+
+  // Runs the destructor of the dynamic type; for objects from clone_into().
+  static void destroy_dynamic(Root* p) noexcept {
+    if (p) ops_of(*p).destroy(p);
+  }
+
+  // Clone using a user-provided allocator (rebound to the dynamic type).
+  // U is the static type of the object, Root or any type derived from it.
+  // Contract: the object is a closed_leaf (type_index() != npos), and the
+  // allocator must outlive the clone. try_clone() and clone_into() check the
+  // first and report ec::type_mismatch instead.
+  template <typename U, typename PassedAlloc>
+  requires std::derived_from<U, Root>
+      && std::convertible_to<PassedAlloc, Alloc>
+  std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>>
+  clone(this U const& self, PassedAlloc passed_alloc) {
+    using ReboundDeleter = AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>;
+
+    Alloc alloc(std::move(passed_alloc));
+    const Root& root = self;
+    Root* r = ops_of(root).clone(root, alloc);
+    return std::unique_ptr<U, ReboundDeleter>(static_cast<U*>(r), ReboundDeleter(Deleter(alloc)));
+  }
+
+  // Clone using the stored allocator.
+  template <typename U>
+  requires std::derived_from<U, Root>
+  std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>>
+  clone(this U const& self) {
+    const Root& root = self;
+    return self.clone(root.allocator_);
+  }
+
+  // noexcept version of clone(alloc). Allocation failure maps to ec::alloc_failed,
+  // any other exception thrown while copying maps to ec::construction_failed.
+  template <typename U, typename PassedAlloc>
+  requires std::derived_from<U, Root>
+      && std::convertible_to<PassedAlloc, Alloc>
+  [[nodiscard]] std::expected<std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>>, ec>
+  try_clone(this U const& self, PassedAlloc passed_alloc) noexcept {
+    if (static_cast<const Root&>(self).tag_ == npos) return std::unexpected(ec::type_mismatch);
+#if defined(__cpp_exceptions)
+    try {
+      return self.clone(std::move(passed_alloc));
+    } catch (const std::bad_alloc&) {
+      return std::unexpected(ec::alloc_failed);
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    return self.clone(std::move(passed_alloc));
+#endif
+  }
+
+  template <typename U>
+  requires std::derived_from<U, Root>
+  [[nodiscard]] std::expected<std::unique_ptr<U, AllocDeleter<typename std::allocator_traits<Alloc>::template rebind_alloc<U>>>, ec>
+  try_clone(this U const& self) noexcept {
+    const Root& root = self;
+    return self.try_clone(root.allocator_);
+  }
+
+  [[nodiscard]] std::size_t clone_size() const noexcept { return tag_ == npos ? 0 : table[tag_].size; }
+  [[nodiscard]] std::size_t clone_align() const noexcept { return tag_ == npos ? 0 : table[tag_].align; }
+
+  // Placement clone, as ICloneable::clone_into. Destroy the result with destroy_dynamic().
+  template <typename U>
+  requires std::derived_from<U, Root>
+  [[nodiscard]] std::expected<U*, ec> clone_into(this U const& self, bytes dst) noexcept {
+    auto [data, size, align] = dst;
+    const Root& root = self;
+    if (root.tag_ == npos) return std::unexpected(ec::type_mismatch);
+    const ops_t& ops = table[root.tag_];
+
+    if (!data || size < ops.size || align < ops.align
+        || reinterpret_cast<std::uintptr_t>(data) % ops.align != 0) {
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    auto r = ops.clone_into(root, static_cast<void*>(data));
+    if (!r) return std::unexpected(r.error());
+    return static_cast<U*>(*r);
+  }
+
+private:
+  struct ops_t {
+    std::size_t size;
+    std::size_t align;
+    Root* (*clone)(const Root&, Alloc&);
+    std::expected<Root*, ec> (*clone_into)(const Root&, void*) noexcept;
+    void (*destroy)(Root*) noexcept;
+    void (*destroy_deallocate)(Alloc&, Root*) noexcept;
+  };
+
+  template <class V>
+  static Root* clone_impl(const Root& src, Alloc& alloc) {
+    using VAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<V>;
+    using vtraits = std::allocator_traits<VAlloc>;
+
+    VAlloc va(alloc);
+    V* p = vtraits::allocate(va, 1);
+#if defined(__cpp_exceptions)
+    try {
+      vtraits::construct(va, p, static_cast<const V&>(src));
+    } catch (...) {
+      vtraits::deallocate(va, p, 1);
+      throw;
+    }
+#else
+    vtraits::construct(va, p, static_cast<const V&>(src));
+#endif
+    return p;
+  }
+
+  template <class V>
+  static std::expected<Root*, ec> clone_into_impl(const Root& src, void* dst) noexcept {
+#if defined(__cpp_exceptions)
+    try {
+      return std::construct_at(static_cast<V*>(dst), static_cast<const V&>(src));
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    return std::construct_at(static_cast<V*>(dst), static_cast<const V&>(src));
+#endif
+  }
+
+  template <class V>
+  static void destroy_impl(Root* p) noexcept {
+    std::destroy_at(static_cast<V*>(p));
+  }
+
+  template <class V>
+  static void destroy_deallocate_impl(Alloc& alloc, Root* p) noexcept {
+    using VAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<V>;
+    using vtraits = std::allocator_traits<VAlloc>;
+
+    VAlloc va(alloc);
+    V* v = static_cast<V*>(p);
+    vtraits::destroy(va, v);
+    vtraits::deallocate(va, v, 1);
+  }
+
+  template <class V>
+  static constexpr ops_t ops_for = {
+    sizeof(V),
+    alignof(V),
+    &clone_impl<V>,
+    &clone_into_impl<V>,
+    &destroy_impl<V>,
+    &destroy_deallocate_impl<V>
+  };
+
+  // One entry per concrete type, indexed by tag_. Built at compile time.
+  static constexpr std::array<ops_t, sizeof...(Ts)> table = {ops_for<Ts>...};
+
+  // The table entry for r's dynamic type. Only closed_leaf stamps a tag; an
+  // untagged object (npos) has no entry.
+  static const ops_t& ops_of(const Root& r) noexcept {
+    assert(r.tag_ != npos && "closed_cloneable: object is not a closed_leaf");
+    return table[r.tag_];
+  }
+
+  // Store the allocator for default cloning. [[no_unique_address]] allows
+  // stateless allocators (like std::allocator) to take zero space.
+  [[no_unique_address]] Alloc allocator_{};
+  tag_type tag_{npos};
+
+  // Only Root and closed_leaf construct this; the leaf sets the tag.
+  closed_cloneable() = default;
+  template <typename PassedAlloc>
+  requires std::convertible_to<PassedAlloc, Alloc>
+  explicit closed_cloneable(PassedAlloc a) : allocator_(Alloc(std::move(a))) {}
+  closed_cloneable(const closed_cloneable&) = default;
+  closed_cloneable(closed_cloneable&&) = default;
+  closed_cloneable& operator=(const closed_cloneable&) = delete;
+  closed_cloneable& operator=(closed_cloneable&&) = delete;
+
+protected:
+  // Non-virtual: never delete through this type; AllocDeleter and
+  // destroy_dynamic() dispatch to the dynamic type instead.
+  ~closed_cloneable() = default;
+};
+
+// Marks Self as a concrete member of its hierarchy's closed type list.
+// Every constructor stamps Self's index into the tag after Parent is built,
+// so copies made from a base of another leaf are re-tagged correctly.
+template <class Self, class Parent>
+class closed_leaf : public Parent {
+public:
+  template <class... Args>
+  requires std::constructible_from<Parent, Args...>
+  explicit(sizeof...(Args) == 1) closed_leaf(Args&&... args)
+      noexcept(std::is_nothrow_constructible_v<Parent, Args...>)
+      : Parent(std::forward<Args>(args)...) {
+    stamp();
+  }
+
+  closed_leaf(const closed_leaf& other) noexcept(std::is_nothrow_copy_constructible_v<Parent>)
+      : Parent(other) {
+    stamp();
+  }
+
+  closed_leaf(closed_leaf&& other) noexcept(std::is_nothrow_move_constructible_v<Parent>)
+      : Parent(std::move(other)) {
+    stamp();
+  }
+
+private:
+  void stamp() noexcept {
+    static_assert(Parent::template index_of<Self> != Parent::npos,
+                  "Self is not listed in the hierarchy's closed type list.");
+    this->tag_ = Parent::template index_of<Self>;
+  }
+};
+
+} // namespace ndof
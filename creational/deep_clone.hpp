@@ -0,0 +1,305 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "ICloneable.hpp"
+#include "clone_block.hpp"
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   struct bytes
+
+// Passed to a node's for_each_ref(); called once per internal (non-owning) U*
+// edge. A plain function pointer + context keeps for_each_ref() virtual-friendly.
+//
+// The edge must be a U* member itself: deep cloning rewrites it in place. A
+// pointer of another type (an edge declared Derived*) or an rvalue would bind
+// a temporary U*, and the clone would keep pointing into the source graph, so
+// those overloads are deleted.
+template <class U>
+struct ref_visitor {
+  void* ctx;
+  void (*fn)(void* ctx, U* const& ref) noexcept;
+
+  void operator()(U* const& ref) const noexcept { fn(ctx, ref); }
+
+  template <class V>
+  requires (!std::is_same_v<V, U>)
+  void operator()(V* const&) const = delete;
+
+  void operator()(U*&&) const = delete;
+};
+
+// A node of a clonable object graph: placement-cloneable (see ICloneable) and
+// able to enumerate its edges. Edges are non-owning U* members; the graph is
+// owned elsewhere (e.g., by an arena or a clone_block). Example:
+//
+//   void for_each_ref(ndof::ref_visitor<Node> v) const noexcept override {
+//     v(left); v(right);
+//   }
+template <class U>
+concept graph_cloneable = placement_cloneable<U> && requires(const U& u, ref_visitor<U> v) {
+  { u.for_each_ref(v) } noexcept;
+};
+
+namespace detail {
+
+  // Grow-only array of trivially copyable T, allocator-aware, error-coded.
+  template <class T, class AllocFamily>
+  class scratch_array {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+  public:
+    using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<T>;
+    using traits         = std::allocator_traits<allocator_type>;
+
+    explicit scratch_array(const allocator_type& a) noexcept : alloc_(a) {}
+    ~scratch_array() noexcept { if (data_) traits::deallocate(alloc_, data_, cap_); }
+
+    scratch_array(const scratch_array&) = delete;
+    scratch_array& operator=(const scratch_array&) = delete;
+
+    std::size_t size() const noexcept { return size_; }
+    const T& operator[](std::size_t i) const noexcept { return data_[i]; }
+
+    std::expected<void, ec> push_back(const T& v) noexcept {
+      if (size_ == cap_) {
+        auto r = grow(cap_ ? cap_ * 2 : 64);
+        if (!r) return r;
+      }
+      data_[size_++] = v;
+      return {};
+    }
+
+  private:
+    std::expected<void, ec> grow(std::size_t n) noexcept {
+      if (n > traits::max_size(alloc_)) return std::unexpected(ec::alloc_failed);
+      T* p = nullptr;
+#if defined(__cpp_exceptions)
+      try {
+        p = traits::allocate(alloc_, n);
+      } catch (...) {
+        return std::unexpected(ec::alloc_failed);
+      }
+#else
+      p = traits::allocate(alloc_, n);
+      if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+      if (data_) {
+        std::memcpy(p, data_, size_ * sizeof(T));
+        traits::deallocate(alloc_, data_, cap_);
+      }
+      data_ = p;
+      cap_  = n;
+      return {};
+    }
+
+    [[no_unique_address]] allocator_type alloc_;
+    T* data_{nullptr};
+    std::size_t size_{0};
+    std::size_t cap_{0};
+  };
+
+  // Flat open-addressing (linear probing) map from node address to dense index.
+  // One contiguous slot array, no per-entry nodes; kept at most half full.
+  template <class U, class AllocFamily>
+  class flat_visited_map {
+    struct slot {
+      const U* key;
+      std::size_t index;
+    };
+
+  public:
+    using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<slot>;
+    using traits         = std::allocator_traits<allocator_type>;
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    explicit flat_visited_map(const allocator_type& a) noexcept : alloc_(a) {}
+    ~flat_visited_map() noexcept { if (slots_) traits::deallocate(alloc_, slots_, cap_); }
+
+    flat_visited_map(const flat_visited_map&) = delete;
+    flat_visited_map& operator=(const flat_visited_map&) = delete;
+
+    std::size_t find(const U* key) const noexcept {
+      if (!slots_) return npos;
+      for (std::size_t i = home(key, shift_);; i = (i + 1) & (cap_ - 1)) {
+        if (slots_[i].key == key) return slots_[i].index;
+        if (!slots_[i].key) return npos;
+      }
+    }
+
+    // true if inserted, false if key was already present.
+    std::expected<bool, ec> try_insert(const U* key, std::size_t index) noexcept {
+      if (2 * (size_ + 1) > cap_) {
+        auto r = rehash(cap_ ? cap_ * 2 : 1024);
+        if (!r) return std::unexpected(r.error());
+      }
+      std::size_t i = home(key, shift_);
+      while (slots_[i].key) {
+        if (slots_[i].key == key) return false;
+        i = (i + 1) & (cap_ - 1);
+      }
+      slots_[i] = {key, index};
+      ++size_;
+      return true;
+    }
+
+  private:
+    // Fibonacci hashing: the top log2(capacity) bits of address * 2^64/phi.
+    static std::size_t home(const U* key, unsigned shift) noexcept {
+      const auto k = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key));
+      return static_cast<std::size_t>((k * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+
+    // n is a power of two.
+    std::expected<void, ec> rehash(std::size_t n) noexcept {
+      if (n > traits::max_size(alloc_)) return std::unexpected(ec::alloc_failed);
+      slot* fresh = nullptr;
+#if defined(__cpp_exceptions)
+      try {
+        fresh = traits::allocate(alloc_, n);
+      } catch (...) {
+        return std::unexpected(ec::alloc_failed);
+      }
+#else
+      fresh = traits::allocate(alloc_, n);
+      if (!fresh) return std::unexpected(ec::alloc_failed);
+#endif
+      for (std::size_t i = 0; i < n; ++i) fresh[i] = {nullptr, 0};
+
+      const auto shift = static_cast<unsigned>(64 - std::countr_zero(n));
+      for (std::size_t j = 0; j < cap_; ++j) {
+        if (!slots_[j].key) continue;
+        std::size_t i = home(slots_[j].key, shift);
+        while (fresh[i].key) i = (i + 1) & (n - 1);
+        fresh[i] = slots_[j];
+      }
+      if (slots_) traits::deallocate(alloc_, slots_, cap_);
+      slots_ = fresh;
+      cap_   = n;
+      shift_ = shift;
+      return {};
+    }
+
+    [[no_unique_address]] allocator_type alloc_;
+    slot* slots_{nullptr};
+    std::size_t cap_{0};
+    std::size_t size_{0};
+    unsigned shift_{64};
+  };
+
+} // namespace detail
+
+// ----------------------------------------------------------------------------
+// Core API: always std::expected
+// ----------------------------------------------------------------------------
+
+// Deep-clones every node reachable from roots into a single allocation from
+// alloc (typically an arena), preserving sharing: a node reachable along
+// several paths is cloned once and every edge to it is redirected to that one
+// copy. Cycles are fine. Edges in the clones are rewritten to point into the
+// new graph; null edges stay null.
+//
+// Nodes are laid out in breadth-first order from the roots, so the clones of
+// the distinct non-null roots come first, in the order given: result[0] is the
+// clone of the first root. Traversal bookkeeping (visited map, BFS queue) is
+// allocated from scratch and released before returning.
+//
+// Errors: ec::alloc_failed, or whatever clone_into() reports.
+template <graph_cloneable U, class AllocFamily, class ScratchAlloc = std::allocator<std::byte>>
+[[nodiscard]] std::expected<clone_block<U, AllocFamily>, ec>
+try_deep_clone(std::span<const U* const> roots,
+               const AllocFamily& alloc,
+               const ScratchAlloc& scratch = ScratchAlloc{}) noexcept {
+  using order_type = detail::scratch_array<const U*, ScratchAlloc>;
+  using map_type   = detail::flat_visited_map<U, ScratchAlloc>;
+  using block_type = clone_block<U, AllocFamily>;
+
+  order_type order{typename order_type::allocator_type(scratch)};
+  map_type visited{typename map_type::allocator_type(scratch)};
+
+  struct discover_ctx {
+    order_type& order;
+    map_type& visited;
+    ec error;
+  } dctx{order, visited, ec::ok};
+
+  auto discover = [](void* c, U* const& ref) noexcept {
+    auto& ctx = *static_cast<discover_ctx*>(c);
+    if (!ref || ctx.error != ec::ok) return;
+    auto ins = ctx.visited.try_insert(ref, ctx.order.size());
+    if (!ins) { ctx.error = ins.error(); return; }
+    if (!*ins) return;
+    auto pushed = ctx.order.push_back(ref);
+    if (!pushed) ctx.error = pushed.error();
+  };
+
+  // Discover: the order array doubles as the BFS queue.
+  for (const U* root : roots) {
+    U* const r = const_cast<U*>(root);
+    discover(&dctx, r);
+  }
+  const ref_visitor<U> dv{&dctx, +discover};
+  for (std::size_t i = 0; i < order.size() && dctx.error == ec::ok; ++i) {
+    order[i]->for_each_ref(dv);
+  }
+  if (dctx.error != ec::ok) return std::unexpected(dctx.error);
+
+  // Clone: one allocation, every node placement-cloned in BFS order.
+  auto built = block_type::try_build(
+      order.size(),
+      [&order](std::size_t i) noexcept -> const U& { return *order[i]; },
+      typename block_type::allocator_type(alloc));
+  if (!built) return std::unexpected(built.error());
+
+  // Fix up: edges in the clones still hold the original addresses.
+  struct fixup_ctx {
+    const map_type& visited;
+    std::span<U* const> clones;
+  } fctx{visited, built->objects()};
+
+  const ref_visitor<U> fv{&fctx, [](void* c, U* const& ref) noexcept {
+    auto& ctx = *static_cast<fixup_ctx*>(c);
+    if (!ref) return;
+    // The clone is a non-const object, so writing through its edge is well-defined.
+    const_cast<U*&>(ref) = ctx.clones[ctx.visited.find(ref)];
+  }};
+  for (U* clone : built->objects()) {
+    clone->for_each_ref(fv);
+  }
+
+  return std::move(*built);
+}
+
+template <graph_cloneable U, class AllocFamily, class ScratchAlloc = std::allocator<std::byte>>
+[[nodiscard]] std::expected<clone_block<U, AllocFamily>, ec>
+try_deep_clone(const U& root, const AllocFamily& alloc, const ScratchAlloc& scratch = ScratchAlloc{}) noexcept {
+  const U* const roots[] = {&root};
+  return try_deep_clone<U>(std::span<const U* const>(roots), alloc, scratch);
+}
+
+// ----------------------------------------------------------------------------
+// Convenience API: stable shape, returns an empty block on failure
+// ----------------------------------------------------------------------------
+
+template <graph_cloneable U, class AllocFamily = std::allocator<std::byte>>
+[[nodiscard]] clone_block<U, AllocFamily>
+deep_clone(const U& root, const AllocFamily& alloc = AllocFamily{}) noexcept {
+  using block_type = clone_block<U, AllocFamily>;
+  auto r = try_deep_clone(root, alloc);
+  return r ? std::move(*r) : block_type(typename block_type::allocator_type(alloc));
+}
+
+} // namespace ndof
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class T, class Alloc, class... Args>
+//   void construct_with_optional_alloc(T*, const Alloc&, Args&&...) noexcept(...)
+
+// A string literal usable as a template argument: product<"circle", Circle>.
+template <std::size_t N>
+struct fixed_string {
+  char chars[N]{};
+
+  constexpr fixed_string(const char (&s)[N]) noexcept {
+    for (std::size_t i = 0; i < N; ++i) chars[i] = s[i];
+  }
+
+  constexpr std::string_view view() const noexcept { return {chars, N - 1}; }
+};
+
+// Registers T under Key. T is constructed by factory::create().
+template <fixed_string Key, class T>
+struct product {
+  using type = T;
+  static constexpr std::string_view key = Key.view();
+};
+
+namespace detail {
+
+  // FNV-1a, seeded. Good enough to find a collision-free seed quickly for
+  // the handful to few hundred keys a factory has.
+  constexpr std::uint64_t key_hash(std::string_view s, std::uint64_t seed) noexcept {
+    std::uint64_t h = 0xcbf29ce484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+    for (char c : s) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 0x100000001b3ull;
+    }
+    return h ^ (h >> 32);
+  }
+
+  // Minimal-ish perfect hash over a fixed key set: the smallest power-of-two
+  // table (at least N, at most 8N) and the first seed for which every key
+  // lands in its own slot. Found at compile time; lookups hash once.
+  template <std::size_t N>
+  struct perfect_hash {
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::size_t max_slots = std::bit_ceil(N) * 8;
+
+    std::uint64_t seed{0};
+    std::size_t mask{0};
+    std::array<std::uint32_t, max_slots> slot{};  // key index, or npos
+    bool found{false};
+
+    static constexpr perfect_hash build(const std::array<std::string_view, N>& keys) noexcept {
+      perfect_hash ph;
+      for (std::size_t m = std::bit_ceil(N); m <= max_slots; m *= 2) {
+        for (std::uint64_t seed = 0; seed < 4096; ++seed) {
+          ph.slot.fill(npos);
+          bool ok = true;
+          for (std::size_t i = 0; i < N && ok; ++i) {
+            auto& s = ph.slot[key_hash(keys[i], seed) & (m - 1)];
+            ok = (s == npos);
+            s = static_cast<std::uint32_t>(i);
+          }
+          if (ok) {
+            ph.seed = seed;
+            ph.mask = m - 1;
+            ph.found = true;
+            return ph;
+          }
+        }
+      }
+      return ph;
+    }
+  };
+
+} // namespace detail
+
+// Abstract factory with a closed, compile-time product list.
+//
+//   using shapes = ndof::factory<Shape,
+//                                ndof::product<"circle", Circle>,
+//                                ndof::product<"square", Square>>;
+//   auto s = shapes::try_create("circle", arena_alloc, 2.0);  // std::expected
+//   auto t = shapes::create("square", 1.0);                    // std::allocator, null on failure
+//
+// Keys are looked up through a perfect hash generated at compile time: one
+// hash of the runtime key, one slot, one string compare. The registry is a
+// constexpr table of function pointers, so there are no registry nodes and
+// no static initialization order to worry about.
+//
+// Construction is erased the way function_with_allocator erases callables: a
+// per-(product, allocator, argument list) function-pointer table, instantiated
+// only for the argument lists actually used. Products are allocated from the
+// caller's allocator, rebound to the product type.
+//
+// Products are owned through deleter<Alloc>, which destroys and deallocates the
+// dynamic type via the product index, so Base needs no virtual destructor.
+template <class Base, class... Products>
+class factory {
+  static_assert(sizeof...(Products) > 0, "A factory needs at least one product.");
+  static_assert((std::derived_from<typename Products::type, Base> && ...),
+                "Every product must derive from Base.");
+
+  static constexpr std::array<std::string_view, sizeof...(Products)> key_list = {Products::key...};
+
+  static constexpr bool distinct_keys = [] {
+    for (std::size_t i = 0; i < key_list.size(); ++i) {
+      for (std::size_t j = i + 1; j < key_list.size(); ++j) {
+        if (key_list[i] == key_list[j]) return false;
+      }
+    }
+    return true;
+  }();
+  static_assert(distinct_keys, "Two products are registered under the same key.");
+
+  static constexpr auto hash = detail::perfect_hash<sizeof...(Products)>::build(key_list);
+  static_assert(hash.found, "No collision-free seed found for this key set.");
+
+public:
+  using index_type = std::uint32_t;
+
+  static constexpr index_type npos = detail::perfect_hash<sizeof...(Products)>::npos;
+
+  [[nodiscard]] static constexpr std::size_t size() noexcept { return sizeof...(Products); }
+  [[nodiscard]] static constexpr const auto& keys() noexcept { return key_list; }
+
+  // Index of the product registered under key, or npos. Usable in constant
+  // expressions, e.g. static_assert(shapes::contains("circle")).
+  [[nodiscard]] static constexpr index_type index_of(std::string_view key) noexcept {
+    const index_type i = hash.slot[detail::key_hash(key, hash.seed) & hash.mask];
+    return (i != npos && key_list[i] == key) ? i : npos;
+  }
+
+  [[nodiscard]] static constexpr bool contains(std::string_view key) noexcept {
+    return index_of(key) != npos;
+  }
+
+  // Index of a product type, or npos if T is not registered.
+  template <class T>
+  static constexpr index_type index_for = [] {
+    constexpr bool hits[] = {std::same_as<T, typename Products::type>...};
+    for (std::size_t i = 0; i < sizeof...(Products); ++i) {
+      if (hits[i]) return static_cast<index_type>(i);
+    }
+    return npos;
+  }();
+
+  // Allocator-aware deleter for products: destroys and deallocates the dynamic
+  // type recorded when the product was created.
+  template <class AllocFamily>
+  struct deleter {
+    using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<Base>;
+
+    [[no_unique_address]] allocator_type alloc{};
+    index_type index{npos};
+
+    void operator()(Base* p) const noexcept {
+      if (!p) return;
+      allocator_type a = alloc;
+      release_table<allocator_type>[index](a, p);
+    }
+  };
+
+  template <class AllocFamily = std::allocator<Base>>
+  using pointer = std::unique_ptr<Base, deleter<AllocFamily>>;
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Creates the product registered under key from args, allocated from alloc.
+  // Errors:
+  //   ec::type_mismatch          no product is registered under key
+  //   ec::construction_failed    that product is not constructible from args,
+  //                              or its constructor threw
+  //   ec::alloc_failed           the allocator failed
+  template <class AllocFamily, class... Args>
+  [[nodiscard]] static std::expected<pointer<AllocFamily>, ec>
+  try_create(std::string_view key, const AllocFamily& alloc, Args&&... args) noexcept {
+    return try_create_at(index_of(key), alloc, std::forward<Args>(args)...);
+  }
+
+  // As try_create(), by product index (index_of / index_for), skipping the lookup.
+  template <class AllocFamily, class... Args>
+  [[nodiscard]] static std::expected<pointer<AllocFamily>, ec>
+  try_create_at(index_type index, const AllocFamily& alloc, Args&&... args) noexcept {
+    using allocator_type = typename deleter<AllocFamily>::allocator_type;
+
+    if (index >= sizeof...(Products)) return std::unexpected(ec::type_mismatch);
+
+    allocator_type a(alloc);
+    auto r = create_table<allocator_type, Args&&...>[index](a, std::forward<Args>(args)...);
+    if (!r) return std::unexpected(r.error());
+    return pointer<AllocFamily>(*r, deleter<AllocFamily>{a, index});
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns nullptr on failure
+  // --------------------------------------------------------------------------
+
+  // From std::allocator<Base>: shapes::create("circle", 2.0).
+  template <class... Args>
+  [[nodiscard]] static pointer<> create(std::string_view key, Args&&... args) noexcept {
+    return create(std::allocator_arg, std::allocator<Base>{}, key, std::forward<Args>(args)...);
+  }
+
+  // From alloc, passed behind std::allocator_arg so that it is never taken for
+  // a constructor argument: shapes::create(std::allocator_arg, arena, "circle", 2.0).
+  template <class AllocFamily, class... Args>
+  [[nodiscard]] static pointer<AllocFamily>
+  create(std::allocator_arg_t, const AllocFamily& alloc, std::string_view key, Args&&... args) noexcept {
+    auto r = try_create(key, alloc, std::forward<Args>(args)...);
+    return r ? std::move(*r) : pointer<AllocFamily>(nullptr, deleter<AllocFamily>{});
+  }
+
+private:
+  template <class Alloc, class... Args>
+  using create_fn = std::expected<Base*, ec> (*)(Alloc&, Args...) noexcept;
+
+  template <class Alloc>
+  using release_fn = void (*)(Alloc&, Base*) noexcept;
+
+  template <class T, class Alloc, class... Args>
+  static std::expected<Base*, ec> create_impl(Alloc& alloc, Args... args) noexcept {
+    if constexpr (!std::is_constructible_v<T, Args...>) {
+      return std::unexpected(ec::construction_failed);
+    } else {
+      using TAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+      using ttraits = std::allocator_traits<TAlloc>;
+
+      TAlloc ta(alloc);
+      T* p = nullptr;
+#if defined(__cpp_exceptions)
+      try {
+        p = ttraits::allocate(ta, 1);
+      } catch (...) {
+        return std::unexpected(ec::alloc_failed);
+      }
+      try {
+        construct_with_optional_alloc(p, ta, std::forward<Args>(args)...);
+      } catch (...) {
+        ttraits::deallocate(ta, p, 1);
+        return std::unexpected(ec::construction_failed);
+      }
+#else
+      p = ttraits::allocate(ta, 1);
+      if (!p) return std::unexpected(ec::alloc_failed);
+      construct_with_optional_alloc(p, ta, std::forward<Args>(args)...);
+#endif
+      return static_cast<Base*>(p);
+    }
+  }
+
+  template <class T, class Alloc>
+  static void release_impl(Alloc& alloc, Base* p) noexcept {
+    using TAlloc  = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+    using ttraits = std::allocator_traits<TAlloc>;
+
+    TAlloc ta(alloc);
+    T* t = static_cast<T*>(p);
+    ttraits::destroy(ta, t);
+    ttraits::deallocate(ta, t, 1);
+  }
+
+  // One entry per product, indexed by product index. Built at compile time,
+  // once per allocator / argument list combination that is actually used.
+  template <class Alloc, class... Args>
+  static constexpr std::array<create_fn<Alloc, Args...>, sizeof...(Products)> create_table = {
+    &create_impl<typename Products::type, Alloc, Args...>...
+  };
+
+  template <class Alloc>
+  static constexpr std::array<release_fn<Alloc>, sizeof...(Products)> release_table = {
+    &release_impl<typename Products::type, Alloc>...
+  };
+};
+
+} // namespace ndof
@@ -0,0 +1,576 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+
+enum class pool_mode {
+  construct_on_acquire, // acquire(args...) constructs, release destroys
+  preconstructed        // objects are default-constructed once and reused as-is
+};
+
+namespace detail {
+
+  // Lock-free LIFO of 32-bit indices (Treiber stack). Links live in a
+  // caller-owned array of atomics; the head packs a 32-bit ABA tag with
+  // index + 1 (0 means empty), so a single 64-bit CAS suffices.
+  class tagged_index_stack {
+  public:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    template <class Links>
+    void push(std::uint32_t i, Links&& link_of) noexcept {
+      std::uint64_t old = head_.load(std::memory_order_relaxed);
+      std::uint64_t fresh;
+      do {
+        link_of(i).store(static_cast<std::uint32_t>(old), std::memory_order_relaxed);
+        fresh = next_tag(old) | (std::uint64_t{i} + 1);
+      } while (!head_.compare_exchange_weak(old, fresh,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+    }
+
+    template <class Links>
+    std::uint32_t pop(Links&& link_of) noexcept {
+      std::uint64_t old = head_.load(std::memory_order_acquire);
+      std::uint64_t fresh;
+      std::uint32_t i;
+      do {
+        const auto low = static_cast<std::uint32_t>(old);
+        if (low == 0) return npos;
+        i = low - 1;
+        fresh = next_tag(old) | link_of(i).load(std::memory_order_relaxed);
+      } while (!head_.compare_exchange_weak(old, fresh,
+                                            std::memory_order_acquire,
+                                            std::memory_order_acquire));
+      return i;
+    }
+
+  private:
+    static std::uint64_t next_tag(std::uint64_t v) noexcept {
+      return ((v >> 32) + 1) << 32;
+    }
+
+    std::atomic<std::uint64_t> head_{0};
+  };
+
+} // namespace detail
+
+// Allocator-aware, bounded pool of T with per-thread magazines.
+//
+//   depot        Lock-free. Holds full magazines (arrays of free slot indices),
+//                empty magazines, and loose slots freed by threads without a
+//                cache. All three are tagged index stacks.
+//   thread_cache Per-thread front end (two magazines, Bonwick style). While a
+//                cache is bound on the calling thread, acquire and release on
+//                that thread touch only the cache, and talk to the depot one
+//                magazine at a time.
+//   growth       Slots come in chunks of chunk_objects from the allocator,
+//                allocated lazily and never beyond max_objects.
+//
+// Objects are handed out as unique_ptr<T, deleter>; the deleter returns the
+// object to the pool (to the releasing thread's cache if it has one, else to
+// the depot), so frees from any thread are safe.
+//
+// In pool_mode::preconstructed, slots are default-constructed when first
+// created (prewarm creates them up front) and released objects are not
+// destroyed; acquire() then returns an object in whatever state it was left.
+//
+// Contract: every object and every thread_cache must be gone before the pool,
+// and the allocator must outlive the pool.
+template <class T,
+          class AllocFamily = std::allocator<std::byte>,
+          pool_mode Mode = pool_mode::construct_on_acquire>
+class object_pool {
+  using index_t = std::uint32_t;
+  static constexpr index_t npos = detail::tagged_index_stack::npos;
+
+public:
+  using value_type     = T;
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  struct config {
+    std::size_t max_objects   = 4096; // hard bound on live + free objects
+    std::size_t chunk_objects = 256;  // slots per lazily allocated chunk
+    std::size_t magazine_size = 32;   // slots per magazine
+    std::size_t max_threads   = 64;   // concurrently bound thread caches
+    std::size_t prewarm       = 0;    // slots created (and constructed) up front
+  };
+
+  // AllocDeleter-style: stateless apart from the pool it returns to.
+  struct deleter {
+    object_pool* pool{nullptr};
+
+    void operator()(T* p) const noexcept {
+      if (p && pool) pool->release(p);
+    }
+  };
+
+  using pointer = std::unique_ptr<T, deleter>;
+
+  class thread_cache;
+
+  explicit object_pool(const config& cfg = config{}, const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a) {
+    (void)init(cfg);
+  }
+
+  ~object_pool() noexcept { teardown(); }
+
+  object_pool(const object_pool&) = delete;
+  object_pool& operator=(const object_pool&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // False if construction could not allocate its bookkeeping; every acquire
+  // then fails with ec::alloc_failed.
+  [[nodiscard]] bool valid() const noexcept { return chunks_ != nullptr; }
+
+  [[nodiscard]] std::size_t max_objects() const noexcept { return max_objects_; }
+
+  // Slot numbers handed out so far (live + free, plus any lost to a failed
+  // chunk allocation or, in preconstructed mode, a throwing constructor);
+  // never more than max_objects().
+  [[nodiscard]] std::size_t created() const noexcept {
+    return static_cast<std::size_t>(fresh_.load(std::memory_order_relaxed));
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::alloc_failed when max_objects are live or a chunk cannot be
+  // allocated; ec::construction_failed when T's constructor throws.
+  template <class... Args>
+  [[nodiscard]] std::expected<pointer, ec> try_acquire(Args&&... args) noexcept {
+    static_assert(Mode == pool_mode::construct_on_acquire || sizeof...(Args) == 0,
+                  "Preconstructed pools hand out existing objects; acquire() takes no arguments.");
+
+    const index_t i = acquire_slot(bound_cache());
+    if (i == npos) return std::unexpected(ec::alloc_failed);
+
+    T* p = object_at(i);
+    if constexpr (Mode == pool_mode::construct_on_acquire) {
+      auto r = construct(p, std::forward<Args>(args)...);
+      if (!r) {
+        release_slot(bound_cache(), i);
+        return std::unexpected(r.error());
+      }
+    }
+    return pointer(p, deleter{this});
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns nullptr on failure
+  // --------------------------------------------------------------------------
+
+  template <class... Args>
+  [[nodiscard]] pointer acquire(Args&&... args) noexcept {
+    auto r = try_acquire(std::forward<Args>(args)...);
+    return r ? std::move(*r) : pointer(nullptr, deleter{this});
+  }
+
+private:
+  // Each slot is [index][pad][T]; the index lets release() find the slot from T*.
+  static constexpr std::size_t slot_header = (sizeof(index_t) + alignof(T) - 1) / alignof(T) * alignof(T);
+  static constexpr std::size_t slot_align  = std::max(alignof(T), alignof(index_t));
+  static constexpr std::size_t slot_stride = (slot_header + sizeof(T) + slot_align - 1) / slot_align * slot_align;
+
+  // Chunk layout: [links: chunk_objects x atomic<index_t>][constructed flags,
+  // preconstructed mode only: chunk_objects x bool][pad][slots].
+  struct chunk_layout {
+    std::size_t flags_offset;
+    std::size_t slots_offset;
+    std::size_t bytes;
+  };
+
+  static constexpr bool tracks_construction = Mode == pool_mode::preconstructed;
+
+  template <class... Args>
+  static std::expected<void, ec> construct(T* p, Args&&... args) noexcept {
+#if defined(__cpp_exceptions)
+    try {
+      std::construct_at(p, std::forward<Args>(args)...);
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    std::construct_at(p, std::forward<Args>(args)...);
+#endif
+    return {};
+  }
+
+  template <class U>
+  static std::expected<U*, ec> allocate_array(allocator_type& a, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(a);
+    if (n > utraits::max_size(ua)) return std::unexpected(ec::alloc_failed);
+    U* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = utraits::allocate(ua, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = utraits::allocate(ua, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  template <class U>
+  static void deallocate_array(allocator_type& a, U* p, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(a);
+    utraits::deallocate(ua, p, n);
+  }
+
+  std::expected<void, ec> init(const config& cfg) noexcept {
+    if (cfg.max_objects == 0 || cfg.max_objects >= npos) return std::unexpected(ec::alloc_failed);
+
+    chunk_objects_ = std::clamp<std::size_t>(cfg.chunk_objects, 1, cfg.max_objects);
+    magazine_size_ = std::max<std::size_t>(cfg.magazine_size, 1);
+    max_chunks_    = (cfg.max_objects + chunk_objects_ - 1) / chunk_objects_;
+    max_objects_   = cfg.max_objects;
+
+    const std::size_t links = chunk_objects_ * sizeof(std::atomic<index_t>);
+    const std::size_t flags = tracks_construction ? chunk_objects_ : 0;
+    const std::size_t slots_offset = (links + flags + slot_align - 1) / slot_align * slot_align;
+    if (chunk_objects_ > (std::numeric_limits<std::size_t>::max() - slots_offset - slot_align) / slot_stride) {
+      return std::unexpected(ec::alloc_failed);
+    }
+    layout_ = {links, slots_offset, slots_offset + chunk_objects_ * slot_stride + slot_align - 1};
+
+    // Enough magazines to hold every slot, plus two per bound cache.
+    mag_count_ = (max_objects_ + magazine_size_ - 1) / magazine_size_ + 2 * cfg.max_threads + 1;
+    if (mag_count_ >= npos) return std::unexpected(ec::alloc_failed);
+
+    auto c = allocate_array<std::atomic<std::byte*>>(alloc_, max_chunks_);
+    if (!c) return std::unexpected(c.error());
+    auto m = allocate_array<index_t>(alloc_, mag_count_ * (magazine_size_ + 1));
+    if (!m) {
+      deallocate_array(alloc_, *c, max_chunks_);
+      return std::unexpected(m.error());
+    }
+    auto l = allocate_array<std::atomic<index_t>>(alloc_, mag_count_);
+    if (!l) {
+      deallocate_array(alloc_, *m, mag_count_ * (magazine_size_ + 1));
+      deallocate_array(alloc_, *c, max_chunks_);
+      return std::unexpected(l.error());
+    }
+
+    chunks_    = *c;
+    mags_      = *m;
+    mag_links_ = *l;
+    for (std::size_t i = 0; i < max_chunks_; ++i) std::construct_at(chunks_ + i, nullptr);
+    for (std::size_t i = 0; i < mag_count_; ++i) {
+      std::construct_at(mag_links_ + i, npos);
+      mags_[i * (magazine_size_ + 1)] = 0;
+      empty_mags_.push(static_cast<index_t>(i), mag_link());
+    }
+
+    // Prewarm: create slots now so the first acquires need no chunk allocation.
+    for (std::size_t n = std::min(cfg.prewarm, max_objects_); n > 0; --n) {
+      const index_t i = fresh_slot();
+      if (i == npos) break;
+      loose_.push(i, slot_link());
+    }
+    return {};
+  }
+
+  void teardown() noexcept {
+    if (!chunks_) return;
+    for (std::size_t k = 0; k < max_chunks_; ++k) {
+      std::byte* raw = chunks_[k].load(std::memory_order_relaxed);
+      if (!raw) continue;
+      if constexpr (tracks_construction) {
+        // Only slots whose constructor ran: a slot number can exist without
+        // an object (its construction threw, or its chunk allocation failed
+        // and another thread created the chunk later).
+        const bool* constructed = flags_of(raw);
+        for (std::size_t j = 0; j < chunk_objects_; ++j) {
+          if (constructed[j]) std::destroy_at(object_at(static_cast<index_t>(k * chunk_objects_ + j)));
+        }
+      }
+      deallocate_array(alloc_, raw, layout_.bytes);
+    }
+    std::destroy_n(chunks_, max_chunks_);
+    std::destroy_n(mag_links_, mag_count_);
+    deallocate_array(alloc_, chunks_, max_chunks_);
+    deallocate_array(alloc_, mags_, mag_count_ * (magazine_size_ + 1));
+    deallocate_array(alloc_, mag_links_, mag_count_);
+    chunks_ = nullptr;
+  }
+
+  // --------------------------------------------------------------------------
+  // Slots
+  // --------------------------------------------------------------------------
+
+  std::byte* slots_of(std::byte* raw) const noexcept {
+    auto base = reinterpret_cast<std::uintptr_t>(raw + layout_.slots_offset);
+    base = (base + slot_align - 1) / slot_align * slot_align;
+    return reinterpret_cast<std::byte*>(base);
+  }
+
+  bool* flags_of(std::byte* raw) const noexcept {
+    return reinterpret_cast<bool*>(raw + layout_.flags_offset);
+  }
+
+  std::byte* slot_at(index_t i) const noexcept {
+    std::byte* raw = chunks_[i / chunk_objects_].load(std::memory_order_acquire);
+    return slots_of(raw) + (i % chunk_objects_) * slot_stride;
+  }
+
+  T* object_at(index_t i) const noexcept {
+    return reinterpret_cast<T*>(slot_at(i) + slot_header);
+  }
+
+  static index_t index_of(T* p) noexcept {
+    index_t i;
+    std::memcpy(&i, reinterpret_cast<std::byte*>(p) - slot_header, sizeof(i));
+    return i;
+  }
+
+  auto slot_link() noexcept {
+    return [this](index_t i) noexcept -> std::atomic<index_t>& {
+      std::byte* raw = chunks_[i / chunk_objects_].load(std::memory_order_acquire);
+      return reinterpret_cast<std::atomic<index_t>*>(raw)[i % chunk_objects_];
+    };
+  }
+
+  auto mag_link() noexcept {
+    return [this](index_t m) noexcept -> std::atomic<index_t>& { return mag_links_[m]; };
+  }
+
+  index_t* magazine(index_t m) const noexcept { return mags_ + std::size_t{m} * (magazine_size_ + 1); }
+
+  // Creates a never-used slot, allocating its chunk on first touch (lock-free:
+  // racing threads each allocate, one wins the CAS, the others give theirs back).
+  // fresh_ stops at max_objects, so exhausted acquires do not move it.
+  index_t fresh_slot() noexcept {
+    std::uint64_t n = fresh_.load(std::memory_order_relaxed);
+    do {
+      if (n >= max_objects_) return npos;
+    } while (!fresh_.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+    const auto i = static_cast<index_t>(n);
+    const std::size_t k = i / chunk_objects_;
+
+    if (!chunks_[k].load(std::memory_order_acquire)) {
+      auto raw = allocate_array<std::byte>(alloc_, layout_.bytes);
+      if (!raw) return give_back_fresh(n);
+      for (std::size_t j = 0; j < chunk_objects_; ++j) {
+        std::construct_at(reinterpret_cast<std::atomic<index_t>*>(*raw) + j, npos);
+      }
+      if constexpr (tracks_construction) {
+        std::fill_n(flags_of(*raw), chunk_objects_, false);
+      }
+      std::byte* expected = nullptr;
+      if (!chunks_[k].compare_exchange_strong(expected, *raw,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+        deallocate_array(alloc_, *raw, layout_.bytes);
+      }
+    }
+
+    std::memcpy(slot_at(i), &i, sizeof(i));
+    if constexpr (tracks_construction) {
+      if (!construct(object_at(i))) return give_back_fresh(n);
+      flags_of(chunks_[k].load(std::memory_order_acquire))[i % chunk_objects_] = true;
+    }
+    return i;
+  }
+
+  // Returns slot number n to the fresh range if no later one has been taken;
+  // otherwise it is lost and the pool just shrinks. Either way its slot holds
+  // no object, and teardown (which goes by the constructed flags) skips it.
+  index_t give_back_fresh(std::uint64_t n) noexcept {
+    std::uint64_t taken = n + 1;
+    (void)fresh_.compare_exchange_strong(taken, n, std::memory_order_relaxed);
+    return npos;
+  }
+
+  // --------------------------------------------------------------------------
+  // Depot and caches
+  // --------------------------------------------------------------------------
+
+  index_t acquire_slot(thread_cache* c) noexcept {
+    if (!chunks_) return npos;
+    if (c) return c->pop();
+
+    // Uncached: loose slots, then fresh ones, then break open a full magazine.
+    index_t i = loose_.pop(slot_link());
+    if (i != npos) return i;
+    i = fresh_slot();
+    if (i != npos) return i;
+
+    const index_t m = full_mags_.pop(mag_link());
+    if (m == npos) return npos;
+    index_t* mag = magazine(m);
+    i = mag[mag[0]--];
+    while (mag[0] > 0) loose_.push(mag[mag[0]--], slot_link());
+    empty_mags_.push(m, mag_link());
+    return i;
+  }
+
+  void release_slot(thread_cache* c, index_t i) noexcept {
+    if (c) {
+      c->push(i);
+    } else {
+      loose_.push(i, slot_link());
+    }
+  }
+
+  void release(T* p) noexcept {
+    const index_t i = index_of(p);
+    if constexpr (Mode == pool_mode::construct_on_acquire) {
+      std::destroy_at(p);
+    }
+    release_slot(bound_cache(), i);
+  }
+
+  // The calling thread's cache for this pool, if one is bound.
+  thread_cache* bound_cache() noexcept {
+    for (thread_cache* c = thread_cache::bound_; c; c = c->next_bound_) {
+      if (c->pool_ == this) return c;
+    }
+    return nullptr;
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+
+  std::atomic<std::byte*>* chunks_{nullptr};
+  std::size_t max_chunks_{0};
+  std::size_t chunk_objects_{1};
+  std::size_t max_objects_{0};
+  chunk_layout layout_{};
+  std::atomic<std::uint64_t> fresh_{0};
+
+  index_t* mags_{nullptr};                 // mag_count_ x [count, slots...]
+  std::atomic<index_t>* mag_links_{nullptr};
+  std::size_t mag_count_{0};
+  std::size_t magazine_size_{1};
+
+  detail::tagged_index_stack full_mags_;
+  detail::tagged_index_stack empty_mags_;
+  detail::tagged_index_stack loose_;
+};
+
+// Binds a per-thread magazine pair to a pool for the lifetime of this object.
+// Construct it on the thread that will use it; while it exists, acquire and
+// release of that pool on this thread go through the cache. Not movable.
+template <class T, class AllocFamily, pool_mode Mode>
+class object_pool<T, AllocFamily, Mode>::thread_cache {
+  friend class object_pool;
+
+public:
+  explicit thread_cache(object_pool& pool) noexcept : pool_(&pool) {
+    if (!pool_->chunks_) return;
+    loaded_ = pool_->empty_mags_.pop(pool_->mag_link());
+    spare_  = pool_->empty_mags_.pop(pool_->mag_link());
+    if (loaded_ == npos || spare_ == npos) {
+      // More caches than config::max_threads; stay unbound and use the depot.
+      if (loaded_ != npos) pool_->empty_mags_.push(loaded_, pool_->mag_link());
+      if (spare_ != npos) pool_->empty_mags_.push(spare_, pool_->mag_link());
+      loaded_ = spare_ = npos;
+      return;
+    }
+    next_bound_ = bound_;
+    bound_ = this;
+  }
+
+  ~thread_cache() noexcept {
+    if (loaded_ == npos) return;
+    for (thread_cache** link = &bound_; *link; link = &(*link)->next_bound_) {
+      if (*link == this) { *link = next_bound_; break; }
+    }
+    give_back(loaded_);
+    give_back(spare_);
+  }
+
+  thread_cache(const thread_cache&) = delete;
+  thread_cache& operator=(const thread_cache&) = delete;
+
+  [[nodiscard]] bool bound() const noexcept { return loaded_ != npos; }
+
+private:
+  void give_back(index_t m) noexcept {
+    if (pool_->magazine(m)[0] > 0) {
+      pool_->full_mags_.push(m, pool_->mag_link());
+    } else {
+      pool_->empty_mags_.push(m, pool_->mag_link());
+    }
+  }
+
+  index_t pop() noexcept {
+    index_t* mag = pool_->magazine(loaded_);
+    if (mag[0] == 0) {
+      std::swap(loaded_, spare_);
+      mag = pool_->magazine(loaded_);
+    }
+    if (mag[0] == 0) {
+      // Both empty: trade one for a full magazine from the depot.
+      const index_t full = pool_->full_mags_.pop(pool_->mag_link());
+      if (full != npos) {
+        pool_->empty_mags_.push(loaded_, pool_->mag_link());
+        loaded_ = full;
+        mag = pool_->magazine(loaded_);
+      } else {
+        // Depot has no full magazines: gather loose slots, then fresh ones.
+        while (mag[0] < pool_->magazine_size_) {
+          index_t i = pool_->loose_.pop(pool_->slot_link());
+          if (i == npos) i = pool_->fresh_slot();
+          if (i == npos) break;
+          mag[++mag[0]] = i;
+        }
+        if (mag[0] == 0) return npos;
+      }
+    }
+    return mag[mag[0]--];
+  }
+
+  void push(index_t i) noexcept {
+    index_t* mag = pool_->magazine(loaded_);
+    if (mag[0] == pool_->magazine_size_) {
+      std::swap(loaded_, spare_);
+      mag = pool_->magazine(loaded_);
+    }
+    if (mag[0] == pool_->magazine_size_) {
+      // Both full: hand one to the depot and continue with an empty one.
+      const index_t empty = pool_->empty_mags_.pop(pool_->mag_link());
+      if (empty == npos) {
+        pool_->loose_.push(i, pool_->slot_link());
+        return;
+      }
+      pool_->full_mags_.push(loaded_, pool_->mag_link());
+      loaded_ = empty;
+      mag = pool_->magazine(loaded_);
+    }
+    mag[++mag[0]] = i;
+  }
+
+  static inline thread_local thread_cache* bound_ = nullptr;
+
+  object_pool* pool_;
+  thread_cache* next_bound_{nullptr};
+  index_t loaded_{npos};
+  index_t spare_{npos};
+};
+
+} // namespace ndof
@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "ICloneable.hpp"
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   struct bytes
+
+// Maps compact keys to registered prototypes (anything derived from ICloneable)
+// and keeps, per prototype, a pool of ready-made clones.
+//
+//   spawn(key)  O(1) pop of a ready clone. Only when the pool is dry does it
+//               refill a batch (clone_into() into recycled or new slots).
+//   delete      The returned unique_ptr uses ICloneable's AllocDeleter over a
+//               slot_allocator. Destroying the object returns its slot to the
+//               pool's recycle list (lock-free, from any thread).
+//   refill(key) Re-clones recycled slots ahead of time, e.g., between frames
+//               or from a maintenance thread, so spawn never has to.
+//
+// Slot memory comes in chunks of `batch` slots from the registry's allocator,
+// so a pool makes one allocation per batch, never one per object.
+//
+// Thread safety:
+//   - try_register / destruction: setup only, not concurrent with anything.
+//   - try_spawn / try_refill: safe from any thread (one short lock per pool).
+//   - thread_cache: one per spawning thread; spawns without locking, pulling
+//     ready clones from the shared pool a batch at a time.
+//   - returning objects: safe from any thread.
+//
+// Contract: every spawned object must be destroyed before the registry, and
+// the allocator must outlive the registry.
+template <class U, class AllocFamily = std::allocator<std::byte>>
+class prototype_registry {
+  struct pool;
+
+public:
+  using key_type       = std::uint32_t;
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  // Deallocation-only allocator handed to AllocDeleter. Slot memory is owned by
+  // the registry's chunks, so destroy() recycles the slot and deallocate() has
+  // nothing left to do. Objects are only ever created by the registry.
+  template <class V>
+  class slot_allocator {
+  public:
+    using value_type = V;
+
+    slot_allocator() noexcept = default;
+    explicit slot_allocator(pool* p) noexcept : pool_(p) {}
+
+    template <class W>
+    slot_allocator(const slot_allocator<W>& other) noexcept : pool_(other.pool_) {}
+
+    // V is polymorphic (ICloneable has a virtual destructor), so the
+    // most-derived address, i.e., the slot the clone was placed in, is
+    // recovered before the object is gone.
+    template <class W>
+    void destroy(W* p) noexcept {
+      void* slot_obj = dynamic_cast<void*>(p);
+      std::destroy_at(p);
+      if (pool_) pool_->recycle(slot_obj);
+    }
+
+    void deallocate(V*, std::size_t) noexcept {}
+
+    template <class W>
+    bool operator==(const slot_allocator<W>& other) const noexcept { return pool_ == other.pool_; }
+
+  private:
+    template <class W> friend class slot_allocator;
+    pool* pool_{nullptr};
+  };
+
+  using deleter_type = typename U::template AllocDeleter<slot_allocator<U>>;
+  using pointer      = std::unique_ptr<U, deleter_type>;
+
+  class thread_cache;
+
+  // capacity: maximum number of prototypes (keys are dense, 0 .. capacity-1).
+  // batch:    slots per chunk, and clones per refill when a pool runs dry.
+  explicit prototype_registry(std::size_t capacity,
+                              std::size_t batch = 64,
+                              const allocator_type& a = allocator_type{}) noexcept
+      : alloc_(a), batch_(std::max<std::size_t>(batch, 1)) {
+    using pool_alloc  = typename traits::template rebind_alloc<pool>;
+    using pool_traits = std::allocator_traits<pool_alloc>;
+    pool_alloc pa(alloc_);
+#if defined(__cpp_exceptions)
+    try {
+      pools_ = pool_traits::allocate(pa, capacity);
+    } catch (...) {
+      pools_ = nullptr;
+    }
+#else
+    pools_ = pool_traits::allocate(pa, capacity);
+#endif
+    capacity_ = pools_ ? capacity : 0;
+  }
+
+  ~prototype_registry() noexcept {
+    for (std::size_t i = count_; i > 0; --i) {
+      destroy_pool(pools_[i - 1]);
+    }
+    if (pools_) {
+      using pool_alloc  = typename traits::template rebind_alloc<pool>;
+      using pool_traits = std::allocator_traits<pool_alloc>;
+      pool_alloc pa(alloc_);
+      pool_traits::deallocate(pa, pools_, capacity_);
+    }
+  }
+
+  prototype_registry(const prototype_registry&) = delete;
+  prototype_registry& operator=(const prototype_registry&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  [[nodiscard]] std::size_t size() const noexcept { return count_; }
+  [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+  [[nodiscard]] std::size_t batch() const noexcept { return batch_; }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Clones proto into the registry (the caller keeps ownership of proto) and
+  // pre-warms `prewarm` ready clones. Returns the key to spawn it by.
+  // Errors: those of init_pool and of the prewarm refill; on failure nothing
+  //         is registered.
+  [[nodiscard]] std::expected<key_type, ec>
+  try_register(const U& proto, std::size_t prewarm = 0) noexcept {
+    if (count_ == capacity_ || count_ > std::numeric_limits<key_type>::max()) {
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    pool* p = std::construct_at(pools_ + count_);
+    auto r = init_pool(*p, proto);
+    if (!r) {
+      std::destroy_at(p);
+      return std::unexpected(r.error());
+    }
+
+    if (prewarm) {
+      std::unique_lock lock(p->mtx);
+      auto w = refill_locked(*p, prewarm);
+      lock.unlock();
+      if (!w) {
+        destroy_pool(*p);
+        return std::unexpected(w.error());
+      }
+    }
+    return static_cast<key_type>(count_++);
+  }
+
+  // Makes at least n clones ready for key (on top of those already ready).
+  std::expected<void, ec> try_refill(key_type key, std::size_t n) noexcept {
+    if (key >= count_) return std::unexpected(ec::empty);
+    pool& p = pools_[key];
+    std::scoped_lock lock(p.mtx);
+    return refill_locked(p, n);
+  }
+
+  // O(1) when a ready clone exists; otherwise refills one batch first.
+  [[nodiscard]] std::expected<pointer, ec> try_spawn(key_type key) noexcept {
+    if (key >= count_) return std::unexpected(ec::empty);
+    pool& p = pools_[key];
+
+    node* n = nullptr;
+    {
+      std::scoped_lock lock(p.mtx);
+      if (!p.ready) {
+        auto r = refill_locked(p, batch_);
+        if (!p.ready) return std::unexpected(r ? ec::alloc_failed : r.error());
+      }
+      n = p.ready;
+      p.ready = n->next;
+      --p.ready_n;
+    }
+    return make_pointer(p, n);
+  }
+
+  // Ready clones currently held by the shared pool for key (excludes thread caches).
+  [[nodiscard]] std::size_t ready(key_type key) const noexcept {
+    if (key >= count_) return 0;
+    pool& p = pools_[key];
+    std::scoped_lock lock(p.mtx);
+    return p.ready_n;
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns nullptr on failure
+  // --------------------------------------------------------------------------
+
+  [[nodiscard]] pointer spawn(key_type key) noexcept {
+    auto r = try_spawn(key);
+    return r ? std::move(*r) : pointer(nullptr, deleter_type{});
+  }
+
+private:
+  // Every slot starts with a link; the clone lives obj_offset bytes further on.
+  // The link is only meaningful while the slot is on the ready or recycle list.
+  struct node {
+    node* next;
+  };
+
+  // Chunks are chained through a header at the start of each raw allocation.
+  struct chunk {
+    chunk* next;
+    std::byte* raw;
+    std::size_t raw_n;
+  };
+
+  struct pool {
+    mutable std::mutex mtx;        // guards ready, ready_n, chunks, and refills
+    node* ready{nullptr};
+    std::size_t ready_n{0};
+    std::atomic<node*> recycled{nullptr}; // lock-free push from any thread
+    chunk* chunks{nullptr};
+
+    U* proto{nullptr};
+    std::ptrdiff_t delta{0};       // U* minus most-derived address, same for every clone
+    std::size_t obj_size{0};
+    std::size_t obj_align{0};
+    std::size_t obj_offset{0};     // node -> object
+    std::size_t slot_size{0};
+    std::size_t slot_align{0};
+
+    std::byte* object_of(node* n) const noexcept {
+      return reinterpret_cast<std::byte*>(n) + obj_offset;
+    }
+
+    node* node_of(void* obj) const noexcept {
+      return reinterpret_cast<node*>(static_cast<std::byte*>(obj) - obj_offset);
+    }
+
+    U* clone_of(node* n) const noexcept {
+      return std::launder(reinterpret_cast<U*>(object_of(n) + delta));
+    }
+
+    void recycle(void* obj) noexcept {
+      node* n = node_of(obj);
+      node* head = recycled.load(std::memory_order_relaxed);
+      do {
+        n->next = head;
+      } while (!recycled.compare_exchange_weak(head, n,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed));
+    }
+  };
+
+  static constexpr std::size_t align_up(std::size_t n, std::size_t a) noexcept {
+    return (n + (a - 1)) & ~(a - 1);
+  }
+
+  std::expected<void, ec> init_pool(pool& p, const U& proto) noexcept {
+    p.obj_size   = proto.clone_size();
+    p.obj_align  = std::max(proto.clone_align(), alignof(node));
+    p.obj_offset = align_up(sizeof(node), p.obj_align);
+    p.slot_align = p.obj_align;
+    p.slot_size  = align_up(p.obj_offset + p.obj_size, p.slot_align);
+
+    // The first chunk also houses the registry's own copy of the prototype.
+    auto r = add_chunk(p);
+    if (!r) return r;
+
+    node* n = p.recycled.exchange(nullptr, std::memory_order_relaxed);
+    node* rest = n->next;
+    auto c = proto.clone_into(bytes{p.object_of(n), p.obj_size, p.obj_align});
+    p.recycled.store(rest, std::memory_order_relaxed);
+    if (!c) {
+      free_chunks(p);
+      return std::unexpected(c.error());
+    }
+
+    p.proto = *c;
+    p.delta = reinterpret_cast<std::byte*>(*c) - p.object_of(n);
+    return {};
+  }
+
+  // Carves one chunk of batch_ slots and pushes them onto the recycle list.
+  std::expected<void, ec> add_chunk(pool& p) noexcept {
+    if (batch_ > (std::numeric_limits<std::size_t>::max() - sizeof(chunk) - p.slot_align) / p.slot_size) {
+      return std::unexpected(ec::alloc_failed);
+    }
+    const std::size_t need = sizeof(chunk) + (p.slot_align - 1) + batch_ * p.slot_size;
+
+    std::byte* raw = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      raw = traits::allocate(alloc_, need);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    raw = traits::allocate(alloc_, need);
+    if (!raw) return std::unexpected(ec::alloc_failed);
+#endif
+
+    void* first = raw + sizeof(chunk);
+    std::size_t space = need - sizeof(chunk);
+    auto* slots = static_cast<std::byte*>(std::align(p.slot_align, batch_ * p.slot_size, first, space));
+    if (!slots) {
+      traits::deallocate(alloc_, raw, need);
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    chunk* c = std::construct_at(reinterpret_cast<chunk*>(raw), chunk{p.chunks, raw, need});
+    p.chunks = c;
+
+    for (std::size_t i = batch_; i > 0; --i) {
+      node* n = std::construct_at(reinterpret_cast<node*>(slots + (i - 1) * p.slot_size), node{nullptr});
+      p.recycle(p.object_of(n));
+    }
+    return {};
+  }
+
+  // Requires p.mtx. Clones into recycled slots first, growing by whole chunks.
+  std::expected<void, ec> refill_locked(pool& p, std::size_t n) noexcept {
+    node* free = p.recycled.exchange(nullptr, std::memory_order_acquire);
+    std::expected<void, ec> result{};
+
+    while (n > 0) {
+      if (!free) {
+        auto r = add_chunk(p);
+        if (!r) { result = r; break; }
+        free = p.recycled.exchange(nullptr, std::memory_order_acquire);
+      }
+
+      node* slot = free;
+      auto c = p.proto->clone_into(bytes{p.object_of(slot), p.obj_size, p.obj_align});
+      if (!c) { result = std::unexpected(c.error()); break; }
+
+      free = slot->next;
+      slot->next = p.ready;
+      p.ready = slot;
+      ++p.ready_n;
+      --n;
+    }
+
+    // Hand unused slots back.
+    while (free) {
+      node* next = free->next;
+      p.recycle(p.object_of(free));
+      free = next;
+    }
+    return result;
+  }
+
+  pointer make_pointer(pool& p, node* n) noexcept {
+    return pointer(p.clone_of(n), deleter_type(slot_allocator<U>(&p)));
+  }
+
+  void free_chunks(pool& p) noexcept {
+    while (p.chunks) {
+      chunk c = *p.chunks;
+      std::destroy_at(p.chunks);
+      traits::deallocate(alloc_, c.raw, c.raw_n);
+      p.chunks = c.next;
+    }
+    p.recycled.store(nullptr, std::memory_order_relaxed);
+  }
+
+  void destroy_pool(pool& p) noexcept {
+    while (p.ready) {
+      node* n = p.ready;
+      p.ready = n->next;
+      std::destroy_at(p.clone_of(n));
+    }
+    p.ready_n = 0;
+    if (p.proto) std::destroy_at(p.proto);
+    free_chunks(p);
+    std::destroy_at(&p);
+  }
+
+  // Locks the pool; moves up to n ready clones of key onto a caller-owned list.
+  // A short refill still hands over what is ready; only an empty take fails,
+  // with the refill's error.
+  std::expected<std::size_t, ec> take_ready(key_type key, std::size_t n, node*& out) noexcept {
+    pool& p = pools_[key];
+    std::scoped_lock lock(p.mtx);
+    if (p.ready_n < n) {
+      auto r = refill_locked(p, n - p.ready_n);
+      if (!p.ready) return std::unexpected(r ? ec::alloc_failed : r.error());
+    }
+
+    std::size_t taken = 0;
+    while (taken < n && p.ready) {
+      node* x = p.ready;
+      p.ready = x->next;
+      x->next = out;
+      out = x;
+      ++taken;
+    }
+    p.ready_n -= taken;
+    return taken;
+  }
+
+  // Returns a caller-owned list of ready clones to the shared pool.
+  void give_back(key_type key, node* list, std::size_t n) noexcept {
+    if (!list) return;
+    pool& p = pools_[key];
+    node* tail = list;
+    while (tail->next) tail = tail->next;
+    std::scoped_lock lock(p.mtx);
+    tail->next = p.ready;
+    p.ready = list;
+    p.ready_n += n;
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  pool* pools_{nullptr};
+  std::size_t capacity_{0};
+  std::size_t count_{0};
+  std::size_t batch_{1};
+};
+
+// Per-thread front end: holds a private stack of ready clones per key and
+// refills it from the shared pool one batch at a time, so the common spawn
+// path takes no lock and touches no shared cache line. Objects spawned here
+// may be destroyed on any thread; their slots go back to the shared pool.
+// Not thread-safe itself: one cache per thread. Destroy before the registry.
+template <class U, class AllocFamily>
+class prototype_registry<U, AllocFamily>::thread_cache {
+public:
+  explicit thread_cache(prototype_registry& reg) noexcept : reg_(&reg) {
+    using local_alloc  = typename traits::template rebind_alloc<local>;
+    using local_traits = std::allocator_traits<local_alloc>;
+    local_alloc la(reg_->alloc_);
+#if defined(__cpp_exceptions)
+    try {
+      locals_ = local_traits::allocate(la, reg_->capacity_);
+    } catch (...) {
+      locals_ = nullptr;
+    }
+#else
+    locals_ = local_traits::allocate(la, reg_->capacity_);
+#endif
+    if (!locals_) return;
+    for (std::size_t i = 0; i < reg_->capacity_; ++i) std::construct_at(locals_ + i);
+  }
+
+  ~thread_cache() noexcept {
+    if (!locals_) return;
+    for (std::size_t i = 0; i < reg_->count_; ++i) {
+      reg_->give_back(static_cast<key_type>(i), locals_[i].head, locals_[i].n);
+    }
+    using local_alloc  = typename traits::template rebind_alloc<local>;
+    using local_traits = std::allocator_traits<local_alloc>;
+    local_alloc la(reg_->alloc_);
+    local_traits::deallocate(la, locals_, reg_->capacity_);
+  }
+
+  thread_cache(const thread_cache&) = delete;
+  thread_cache& operator=(const thread_cache&) = delete;
+
+  [[nodiscard]] std::expected<pointer, ec> try_spawn(key_type key) noexcept {
+    if (!locals_) return std::unexpected(ec::alloc_failed);
+    if (key >= reg_->count_) return std::unexpected(ec::empty);
+
+    local& l = locals_[key];
+    if (!l.head) {
+      auto taken = reg_->take_ready(key, reg_->batch_, l.head);
+      if (!taken) return std::unexpected(taken.error());
+      l.n = *taken;
+    }
+
+    node* n = l.head;
+    l.head = n->next;
+    --l.n;
+    return reg_->make_pointer(reg_->pools_[key], n);
+  }
+
+  [[nodiscard]] pointer spawn(key_type key) noexcept {
+    auto r = try_spawn(key);
+    return r ? std::move(*r) : pointer(nullptr, deleter_type{});
+  }
+
+private:
+  struct local {
+    node* head{nullptr};
+    std::size_t n{0};
+  };
+
+  prototype_registry* reg_;
+  local* locals_{nullptr};
+};
+
+} // namespace ndof
@@ -0,0 +1,485 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+
+// Composite stored flat: the nodes of a forest in preorder, as a set of
+// parallel arrays instead of a pointer tree.
+//
+//   layout     Node (cold payload), Hot (optional hot fields), depth, subtree
+//              size and parent each live in their own contiguous array. A
+//              node's descendants are the index span [i + 1, i + size(i)); its
+//              children are found by skipping sibling subtrees.
+//   passes     top_down(f) calls f(parent, child) in preorder, bottom_up(f) in
+//              reverse preorder (children before parents). Both are single
+//              linear scans over the Hot array (Node when Hot is void) and the
+//              parent array. The subtree overloads touch only their span, so
+//              disjoint subtrees can be processed on different threads after
+//              compact().
+//   insertion  The arrays are a gap buffer: inserting or erasing moves the gap
+//              to the position first, so edits clustered in one region cost
+//              O(distance moved) plus a walk to fix the ancestors' sizes:
+//              O(depth) while the parent array is current (appends keep it so),
+//              O(depth x fan-out) otherwise. Passes move the gap to the end and
+//              rebuild the parent array (linear) if the shape changed since.
+//
+// Indices are preorder positions: inserting or erasing before a node shifts it.
+// Node and Hot must be nothrow move constructible (the gap moves them).
+// Not thread-safe.
+//
+// Contract: the allocator must outlive the composite.
+template <class Node, class Hot = void, class AllocFamily = std::allocator<std::byte>>
+class flat_composite {
+  static constexpr bool has_hot = !std::is_void_v<Hot>;
+  using hot_slot = std::conditional_t<has_hot, Hot, std::byte>;
+
+public:
+  using node_type      = Node;
+  using hot_type       = Hot;
+  using pass_type      = std::conditional_t<has_hot, Hot, Node>; // what passes visit
+  using index_type     = std::uint32_t;
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  static_assert(std::is_nothrow_move_constructible_v<Node>, "Node must be nothrow move constructible.");
+  static_assert(!has_hot || std::is_nothrow_move_constructible_v<hot_slot>, "Hot must be nothrow move constructible.");
+
+  static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+  explicit flat_composite(const allocator_type& a = allocator_type{}) noexcept : alloc_(a) {}
+
+  ~flat_composite() noexcept { release(); }
+
+  flat_composite(const flat_composite&) = delete;
+  flat_composite& operator=(const flat_composite&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  [[nodiscard]] index_type size() const noexcept { return count_; }
+  [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+  [[nodiscard]] index_type capacity() const noexcept { return cap_; }
+
+  // True when the gap is at the end and the parent array is current: the
+  // spans and the subtree passes are usable.
+  [[nodiscard]] bool compacted() const noexcept { return gap_ == count_ && parents_fresh_; }
+
+  [[nodiscard]] Node& node(index_type i) noexcept { return node_[phys(i)]; }
+  [[nodiscard]] const Node& node(index_type i) const noexcept { return node_[phys(i)]; }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] H& hot(index_type i) noexcept { return hot_[phys(i)]; }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] const H& hot(index_type i) const noexcept { return hot_[phys(i)]; }
+
+  [[nodiscard]] index_type depth(index_type i) const noexcept { return depth_[phys(i)]; }
+
+  // Number of nodes in i's subtree, i included.
+  [[nodiscard]] index_type subtree_size(index_type i) const noexcept { return size_[phys(i)]; }
+
+  // npos for top-level nodes.
+  [[nodiscard]] index_type parent(index_type i) const noexcept {
+    if (parents_fresh_) return parent_[phys(i)];
+    const index_type d = depth(i);
+    if (d == 0) return npos;
+    index_type p = i - 1;
+    while (depth(p) >= d) --p;
+    return p;
+  }
+
+  [[nodiscard]] index_type first_child(index_type i) const noexcept {
+    return subtree_size(i) > 1 ? i + 1 : npos;
+  }
+
+  [[nodiscard]] index_type next_sibling(index_type i) const noexcept {
+    const index_type n = i + subtree_size(i);
+    return n < count_ && depth(n) == depth(i) ? n : npos;
+  }
+
+  // Moves the gap to the end and rebuilds the parent array if needed. Linear.
+  void compact() noexcept {
+    move_gap(count_);
+    if (parents_fresh_) return;
+    for (index_type i = 0; i < count_; ++i) {
+      if (depth_[i] == 0) {
+        parent_[i] = npos;
+        continue;
+      }
+      // Climb from the previous node; telescopes to O(n) over the scan.
+      index_type p = i - 1;
+      while (depth_[p] >= depth_[i]) p = parent_[p];
+      parent_[i] = p;
+    }
+    parents_fresh_ = true;
+  }
+
+  // Preorder spans; compact first.
+  [[nodiscard]] std::span<Node> nodes() noexcept {
+    compact();
+    return {node_, count_};
+  }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] std::span<H> hots() noexcept {
+    compact();
+    return {hot_, count_};
+  }
+
+  [[nodiscard]] std::span<const index_type> parents() noexcept {
+    compact();
+    return {parent_, count_};
+  }
+
+  // f(const pass_type& parent, pass_type& child) for every non-root node,
+  // parents before children.
+  template <class F>
+  void top_down(F&& f) {
+    compact();
+    pass_type* v = values();
+    for (index_type i = 0; i < count_; ++i) {
+      if (depth_[i]) f(std::as_const(v[parent_[i]]), v[i]);
+    }
+  }
+
+  // f(pass_type& parent, const pass_type& child) for every non-root node,
+  // children (and their whole subtrees) before parents.
+  template <class F>
+  void bottom_up(F&& f) {
+    compact();
+    pass_type* v = values();
+    for (index_type i = count_; i-- > 0;) {
+      if (depth_[i]) f(v[parent_[i]], std::as_const(v[i]));
+    }
+  }
+
+  // The same passes over root's descendants only; root itself is only a
+  // parent. Precondition: compacted(). Runs concurrently with passes over
+  // disjoint subtrees.
+  template <class F>
+  void top_down(index_type root, F&& f) {
+    pass_type* v = values();
+    const index_type end = root + size_[root];
+    for (index_type i = root + 1; i < end; ++i) f(std::as_const(v[parent_[i]]), v[i]);
+  }
+
+  template <class F>
+  void bottom_up(index_type root, F&& f) {
+    pass_type* v = values();
+    for (index_type i = root + size_[root]; --i > root;) f(v[parent_[i]], std::as_const(v[i]));
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::alloc_failed.
+  [[nodiscard]] std::expected<void, ec> try_reserve(index_type n) noexcept {
+    if (n <= cap_) return {};
+    return grow(n, gap_);
+  }
+
+  // Appends a new top-level tree. Returns its index.
+  // Errors: ec::alloc_failed.
+  [[nodiscard]] std::expected<index_type, ec> try_append_root(Node node) noexcept
+  requires (!has_hot) {
+    return insert_at(count_, 0, npos, std::move(node), hot_slot{});
+  }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] std::expected<index_type, ec> try_append_root(Node node, H hot) noexcept {
+    return insert_at(count_, 0, npos, std::move(node), std::move(hot));
+  }
+
+  // Inserts a node as parent's last child. Returns its index; nodes at or
+  // after it shift by one.
+  // Errors: ec::empty if parent is out of range, ec::alloc_failed.
+  [[nodiscard]] std::expected<index_type, ec> try_insert_child(index_type parent, Node node) noexcept
+  requires (!has_hot) {
+    return insert_under(parent, std::move(node), hot_slot{});
+  }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] std::expected<index_type, ec> try_insert_child(index_type parent, Node node, H hot) noexcept {
+    return insert_under(parent, std::move(node), std::move(hot));
+  }
+
+  // Removes i and its subtree.
+  // Errors: ec::empty if i is out of range.
+  [[nodiscard]] std::expected<void, ec> try_erase(index_type i) noexcept {
+    if (i >= count_) return std::unexpected(ec::empty);
+    const index_type n = subtree_size(i);
+    adjust_path(i, false, -static_cast<std::int64_t>(n));
+    move_gap(i);
+    const std::size_t from = std::size_t{i} + gap_len();
+    std::destroy_n(node_ + from, n);
+    if constexpr (has_hot) std::destroy_n(hot_ + from, n);
+    parents_fresh_ = parents_fresh_ && i + n == count_;
+    count_ -= n;
+    return {};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns npos / false on failure
+  // --------------------------------------------------------------------------
+
+  [[nodiscard]] index_type append_root(Node node) noexcept
+  requires (!has_hot) {
+    auto r = try_append_root(std::move(node));
+    return r ? *r : npos;
+  }
+
+  [[nodiscard]] index_type insert_child(index_type parent, Node node) noexcept
+  requires (!has_hot) {
+    auto r = try_insert_child(parent, std::move(node));
+    return r ? *r : npos;
+  }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] index_type append_root(Node node, H hot) noexcept {
+    auto r = try_append_root(std::move(node), std::move(hot));
+    return r ? *r : npos;
+  }
+
+  template <class H = Hot>
+  requires (!std::is_void_v<H>)
+  [[nodiscard]] index_type insert_child(index_type parent, Node node, H hot) noexcept {
+    auto r = try_insert_child(parent, std::move(node), std::move(hot));
+    return r ? *r : npos;
+  }
+
+  bool erase(index_type i) noexcept { return try_erase(i).has_value(); }
+
+  void clear() noexcept {
+    compact();
+    std::destroy_n(node_, count_);
+    if constexpr (has_hot) std::destroy_n(hot_, count_);
+    count_ = 0;
+    gap_ = 0;
+    parents_fresh_ = true;
+  }
+
+private:
+  std::size_t gap_len() const noexcept { return std::size_t{cap_} - count_; }
+
+  std::size_t phys(index_type i) const noexcept { return i < gap_ ? i : i + gap_len(); }
+
+  pass_type* values() noexcept {
+    if constexpr (has_hot) return hot_;
+    else return node_;
+  }
+
+  template <class U>
+  std::expected<U*, ec> allocate_array(std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    if (n > utraits::max_size(ua)) return std::unexpected(ec::alloc_failed);
+    U* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = utraits::allocate(ua, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = utraits::allocate(ua, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  template <class U>
+  void deallocate_array(U* p, std::size_t n) noexcept {
+    using ualloc  = typename traits::template rebind_alloc<U>;
+    using utraits = std::allocator_traits<ualloc>;
+    ualloc ua(alloc_);
+    if (p) utraits::deallocate(ua, p, n);
+  }
+
+  // Moves n live elements from src[0, n) into uninitialized dst[0, n); the
+  // ranges may overlap. Sources end up destroyed.
+  template <class T>
+  static void relocate(T* src, T* dst, std::size_t n) noexcept {
+    if (n == 0 || src == dst) return;
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      std::memmove(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(T));
+    } else if (dst > src) {
+      for (std::size_t k = n; k-- > 0;) {
+        std::construct_at(dst + k, std::move(src[k]));
+        std::destroy_at(src + k);
+      }
+    } else {
+      for (std::size_t k = 0; k < n; ++k) {
+        std::construct_at(dst + k, std::move(src[k]));
+        std::destroy_at(src + k);
+      }
+    }
+  }
+
+  template <class F>
+  void for_each_array(F&& f) noexcept {
+    f(node_);
+    if constexpr (has_hot) f(hot_);
+    f(depth_);
+    f(size_);
+    f(parent_);
+  }
+
+  // Gap to logical position p. Logical indices (and so the parent array) are
+  // unchanged.
+  void move_gap(index_type p) noexcept {
+    if (p == gap_) return;
+    const std::size_t g = gap_len();
+    if (p < gap_) {
+      for_each_array([&](auto* a) { relocate(a + p, a + p + g, gap_ - p); });
+    } else {
+      for_each_array([&](auto* a) { relocate(a + gap_ + g, a + gap_, p - gap_); });
+    }
+    gap_ = p;
+  }
+
+  // Reallocates to at least n slots with the gap at logical position p.
+  std::expected<void, ec> grow(std::size_t n, index_type p) noexcept {
+    if (n > npos - 1) return std::unexpected(ec::alloc_failed);
+    const auto cap = static_cast<index_type>(n);
+    auto nn = allocate_array<Node>(cap);
+    auto nh = has_hot ? allocate_array<hot_slot>(cap) : std::expected<hot_slot*, ec>(nullptr);
+    auto nd = allocate_array<index_type>(cap);
+    auto ns = allocate_array<index_type>(cap);
+    auto np = allocate_array<index_type>(cap);
+    if (!nn || !nh || !nd || !ns || !np) {
+      if (nn) deallocate_array(*nn, cap);
+      if (nh) deallocate_array(*nh, cap);
+      if (nd) deallocate_array(*nd, cap);
+      if (ns) deallocate_array(*ns, cap);
+      if (np) deallocate_array(*np, cap);
+      return std::unexpected(ec::alloc_failed);
+    }
+
+    move_gap(count_);
+    const std::size_t tail = count_ - p;
+    const std::size_t new_gap = cap - count_;
+    auto move_over = [&](auto* from, auto* to) {
+      relocate(from, to, p);
+      relocate(from + p, to + p + new_gap, tail);
+    };
+    move_over(node_, *nn);
+    if constexpr (has_hot) move_over(hot_, *nh);
+    move_over(depth_, *nd);
+    move_over(size_, *ns);
+    move_over(parent_, *np);
+
+    const std::size_t old = cap_;
+    deallocate_array(node_, old);
+    deallocate_array(hot_, old);
+    deallocate_array(depth_, old);
+    deallocate_array(size_, old);
+    deallocate_array(parent_, old);
+    node_ = *nn;
+    hot_ = *nh;
+    depth_ = *nd;
+    size_ = *ns;
+    parent_ = *np;
+    cap_ = cap;
+    gap_ = p;
+    return {};
+  }
+
+  std::expected<index_type, ec> insert_under(index_type parent, Node&& node, hot_slot&& hot) noexcept {
+    if (parent >= count_) return std::unexpected(ec::empty);
+    const index_type at = parent + subtree_size(parent);
+    auto r = insert_at(at, depth(parent) + 1, parent, std::move(node), std::move(hot));
+    if (r) adjust_path(parent, true, 1);
+    return r;
+  }
+
+  std::expected<index_type, ec> insert_at(index_type at, index_type d, index_type parent, Node&& node,
+                                          hot_slot&& hot) noexcept {
+    if (count_ == cap_) {
+      if (cap_ == npos - 1) return std::unexpected(ec::alloc_failed);
+      const std::size_t want = cap_ ? std::min<std::size_t>(std::size_t{cap_} * 2, npos - 1) : 16;
+      auto g = grow(want, at);
+      if (!g) return std::unexpected(g.error());
+    } else {
+      move_gap(at);
+    }
+    std::construct_at(node_ + at, std::move(node));
+    if constexpr (has_hot) std::construct_at(hot_ + at, std::move(hot));
+    depth_[at] = d;
+    size_[at] = 1;
+    parent_[at] = parent;
+    // Appending shifts nothing, so the parent array stays current.
+    parents_fresh_ = parents_fresh_ && at == count_;
+    ++gap_;
+    ++count_;
+    return at;
+  }
+
+  // Adds delta to the subtree size of target's proper ancestors (and target's
+  // own when include_target): up the parent array when it is current (O(depth)),
+  // else by descending from the top-level root. Positions up to target are not
+  // moved by the edit being accounted for.
+  void adjust_path(index_type target, bool include_target, std::int64_t delta) noexcept {
+    auto bump = [&](index_type a) {
+      index_type& s = size_[phys(a)];
+      s = static_cast<index_type>(s + delta);
+    };
+    if (parents_fresh_) {
+      for (index_type a = include_target ? target : parent_[phys(target)]; a != npos; a = parent_[phys(a)]) bump(a);
+      return;
+    }
+    index_type a = 0;
+    while (a + subtree_size(a) <= target) a += subtree_size(a);
+    while (a != target) {
+      bump(a);
+      index_type c = a + 1;
+      while (c + subtree_size(c) <= target) c += subtree_size(c);
+      a = c;
+    }
+    if (include_target) bump(target);
+  }
+
+  void release() noexcept {
+    clear();
+    deallocate_array(node_, cap_);
+    deallocate_array(hot_, cap_);
+    deallocate_array(depth_, cap_);
+    deallocate_array(size_, cap_);
+    deallocate_array(parent_, cap_);
+    node_ = nullptr;
+    hot_ = nullptr;
+    depth_ = size_ = parent_ = nullptr;
+    cap_ = 0;
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  Node* node_{nullptr};
+  hot_slot* hot_{nullptr};
+  index_type* depth_{nullptr};
+  index_type* size_{nullptr};
+  index_type* parent_{nullptr};
+  index_type count_{0};
+  index_type cap_{0};
+  index_type gap_{0};
+  bool parents_fresh_{true};
+};
+
+} // namespace ndof
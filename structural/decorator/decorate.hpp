@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class function_with_allocator
+
+// A callable with decorators stacked around it, composed at compile time into
+// one object.
+//
+//   decorate(f, d1, d2)   d1 wraps f, d2 wraps that: calls enter d2 first.
+//
+// A decorator is any object callable as d(next, args...), where next(args...)
+// runs the layers inside it and returns their result. A decorator may call
+// next any number of times (retry) or not at all (short-circuit), and may
+// change the arguments it passes on. Layers are plain members of one object
+// and call each other directly, so the whole stack inlines into operator().
+//
+// Put the result in a function_with_allocator and the stack costs one
+// aligned_storage block (inline when it fits the SBO, else one allocation),
+// one ops table and one indirect call, instead of one of each per layer for
+// nested wrappers. Layers are mutable so that stateful decorators work
+// through function_with_allocator's const call path, as with plugins
+// elsewhere in this library.
+template <class F, class... Ds>
+class decorated {
+public:
+  static constexpr std::size_t decorator_count = sizeof...(Ds);
+
+  template <class F2, class... Ds2>
+  explicit decorated(std::in_place_t, F2&& f, Ds2&&... ds)
+      noexcept(std::is_nothrow_constructible_v<std::tuple<F, Ds...>, F2&&, Ds2&&...>)
+      : layers_(std::forward<F2>(f), std::forward<Ds2>(ds)...) {}
+
+  template <class... Args>
+  decltype(auto) operator()(Args&&... args) const {
+    return call<sizeof...(Ds)>(std::forward<Args>(args)...);
+  }
+
+  [[nodiscard]] F& target() const noexcept { return std::get<0>(layers_); }
+
+  // Decorator I, counted from the innermost (I = 0 is d1).
+  template <std::size_t I>
+  [[nodiscard]] auto& decorator() const noexcept {
+    static_assert(I < sizeof...(Ds), "Decorator index out of range.");
+    return std::get<I + 1>(layers_);
+  }
+
+private:
+  // Layer 0 is the target; layer L > 0 is decorator L - 1 around layer L - 1.
+  template <std::size_t L, class... Args>
+  decltype(auto) call(Args&&... args) const {
+    if constexpr (L == 0) {
+      return std::invoke(std::get<0>(layers_), std::forward<Args>(args)...);
+    } else {
+      auto next = [this]<class... As>(As&&... as) -> decltype(auto) {
+        return this->template call<L - 1>(std::forward<As>(as)...);
+      };
+      return std::get<L>(layers_)(next, std::forward<Args>(args)...);
+    }
+  }
+
+  mutable std::tuple<F, Ds...> layers_;
+};
+
+template <class F, class... Ds>
+[[nodiscard]] decorated<std::decay_t<F>, std::decay_t<Ds>...> decorate(F&& f, Ds&&... ds)
+    noexcept(std::is_nothrow_constructible_v<std::tuple<std::decay_t<F>, std::decay_t<Ds>...>, F&&, Ds&&...>) {
+  return decorated<std::decay_t<F>, std::decay_t<Ds>...>(std::in_place, std::forward<F>(f), std::forward<Ds>(ds)...);
+}
+
+// decorate(f, ds...) emplaced into dst: one storage block, one ops table.
+// Errors: whatever function_with_allocator::try_emplace reports;
+//         ec::construction_failed if copying f or a decorator throws.
+template <class Signature, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign, class F, class... Ds>
+[[nodiscard]] std::expected<decorated<std::decay_t<F>, std::decay_t<Ds>...>*, ec>
+try_emplace_decorated(function_with_allocator<Signature, AllocFamily, SboBytes, SboAlign>& dst,
+                      F&& f, Ds&&... ds) noexcept {
+#if defined(__cpp_exceptions)
+  try {
+    return dst.try_emplace(decorate(std::forward<F>(f), std::forward<Ds>(ds)...));
+  } catch (...) {
+    return std::unexpected(ec::construction_failed);
+  }
+#else
+  return dst.try_emplace(decorate(std::forward<F>(f), std::forward<Ds>(ds)...));
+#endif
+}
+
+namespace decorators {
+
+  // Calls next again while the result tests false (an error std::expected,
+  // false, a null pointer), up to attempts calls in all. Arguments are passed
+  // as lvalues so every attempt sees them.
+  struct retry {
+    std::size_t attempts{3};
+
+    template <class Next, class... Args>
+    auto operator()(Next& next, Args&&... args) const {
+      auto r = next(args...);
+      for (std::size_t i = 1; i < attempts && !r; ++i) r = next(args...);
+      return r;
+    }
+  };
+
+  // Adds each call's duration in nanoseconds (exceptional exits included) to
+  // *total, and counts calls in *calls if given.
+  struct timed {
+    std::atomic<std::uint64_t>* total{nullptr};
+    std::atomic<std::uint64_t>* calls{nullptr};
+
+    template <class Next, class... Args>
+    decltype(auto) operator()(Next& next, Args&&... args) const {
+      struct scope {
+        const timed& self;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ~scope() {
+          const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start).count();
+          if (self.total) self.total->fetch_add(static_cast<std::uint64_t>(ns), std::memory_order_relaxed);
+          if (self.calls) self.calls->fetch_add(1, std::memory_order_relaxed);
+        }
+      } s{*this};
+      return next(std::forward<Args>(args)...);
+    }
+  };
+
+  // Calls before(args...) ahead of next and after(args...) once it returns
+  // normally: logging, tracing, metrics hooks.
+  template <class Before, class After>
+  struct tap {
+    Before before;
+    After after;
+
+    template <class Next, class... Args>
+    decltype(auto) operator()(Next& next, Args&&... args) const {
+      before(std::as_const(args)...);
+      if constexpr (std::is_void_v<decltype(next(args...))>) {
+        next(args...);
+        after(std::as_const(args)...);
+      } else {
+        decltype(auto) r = next(args...);
+        after(std::as_const(args)...);
+        return r;
+      }
+    }
+  };
+
+  template <class Before, class After>
+  tap(Before, After) -> tap<Before, After>;
+
+} // namespace decorators
+
+} // namespace ndof
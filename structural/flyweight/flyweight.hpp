@@ -0,0 +1,391 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   construct_with_optional_alloc
+
+// Handle to an interned, immutable value. One pointer in size; two handles from
+// the same intern_table are equal iff they refer to equal values, so equality
+// and hashing are on the address. A default-constructed handle is empty.
+template <class T>
+class flyweight {
+public:
+  using value_type = T;
+
+  constexpr flyweight() noexcept = default;
+
+  [[nodiscard]] const T& get() const noexcept { return *p_; }
+  [[nodiscard]] const T& operator*() const noexcept { return *p_; }
+  [[nodiscard]] const T* operator->() const noexcept { return p_; }
+
+  [[nodiscard]] bool has_value() const noexcept { return p_ != nullptr; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  friend bool operator==(flyweight a, flyweight b) noexcept { return a.p_ == b.p_; }
+
+  // Address order: stable for the table's lifetime, unrelated to value order.
+  friend std::strong_ordering operator<=>(flyweight a, flyweight b) noexcept {
+    return std::compare_three_way{}(a.p_, b.p_);
+  }
+
+private:
+  template <class, class, class, class> friend class intern_table;
+
+  explicit flyweight(const T* p) noexcept : p_(p) {}
+
+  const T* p_{nullptr};
+};
+
+// Sharded, concurrent intern table backing flyweight<T>.
+//
+//   lookup  Lock-free: the shard's open-addressing slot array is read with
+//           acquire loads only. Interning a value that is already present
+//           never takes a lock.
+//   insert  Takes only the owning shard's mutex (shards = 2^shard_bits), so
+//           insert contention is spread across shards.
+//   memory  Arena lifetime: values are bump-allocated into per-shard chunks
+//           from the table's allocator and live until the table is destroyed.
+//           No per-value allocation header and no reclamation on the hot path.
+//           Slot arrays replaced by growth are retired, not freed, because
+//           readers may still be probing them; they total less than the live
+//           array, so the overhead is bounded by 2x the slot memory.
+//
+// Contract: handles must not outlive the table; the allocator must outlive it.
+template <class T,
+          class Hash = std::hash<T>,
+          class KeyEqual = std::equal_to<T>,
+          class AllocFamily = std::allocator<std::byte>>
+class intern_table {
+  // Heterogeneous keys: only when both functors opt in, as with std::unordered_set.
+  template <class K>
+  static constexpr bool transparent =
+      requires { typename Hash::is_transparent; typename KeyEqual::is_transparent; }
+      && std::is_constructible_v<T, const K&>;
+
+public:
+  using value_type     = T;
+  using handle         = flyweight<T>;
+  using allocator_type = typename std::allocator_traits<AllocFamily>::template rebind_alloc<std::byte>;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  static constexpr std::size_t default_shard_bits = 6;
+  static constexpr std::size_t default_chunk_bytes = 64 * 1024;
+
+  explicit intern_table(std::size_t shard_bits = default_shard_bits,
+                        const allocator_type& a = allocator_type{},
+                        std::size_t chunk_bytes = default_chunk_bytes) noexcept
+      : alloc_(a),
+        shard_bits_(std::min<std::size_t>(shard_bits, 16)),
+        chunk_bytes_(std::max(chunk_bytes, sizeof(chunk) + sizeof(entry) + alignof(entry))) {
+    using shard_alloc  = typename traits::template rebind_alloc<shard>;
+    using shard_traits = std::allocator_traits<shard_alloc>;
+    shard_alloc sa(alloc_);
+    const std::size_t n = std::size_t{1} << shard_bits_;
+#if defined(__cpp_exceptions)
+    try {
+      shards_ = shard_traits::allocate(sa, n);
+    } catch (...) {
+      shards_ = nullptr;
+    }
+#else
+    shards_ = shard_traits::allocate(sa, n);
+#endif
+    if (!shards_) return;
+    for (std::size_t i = 0; i < n; ++i) std::construct_at(shards_ + i);
+  }
+
+  ~intern_table() noexcept {
+    if (!shards_) return;
+    const std::size_t n = std::size_t{1} << shard_bits_;
+    for (std::size_t i = 0; i < n; ++i) {
+      release_shard(shards_[i]);
+      std::destroy_at(shards_ + i);
+    }
+    using shard_alloc  = typename traits::template rebind_alloc<shard>;
+    using shard_traits = std::allocator_traits<shard_alloc>;
+    shard_alloc sa(alloc_);
+    shard_traits::deallocate(sa, shards_, n);
+  }
+
+  intern_table(const intern_table&) = delete;
+  intern_table& operator=(const intern_table&) = delete;
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  // Number of distinct values interned (a snapshot under concurrency).
+  [[nodiscard]] std::size_t size() const noexcept {
+    std::size_t total = 0;
+    for_each_shard([&](const shard& s) { total += s.count.load(std::memory_order_relaxed); });
+    return total;
+  }
+
+  // Bytes obtained from the allocator: value arenas, live and retired slot arrays.
+  [[nodiscard]] std::size_t memory_bytes() const noexcept {
+    std::size_t total = 0;
+    for_each_shard([&](const shard& s) { total += s.bytes.load(std::memory_order_relaxed); });
+    return total;
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Returns the handle of the value equal to key, inserting a copy of it first
+  // if none exists. K is T, or any type Hash and KeyEqual accept transparently
+  // (e.g., std::string_view for std::string) that T is constructible from.
+  template <class K = T>
+  requires std::same_as<std::remove_cvref_t<K>, T> || transparent<K>
+  [[nodiscard]] std::expected<handle, ec> try_intern(const K& key) noexcept {
+    if (!shards_) return std::unexpected(ec::alloc_failed);
+    const std::size_t h = mix(hasher_(key));
+    shard& s = shard_of(h);
+
+    if (const entry* e = probe(s.table.load(std::memory_order_acquire), h, key)) {
+      return handle(&e->value);
+    }
+
+    std::scoped_lock lock(s.mtx);
+    slot_array* arr = s.table.load(std::memory_order_relaxed);
+    if (const entry* e = probe(arr, h, key)) return handle(&e->value);
+
+    auto grown = reserve_one(s, arr);
+    if (!grown) return std::unexpected(grown.error());
+    arr = *grown;
+
+    auto made = make_entry(s, h, key);
+    if (!made) return std::unexpected(made.error());
+
+    std::size_t i = h & (arr->cap - 1);
+    while (arr->slots()[i].load(std::memory_order_relaxed)) i = (i + 1) & (arr->cap - 1);
+    arr->slots()[i].store(*made, std::memory_order_release);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    return handle(&(*made)->value);
+  }
+
+  // Lock-free lookup without insertion. Empty handle if key is not interned.
+  template <class K = T>
+  requires std::same_as<std::remove_cvref_t<K>, T> || transparent<K>
+  [[nodiscard]] handle find(const K& key) const noexcept {
+    if (!shards_) return handle{};
+    const std::size_t h = mix(hasher_(key));
+    const entry* e = probe(shard_of(h).table.load(std::memory_order_acquire), h, key);
+    return e ? handle(&e->value) : handle{};
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, returns an empty handle on failure
+  // --------------------------------------------------------------------------
+
+  template <class K = T>
+  requires std::same_as<std::remove_cvref_t<K>, T> || transparent<K>
+  [[nodiscard]] handle intern(const K& key) noexcept {
+    auto r = try_intern(key);
+    return r ? *r : handle{};
+  }
+
+private:
+  struct entry {
+    std::size_t hash;
+    T value;
+  };
+
+  using slot = std::atomic<const entry*>;
+
+  // Header followed by cap slots in the same allocation.
+  struct slot_array {
+    std::size_t cap;          // power of two
+    slot_array* retired_next; // chain of arrays replaced by growth
+
+    slot* slots() noexcept { return reinterpret_cast<slot*>(this + 1); }
+    const slot* slots() const noexcept { return reinterpret_cast<const slot*>(this + 1); }
+
+    static std::size_t bytes_for(std::size_t cap) noexcept {
+      static_assert(sizeof(slot_array) % alignof(slot) == 0);
+      return sizeof(slot_array) + cap * sizeof(slot);
+    }
+  };
+
+  struct chunk {
+    chunk* next;
+    std::size_t n;
+  };
+
+  // 64-byte aligned so neighbouring shards do not share a cache line.
+  struct alignas(64) shard {
+    std::mutex mtx;                           // writers only
+    std::atomic<slot_array*> table{nullptr};
+    std::atomic<std::size_t> count{0};
+    std::atomic<std::size_t> bytes{0};
+    slot_array* retired{nullptr};
+    chunk* chunks{nullptr};
+    std::byte* bump{nullptr};
+    std::size_t bump_left{0};
+  };
+
+  // std::hash is the identity for integers. The shard takes the top bits and
+  // the slot the low bits, so every input bit must reach both ends: a full
+  // 64-bit finalizer (a multiply alone leaves the low bits depending only on
+  // the low bits of the key, and strided keys pile into a few slots).
+  static std::size_t mix(std::size_t h) noexcept {
+    std::uint64_t x = static_cast<std::uint64_t>(h);
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return static_cast<std::size_t>(x ^ (x >> 31));
+  }
+
+  shard& shard_of(std::size_t h) const noexcept {
+    if (shard_bits_ == 0) return shards_[0];
+    return shards_[h >> (std::numeric_limits<std::size_t>::digits - shard_bits_)];
+  }
+
+  template <class K>
+  const entry* probe(const slot_array* arr, std::size_t h, const K& key) const noexcept {
+    if (!arr) return nullptr;
+    for (std::size_t i = h & (arr->cap - 1);; i = (i + 1) & (arr->cap - 1)) {
+      const entry* e = arr->slots()[i].load(std::memory_order_acquire);
+      if (!e) return nullptr;
+      if (e->hash == h && equal_(e->value, key)) return e;
+    }
+  }
+
+  template <class F>
+  void for_each_shard(F&& f) const noexcept {
+    if (!shards_) return;
+    for (std::size_t i = 0, n = std::size_t{1} << shard_bits_; i < n; ++i) f(shards_[i]);
+  }
+
+  std::expected<std::byte*, ec> allocate_bytes(std::size_t n) noexcept {
+    std::byte* p = nullptr;
+#if defined(__cpp_exceptions)
+    try {
+      p = traits::allocate(alloc_, n);
+    } catch (...) {
+      return std::unexpected(ec::alloc_failed);
+    }
+#else
+    p = traits::allocate(alloc_, n);
+    if (!p) return std::unexpected(ec::alloc_failed);
+#endif
+    return p;
+  }
+
+  // Requires s.mtx. Keeps the array at most half full; growth publishes a new
+  // array with the same entries and retires the old one.
+  std::expected<slot_array*, ec> reserve_one(shard& s, slot_array* arr) noexcept {
+    const std::size_t count = s.count.load(std::memory_order_relaxed);
+    if (arr && 2 * (count + 1) <= arr->cap) return arr;
+
+    const std::size_t cap = arr ? arr->cap * 2 : 64;
+    const std::size_t n = slot_array::bytes_for(cap);
+    auto raw = allocate_bytes(n);
+    if (!raw) return std::unexpected(raw.error());
+
+    auto* fresh = std::construct_at(reinterpret_cast<slot_array*>(*raw), slot_array{cap, nullptr});
+    for (std::size_t i = 0; i < cap; ++i) std::construct_at(fresh->slots() + i, nullptr);
+
+    if (arr) {
+      for (std::size_t j = 0; j < arr->cap; ++j) {
+        const entry* e = arr->slots()[j].load(std::memory_order_relaxed);
+        if (!e) continue;
+        std::size_t i = e->hash & (cap - 1);
+        while (fresh->slots()[i].load(std::memory_order_relaxed)) i = (i + 1) & (cap - 1);
+        fresh->slots()[i].store(e, std::memory_order_relaxed);
+      }
+      arr->retired_next = s.retired;
+      s.retired = arr;
+    }
+
+    s.table.store(fresh, std::memory_order_release);
+    s.bytes.fetch_add(n, std::memory_order_relaxed);
+    return fresh;
+  }
+
+  // Requires s.mtx. Bump-allocates an entry from the shard's arena.
+  template <class K>
+  std::expected<const entry*, ec> make_entry(shard& s, std::size_t h, const K& key) noexcept {
+    void* p = s.bump;
+    std::size_t space = s.bump_left;
+    if (!p || !std::align(alignof(entry), sizeof(entry), p, space)) {
+      const std::size_t n = std::max(chunk_bytes_, sizeof(chunk) + alignof(entry) + sizeof(entry));
+      auto raw = allocate_bytes(n);
+      if (!raw) return std::unexpected(raw.error());
+      s.chunks = std::construct_at(reinterpret_cast<chunk*>(*raw), chunk{s.chunks, n});
+      s.bytes.fetch_add(n, std::memory_order_relaxed);
+      p = *raw + sizeof(chunk);
+      space = n - sizeof(chunk);
+      std::align(alignof(entry), sizeof(entry), p, space);
+    }
+
+    auto* e = static_cast<entry*>(p);
+    e->hash = h;
+#if defined(__cpp_exceptions)
+    try {
+      construct_with_optional_alloc(&e->value, alloc_, key);
+    } catch (const std::bad_alloc&) {
+      return std::unexpected(ec::alloc_failed);
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+#else
+    construct_with_optional_alloc(&e->value, alloc_, key);
+#endif
+    // Only a fully constructed entry consumes arena space.
+    s.bump = static_cast<std::byte*>(p) + sizeof(entry);
+    s.bump_left = space - sizeof(entry);
+    return e;
+  }
+
+  void release_shard(shard& s) noexcept {
+    if (slot_array* arr = s.table.load(std::memory_order_relaxed)) {
+      for (std::size_t i = 0; i < arr->cap; ++i) {
+        if (const entry* e = arr->slots()[i].load(std::memory_order_relaxed)) {
+          std::destroy_at(&const_cast<entry*>(e)->value);
+        }
+      }
+      traits::deallocate(alloc_, reinterpret_cast<std::byte*>(arr), slot_array::bytes_for(arr->cap));
+    }
+    while (slot_array* old = s.retired) {
+      s.retired = old->retired_next;
+      traits::deallocate(alloc_, reinterpret_cast<std::byte*>(old), slot_array::bytes_for(old->cap));
+    }
+    while (chunk* c = s.chunks) {
+      s.chunks = c->next;
+      traits::deallocate(alloc_, reinterpret_cast<std::byte*>(c), c->n);
+    }
+  }
+
+  [[no_unique_address]] allocator_type alloc_{};
+  [[no_unique_address]] Hash hasher_{};
+  [[no_unique_address]] KeyEqual equal_{};
+  shard* shards_{nullptr};
+  std::size_t shard_bits_{0};
+  std::size_t chunk_bytes_{0};
+};
+
+} // namespace ndof
+
+template <class T>
+struct std::hash<ndof::flyweight<T>> {
+  std::size_t operator()(ndof::flyweight<T> f) const noexcept {
+    return std::hash<const T*>{}(f.operator->());
+  }
+};
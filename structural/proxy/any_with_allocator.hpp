@@ -39,6 +39,10 @@ public:
   bool has_value() const noexcept { return ops_ != nullptr; }
   const void* held_type_id() const noexcept { return tid_; }
 
+  // Address of the held object (nullptr when empty); held_type_id() says what it is.
+  void* data() noexcept { return ops_ ? obj_.ptr : nullptr; }
+  const void* data() const noexcept { return ops_ ? obj_.ptr : nullptr; }
+
   void reset() noexcept {
     if (!ops_) return;
     ops_->destroy(*this);
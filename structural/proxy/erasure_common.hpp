@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Vocabulary shared by aligned_storage, any_with_allocator,
+// function_with_allocator and the allocator-aware patterns built on them.
+// Include this before those headers.
+
+namespace ndof {
+
+enum class ec {
+  ok,
+  empty,
+  type_mismatch,
+  alloc_failed,
+  construction_failed,
+  not_copyable,
+  not_movable
+};
+
+// A caller-provided destination for placement construction (see clone_into).
+struct bytes {
+  std::byte* data;
+  std::size_t size;
+  std::size_t align;
+};
+
+// Error-coded result used by aligned_storage. Tests true on success.
+template <class T>
+struct result {
+  T value;
+  ec code;
+
+  explicit operator bool() const noexcept { return code == ec::ok; }
+  ec error() const noexcept { return code; }
+};
+
+template <>
+struct result<void> {
+  struct none {} value;
+  ec code;
+
+  explicit operator bool() const noexcept { return code == ec::ok; }
+  ec error() const noexcept { return code; }
+};
+
+namespace detail {
+  template <class T>
+  inline constexpr char type_tag{};
+}
+
+// A closed set of types, e.g., every concrete type of a closed hierarchy
+// (closed_cloneable), the alternatives of a shared_any, or the visitors of a
+// visitor_table.
+template <class... Ts>
+struct type_list {};
+
+// One distinct address per type, without RTTI.
+template <class T>
+constexpr const void* type_id() noexcept {
+  return &detail::type_tag<T>;
+}
+
+// True if T can be uses-allocator constructed from Args... without throwing.
+template <class T, class Alloc, class... Args>
+constexpr bool nothrow_constructible_with_alloc_v = [] {
+  if constexpr (!std::uses_allocator_v<T, Alloc>) {
+    return std::is_nothrow_constructible_v<T, Args...>;
+  } else if constexpr (std::is_constructible_v<T, std::allocator_arg_t, const Alloc&, Args...>) {
+    return std::is_nothrow_constructible_v<T, std::allocator_arg_t, const Alloc&, Args...>;
+  } else {
+    return std::is_nothrow_constructible_v<T, Args..., const Alloc&>;
+  }
+}();
+
+// Constructs T at p, passing the allocator along only if T uses one.
+template <class T, class Alloc, class... Args>
+void construct_with_optional_alloc(T* p, const Alloc& a, Args&&... args)
+    noexcept(nothrow_constructible_with_alloc_v<T, Alloc, Args...>) {
+  std::uninitialized_construct_using_allocator(p, a, std::forward<Args>(args)...);
+}
+
+} // namespace ndof
@@ -510,8 +510,6 @@ private:
   };
 
 private:
-  using storage_type = aligned_storage<allocator_type, SboBytes, SboAlign>;
-
   storage_type storage_{};
   typename storage_type::block obj_{};
   const ops_t* ops_{nullptr};
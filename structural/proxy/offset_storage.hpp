@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class T> struct result
+
+// A self-relative pointer: stores the distance from itself to the target, so
+// it stays valid when the memory holding both is mapped at another address
+// (shared memory, memory-mapped files) or copied as a whole. Copying an
+// offset_ptr recomputes the distance from the new location; copying its
+// bytes does not, so it is not trivially copyable.
+template <class T>
+class offset_ptr {
+public:
+  using element_type = T;
+
+  offset_ptr() noexcept = default;
+  offset_ptr(std::nullptr_t) noexcept {}
+  offset_ptr(T* p) noexcept { set(p); }
+
+  template <class U>
+    requires std::is_convertible_v<U*, T*>
+  offset_ptr(const offset_ptr<U>& other) noexcept { set(other.get()); }
+
+  offset_ptr(const offset_ptr& other) noexcept { set(other.get()); }
+
+  offset_ptr& operator=(const offset_ptr& other) noexcept {
+    set(other.get());
+    return *this;
+  }
+
+  offset_ptr& operator=(T* p) noexcept {
+    set(p);
+    return *this;
+  }
+
+  [[nodiscard]] T* get() const noexcept {
+    if (off_ == null_offset) return nullptr;
+    return reinterpret_cast<T*>(reinterpret_cast<std::uintptr_t>(this) + static_cast<std::uintptr_t>(off_));
+  }
+
+  template <class U = T>
+    requires(!std::is_void_v<U>)
+  U& operator*() const noexcept { return *get(); }
+
+  T* operator->() const noexcept { return get(); }
+
+  explicit operator bool() const noexcept { return off_ != null_offset; }
+
+  friend bool operator==(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() == b.get(); }
+  friend bool operator==(const offset_ptr& a, std::nullptr_t) noexcept { return !a; }
+
+private:
+  // One byte past this: inside the offset_ptr itself, so never a target.
+  static constexpr std::ptrdiff_t null_offset = 1;
+
+  void set(const T* p) noexcept {
+    off_ = p ? static_cast<std::ptrdiff_t>(reinterpret_cast<std::uintptr_t>(p) -
+                                           reinterpret_cast<std::uintptr_t>(this))
+             : null_offset;
+  }
+
+  std::ptrdiff_t off_{null_offset};
+};
+
+// Storage policy with aligned_storage's interface (block, allocate,
+// deallocate, get_allocator) that holds no absolute address: the block
+// points at its object through an offset_ptr, and the heap header records
+// the distance back to the start of the allocation instead of its address.
+// An object in SBO or allocated from an allocator whose own state is
+// address-free (shared_arena_allocator) can then live in memory mapped at
+// different addresses in different processes.
+//
+// Contract: a block is only used inside the memory region that holds its
+// storage (it is copied with the storage, not out of it).
+template <class AllocFamily,
+          std::size_t SboBytes,
+          std::size_t SboAlign>
+class offset_storage {
+public:
+  using allocator_type = AllocFamily;
+  using traits         = std::allocator_traits<allocator_type>;
+
+  offset_storage() = default;
+  explicit offset_storage(const allocator_type& a) noexcept : alloc_(a) {}
+
+  allocator_type get_allocator() const noexcept { return alloc_; }
+
+  struct block {
+    offset_ptr<void> ptr{};
+    std::size_t bytes{};
+    std::size_t align{};
+    bool in_sbo{};
+  };
+
+  result<void> allocate(block& out, std::size_t bytes, std::size_t align) noexcept {
+    out = {};
+    out.bytes = bytes;
+    out.align = align;
+
+    if (bytes <= SboBytes && align <= SboAlign) {
+      out.in_sbo = true;
+      out.ptr = static_cast<void*>(sbo_);
+      return {{}, ec::ok};
+    }
+
+    const std::size_t slack = align ? (align - 1) : 0;
+    const std::size_t need  = bytes + slack + header_size;
+
+    byte_alloc ba(alloc_);
+    std::byte* raw = nullptr;
+
+#if defined(__cpp_exceptions)
+    try {
+      raw = byte_traits::allocate(ba, need);
+    } catch (...) {
+      return {{}, ec::alloc_failed};
+    }
+#else
+    raw = byte_traits::allocate(ba, need);
+    if (!raw) return {{}, ec::alloc_failed};
+#endif
+
+    void* p = raw + header_size;
+    std::size_t space = need - header_size;
+    void* aligned = std::align(align, bytes, p, space);
+
+    if (!aligned) {
+      byte_traits::deallocate(ba, raw, need);
+      return {{}, ec::alloc_failed};
+    }
+
+    const header h{static_cast<std::size_t>(static_cast<std::byte*>(aligned) - raw), need};
+    std::memcpy(static_cast<std::byte*>(aligned) - header_size, &h, header_size);
+
+    out.ptr = aligned;
+    return {{}, ec::ok};
+  }
+
+  void deallocate(block& b) noexcept {
+    if (!b.ptr) return;
+    if (b.in_sbo) { b = {}; return; }
+
+    auto* p = static_cast<std::byte*>(b.ptr.get());
+    header h{};
+    std::memcpy(&h, p - header_size, header_size);
+
+    byte_alloc ba(alloc_);
+    byte_traits::deallocate(ba, p - h.back, h.n);
+
+    b = {};
+  }
+
+private:
+  using byte_alloc  = typename traits::template rebind_alloc<std::byte>;
+  using byte_traits = std::allocator_traits<byte_alloc>;
+
+  struct header {
+    std::size_t back; // aligned object - start of allocation
+    std::size_t n;
+  };
+
+  static_assert(std::is_trivially_copyable_v<header>);
+
+  static constexpr std::size_t header_size = sizeof(header);
+
+  [[no_unique_address]] allocator_type alloc_{};
+  alignas(SboAlign) std::byte sbo_[SboBytes]{};
+};
+
+} // namespace ndof
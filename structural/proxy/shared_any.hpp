@@ -0,0 +1,313 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   struct bytes
+//   template<class... Ts> struct type_list
+//   template<class T, class Alloc, class... Args>
+//   constexpr bool nothrow_constructible_with_alloc_v
+//   template<class T, class Alloc, class... Args>
+//   void construct_with_optional_alloc(T*, const Alloc&, Args&&...) noexcept(...)
+//   template<class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+//   class offset_storage                                      (offset_storage.hpp)
+
+template <class Types,
+          class AllocFamily = std::allocator<std::byte>,
+          std::size_t SboBytes = 3 * sizeof(void*),
+          std::size_t SboAlign = alignof(std::max_align_t)>
+class shared_any;
+
+// any_with_allocator for memory shared between processes: a type-erased
+// value that can be built by one process and read, copied or destroyed by
+// another that maps the same region at a different address, with no
+// serialization.
+//
+//   types     Closed: the registry Types = type_list<Ts...> lists every type
+//             the object may hold, and the object stores a type index into
+//             it (0 when empty) instead of an ops pointer and a type_id
+//             address, which differ between processes. Each process resolves
+//             the index through its own constexpr ops table, so every process
+//             must be built with the same registry.
+//   storage   offset_storage: the object is reached through a self-relative
+//             offset, never an absolute address. With the default SBO a
+//             small message needs no allocator at all; larger ones use
+//             AllocFamily, which for sharing must be address-free itself
+//             (shared_arena_allocator).
+//
+// Same error-coded API as any_with_allocator (moves deep-move into the
+// destination's allocator; copies use clone_into when the type has one).
+//
+//   auto* arena = shared_arena::create(region, size);          // process A
+//   using msg = shared_any<type_list<quote, trade>, shared_arena_allocator<std::byte>>;
+//   auto* m = std::construct_at(static_cast<msg*>(*arena->try_allocate(sizeof(msg), alignof(msg))),
+//                               shared_arena_allocator<std::byte>(*arena));
+//   m->try_emplace<trade>(...);
+//   ...
+//   if (const trade* t = m->get_if<trade>()) ...                // process B, other mapping
+//
+// Contract: the held types are themselves address-free (plain data, offset_ptr
+// into the same region; no raw pointers, vptrs or std containers), the object
+// stays in the region that holds its heap storage, and processes synchronize
+// access.
+template <class... Ts, class AllocFamily, std::size_t SboBytes, std::size_t SboAlign>
+class shared_any<type_list<Ts...>, AllocFamily, SboBytes, SboAlign> {
+public:
+  static_assert(sizeof...(Ts) > 0, "A shared_any needs at least one registered type.");
+
+  using allocator_type = AllocFamily;
+  using traits         = std::allocator_traits<allocator_type>;
+  using index_type     = std::conditional_t<(sizeof...(Ts) < std::numeric_limits<std::uint8_t>::max()),
+                                            std::uint8_t, std::uint16_t>;
+
+  // 1-based position of T in Ts..., or 0 if T is not registered.
+  template <class T>
+  static constexpr index_type index_of = [] {
+    constexpr bool hits[] = {std::same_as<std::remove_cvref_t<T>, Ts>...};
+    for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+      if (hits[i]) return static_cast<index_type>(i + 1);
+    }
+    return index_type{0};
+  }();
+
+  shared_any() noexcept(std::is_nothrow_default_constructible_v<allocator_type>) = default;
+
+  explicit shared_any(const allocator_type& a) noexcept
+      : storage_(a) {}
+
+  ~shared_any() noexcept { reset(); }
+
+  allocator_type get_allocator() const noexcept { return storage_.get_allocator(); }
+
+  bool has_value() const noexcept { return index_ != 0; }
+
+  // 0 when empty; otherwise index_of<T> for the held T. The same in every
+  // process built with this registry.
+  index_type type_index() const noexcept { return index_; }
+
+  template <class T>
+  bool holds() const noexcept { return index_ != 0 && index_ == index_of<T>; }
+
+  // Address of the held object in this process (nullptr when empty).
+  void* data() noexcept { return index_ ? obj_.ptr.get() : nullptr; }
+  const void* data() const noexcept { return index_ ? obj_.ptr.get() : nullptr; }
+
+  void reset() noexcept {
+    if (!index_) return;
+    table[index_ - 1].destroy(*this);
+    index_ = 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  template <class T, class... Args>
+  std::expected<T*, ec> try_emplace(Args&&... args) noexcept {
+    using U = std::remove_cvref_t<T>;
+    static_assert(index_of<U> != 0, "Type is not in this shared_any's registry.");
+    reset();
+
+    typename storage_type::block b{};
+    auto ar = storage_.allocate(b, sizeof(U), alignof(U));
+    if (!ar) return std::unexpected(ar.error());
+
+    if constexpr (!nothrow_constructible_with_alloc_v<U, allocator_type, Args...>) {
+      storage_.deallocate(b);
+      return std::unexpected(ec::construction_failed);
+    }
+
+    auto* p = static_cast<U*>(b.ptr.get());
+    construct_with_optional_alloc<U>(p, storage_.get_allocator(), std::forward<Args>(args)...);
+
+    obj_ = b;
+    index_ = index_of<U>;
+    return p;
+  }
+
+  std::expected<void, ec> try_copy_from(const shared_any& other) noexcept {
+    if (!other.index_) return std::unexpected(ec::empty);
+    return table[other.index_ - 1].clone_to(*this, other);
+  }
+
+  std::expected<void, ec> try_move_from(shared_any&& other) noexcept {
+    if (!other.index_) return std::unexpected(ec::empty);
+    return table[other.index_ - 1].move_to(*this, std::move(other));
+  }
+
+  template <class T>
+  std::expected<T*, ec> try_get_if() noexcept {
+    using U = std::remove_cvref_t<T>;
+    if (!index_) return std::unexpected(ec::empty);
+    if (index_ != index_of<U>) return std::unexpected(ec::type_mismatch);
+    return static_cast<U*>(obj_.ptr.get());
+  }
+
+  template <class T>
+  std::expected<const T*, ec> try_get_if() const noexcept {
+    using U = std::remove_cvref_t<T>;
+    if (!index_) return std::unexpected(ec::empty);
+    if (index_ != index_of<U>) return std::unexpected(ec::type_mismatch);
+    return static_cast<const U*>(obj_.ptr.get());
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape, no std::expected here
+  // --------------------------------------------------------------------------
+
+  template <class T, class... Args>
+  T* emplace_ptr(Args&&... args) noexcept {
+    auto r = try_emplace<T>(std::forward<Args>(args)...);
+    return r ? *r : nullptr;
+  }
+
+  template <class T>
+  T* get_if() noexcept {
+    auto r = try_get_if<T>();
+    return r ? *r : nullptr;
+  }
+
+  template <class T>
+  const T* get_if() const noexcept {
+    auto r = try_get_if<T>();
+    return r ? *r : nullptr;
+  }
+
+  // --------------------------------------------------------------------------
+  // Value semantics
+  // --------------------------------------------------------------------------
+
+  shared_any(const shared_any& other) noexcept
+      : storage_(traits::select_on_container_copy_construction(other.get_allocator())) {
+    (void)try_copy_from(other);
+  }
+
+  shared_any& operator=(const shared_any& other) noexcept {
+    if (this == &other) return *this;
+    reset();
+    if constexpr (traits::propagate_on_container_copy_assignment::value) {
+      storage_ = storage_type(other.get_allocator());
+    }
+    (void)try_copy_from(other);
+    return *this;
+  }
+
+  shared_any(shared_any&& other) noexcept
+      : storage_(other.get_allocator()) {
+    (void)try_move_from(std::move(other));
+  }
+
+  shared_any& operator=(shared_any&& other) noexcept {
+    if (this == &other) return *this;
+    reset();
+    if constexpr (traits::propagate_on_container_move_assignment::value) {
+      storage_ = storage_type(other.get_allocator());
+    }
+    (void)try_move_from(std::move(other));
+    return *this;
+  }
+
+private:
+  using storage_type = offset_storage<allocator_type, SboBytes, SboAlign>;
+
+  template <class U>
+  static constexpr bool has_clone_into_v =
+    requires(const U& u, bytes dst) {
+      { u.clone_into(dst) } noexcept -> std::same_as<std::expected<U*, ec>>;
+    };
+
+  struct ops_t {
+    void (*destroy)(shared_any&) noexcept;
+    std::expected<void, ec> (*move_to)(shared_any&, shared_any&&) noexcept;
+    std::expected<void, ec> (*clone_to)(shared_any&, const shared_any&) noexcept;
+  };
+
+  template <class U>
+  static void destroy_impl(shared_any& self) noexcept {
+    std::destroy_at(static_cast<U*>(self.obj_.ptr.get()));
+    self.storage_.deallocate(self.obj_);
+  }
+
+  template <class U>
+  static std::expected<void, ec>
+  move_to_impl(shared_any& dst, shared_any&& src) noexcept {
+    if constexpr (!std::is_nothrow_move_constructible_v<U>) {
+      return std::unexpected(ec::not_movable);
+    }
+
+    dst.reset();
+
+    typename storage_type::block b{};
+    auto ar = dst.storage_.allocate(b, sizeof(U), alignof(U));
+    if (!ar) return std::unexpected(ar.error());
+
+    if constexpr (!nothrow_constructible_with_alloc_v<U, allocator_type, U&&>) {
+      dst.storage_.deallocate(b);
+      return std::unexpected(ec::construction_failed);
+    }
+
+    auto* dp = static_cast<U*>(b.ptr.get());
+    auto* sp = static_cast<U*>(src.obj_.ptr.get());
+
+    construct_with_optional_alloc<U>(dp, dst.storage_.get_allocator(), std::move(*sp));
+
+    std::destroy_at(sp);
+    src.storage_.deallocate(src.obj_);
+    src.index_ = 0;
+
+    dst.obj_ = b;
+    dst.index_ = index_of<U>;
+    return {};
+  }
+
+  template <class U>
+  static std::expected<void, ec>
+  clone_to_impl(shared_any& dst, const shared_any& src) noexcept {
+    dst.reset();
+
+    typename storage_type::block b{};
+    auto ar = dst.storage_.allocate(b, sizeof(U), alignof(U));
+    if (!ar) return std::unexpected(ar.error());
+
+    if constexpr (has_clone_into_v<U>) {
+      bytes out{static_cast<std::byte*>(b.ptr.get()), b.bytes, b.align};
+      auto r = static_cast<const U*>(src.obj_.ptr.get())->clone_into(out);
+      if (!r) {
+        dst.storage_.deallocate(b);
+        return std::unexpected(r.error());
+      }
+    } else {
+      if constexpr (!std::is_nothrow_copy_constructible_v<U>) {
+        dst.storage_.deallocate(b);
+        return std::unexpected(ec::not_copyable);
+      } else {
+        std::construct_at(static_cast<U*>(b.ptr.get()), *static_cast<const U*>(src.obj_.ptr.get()));
+      }
+    }
+
+    dst.obj_ = b;
+    dst.index_ = index_of<U>;
+    return {};
+  }
+
+  // The per-process half of the registry: index i + 1 dispatches to Ts[i].
+  static constexpr ops_t table[] = {
+    {&destroy_impl<Ts>, &move_to_impl<Ts>, &clone_to_impl<Ts>}...
+  };
+
+  storage_type storage_{};
+  typename storage_type::block obj_{};
+  index_type index_{0};
+};
+
+} // namespace ndof
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <new>
+#include <thread>
+
+namespace ndof {
+
+// Assumes these already exist in the namespace:
+//   enum class ec
+//   template<class T> class offset_ptr   (offset_storage.hpp)
+
+// A general-purpose allocator laid out inside a caller-provided region (a
+// shared-memory mapping, typically), holding only offsets from its own
+// address. Processes that map the region at different addresses share it:
+// one calls create(), the others attach().
+//
+//   blocks    Power-of-two size classes from 16 bytes, each block aligned to
+//             its size (up to max_align). Freed blocks go to their class's
+//             free list and are reused; fresh blocks come from a bump
+//             pointer. No splitting or coalescing: simple, and predictable
+//             for the fixed set of message types a data plane exchanges.
+//   locking   A spinlock on an address-free atomic, so it works across
+//             processes. Critical sections are a few loads and stores.
+//
+// The region must be aligned to max_align (mmap gives page alignment).
+//
+// Contract: a process that dies while allocating leaves the arena locked;
+// every process maps the whole region.
+class shared_arena {
+public:
+  static constexpr std::size_t min_block = 16;
+  static constexpr std::size_t max_align = 4096;
+
+  // Formats an arena at the start of [base, base + size). Null if the region
+  // is misaligned or too small for the arena's own header.
+  [[nodiscard]] static shared_arena* create(void* base, std::size_t size) noexcept {
+    if (!base || reinterpret_cast<std::uintptr_t>(base) % max_align != 0) return nullptr;
+    if (size < header_end()) return nullptr;
+    return ::new (base) shared_arena(size);
+  }
+
+  // An arena another process created in this region. Null if there is none.
+  [[nodiscard]] static shared_arena* attach(void* base) noexcept {
+    if (!base || reinterpret_cast<std::uintptr_t>(base) % max_align != 0) return nullptr;
+    auto* a = std::launder(static_cast<shared_arena*>(base));
+    return a->magic_ == magic ? a : nullptr;
+  }
+
+  shared_arena(const shared_arena&) = delete;
+  shared_arena& operator=(const shared_arena&) = delete;
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+  // Bytes handed out from the bump pointer so far (including freed blocks
+  // waiting for reuse).
+  [[nodiscard]] std::size_t used() const noexcept {
+    guard g(*this);
+    return top_;
+  }
+
+  // --------------------------------------------------------------------------
+  // Core API: always std::expected
+  // --------------------------------------------------------------------------
+
+  // Errors: ec::alloc_failed if the region is exhausted or align exceeds
+  //         max_align.
+  [[nodiscard]] std::expected<void*, ec> try_allocate(std::size_t bytes, std::size_t align) noexcept {
+    if (align > max_align || bytes > capacity_) return std::unexpected(ec::alloc_failed);
+    const unsigned c = size_class(bytes, align);
+    const std::size_t size = std::size_t{1} << c;
+    const std::size_t block_align = size < max_align ? size : max_align;
+
+    guard g(*this);
+    if (std::size_t off = free_[c - min_shift]) {
+      free_[c - min_shift] = *reinterpret_cast<const std::size_t*>(at(off));
+      return static_cast<void*>(at(off));
+    }
+    const std::size_t off = (top_ + block_align - 1) & ~(block_align - 1);
+    if (off > capacity_ || size > capacity_ - off) return std::unexpected(ec::alloc_failed);
+    top_ = off + size;
+    return static_cast<void*>(at(off));
+  }
+
+  // --------------------------------------------------------------------------
+  // Convenience API: stable shape
+  // --------------------------------------------------------------------------
+
+  // Null on failure.
+  [[nodiscard]] void* allocate(std::size_t bytes, std::size_t align) noexcept {
+    auto r = try_allocate(bytes, align);
+    return r ? *r : nullptr;
+  }
+
+  // bytes and align as passed to allocate.
+  void deallocate(void* p, std::size_t bytes, std::size_t align) noexcept {
+    if (!p) return;
+    const unsigned c = size_class(bytes, align);
+    const std::size_t off = static_cast<std::size_t>(static_cast<std::byte*>(p) - at(0));
+
+    guard g(*this);
+    *static_cast<std::size_t*>(p) = free_[c - min_shift];
+    free_[c - min_shift] = off;
+  }
+
+private:
+  static constexpr std::uint64_t magic    = 0x6e646f662d61726eull; // "ndof-arn"
+  static constexpr unsigned min_shift     = 4;                      // 16 bytes
+  static constexpr unsigned class_count   = std::numeric_limits<std::size_t>::digits - min_shift;
+
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+                "The arena lock must be address-free to work across processes.");
+
+  explicit shared_arena(std::size_t size) noexcept : capacity_(size), top_(header_end()) {
+    magic_ = magic;
+  }
+
+  static constexpr std::size_t header_end() noexcept {
+    return (sizeof(shared_arena) + min_block - 1) & ~(min_block - 1);
+  }
+
+  // log2 of the block size for a request.
+  static unsigned size_class(std::size_t bytes, std::size_t align) noexcept {
+    std::size_t n = bytes > align ? bytes : align;
+    if (n < min_block) n = min_block;
+    return static_cast<unsigned>(std::bit_width(n - 1));
+  }
+
+  std::byte* at(std::size_t off) const noexcept {
+    return const_cast<std::byte*>(reinterpret_cast<const std::byte*>(this)) + off;
+  }
+
+  class guard {
+  public:
+    explicit guard(const shared_arena& a) noexcept : lock_(a.lock_) {
+      while (lock_.exchange(1, std::memory_order_acquire)) {
+        while (lock_.load(std::memory_order_relaxed)) std::this_thread::yield();
+      }
+    }
+    ~guard() noexcept { lock_.store(0, std::memory_order_release); }
+
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+  private:
+    std::atomic<std::uint32_t>& lock_;
+  };
+
+  std::uint64_t magic_{0};
+  mutable std::atomic<std::uint32_t> lock_{0};
+  std::size_t capacity_;
+  std::size_t top_;                       // offset of the first unused byte
+  std::size_t free_[class_count]{};       // offset of each class's first free block; 0: none
+};
+
+// Standard allocator over a shared_arena. It refers to the arena through an
+// offset_ptr, so objects that store it (shared_any, through offset_storage)
+// can live in the arena's region and be used from every process that maps
+// it. Its pointer type is still T*: std containers built with it hold
+// absolute addresses and are only usable in the process that built them.
+// allocate() throws std::bad_alloc when the arena is exhausted (returns
+// nullptr without exceptions).
+template <class T>
+class shared_arena_allocator {
+public:
+  using value_type = T;
+
+  explicit shared_arena_allocator(shared_arena& arena) noexcept : arena_(&arena) {}
+
+  template <class U>
+  shared_arena_allocator(const shared_arena_allocator<U>& other) noexcept : arena_(other.arena()) {}
+
+  [[nodiscard]] T* allocate(std::size_t n) {
+    auto r = n <= std::numeric_limits<std::size_t>::max() / sizeof(T)
+           ? arena_->try_allocate(n * sizeof(T), alignof(T))
+           : std::expected<void*, ec>(std::unexpected(ec::alloc_failed));
+    if (!r) {
+#if defined(__cpp_exceptions)
+      throw std::bad_alloc();
+#else
+      return nullptr;
+#endif
+    }
+    return static_cast<T*>(*r);
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept { arena_->deallocate(p, n * sizeof(T), alignof(T)); }
+
+  [[nodiscard]] shared_arena* arena() const noexcept { return arena_.get(); }
+
+  template <class U>
+  friend bool operator==(const shared_arena_allocator& a, const shared_arena_allocator<U>& b) noexcept {
+    return a.arena() == b.arena();
+  }
+
+private:
+  offset_ptr<shared_arena> arena_;
+};
+
+} // namespace ndof
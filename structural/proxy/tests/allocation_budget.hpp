@@ -0,0 +1,211 @@
+// File: tests/allocation_budget.hpp
+//
+// Test support for "zero allocations on the hot path".
+//
+//   allocation_scope        RAII. Counts allocations, deallocations, bytes and
+//                           peak live bytes made on this thread while it is
+//                           alive. Scopes nest; an allocation counts in every
+//                           enclosing scope. fail_at(n) makes the nth
+//                           counting_allocator allocation in the scope fail.
+//   counting_allocator<T>   A stateless allocator family that reports to the
+//                           current scopes. An injected failure throws
+//                           std::bad_alloc, or returns nullptr when built
+//                           without exceptions.
+//   global operator new     Counted too (as global_allocations), through
+//                           global_new_counter.cpp, which every executable
+//                           using this header links.
+//
+//   EXPECT_NO_ALLOCATIONS { ... }
+//   EXPECT_MAX_ALLOCATIONS(n) { ... }
+//                           Non-fatal failure if the block allocates (through
+//                           either path) more than the budget.
+//
+// Counting is per thread: work handed to other threads is not seen.
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "global_new_counter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ndof::test {
+
+struct allocation_stats {
+  std::size_t allocations{};        // through counting_allocator
+  std::size_t deallocations{};
+  std::size_t bytes_allocated{};
+  std::size_t bytes_live{};
+  std::size_t peak_bytes{};
+  std::size_t failures{};           // injected
+  std::size_t global_allocations{}; // through the global operator new
+
+  std::size_t total_allocations() const noexcept { return allocations + global_allocations; }
+};
+
+class allocation_scope {
+public:
+  allocation_scope() noexcept : parent_(current()), global_base_(global_new_calls()) { current() = this; }
+
+  ~allocation_scope() noexcept { current() = parent_; }
+
+  allocation_scope(const allocation_scope&) = delete;
+  allocation_scope& operator=(const allocation_scope&) = delete;
+
+  const allocation_stats& stats() const noexcept {
+    stats_.global_allocations = global_new_calls() - global_base_;
+    return stats_;
+  }
+
+  // The nth counting_allocator allocation from now on (1-based) fails;
+  // 0 disarms.
+  void fail_at(std::size_t n) noexcept {
+    fail_at_ = n ? stats_.allocations + n : 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // Hooks: called by counting_allocator.
+  // --------------------------------------------------------------------------
+
+  // False if an enclosing scope injects a failure here; nothing is counted
+  // then except the failure.
+  static bool on_allocate(std::size_t bytes) noexcept {
+    bool fail = false;
+    for (allocation_scope* s = current(); s; s = s->parent_) {
+      if (s->fail_at_ && s->stats_.allocations + 1 == s->fail_at_) fail = true;
+    }
+    for (allocation_scope* s = current(); s; s = s->parent_) {
+      allocation_stats& st = s->stats_;
+      if (fail) {
+        ++st.failures;
+        if (st.allocations + 1 == s->fail_at_) s->fail_at_ = 0;
+        continue;
+      }
+      ++st.allocations;
+      st.bytes_allocated += bytes;
+      st.bytes_live += bytes;
+      if (st.bytes_live > st.peak_bytes) st.peak_bytes = st.bytes_live;
+    }
+    return !fail;
+  }
+
+  static void on_deallocate(std::size_t bytes) noexcept {
+    for (allocation_scope* s = current(); s; s = s->parent_) {
+      ++s->stats_.deallocations;
+      // Memory allocated before the scope opened is not live in it.
+      s->stats_.bytes_live -= bytes < s->stats_.bytes_live ? bytes : s->stats_.bytes_live;
+    }
+  }
+
+private:
+  static allocation_scope*& current() noexcept {
+    thread_local allocation_scope* top = nullptr;
+    return top;
+  }
+
+  allocation_scope* parent_;
+  std::size_t global_base_;          // global_new_calls() when the scope opened
+  mutable allocation_stats stats_{};
+  std::size_t fail_at_{0}; // allocation count at which to fail; 0: never
+};
+
+template <class T>
+class counting_allocator {
+public:
+  using value_type      = T;
+  using is_always_equal = std::true_type;
+
+  counting_allocator() noexcept = default;
+  template <class U>
+  counting_allocator(const counting_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) return fail();
+    const std::size_t bytes = n * sizeof(T);
+    if (!allocation_scope::on_allocate(bytes)) return fail();
+    // aligned_alloc, not operator new: the global counter must not see these.
+    constexpr std::size_t align = alignof(T) < alignof(void*) ? alignof(void*) : alignof(T);
+    void* p = std::aligned_alloc(align, (bytes + align - 1) / align * align);
+    if (!p) return fail();
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    allocation_scope::on_deallocate(n * sizeof(T));
+    std::free(p);
+  }
+
+  template <class U>
+  friend bool operator==(const counting_allocator&, const counting_allocator<U>&) noexcept {
+    return true;
+  }
+
+private:
+  static T* fail() {
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#else
+    return nullptr;
+#endif
+  }
+};
+
+namespace detail {
+
+  // Runs the body of an EXPECT_*_ALLOCATIONS block once, then closes the
+  // scope and checks the budget. Reporting allocates, so it happens after.
+  class allocation_budget {
+  public:
+    allocation_budget(std::size_t budget, const char* what, const char* file, int line) noexcept
+        : budget_(budget), what_(what), file_(file), line_(line) {
+      scope_.emplace();
+    }
+
+    ~allocation_budget() { finish(); }
+
+    allocation_budget(const allocation_budget&) = delete;
+    allocation_budget& operator=(const allocation_budget&) = delete;
+
+    bool running() const noexcept { return scope_.has_value(); }
+
+    void finish() {
+      if (!scope_) return;
+      const allocation_stats s = scope_->stats();
+      scope_.reset();
+      if (s.total_allocations() > budget_) {
+        ADD_FAILURE_AT(file_, line_) << what_ << ": " << s.total_allocations() << " allocation(s) ("
+                                     << s.allocations << " through counting_allocator, " << s.bytes_allocated
+                                     << " bytes; " << s.global_allocations << " through global operator new)"
+                                     << ", budget " << budget_;
+      }
+    }
+
+  private:
+    std::size_t budget_;
+    const char* what_;
+    const char* file_;
+    int line_;
+    std::optional<allocation_scope> scope_;
+  };
+
+} // namespace detail
+
+} // namespace ndof::test
+
+#define EXPECT_MAX_ALLOCATIONS(n)                                                                     \
+  for (::ndof::test::detail::allocation_budget ndof_allocation_budget_((n), "EXPECT_MAX_ALLOCATIONS(" #n ")", \
+                                                                       __FILE__, __LINE__);           \
+       ndof_allocation_budget_.running(); ndof_allocation_budget_.finish())
+
+#define EXPECT_NO_ALLOCATIONS                                                                         \
+  for (::ndof::test::detail::allocation_budget ndof_allocation_budget_(0, "EXPECT_NO_ALLOCATIONS", __FILE__, \
+                                                                       __LINE__);                     \
+       ndof_allocation_budget_.running(); ndof_allocation_budget_.finish())
@@ -0,0 +1,69 @@
+// File: tests/global_new_counter.cpp
+//
+// The replacement global allocation functions behind global_new_counter.hpp.
+// Kept in its own translation unit: the compiler never sees these bodies
+// next to a new-expression, so it cannot pair an inlined malloc with a
+// delete (-Wmismatched-new-delete), and exactly one definition exists per
+// executable.
+
+#include "global_new_counter.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local std::size_t calls = 0;
+
+void* allocate(std::size_t n) noexcept {
+  ++calls;
+  return std::malloc(n ? n : 1);
+}
+
+void* allocate(std::size_t n, std::align_val_t al) noexcept {
+  ++calls;
+  std::size_t align = static_cast<std::size_t>(al);
+  if (align < alignof(void*)) align = alignof(void*);
+  // aligned_alloc wants a multiple of the alignment.
+  const std::size_t size = n ? (n + align - 1) / align * align : align;
+  if (size < n) return nullptr;
+  return std::aligned_alloc(align, size);
+}
+
+void* or_throw(void* p) {
+  if (p) return p;
+#if defined(__cpp_exceptions)
+  throw std::bad_alloc();
+#else
+  std::abort();
+#endif
+}
+
+} // namespace
+
+std::size_t ndof::test::global_new_calls() noexcept { return calls; }
+
+void* operator new(std::size_t n) { return or_throw(allocate(n)); }
+void* operator new[](std::size_t n) { return or_throw(allocate(n)); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return allocate(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return allocate(n); }
+
+void* operator new(std::size_t n, std::align_val_t al) { return or_throw(allocate(n, al)); }
+void* operator new[](std::size_t n, std::align_val_t al) { return or_throw(allocate(n, al)); }
+void* operator new(std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(n, al); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
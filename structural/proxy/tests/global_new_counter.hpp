@@ -0,0 +1,20 @@
+// File: tests/global_new_counter.hpp
+//
+// Counts calls to the global operator new. Linking global_new_counter.cpp
+// into an executable replaces every replaceable form of operator new and
+// operator delete (plain, array, nothrow, sized, aligned) with malloc/free
+// based ones that count each allocation on the calling thread. Without
+// exceptions an exhausted throwing form aborts.
+//
+// No dependency on gtest: the benchmarks use it too.
+
+#pragma once
+
+#include <cstddef>
+
+namespace ndof::test {
+
+// Calls to the global operator new (any form) made on this thread so far.
+std::size_t global_new_calls() noexcept;
+
+} // namespace ndof::test
@@ -0,0 +1,263 @@
+// File: tests/test_allocation_budget.cpp
+//
+// Allocation budgets for the type-erasure primitives: SBO paths must never
+// allocate, and allocation failure must surface as ec::alloc_failed. Built
+// twice, with and without exceptions (test_allocation_budget_noexcept), since
+// aligned_storage detects failure differently in each.
+
+#include "allocation_budget.hpp"
+
+#include <gtest/gtest-spi.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../erasure_common.hpp"
+namespace ndof {
+#include "../aligned_storage.hpp"
+}
+#include "../function_with_allocator.hpp"
+#include "../any_with_allocator.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+using alloc = counting_allocator<std::byte>;
+using fn    = function_with_allocator<int(int), alloc>;
+using any   = any_with_allocator<alloc>;
+
+// A callable of exactly N bytes.
+template <std::size_t N>
+struct payload {
+  unsigned char bytes[N]{};
+
+  explicit payload(int seed) noexcept { bytes[0] = static_cast<unsigned char>(seed); }
+  int operator()(int x) const noexcept { return x + bytes[0]; }
+};
+
+using small = payload<sizeof(void*)>;      // fits the default SBO
+using large = payload<8 * sizeof(void*)>;  // does not
+
+// A new-expression may be elided; one whose result escapes may not.
+void new_and_delete_int() {
+  int* volatile p = new int(1);
+  delete p;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// The harness itself
+// ----------------------------------------------------------------------------
+
+TEST(AllocationBudgetTest, ScopeCountsAllocationsBytesAndPeak) {
+  allocation_scope scope;
+  {
+    std::vector<int, counting_allocator<int>> v;
+    v.reserve(4);
+    v.reserve(16);
+  }
+
+  const auto& s = scope.stats();
+  EXPECT_EQ(s.allocations, 2u);
+  EXPECT_EQ(s.deallocations, 2u);
+  EXPECT_EQ(s.bytes_allocated, 20 * sizeof(int));
+  EXPECT_EQ(s.peak_bytes, 20 * sizeof(int)); // both blocks live during the move
+  EXPECT_EQ(s.bytes_live, 0u);
+}
+
+TEST(AllocationBudgetTest, ScopesNest) {
+  allocation_scope outer;
+  counting_allocator<int> a;
+  int* p = a.allocate(1);
+  {
+    allocation_scope inner;
+    int* q = a.allocate(2);
+    a.deallocate(q, 2);
+    EXPECT_EQ(inner.stats().allocations, 1u);
+  }
+  a.deallocate(p, 1);
+  EXPECT_EQ(outer.stats().allocations, 2u);
+  EXPECT_EQ(outer.stats().peak_bytes, 3 * sizeof(int));
+}
+
+TEST(AllocationBudgetTest, FailAtInjectsOneFailure) {
+  allocation_scope scope;
+  scope.fail_at(2);
+  counting_allocator<int> a;
+  int* p = a.allocate(1);
+  ASSERT_NE(p, nullptr);
+#if defined(__cpp_exceptions)
+  EXPECT_THROW((void)a.allocate(1), std::bad_alloc);
+#else
+  EXPECT_EQ(a.allocate(1), nullptr);
+#endif
+  int* q = a.allocate(1); // disarmed after firing
+  ASSERT_NE(q, nullptr);
+  a.deallocate(q, 1);
+  a.deallocate(p, 1);
+  EXPECT_EQ(scope.stats().failures, 1u);
+  EXPECT_EQ(scope.stats().allocations, 2u);
+}
+
+TEST(AllocationBudgetTest, ExpectNoAllocationsReportsBothPaths) {
+  EXPECT_NONFATAL_FAILURE(
+      EXPECT_NO_ALLOCATIONS {
+        counting_allocator<int> a;
+        a.deallocate(a.allocate(1), 1);
+      },
+      "1 through counting_allocator");
+  EXPECT_NONFATAL_FAILURE(
+      EXPECT_NO_ALLOCATIONS { new_and_delete_int(); }, "1 through global operator new");
+  EXPECT_NO_ALLOCATIONS {}
+  EXPECT_MAX_ALLOCATIONS(1) { new_and_delete_int(); }
+}
+
+// ----------------------------------------------------------------------------
+// function_with_allocator: the SBO path never allocates
+// ----------------------------------------------------------------------------
+
+TEST(AllocationBudgetTest, FunctionSboPathNeverAllocates) {
+  EXPECT_NO_ALLOCATIONS {
+    fn f;
+    ASSERT_TRUE(f.try_emplace(small(1)));
+    EXPECT_EQ(f(41), 42);
+    EXPECT_EQ(std::as_const(f)(1), 2);
+
+    fn copy;
+    ASSERT_TRUE(copy.try_copy_from(f));
+    fn moved(std::move(copy));
+    EXPECT_EQ(moved(1), 2);
+
+    fn assigned;
+    assigned = f;
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned(1), 2);
+
+    f.reset();
+    ASSERT_TRUE(f.try_emplace([](int x) noexcept { return x * 2; }));
+    EXPECT_EQ(f(21), 42);
+  }
+}
+
+TEST(AllocationBudgetTest, FunctionHeapPathAllocatesOncePerObject) {
+  allocation_scope scope;
+  {
+    fn f;
+    ASSERT_TRUE(f.try_emplace(large(1)));
+    fn copy;
+    ASSERT_TRUE(copy.try_copy_from(f));
+    EXPECT_EQ(copy(1), 2);
+  }
+  EXPECT_EQ(scope.stats().allocations, 2u);
+  EXPECT_EQ(scope.stats().deallocations, 2u);
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+  EXPECT_EQ(scope.stats().global_allocations, 0u);
+}
+
+TEST(AllocationBudgetTest, FunctionReportsAllocFailure) {
+  allocation_scope scope;
+  scope.fail_at(1);
+  fn f;
+  auto r = f.try_emplace(large(1));
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::alloc_failed);
+  EXPECT_FALSE(f.has_value());
+
+  ASSERT_TRUE(f.try_emplace(large(1)));
+  fn copy;
+  scope.fail_at(1);
+  auto c = copy.try_copy_from(f);
+  ASSERT_FALSE(c);
+  EXPECT_EQ(c.error(), ec::alloc_failed);
+  EXPECT_FALSE(copy.has_value());
+  EXPECT_EQ(f(1), 2);
+}
+
+// ----------------------------------------------------------------------------
+// any_with_allocator: the SBO path never allocates
+// ----------------------------------------------------------------------------
+
+TEST(AllocationBudgetTest, AnySboPathNeverAllocates) {
+  EXPECT_NO_ALLOCATIONS {
+    any a;
+    ASSERT_TRUE(a.try_emplace<small>(1));
+    ASSERT_NE(a.get_if<small>(), nullptr);
+
+    any copy;
+    ASSERT_TRUE(copy.try_copy_from(a));
+    any moved(std::move(copy));
+    ASSERT_NE(moved.get_if<small>(), nullptr);
+    EXPECT_EQ((*moved.get_if<small>())(1), 2);
+
+    any assigned;
+    assigned = a;
+    assigned = std::move(moved);
+    EXPECT_TRUE(assigned.has_value());
+
+    a.reset();
+    ASSERT_TRUE(a.try_emplace<int>(7));
+    EXPECT_EQ(*a.get_if<int>(), 7);
+  }
+}
+
+TEST(AllocationBudgetTest, AnyReportsAllocFailure) {
+  allocation_scope scope;
+  scope.fail_at(1);
+  any a;
+  auto r = a.try_emplace<large>(1);
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::alloc_failed);
+  EXPECT_FALSE(a.has_value());
+  EXPECT_EQ(scope.stats().failures, 1u);
+}
+
+// ----------------------------------------------------------------------------
+// aligned_storage: ec::alloc_failed, with or without exceptions
+// ----------------------------------------------------------------------------
+
+TEST(AllocationBudgetTest, AlignedStorageSboPathIgnoresAllocator) {
+  aligned_storage<alloc, 32, alignof(std::max_align_t)> s;
+  allocation_scope scope;
+  scope.fail_at(1);
+  decltype(s)::block b{};
+  auto r = s.allocate(b, 32, alignof(std::max_align_t));
+  ASSERT_TRUE(r);
+  EXPECT_TRUE(b.in_sbo);
+  s.deallocate(b);
+  EXPECT_EQ(scope.stats().allocations, 0u);
+  EXPECT_EQ(scope.stats().failures, 0u);
+}
+
+TEST(AllocationBudgetTest, AlignedStorageReportsAllocFailure) {
+  aligned_storage<alloc, 16, alignof(std::max_align_t)> s;
+  allocation_scope scope;
+  decltype(s)::block b{};
+
+  scope.fail_at(1);
+  auto r = s.allocate(b, 64, 64);
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::alloc_failed);
+  EXPECT_EQ(b.ptr, nullptr);
+  EXPECT_EQ(scope.stats().failures, 1u);
+
+  r = s.allocate(b, 64, 64);
+  ASSERT_TRUE(r);
+  EXPECT_FALSE(b.in_sbo);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b.ptr) % 64, 0u);
+  s.deallocate(b);
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
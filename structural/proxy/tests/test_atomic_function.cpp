@@ -0,0 +1,232 @@
+// File: tests/test_atomic_function.cpp
+
+#include "allocation_budget.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/atomic_function.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+constexpr int alive = 0x5a5a5a5a;
+
+// Counts live copies and poisons itself on destruction, so a call running a
+// destroyed callable fails the check (and ASan reports the freed node).
+struct probe {
+  std::atomic<int>* live;
+  int value;
+  int canary = alive;
+
+  probe(std::atomic<int>* l, int v) noexcept : live(l), value(v) { live->fetch_add(1); }
+  probe(const probe& o) noexcept : live(o.live), value(o.value) { live->fetch_add(1); }
+  ~probe() {
+    canary = 0;
+    live->fetch_sub(1);
+  }
+
+  int operator()(int x) const { return canary == alive ? value + x : -1; }
+};
+
+// Larger than the default SBO: the callable gets its own allocation.
+struct big {
+  char pad[64]{};
+  int operator()(int x) const { return x + 1000; }
+};
+
+} // namespace
+
+TEST(AtomicFunctionTest, StoreCallAndReset) {
+  atomic_function<int(int)> f;
+  ASSERT_TRUE(f.valid());
+  EXPECT_FALSE(f);
+  EXPECT_EQ(f.try_invoke(1).error(), ec::empty);
+  EXPECT_EQ(f.try_reset().error(), ec::empty);
+
+  ASSERT_TRUE(f.store([](int x) { return x + 1; }));
+  EXPECT_EQ(f(1), 2);
+  ASSERT_TRUE(f.store([](int x) { return x * 10; }));
+  EXPECT_EQ(*f.try_invoke(3), 30);
+  ASSERT_TRUE(f.store(big{}));
+  EXPECT_EQ(f(1), 1001);
+
+  f.reset();
+  EXPECT_FALSE(f);
+  EXPECT_EQ(f.try_invoke(1).error(), ec::empty);
+
+  // No call in progress: everything retired goes.
+  f.synchronize();
+  EXPECT_EQ(f.retired(), 0u);
+
+  atomic_function<void()> v;
+  int hits = 0;
+  ASSERT_TRUE(v.store([&hits] { ++hits; }));
+  ASSERT_TRUE(v.try_invoke());
+  v();
+  EXPECT_EQ(hits, 2);
+}
+
+// A call that replaces or clears its own slot keeps running intact: its
+// captures stay alive until it returns.
+TEST(AtomicFunctionTest, StoreAndResetFromInsideACall) {
+  atomic_function<std::string(int)> f;
+  std::string tag = "a string long enough to live on the heap, not inline";
+
+  ASSERT_TRUE(f.store([&f, tag](int x) {
+    EXPECT_TRUE(f.store([](int) { return std::string("replaced"); }));
+    if (x == 1) f.reset();
+    f.collect(); // must not free the running callable
+    return tag;
+  }));
+  EXPECT_EQ(f(0), tag);
+  EXPECT_EQ(f(0), "replaced");
+
+  ASSERT_TRUE(f.store([&f, tag](int) {
+    f.reset();
+    f.collect();
+    return tag + "!";
+  }));
+  EXPECT_EQ(f(1), tag + "!");
+  EXPECT_FALSE(f);
+
+  f.synchronize();
+  EXPECT_EQ(f.retired(), 0u);
+}
+
+// A callable replaced while a call is inside it is reclaimed only after that
+// call leaves.
+TEST(AtomicFunctionTest, ReplacedCallableOutlivesItsCalls) {
+  std::atomic<int> live{0};
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+  {
+    atomic_function<int(int)> f({}, {.reader_stripes = 4});
+    ASSERT_TRUE(f.store([p = probe(&live, 1), &entered, &release](int x) {
+      entered.store(true);
+      while (!release.load()) std::this_thread::yield();
+      return p(x);
+    }));
+
+    int result = 0;
+    std::thread reader([&] { result = f(1); });
+    while (!entered.load()) std::this_thread::yield();
+
+    ASSERT_TRUE(f.store(probe(&live, 100)));
+    for (int i = 0; i < 4; ++i) f.collect();
+    EXPECT_EQ(f.retired(), 1u);
+    EXPECT_EQ(live.load(), 2);
+
+    release.store(true);
+    reader.join();
+    EXPECT_EQ(result, 2);
+
+    f.synchronize();
+    EXPECT_EQ(f.retired(), 0u);
+    EXPECT_EQ(live.load(), 1);
+    EXPECT_EQ(f(1), 101);
+  }
+  EXPECT_EQ(live.load(), 0);
+}
+
+// Readers call nonstop while a writer keeps storing; every call must see a
+// whole, live callable. Run under TSan and ASan.
+TEST(AtomicFunctionTest, StoresDuringConcurrentCalls) {
+  constexpr int readers = 4;
+  constexpr int stores = 2000;
+  std::atomic<int> live{0};
+  {
+    atomic_function<int(int)> f({}, {.reader_stripes = 2}); // shared stripes too
+    ASSERT_TRUE(f.store(probe(&live, 0)));
+
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < readers; ++t) {
+      ts.emplace_back([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+          const int r = f(0);
+          if (r < 0 || r > stores) bad.fetch_add(1);
+        }
+      });
+    }
+
+    for (int i = 1; i <= stores; ++i) {
+      ASSERT_TRUE(f.store(probe(&live, i)));
+      if (i % 3 == 0) f.collect();
+    }
+    done.store(true);
+    for (auto& t : ts) t.join();
+
+    EXPECT_EQ(bad.load(), 0);
+    EXPECT_EQ(f(0), stores);
+    f.synchronize();
+    EXPECT_EQ(f.retired(), 0u);
+    EXPECT_EQ(live.load(), 1);
+  }
+  EXPECT_EQ(live.load(), 0);
+}
+
+#if defined(__cpp_exceptions)
+TEST(AtomicFunctionTest, ThrowingCallLeavesTheSlotUsable) {
+  atomic_function<int(int)> f;
+  ASSERT_TRUE(f.store([](int x) -> int {
+    if (x < 0) throw std::runtime_error("negative");
+    return x;
+  }));
+  EXPECT_THROW((void)f(-1), std::runtime_error);
+  EXPECT_THROW((void)f.try_invoke(-1), std::runtime_error);
+  EXPECT_EQ(f(4), 4);
+
+  // The throwing calls left their stripes: the old callable can go.
+  ASSERT_TRUE(f.store([](int x) { return -x; }));
+  f.synchronize();
+  EXPECT_EQ(f.retired(), 0u);
+  EXPECT_EQ(f(4), -4);
+}
+#endif
+
+// A failed store leaves the previous callable in place and leaks nothing.
+TEST(AtomicFunctionTest, FailedStoreKeepsThePreviousCallable) {
+  using slot = atomic_function<int(int), counting_allocator<std::byte>>;
+  allocation_scope scope;
+  {
+    slot f({}, {.reader_stripes = 2});
+    ASSERT_TRUE(f.valid());
+    ASSERT_TRUE(f.store([](int x) { return x + 1; }));
+    const std::size_t bytes = scope.stats().bytes_live;
+
+    scope.fail_at(1); // the node
+    EXPECT_EQ(f.try_store([](int x) { return x; }).error(), ec::alloc_failed);
+    EXPECT_EQ(f(1), 2);
+    EXPECT_EQ(scope.stats().bytes_live, bytes);
+
+    scope.fail_at(2); // the out-of-line callable inside the node
+    EXPECT_EQ(f.try_store(big{}).error(), ec::alloc_failed);
+    EXPECT_EQ(f(1), 2);
+    EXPECT_EQ(scope.stats().bytes_live, bytes);
+    EXPECT_EQ(f.retired(), 0u);
+  }
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+
+  // Stripes that cannot be allocated make an invalid slot that refuses stores.
+  scope.fail_at(1);
+  slot broken;
+  EXPECT_FALSE(broken.valid());
+  EXPECT_EQ(broken.reader_stripes(), 0u);
+  EXPECT_EQ(broken.try_store([](int x) { return x; }).error(), ec::alloc_failed);
+}
@@ -0,0 +1,230 @@
+// File: tests/test_clone_block.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/ICloneable.hpp"
+#include "creational/clone_block.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+// Destructors append the id, so a test can check the destruction order.
+std::vector<int>* destroyed = nullptr;
+int live_parts = 0;
+
+struct part : ICloneable<part> {
+  int id;
+  mutable int throw_after{-1}; // copies left before the copy constructor throws
+
+  explicit part(int i) : id(i) { ++live_parts; }
+  part(const part& o) : ICloneable<part>(o), id(o.id), throw_after(o.throw_after) {
+    if (throw_after == 0) throw std::runtime_error("copy");
+    if (throw_after > 0) --o.throw_after;
+    ++live_parts;
+  }
+  ~part() override {
+    --live_parts;
+    if (destroyed) destroyed->push_back(id);
+  }
+};
+
+// A larger, over-aligned dynamic type.
+struct wide_part : part {
+  alignas(64) std::uint64_t words[4]{1, 2, 3, 4};
+
+  explicit wide_part(int i) : part(i) {}
+  wide_part(const wide_part&) = default;
+
+protected:
+  std::unique_ptr<part, Deleter> do_clone(Alloc alloc) const override {
+    using wide_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<wide_part>;
+    wide_alloc wa(alloc);
+    wide_part* p = std::allocator_traits<wide_alloc>::allocate(wa, 1);
+    std::construct_at(p, *this);
+    return std::unique_ptr<part, Deleter>(p, Deleter(alloc));
+  }
+  clone_layout do_clone_layout() const noexcept override { return {sizeof(wide_part), alignof(wide_part)}; }
+  std::expected<part*, ec> do_clone_into(void* dst) const noexcept override {
+    try {
+      return std::construct_at(static_cast<wide_part*>(dst), *this);
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+  }
+};
+
+// Reports whatever layout it is given; for the overflow and alignment checks,
+// which fail before anything is cloned.
+struct bad_layout {
+  std::size_t size;
+  std::size_t align;
+
+  std::size_t clone_size() const noexcept { return size; }
+  std::size_t clone_align() const noexcept { return align; }
+  std::expected<bad_layout*, ec> clone_into(bytes) const noexcept { return std::unexpected(ec::construction_failed); }
+};
+
+static_assert(placement_cloneable<part>);
+static_assert(placement_cloneable<bad_layout>);
+
+bool aligned(const void* p, std::size_t a) { return reinterpret_cast<std::uintptr_t>(p) % a == 0; }
+
+} // namespace
+
+// One allocation holds the table and every clone, back to back in order.
+TEST(CloneBlockTest, CloneNPacksCopiesInOneAllocation) {
+  allocation_scope scope;
+  const part proto(7);
+  {
+    auto block = try_clone_n(proto, 5, counting_allocator<std::byte>{});
+    ASSERT_TRUE(block);
+    EXPECT_EQ(scope.stats().allocations, 1u);
+    EXPECT_EQ(scope.stats().bytes_live, block->allocated_bytes());
+    ASSERT_EQ(block->size(), 5u);
+    EXPECT_EQ(live_parts, 6);
+
+    const auto* table = reinterpret_cast<const std::byte*>(block->begin());
+    const std::size_t stride = (sizeof(part) + alignof(part) - 1) / alignof(part) * alignof(part);
+    for (std::size_t i = 0; i < block->size(); ++i) {
+      EXPECT_EQ((*block)[i].id, 7);
+      EXPECT_NE(&(*block)[i], &proto);
+      EXPECT_TRUE(aligned(block->objects()[i], alignof(part)));
+      if (i > 0) {
+        EXPECT_EQ(reinterpret_cast<const std::byte*>(block->objects()[i]) -
+                      reinterpret_cast<const std::byte*>(block->objects()[i - 1]),
+                  static_cast<std::ptrdiff_t>(stride));
+      }
+    }
+    // The table sits in front of the first clone.
+    EXPECT_LE(table + 5 * sizeof(part*), reinterpret_cast<const std::byte*>(block->objects()[0]));
+    EXPECT_LT(reinterpret_cast<const std::byte*>(block->objects()[4]) + sizeof(part),
+              table + block->allocated_bytes());
+  }
+  EXPECT_EQ(live_parts, 1);
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+
+  auto empty = try_clone_n(proto, 0, counting_allocator<std::byte>{});
+  ASSERT_TRUE(empty);
+  EXPECT_TRUE(empty->empty());
+  EXPECT_EQ(empty->allocated_bytes(), 0u);
+  EXPECT_EQ(scope.stats().allocations, 1u);
+}
+
+// Heterogeneous prototypes keep their dynamic type and alignment; elements may
+// be prototypes or pointers to them.
+TEST(CloneBlockTest, CloneAllPacksMixedTypes) {
+  const part a(1);
+  const wide_part w(2);
+  const part b(3);
+  {
+    const part* protos[] = {&a, &w, &b, &w};
+    auto block = try_clone_all(protos, std::allocator<std::byte>{});
+    ASSERT_TRUE(block);
+    ASSERT_EQ(block->size(), 4u);
+    for (std::size_t i = 0; i < 4; ++i) EXPECT_EQ((*block)[i].id, protos[i]->id);
+    EXPECT_NE(dynamic_cast<wide_part*>(&(*block)[1]), nullptr);
+    EXPECT_EQ(dynamic_cast<wide_part*>(&(*block)[2]), nullptr);
+    EXPECT_TRUE(aligned(block->objects()[1], 64));
+    EXPECT_TRUE(aligned(block->objects()[3], 64));
+    EXPECT_EQ(dynamic_cast<wide_part&>((*block)[3]).words[3], 4u);
+
+    // Moves hand over the one allocation.
+    const std::size_t bytes = block->allocated_bytes();
+    clone_block<part> moved(std::move(*block));
+    EXPECT_TRUE(block->empty());
+    EXPECT_EQ(moved.allocated_bytes(), bytes);
+    EXPECT_EQ(moved[0].id, 1);
+  }
+  EXPECT_EQ(live_parts, 3);
+
+  const std::vector<part> values(3, part(9));
+  auto block = clone_all(values);
+  ASSERT_EQ(block.size(), 3u);
+  EXPECT_EQ(block[2].id, 9);
+}
+
+TEST(CloneBlockTest, ClonesAreDestroyedInReverseOrder) {
+  std::vector<int> order;
+  const part a(1);
+  const part b(2);
+  const part c(3);
+  {
+    const part* protos[] = {&a, &b, &c};
+    auto block = clone_all(protos);
+    ASSERT_EQ(block.size(), 3u);
+    destroyed = &order;
+  }
+  EXPECT_EQ(order, (std::vector<int>{3, 2, 1}));
+
+  order.clear();
+  auto block = clone_n(b, 2);
+  block.reset();
+  EXPECT_TRUE(block.empty());
+  block.reset(); // no-op
+  EXPECT_EQ(order, (std::vector<int>{2, 2}));
+  destroyed = nullptr;
+}
+
+// A layout whose size or padding overflows, or whose alignment is not a power
+// of two, is rejected before allocating.
+TEST(CloneBlockTest, RejectsLayoutsThatOverflowOrMisalign) {
+  allocation_scope scope;
+  constexpr std::size_t max = std::numeric_limits<std::size_t>::max();
+  const counting_allocator<std::byte> alloc;
+
+  EXPECT_EQ(try_clone_n(bad_layout{8, 3}, 1, alloc).error(), ec::alloc_failed);
+  EXPECT_EQ(try_clone_n(bad_layout{8, 0}, 1, alloc).error(), ec::alloc_failed);
+  EXPECT_EQ(try_clone_n(bad_layout{max - 4, 8}, 1, alloc).error(), ec::alloc_failed);
+  EXPECT_EQ(try_clone_n(bad_layout{max / 2, 8}, 2, alloc).error(), ec::alloc_failed);
+  EXPECT_EQ(try_clone_n(bad_layout{8, std::size_t{1} << 63}, 1, alloc).error(), ec::alloc_failed);
+  EXPECT_EQ(try_clone_n(bad_layout{8, 8}, max / sizeof(void*) + 1, alloc).error(), ec::alloc_failed);
+
+  const bad_layout mixed[] = {{8, 8}, {16, 6}};
+  EXPECT_EQ(try_clone_all(mixed, alloc).error(), ec::alloc_failed);
+
+  EXPECT_EQ(scope.stats().allocations, 0u);
+  EXPECT_EQ(scope.stats().failures, 0u);
+}
+
+// A failed allocation, or a clone that fails part way, leaves nothing
+// constructed and nothing allocated.
+TEST(CloneBlockTest, FailureLeavesNothingConstructed) {
+  allocation_scope scope;
+  const counting_allocator<std::byte> alloc;
+  std::vector<int> order;
+  destroyed = &order;
+  {
+    part proto(4);
+    const int before = live_parts;
+
+    scope.fail_at(1);
+    EXPECT_EQ(try_clone_n(proto, 3, alloc).error(), ec::alloc_failed);
+    EXPECT_EQ(scope.stats().bytes_live, 0u);
+
+    scope.fail_at(1);
+    EXPECT_TRUE(clone_n(proto, 3, alloc).empty());
+
+    // The third copy throws: the two before it are destroyed, last first.
+    proto.throw_after = 2;
+    auto r = try_clone_n(proto, 5, alloc);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error(), ec::construction_failed);
+    EXPECT_EQ(live_parts, before);
+    EXPECT_EQ(order, (std::vector<int>{4, 4}));
+    EXPECT_EQ(scope.stats().bytes_live, 0u);
+    EXPECT_EQ(scope.stats().allocations, 1u);
+  }
+  destroyed = nullptr;
+}
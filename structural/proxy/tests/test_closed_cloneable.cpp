@@ -0,0 +1,243 @@
+// File: tests/test_closed_cloneable.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/closed_cloneable.hpp"
+#include "creational/clone_block.hpp"
+#include "behavioral/visitor.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+struct circle;
+struct label;
+struct wide;
+struct fragile;
+
+// Destructors append the id, so a test can check which dynamic type was
+// destroyed, and in what order.
+std::vector<int>* destroyed = nullptr;
+
+struct shape : closed_cloneable<shape, type_list<circle, label, wide, fragile>, counting_allocator<shape>> {
+  int id{0};
+
+  shape() = default;
+  explicit shape(int i) : id(i) {}
+};
+
+struct circle : closed_leaf<circle, shape> {
+  using closed_leaf::closed_leaf;
+  int r{1};
+  ~circle() { if (destroyed) destroyed->push_back(id); }
+};
+
+// A member that leaks if the wrong destructor runs.
+struct label : closed_leaf<label, shape> {
+  using closed_leaf::closed_leaf;
+  std::string text{"a string long enough to live on the heap, not inline"};
+  ~label() { if (destroyed) destroyed->push_back(-id); }
+};
+
+struct wide : closed_leaf<wide, shape> {
+  using closed_leaf::closed_leaf;
+  alignas(64) std::uint64_t words[8]{};
+};
+
+struct fragile : closed_leaf<fragile, shape> {
+  using closed_leaf::closed_leaf;
+  fragile(const fragile& o) : closed_leaf(o) { throw std::runtime_error("copy"); }
+};
+
+using deleter = shape::AllocDeleter<counting_allocator<shape>>;
+
+static_assert(std::is_same_v<shape::tag_type, std::uint8_t>);
+static_assert(shape::index_of<circle> == 0 && shape::index_of<fragile> == 3);
+static_assert(shape::index_of<shape> == shape::npos);
+static_assert(!std::has_virtual_destructor_v<shape>);
+static_assert(placement_cloneable<shape>);
+
+} // namespace
+
+TEST(ClosedCloneableTest, LeavesStampTheirTag) {
+  const circle c(7);
+  const label l(8);
+  const shape plain(9);
+  EXPECT_EQ(c.type_index(), 0u);
+  EXPECT_EQ(l.type_index(), 1u);
+  EXPECT_EQ(plain.type_index(), shape::npos);
+
+  EXPECT_TRUE(c.holds<circle>());
+  EXPECT_FALSE(c.holds<label>());
+  const shape& s = c;
+  EXPECT_EQ(s.get_if<circle>(), &c);
+  EXPECT_EQ(s.get_if<label>(), nullptr);
+  EXPECT_EQ(plain.get_if<circle>(), nullptr);
+
+  // Copies keep the tag; a leaf built from another leaf's base takes its own.
+  const circle copy(c);
+  EXPECT_TRUE(copy.holds<circle>());
+  const label relabeled(static_cast<const shape&>(c));
+  EXPECT_TRUE(relabeled.holds<label>());
+  EXPECT_EQ(relabeled.id, 7);
+}
+
+// clone() through a Root reference finds the dynamic type in the table, and
+// the deleter destroys and frees exactly that type.
+TEST(ClosedCloneableTest, CloneDispatchesThroughTheTable) {
+  std::vector<int> order;
+  destroyed = &order;
+  allocation_scope scope;
+  {
+    const label l(3);
+    const wide w(4);
+    const shape& ls = l;
+    const shape& ws = w;
+    EXPECT_EQ(ls.clone_size(), sizeof(label));
+    EXPECT_EQ(ws.clone_align(), alignof(wide));
+
+    auto a = ls.clone(counting_allocator<shape>{});
+    ASSERT_TRUE(a);
+    ASSERT_TRUE(a->holds<label>());
+    EXPECT_EQ(a->get_if<label>()->text, l.text);
+    EXPECT_EQ(a->id, 3);
+    EXPECT_EQ(scope.stats().bytes_live, sizeof(label));
+
+    auto b = ws.try_clone();
+    ASSERT_TRUE(b);
+    ASSERT_TRUE((*b)->holds<wide>());
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b->get()) % alignof(wide), 0u);
+    EXPECT_EQ(scope.stats().bytes_live, sizeof(label) + sizeof(wide));
+
+    a.reset();
+    EXPECT_EQ(order, std::vector<int>{-3});
+    b->reset();
+    EXPECT_EQ(scope.stats().bytes_live, 0u);
+  }
+  destroyed = nullptr;
+}
+
+// The deleter converts along with the pointer, from a leaf's allocator to the
+// root's, and still frees the leaf with the leaf's size.
+TEST(ClosedCloneableTest, AllocDeleterDestroysTheDynamicType) {
+  std::vector<int> order;
+  destroyed = &order;
+  allocation_scope scope;
+  {
+    counting_allocator<circle> ca;
+    circle* p = std::allocator_traits<counting_allocator<circle>>::allocate(ca, 1);
+    std::construct_at(p, 5);
+    std::unique_ptr<circle, shape::AllocDeleter<counting_allocator<circle>>> leaf(p);
+    std::unique_ptr<shape, deleter> root(std::move(leaf));
+    EXPECT_EQ(scope.stats().bytes_live, sizeof(circle));
+    root.reset();
+    EXPECT_EQ(order, std::vector<int>{5});
+    EXPECT_EQ(scope.stats().bytes_live, 0u);
+
+    deleter{}(nullptr); // no-op
+  }
+  destroyed = nullptr;
+}
+
+TEST(ClosedCloneableTest, CloneIntoChecksTheBuffer) {
+  const wide w(2);
+  const shape& s = w;
+  alignas(64) std::byte buf[2 * sizeof(wide)];
+
+  EXPECT_EQ(s.clone_into(bytes{buf, sizeof(wide) - 1, 64}).error(), ec::alloc_failed);
+  EXPECT_EQ(s.clone_into(bytes{buf, sizeof(buf), 32}).error(), ec::alloc_failed);
+  EXPECT_EQ(s.clone_into(bytes{buf + 8, sizeof(wide), 64}).error(), ec::alloc_failed);
+  EXPECT_EQ(s.clone_into(bytes{nullptr, sizeof(wide), 64}).error(), ec::alloc_failed);
+
+  auto r = s.clone_into(bytes{buf, sizeof(buf), 64});
+  ASSERT_TRUE(r);
+  EXPECT_EQ(static_cast<void*>(*r), static_cast<void*>(buf));
+  EXPECT_TRUE((*r)->holds<wide>());
+  EXPECT_EQ((*r)->id, 2);
+  shape::destroy_dynamic(*r);
+  shape::destroy_dynamic(nullptr);
+}
+
+// An object that is not a closed_leaf has no table entry: the checked paths
+// refuse it instead of dispatching on npos.
+TEST(ClosedCloneableTest, UntaggedObjectsAreATypeMismatch) {
+  allocation_scope scope;
+  const shape plain(1);
+  alignas(64) std::byte buf[256];
+  EXPECT_EQ(plain.clone_size(), 0u);
+  EXPECT_EQ(plain.clone_align(), 0u);
+  EXPECT_EQ(plain.try_clone().error(), ec::type_mismatch);
+  EXPECT_EQ(plain.try_clone(counting_allocator<shape>{}).error(), ec::type_mismatch);
+  EXPECT_EQ(plain.clone_into(bytes{buf, sizeof(buf), 64}).error(), ec::type_mismatch);
+  EXPECT_EQ(scope.stats().allocations, 0u);
+}
+
+TEST(ClosedCloneableTest, FailuresMapToErrorCodes) {
+  allocation_scope scope;
+  const circle c(1);
+  const fragile f(2);
+  const shape& cs = c;
+  const shape& fs = f;
+
+  scope.fail_at(1);
+  EXPECT_EQ(cs.try_clone().error(), ec::alloc_failed);
+  EXPECT_EQ(fs.try_clone().error(), ec::construction_failed);
+  alignas(64) std::byte buf[sizeof(fragile)];
+  EXPECT_EQ(fs.clone_into(bytes{buf, sizeof(buf), alignof(fragile)}).error(), ec::construction_failed);
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+}
+
+// clone_block destroys closed clones through destroy_dynamic(), last first.
+TEST(ClosedCloneableTest, CloneBlockDestroysThroughTheTable) {
+  std::vector<int> order;
+  destroyed = &order;
+  {
+    const circle c(1);
+    const label l(2);
+    const wide w(3);
+    const shape* protos[] = {&c, &l, &w, &c};
+    auto block = try_clone_all(protos, std::allocator<std::byte>{});
+    ASSERT_TRUE(block);
+    ASSERT_EQ(block->size(), 4u);
+    EXPECT_TRUE((*block)[1].holds<label>());
+    EXPECT_TRUE((*block)[2].holds<wide>());
+  }
+  // The block goes first, then the prototypes.
+  EXPECT_EQ(order, (std::vector<int>{1, -2, 1, -2, 1}));
+  destroyed = nullptr;
+}
+
+// visitor_table dispatches on the tag; with the elements listed out of the
+// hierarchy's order, through its remap.
+TEST(ClosedCloneableTest, VisitorTableDispatchesOnTheTag) {
+  struct namer {
+    std::string operator()(circle& c) const { return "circle " + std::to_string(c.id); }
+    std::string operator()(label& l) const { return l.text; }
+  };
+  using table = visitor_table<std::string, type_list<namer>, type_list<label, circle>>;
+
+  namer n;
+  circle c(4);
+  label l(5);
+  wide w(6);
+  shape bare(7);
+  shape& cs = c;
+  shape& ls = l;
+  shape& ws = w;
+  EXPECT_EQ(*table::try_visit(n, cs), "circle 4");
+  EXPECT_EQ(*table::try_visit(n, ls), l.text);
+  EXPECT_EQ(table::try_visit(n, ws).error(), ec::type_mismatch);
+  EXPECT_EQ(table::try_visit(n, bare).error(), ec::type_mismatch);
+}
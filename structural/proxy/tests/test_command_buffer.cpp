@@ -0,0 +1,159 @@
+// File: tests/test_command_buffer.cpp
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "behavioral/command_buffer.hpp"
+
+using namespace ndof;
+
+namespace {
+
+// Records of 32 bytes (16-byte header, 16-byte capture) ...
+struct small_cmd {
+  std::vector<int>* out;
+  int value;
+  void operator()() const { out->push_back(value); }
+};
+
+// ... and of 48 bytes.
+struct large_cmd {
+  std::vector<int>* out;
+  std::array<int, 6> values;
+  void operator()() const { out->push_back(values[0]); }
+};
+
+static_assert(sizeof(small_cmd) == 16 && sizeof(large_cmd) == 32);
+
+struct counted_cmd {
+  int* alive;
+  explicit counted_cmd(int* a) noexcept : alive(a) { ++*alive; }
+  counted_cmd(const counted_cmd& o) noexcept : alive(o.alive) { ++*alive; }
+  ~counted_cmd() { --*alive; }
+  void operator()() const {}
+};
+
+} // namespace
+
+TEST(CommandBufferTest, ExecutesInOrderAndReportsFull) {
+  command_buffer<> cb(64);
+  ASSERT_TRUE(cb.valid());
+  EXPECT_EQ(cb.capacity(), 64u);
+
+  std::vector<int> out;
+  EXPECT_TRUE(cb.push(small_cmd{&out, 1}));
+  EXPECT_TRUE(cb.push(small_cmd{&out, 2}));
+  EXPECT_EQ(cb.size_bytes(), 64u);
+  auto r = cb.try_push(small_cmd{&out, 3});
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::alloc_failed);
+
+  EXPECT_EQ(cb.execute(1), 1u);
+  EXPECT_TRUE(cb.push(small_cmd{&out, 3}));
+  EXPECT_EQ(cb.execute(), 2u);
+  EXPECT_TRUE(cb.empty());
+  EXPECT_EQ(out, (std::vector<int>{1, 2, 3}));
+}
+
+// A record that does not fit before the end of the ring starts over at offset
+// 0 behind a skip marker; execute() and replay() step over the marker.
+TEST(CommandBufferTest, RecordsWrapBehindASkipMarker) {
+  command_buffer<> cb(128);
+  std::vector<int> out;
+  for (int i = 0; i < 3; ++i) ASSERT_TRUE(cb.push(small_cmd{&out, i}));
+  ASSERT_EQ(cb.execute(), 3u); // head and tail at 96: 32 bytes left before the end
+
+  ASSERT_TRUE(cb.push(large_cmd{&out, {10}}));
+  EXPECT_EQ(cb.size_bytes(), 32u + 48u); // skip marker + record
+  ASSERT_TRUE(cb.push(small_cmd{&out, 11}));
+
+  out.clear();
+  EXPECT_EQ(cb.replay(), 2u);
+  EXPECT_EQ(out, (std::vector<int>{10, 11}));
+  EXPECT_EQ(cb.execute(), 2u);
+  EXPECT_EQ(out, (std::vector<int>{10, 11, 10, 11}));
+  EXPECT_TRUE(cb.empty());
+
+  // The skip marker counts against the room the record needs.
+  command_buffer<> tight(64);
+  ASSERT_TRUE(tight.push(small_cmd{&out, 0}));
+  ASSERT_EQ(tight.execute(), 1u);
+  EXPECT_FALSE(tight.push(large_cmd{&out, {0}}));
+  EXPECT_TRUE(tight.push(small_cmd{&out, 1}));
+}
+
+TEST(CommandBufferTest, ClearAndExecuteDestroyCommands) {
+  int alive = 0;
+  {
+    command_buffer<> cb(256);
+    for (int i = 0; i < 4; ++i) ASSERT_TRUE(cb.push(counted_cmd(&alive)));
+    EXPECT_EQ(alive, 4);
+    EXPECT_EQ(cb.replay(), 4u);
+    EXPECT_EQ(alive, 4);
+    EXPECT_EQ(cb.execute(2), 2u);
+    EXPECT_EQ(alive, 2);
+    cb.clear();
+    EXPECT_EQ(alive, 0);
+    EXPECT_TRUE(cb.empty());
+
+    ASSERT_TRUE(cb.push(counted_cmd(&alive)));
+  }
+  EXPECT_EQ(alive, 0);
+}
+
+#if defined(__cpp_exceptions)
+TEST(CommandBufferTest, ThrowingCommandIsStillConsumed) {
+  command_buffer<> cb(128);
+  std::vector<int> out;
+  ASSERT_TRUE(cb.push([] { throw std::runtime_error("boom"); }));
+  ASSERT_TRUE(cb.push(small_cmd{&out, 1}));
+  EXPECT_THROW(cb.execute(), std::runtime_error);
+  EXPECT_EQ(cb.execute(), 1u);
+  EXPECT_EQ(out, (std::vector<int>{1}));
+}
+#endif
+
+// One producer records through a small ring (so it wraps and fills) while
+// one consumer executes; every command runs once, in order.
+TEST(CommandBufferTest, SpscProducerAndConsumer) {
+  constexpr int n = 20000;
+  command_buffer<std::allocator<std::byte>, command_buffer_mode::spsc> cb(256);
+
+  int expected = 0;
+  bool in_order = true;
+  std::thread consumer([&] {
+    while (expected < n) {
+      if (cb.execute() == 0) std::this_thread::yield();
+    }
+  });
+
+  for (int i = 0; i < n; ++i) {
+    if (i % 3 == 0) {
+      std::array<int, 8> pad{i};
+      while (!cb.push([&expected, &in_order, pad] {
+        in_order = in_order && pad[0] == expected;
+        ++expected;
+      })) {
+        std::this_thread::yield();
+      }
+    } else {
+      while (!cb.push([&expected, &in_order, i] {
+        in_order = in_order && i == expected;
+        ++expected;
+      })) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  consumer.join();
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ(expected, n);
+  EXPECT_TRUE(cb.empty());
+}
@@ -0,0 +1,173 @@
+// File: tests/test_decorate.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "structural/decorator/decorate.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+// Fails the first `failures` calls, then returns its argument doubled.
+struct flaky {
+  int failures = 0;
+  int calls = 0;
+  std::expected<int, ec> operator()(int x) {
+    if (calls++ < failures) return std::unexpected(ec::construction_failed);
+    return 2 * x;
+  }
+};
+
+// Appends its name on the way in and out.
+struct traced {
+  std::vector<std::string>* log;
+  const char* name;
+  template <class Next>
+  int operator()(Next& next, int x) const {
+    log->push_back(std::string(name) + " in");
+    const int r = next(x);
+    log->push_back(std::string(name) + " out");
+    return r;
+  }
+};
+
+struct add_one {
+  template <class Next>
+  decltype(auto) operator()(Next& next, int x) const { return next(x + 1); }
+};
+
+} // namespace
+
+// decorate(f, d1, d2): calls enter d2 first, and argument changes made by an
+// outer layer reach the inner ones.
+TEST(DecorateTest, OuterLayersRunFirst) {
+  std::vector<std::string> log;
+  auto d = decorate([&log](int x) {
+    log.push_back("target " + std::to_string(x));
+    return x;
+  }, traced{&log, "d1"}, add_one{}, traced{&log, "d3"});
+  static_assert(decltype(d)::decorator_count == 3);
+
+  EXPECT_EQ(d(1), 2);
+  EXPECT_EQ(log, (std::vector<std::string>{"d3 in", "d1 in", "target 2", "d1 out", "d3 out"}));
+  EXPECT_STREQ(d.decorator<0>().name, "d1");
+  EXPECT_STREQ(d.decorator<2>().name, "d3");
+}
+
+TEST(DecorateTest, RetryStopsAtTheFirstSuccess) {
+  auto d = decorate(flaky{2}, decorators::retry{3});
+  auto r = d(5);
+  ASSERT_TRUE(r);
+  EXPECT_EQ(*r, 10);
+  EXPECT_EQ(d.target().calls, 3);
+
+  // Succeeds at once from now on: one call each.
+  ASSERT_TRUE(d(1));
+  EXPECT_EQ(d.target().calls, 4);
+}
+
+TEST(DecorateTest, RetryGivesUpWithTheLastError) {
+  auto d = decorate(flaky{10}, decorators::retry{4});
+  EXPECT_EQ(d(5).error(), ec::construction_failed);
+  EXPECT_EQ(d.target().calls, 4);
+
+  // attempts == 0 still makes the one call.
+  auto once = decorate(flaky{10}, decorators::retry{0});
+  EXPECT_FALSE(once(5));
+  EXPECT_EQ(once.target().calls, 1);
+}
+
+// Every attempt sees the same arguments, even ones passed as rvalues.
+TEST(DecorateTest, RetryPassesArgumentsToEveryAttempt) {
+  std::vector<std::string> seen;
+  auto d = decorate([&seen](std::string s) {
+    seen.push_back(std::move(s));
+    return seen.size() == 3;
+  }, decorators::retry{5});
+  EXPECT_TRUE(d(std::string("payload that does not fit the small string buffer")));
+  ASSERT_EQ(seen.size(), 3u);
+  for (const auto& s : seen) EXPECT_EQ(s, "payload that does not fit the small string buffer");
+}
+
+TEST(DecorateTest, TapSeesArgumentsAroundTheCall) {
+  std::vector<std::string> log;
+  auto d = decorate([&log](int x) {
+    log.push_back("target");
+    return x * 3;
+  }, decorators::tap{[&log](const int& x) { log.push_back("before " + std::to_string(x)); },
+                     [&log](const int& x) { log.push_back("after " + std::to_string(x)); }});
+  EXPECT_EQ(d(4), 12);
+  EXPECT_EQ(log, (std::vector<std::string>{"before 4", "target", "after 4"}));
+
+  // A void target.
+  int hits = 0;
+  auto v = decorate([&hits] { ++hits; },
+                    decorators::tap{[&hits] { hits += 10; }, [&hits] { hits += 100; }});
+  v();
+  EXPECT_EQ(hits, 111);
+}
+
+#if defined(__cpp_exceptions)
+TEST(DecorateTest, TapSkipsAfterOnException) {
+  int before = 0;
+  int after = 0;
+  auto d = decorate([](int x) -> int {
+    if (x < 0) throw std::runtime_error("negative");
+    return x;
+  }, decorators::tap{[&before](int) { ++before; }, [&after](int) { ++after; }});
+  EXPECT_THROW((void)d(-1), std::runtime_error);
+  EXPECT_EQ(before, 1);
+  EXPECT_EQ(after, 0);
+  EXPECT_EQ(d(2), 2);
+  EXPECT_EQ(after, 1);
+}
+#endif
+
+// Retry inside tap: tap sees one call however many attempts it took. Retry
+// outside tap: tap sees every attempt.
+TEST(DecorateTest, StackingOrderDecidesWhatTapSees) {
+  int taps = 0;
+  auto tap = decorators::tap{[&taps](int) { ++taps; }, [](int) {}};
+
+  auto inner_retry = decorate(flaky{2}, decorators::retry{3}, tap);
+  ASSERT_TRUE(inner_retry(1));
+  EXPECT_EQ(taps, 1);
+
+  taps = 0;
+  auto outer_retry = decorate(flaky{2}, tap, decorators::retry{3});
+  ASSERT_TRUE(outer_retry(1));
+  EXPECT_EQ(taps, 3);
+}
+
+// The whole stack is one object in one function_with_allocator: stateful
+// layers work through its const call path, and a stack that fits the SBO
+// does not allocate.
+TEST(DecorateTest, EmplacedStackKeepsStateAndFitsTheSbo) {
+  using fn = function_with_allocator<std::expected<int, ec>(int), counting_allocator<std::byte>, 64>;
+  allocation_scope scope;
+  const fn f = [] {
+    fn g;
+    auto p = try_emplace_decorated(g, flaky{1}, decorators::retry{2}, add_one{});
+    EXPECT_TRUE(p);
+    return g;
+  }();
+  auto r = f(1);
+  ASSERT_TRUE(r);
+  EXPECT_EQ(*r, 4);
+  EXPECT_EQ(f(2).value(), 6);
+  EXPECT_EQ(scope.stats().allocations, 0u);
+}
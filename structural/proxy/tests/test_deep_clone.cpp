@@ -0,0 +1,253 @@
+// File: tests/test_deep_clone.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <random>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/ICloneable.hpp"
+#include "creational/deep_clone.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+int live_nodes = 0;
+
+struct node : ICloneable<node> {
+  int id{0};
+  node* a{nullptr};
+  node* b{nullptr};
+  bool throw_on_copy{false};
+
+  node() { ++live_nodes; }
+  explicit node(int i) : id(i) { ++live_nodes; }
+  node(const node& o) : ICloneable<node>(o), id(o.id), a(o.a), b(o.b), throw_on_copy(o.throw_on_copy) {
+    if (throw_on_copy) throw std::runtime_error("copy");
+    ++live_nodes;
+  }
+  ~node() override { --live_nodes; }
+
+  void for_each_ref(ref_visitor<node> v) const noexcept {
+    v(a);
+    v(b);
+  }
+};
+
+// A node with a different dynamic type and size.
+struct heavy : node {
+  std::uint64_t extra[4]{1, 2, 3, 4};
+
+  explicit heavy(int i) : node(i) {}
+  heavy(const heavy&) = default;
+
+protected:
+  std::unique_ptr<node, Deleter> do_clone(Alloc alloc) const override {
+    using traits = std::allocator_traits<Alloc>;
+    using heavy_alloc = typename traits::template rebind_alloc<heavy>;
+    heavy_alloc ha(alloc);
+    heavy* p = std::allocator_traits<heavy_alloc>::allocate(ha, 1);
+    std::construct_at(p, *this);
+    return std::unique_ptr<node, Deleter>(p, Deleter(alloc));
+  }
+  clone_layout do_clone_layout() const noexcept override { return {sizeof(heavy), alignof(heavy)}; }
+  std::expected<node*, ec> do_clone_into(void* dst) const noexcept override {
+    return std::construct_at(static_cast<heavy*>(dst), *this);
+  }
+};
+
+// An edge declared with a derived type cannot be visited: it would be fixed
+// up through a temporary.
+static_assert(std::is_invocable_v<const ref_visitor<node>&, node* const&>);
+static_assert(!std::is_invocable_v<const ref_visitor<node>&, heavy* const&>);
+static_assert(!std::is_invocable_v<const ref_visitor<node>&, node*>);
+
+using nodes = std::vector<std::unique_ptr<node>>;
+
+node* make(nodes& g, int id) {
+  g.push_back(std::make_unique<node>(id));
+  return g.back().get();
+}
+
+// Every edge of every clone points at a clone, and mirrors the source edge.
+void expect_isomorphic(const clone_block<node>& out, std::span<const node* const> sources) {
+  std::set<const node*> clones(out.begin(), out.end());
+  ASSERT_EQ(clones.size(), out.size());
+  for (const node* c : out) {
+    for (const node* e : {c->a, c->b}) {
+      if (e) {
+        EXPECT_TRUE(clones.count(e)) << "edge of " << c->id << " points outside the clone";
+      }
+    }
+  }
+  ASSERT_EQ(out.size(), sources.size());
+  for (std::size_t i = 0; i < sources.size(); ++i) {
+    EXPECT_EQ(out[i].id, sources[i]->id);
+    EXPECT_EQ(out[i].a == nullptr, sources[i]->a == nullptr);
+    EXPECT_EQ(out[i].b == nullptr, sources[i]->b == nullptr);
+    if (out[i].a) {
+      EXPECT_EQ(out[i].a->id, sources[i]->a->id);
+    }
+    if (out[i].b) {
+      EXPECT_EQ(out[i].b->id, sources[i]->b->id);
+    }
+  }
+}
+
+} // namespace
+
+// r -> x, x -> r (cycle), r -> s, x -> s (shared), s -> s (self loop), s.b null.
+TEST(DeepCloneTest, CyclesSharingAndNullEdges) {
+  nodes g;
+  node* r = make(g, 0);
+  node* x = make(g, 1);
+  node* s = make(g, 2);
+  r->a = x;
+  r->b = s;
+  x->a = r;
+  x->b = s;
+  s->a = s;
+
+  {
+    auto out = try_deep_clone(*r, std::allocator<std::byte>{});
+    ASSERT_TRUE(out);
+    ASSERT_EQ(out->size(), 3u); // s cloned once
+    const node* const bfs[] = {r, x, s};
+    expect_isomorphic(*out, bfs);
+
+    node& r2 = (*out)[0];
+    EXPECT_NE(&r2, r);
+    EXPECT_EQ(r2.a->a, &r2);      // the cycle closes on the clone
+    EXPECT_EQ(r2.b, r2.a->b);     // both paths reach the same copy of s
+    EXPECT_EQ(r2.b->a, r2.b);     // self loop
+    EXPECT_EQ(r2.b->b, nullptr);  // null stays null
+    EXPECT_EQ(live_nodes, 6);
+  }
+  EXPECT_EQ(live_nodes, 3);
+}
+
+// Roots come first, in the order given; duplicates and nulls among the roots
+// are skipped.
+TEST(DeepCloneTest, SeveralRoots) {
+  nodes g;
+  node* p = make(g, 10);
+  node* q = make(g, 11);
+  node* t = make(g, 12);
+  p->a = t;
+  q->a = t;
+
+  const node* const roots[] = {q, nullptr, p, q};
+  auto out = try_deep_clone<node>(std::span<const node* const>(roots), std::allocator<std::byte>{});
+  ASSERT_TRUE(out);
+  ASSERT_EQ(out->size(), 3u);
+  EXPECT_EQ((*out)[0].id, 11);
+  EXPECT_EQ((*out)[1].id, 10);
+  EXPECT_EQ((*out)[2].id, 12);
+  EXPECT_EQ((*out)[0].a, (*out)[1].a);
+
+  const node* const none[] = {nullptr};
+  auto empty = try_deep_clone<node>(std::span<const node* const>(none), std::allocator<std::byte>{});
+  ASSERT_TRUE(empty);
+  EXPECT_TRUE(empty->empty());
+}
+
+// Mixed dynamic types keep their type and size in the packed block.
+TEST(DeepCloneTest, ClonesKeepTheirDynamicType) {
+  heavy h(1);
+  node n(2);
+  h.a = &n;
+  n.a = &h;
+
+  auto out = try_deep_clone<node>(h, std::allocator<std::byte>{});
+  ASSERT_TRUE(out);
+  ASSERT_EQ(out->size(), 2u);
+  auto* h2 = dynamic_cast<heavy*>(&(*out)[0]);
+  ASSERT_NE(h2, nullptr);
+  EXPECT_EQ(h2->extra[3], 4u);
+  EXPECT_EQ(dynamic_cast<heavy*>(&(*out)[1]), nullptr);
+  EXPECT_EQ(h2->a->a, h2);
+}
+
+// Thousands of nodes, so the visited map and the queue grow several times.
+TEST(DeepCloneTest, LargeRandomGraph) {
+  nodes g;
+  for (int i = 0; i < 5000; ++i) make(g, i);
+  std::mt19937 rng(7);
+  for (int i = 0; i < 5000; ++i) {
+    if (i + 1 < 5000) g[i]->a = g[i + 1].get();
+    if (rng() % 4) g[i]->b = g[rng() % 5000].get();
+  }
+
+  auto out = try_deep_clone(*g[0], std::allocator<std::byte>{});
+  ASSERT_TRUE(out);
+  ASSERT_EQ(out->size(), 5000u);
+  std::set<const node*> clones(out->begin(), out->end());
+  for (const node* c : *out) {
+    if (c->a) {
+      EXPECT_TRUE(clones.count(c->a));
+      EXPECT_EQ(c->a->id, c->id + 1);
+    }
+    if (c->b) {
+      EXPECT_TRUE(clones.count(c->b));
+      EXPECT_EQ(c->b->id, g[static_cast<std::size_t>(c->id)]->b->id);
+    }
+  }
+}
+
+// Every allocation, scratch or block, may fail: the error is alloc_failed and
+// nothing is left allocated or constructed.
+TEST(DeepCloneTest, AllocationFailureLeavesNothing) {
+  nodes g;
+  for (int i = 0; i < 2000; ++i) make(g, i);
+  for (int i = 0; i + 1 < 2000; ++i) g[i]->a = g[i + 1].get();
+
+  const counting_allocator<std::byte> alloc;
+  const int before = live_nodes;
+  for (std::size_t n = 1;; ++n) {
+    allocation_scope scope;
+    scope.fail_at(n);
+    auto out = try_deep_clone(*g[0], alloc, alloc);
+    if (out) {
+      EXPECT_GT(n, 2u); // scratch, then the block
+      EXPECT_EQ(out->size(), 2000u);
+      break;
+    }
+    EXPECT_EQ(out.error(), ec::alloc_failed) << n;
+    EXPECT_EQ(scope.stats().bytes_live, 0u) << n;
+    EXPECT_EQ(live_nodes, before) << n;
+    ASSERT_LT(n, 100u);
+  }
+
+  allocation_scope scope;
+  scope.fail_at(1);
+  EXPECT_TRUE(deep_clone(*g[0], alloc).empty());
+}
+
+#if defined(__cpp_exceptions)
+TEST(DeepCloneTest, ThrowingCopyDestroysTheClonesMadeSoFar) {
+  nodes g;
+  node* r = make(g, 0);
+  node* x = make(g, 1);
+  node* y = make(g, 2);
+  r->a = x;
+  r->b = y;
+  y->throw_on_copy = true;
+
+  const int before = live_nodes;
+  auto out = try_deep_clone(*r, std::allocator<std::byte>{});
+  ASSERT_FALSE(out);
+  EXPECT_EQ(out.error(), ec::construction_failed);
+  EXPECT_EQ(live_nodes, before);
+}
+#endif
@@ -0,0 +1,184 @@
+// File: tests/test_event_bus.cpp
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "structural/proxy/any_with_allocator.hpp"
+#include "behavioral/event_bus.hpp"
+
+using namespace ndof;
+
+namespace {
+
+using bus_type = event_bus<>;
+
+bus_type::config manual_config() {
+  bus_type::config cfg;
+  cfg.shards = 4;
+  cfg.manual = true;
+  return cfg;
+}
+
+bus_type::config threaded_config(std::size_t dispatchers) {
+  bus_type::config cfg;
+  cfg.dispatchers = dispatchers;
+  cfg.shards = dispatchers;
+  return cfg;
+}
+
+} // namespace
+
+TEST(EventBusTest, DeliversInPublishOrderPerTopic) {
+  bus_type bus(manual_config());
+  ASSERT_TRUE(bus.valid());
+  std::vector<int> seen;
+  auto sub = bus.subscribe<int>(7, [&seen](int v) { seen.push_back(v); });
+  ASSERT_TRUE(sub);
+
+  for (int i = 0; i < 10; ++i) ASSERT_TRUE(bus.publish<int>(7, i));
+  ASSERT_TRUE(bus.publish<double>(7, 1.5)); // other type: skipped
+  bus.wait_idle();
+  ASSERT_EQ(seen.size(), 10u);
+  for (int i = 0; i < 10; ++i) EXPECT_EQ(seen[i], i);
+
+  ASSERT_TRUE(bus.try_unsubscribe(sub));
+  EXPECT_EQ(bus.try_unsubscribe(sub).error(), ec::empty);
+  ASSERT_TRUE(bus.publish<int>(7, 99));
+  bus.wait_idle();
+  EXPECT_EQ(seen.size(), 10u);
+}
+
+TEST(EventBusTest, SubscriberMayUnsubscribeItself) {
+  bus_type bus(manual_config());
+  int calls = 0;
+  bus_type::subscription self;
+  self = bus.subscribe<int>(1, [&](int) {
+    ++calls;
+    bus.unsubscribe(self);
+  });
+  ASSERT_TRUE(self);
+  for (int i = 0; i < 3; ++i) ASSERT_TRUE(bus.publish<int>(1, i));
+  bus.wait_idle();
+  EXPECT_EQ(calls, 1);
+}
+
+// Every subscriber subscribes and unsubscribes on other topics, hence other
+// shards, while two dispatchers drain. Edits to a shard someone else is
+// draining must not wait for it, or the two dispatchers wait on each other.
+TEST(EventBusTest, CrossShardSubscriptionEditsDoNotDeadlock) {
+  constexpr std::uint64_t topics = 16;
+  constexpr int rounds = 200;
+  bus_type bus(threaded_config(2));
+  ASSERT_TRUE(bus.valid());
+
+  std::atomic<int> delivered{0};
+  std::atomic<int> extra{0};
+  for (std::uint64_t t = 0; t < topics; ++t) {
+    auto sub = bus.subscribe<int>(t, [&bus, &delivered, &extra, t](int) {
+      delivered.fetch_add(1, std::memory_order_relaxed);
+      auto s = bus.subscribe<int>((t + 1) % topics, [&extra](int) { extra.fetch_add(1, std::memory_order_relaxed); });
+      bus.unsubscribe(s);
+    });
+    ASSERT_TRUE(sub);
+  }
+
+  {
+    bus_type::publisher pub(bus);
+    for (int r = 0; r < rounds; ++r) {
+      for (std::uint64_t t = 0; t < topics; ++t) {
+        while (!pub.publish<int>(t, r)) std::this_thread::yield();
+      }
+    }
+  }
+  bus.wait_idle();
+  EXPECT_EQ(delivered.load(), static_cast<int>(topics) * rounds);
+}
+
+// Two dispatchers, each inside a subscriber of its own shard, subscribe to the
+// other's shard at the same moment. (Topics 0 and 1 hash to different shards
+// of two.)
+TEST(EventBusTest, DispatchersEditEachOthersShardsAtOnce) {
+  bus_type bus(threaded_config(2));
+  ASSERT_TRUE(bus.valid());
+
+  std::atomic<int> inside{0};
+  std::atomic<int> done{0};
+  std::atomic<int> late{0};
+  auto handler = [&](std::uint64_t other) {
+    return [&, other](int round) {
+      if (round != 0) return;
+      inside.fetch_add(1);
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (inside.load() < 2 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+      auto s = bus.subscribe<int>(other, [&late](int) { late.fetch_add(1); });
+      EXPECT_TRUE(s);
+      done.fetch_add(1);
+    };
+  };
+  ASSERT_TRUE(bus.subscribe<int>(0, handler(1)));
+  ASSERT_TRUE(bus.subscribe<int>(1, handler(0)));
+
+  ASSERT_TRUE(bus.publish<int>(0, 0));
+  ASSERT_TRUE(bus.publish<int>(1, 0));
+  bus.wait_idle();
+  EXPECT_EQ(inside.load(), 2);
+  EXPECT_EQ(done.load(), 2);
+
+  // The new subscriptions are in place for what comes next.
+  ASSERT_TRUE(bus.publish<int>(0, 1));
+  ASSERT_TRUE(bus.publish<int>(1, 1));
+  bus.wait_idle();
+  EXPECT_EQ(late.load(), 2);
+}
+
+// An event stuck in one shard keeps wait_idle() waiting even while other
+// shards deliver events published after the call.
+TEST(EventBusTest, WaitIdleWaitsForEachShard) {
+  bus_type bus(threaded_config(2));
+  ASSERT_TRUE(bus.valid());
+
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  std::atomic<int> others{0};
+  ASSERT_TRUE(bus.subscribe<int>(0, [&](int) {
+    started.store(true);
+    while (!release.load()) std::this_thread::yield();
+  }));
+  for (std::uint64_t t = 1; t <= 8; ++t) {
+    ASSERT_TRUE(bus.subscribe<int>(t, [&](int) { others.fetch_add(1); }));
+  }
+
+  ASSERT_TRUE(bus.publish<int>(0, 0));
+  while (!started.load()) std::this_thread::yield();
+
+  std::atomic<bool> returned{false};
+  std::thread waiter([&] {
+    bus.wait_idle();
+    returned.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // At least one of these topics lives in the shard that is not blocked.
+  for (std::uint64_t t = 1; t <= 8; ++t) ASSERT_TRUE(bus.publish<int>(t, 1));
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (others.load() == 0 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+  ASSERT_GT(others.load(), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(returned.load());
+
+  release.store(true);
+  waiter.join();
+  EXPECT_TRUE(returned.load());
+}
@@ -0,0 +1,133 @@
+// File: tests/test_factory.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/factory.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+// No virtual destructor: the deleter must destroy the dynamic type.
+struct shape {
+  static inline int live = 0;
+  int sides{0};
+};
+
+struct circle : shape {
+  double radius;
+  explicit circle(double r) noexcept : radius(r) { ++live; }
+  ~circle() { --live; }
+};
+
+struct square : shape {
+  double side;
+  char padding[64]{};
+  explicit square(double s) noexcept : side(s) {
+    sides = 4;
+    ++live;
+  }
+  ~square() { --live; }
+};
+
+struct triangle : shape {
+  triangle() noexcept {
+    sides = 3;
+    ++live;
+  }
+  ~triangle() { --live; }
+};
+
+using shapes = factory<shape,
+                       product<"circle", circle>,
+                       product<"square", square>,
+                       product<"triangle", triangle>>;
+
+static_assert(shapes::contains("circle"));
+static_assert(shapes::index_of("square") == shapes::index_for<square>);
+static_assert(shapes::index_of("hexagon") == shapes::npos);
+
+} // namespace
+
+TEST(FactoryTest, PerfectHashFindsEveryKeyAndOnlyThose) {
+  ASSERT_EQ(shapes::size(), 3u);
+  for (std::size_t i = 0; i < shapes::size(); ++i) {
+    EXPECT_EQ(shapes::index_of(shapes::keys()[i]), i);
+  }
+  EXPECT_EQ(shapes::index_for<circle>, shapes::index_of("circle"));
+  EXPECT_EQ(shapes::index_for<triangle>, shapes::index_of("triangle"));
+  EXPECT_EQ(shapes::index_for<shape>, shapes::npos);
+
+  // Near misses: prefixes, extensions, case, the empty key.
+  for (std::string_view k : {"", "c", "circl", "circles", "Circle", "squar", "triangle "}) {
+    EXPECT_FALSE(shapes::contains(k)) << k;
+  }
+}
+
+TEST(FactoryTest, CreateUsesStdAllocatorByDefault) {
+  shape::live = 0;
+  {
+    auto c = shapes::create("circle", 2.0);
+    ASSERT_TRUE(c);
+    EXPECT_EQ(static_cast<circle*>(c.get())->radius, 2.0);
+    auto t = shapes::create("triangle");
+    ASSERT_TRUE(t);
+    EXPECT_EQ(t->sides, 3);
+    EXPECT_EQ(shape::live, 2);
+  }
+  EXPECT_EQ(shape::live, 0);
+}
+
+TEST(FactoryTest, UnknownKeysAndBadArgumentsAreErrors) {
+  counting_allocator<shape> alloc;
+  auto r = shapes::try_create("hexagon", alloc, 1.0);
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::type_mismatch);
+  EXPECT_EQ(shapes::try_create_at(shapes::npos, alloc).error(), ec::type_mismatch);
+
+  // triangle takes no arguments.
+  auto bad = shapes::try_create("triangle", alloc, 1.0);
+  ASSERT_FALSE(bad);
+  EXPECT_EQ(bad.error(), ec::construction_failed);
+
+  EXPECT_FALSE(shapes::create("hexagon"));
+  EXPECT_FALSE(shapes::create(std::allocator_arg, alloc, "hexagon", 1.0));
+}
+
+TEST(FactoryTest, AllocationFailureIsReported) {
+  allocation_scope scope;
+  scope.fail_at(1);
+  auto r = shapes::try_create("square", counting_allocator<shape>{}, 1.0);
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::alloc_failed);
+}
+
+// The deleter destroys and deallocates the dynamic type, with the size of
+// the dynamic type, through the allocator the product came from.
+TEST(FactoryTest, DeleterReleasesTheDynamicType) {
+  shape::live = 0;
+  allocation_scope scope;
+  {
+    auto s = shapes::create(std::allocator_arg, counting_allocator<shape>{}, "square", 3.0);
+    ASSERT_TRUE(s);
+    EXPECT_EQ(s->sides, 4);
+    EXPECT_EQ(s.get_deleter().index, shapes::index_for<square>);
+    EXPECT_EQ(scope.stats().bytes_live, sizeof(square));
+
+    auto c = shapes::try_create("circle", counting_allocator<shape>{}, 1.5);
+    ASSERT_TRUE(c);
+    EXPECT_EQ(scope.stats().bytes_live, sizeof(square) + sizeof(circle));
+    EXPECT_EQ(shape::live, 2);
+  }
+  EXPECT_EQ(shape::live, 0);
+  EXPECT_EQ(scope.stats().allocations, 2u);
+  EXPECT_EQ(scope.stats().deallocations, 2u);
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+}
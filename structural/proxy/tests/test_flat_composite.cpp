@@ -0,0 +1,195 @@
+// File: tests/test_flat_composite.cpp
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "structural/composite/flat_composite.hpp"
+
+using namespace ndof;
+
+namespace {
+
+// Not trivially copyable, so gap moves go through move construction.
+struct payload {
+  int id;
+  std::string name;
+};
+
+// The classic pointer composite, as the oracle.
+struct tree_node {
+  int id;
+  tree_node* parent;
+  std::vector<std::unique_ptr<tree_node>> kids;
+};
+
+struct oracle {
+  std::vector<std::unique_ptr<tree_node>> roots;
+
+  struct row {
+    tree_node* n;
+    std::uint32_t depth;
+    std::uint32_t size;
+    std::uint32_t parent; // preorder index, or npos
+  };
+
+  std::vector<row> preorder() const {
+    std::vector<row> out;
+    auto walk = [&out](auto& self, tree_node* n, std::uint32_t depth, std::uint32_t parent) -> void {
+      const auto at = static_cast<std::uint32_t>(out.size());
+      out.push_back({n, depth, 1, parent});
+      for (auto& k : n->kids) self(self, k.get(), depth + 1, at);
+      out[at].size = static_cast<std::uint32_t>(out.size()) - at;
+    };
+    for (auto& r : roots) walk(walk, r.get(), 0, std::numeric_limits<std::uint32_t>::max());
+    return out;
+  }
+
+  void erase(tree_node* n) {
+    auto& owner = n->parent ? n->parent->kids : roots;
+    for (auto it = owner.begin(); it != owner.end(); ++it) {
+      if (it->get() == n) {
+        owner.erase(it);
+        return;
+      }
+    }
+  }
+
+  // Sum of ids over n's subtree.
+  static std::int64_t subtree_sum(const tree_node* n) {
+    std::int64_t s = n->id;
+    for (auto& k : n->kids) s += subtree_sum(k.get());
+    return s;
+  }
+};
+
+template <class Flat>
+void expect_same_shape(Flat& f, const oracle& o, const char* when) {
+  const auto rows = o.preorder();
+  ASSERT_EQ(f.size(), rows.size()) << when;
+  for (std::uint32_t i = 0; i < rows.size(); ++i) {
+    ASSERT_EQ(f.node(i).id, rows[i].n->id) << when << " at " << i;
+    ASSERT_EQ(f.node(i).name, "n" + std::to_string(rows[i].n->id)) << when;
+    ASSERT_EQ(f.depth(i), rows[i].depth) << when << " at " << i;
+    ASSERT_EQ(f.subtree_size(i), rows[i].size) << when << " at " << i;
+    ASSERT_EQ(f.parent(i), rows[i].parent) << when << " at " << i;
+    ASSERT_EQ(f.first_child(i), rows[i].size > 1 ? i + 1 : Flat::npos) << when;
+
+    // next_sibling: the row right after i's subtree, if it is at i's depth.
+    std::uint32_t sib = Flat::npos;
+    const std::uint32_t after = i + rows[i].size;
+    if (after < rows.size() && rows[after].depth == rows[i].depth) sib = after;
+    ASSERT_EQ(f.next_sibling(i), sib) << when;
+  }
+}
+
+// Random appends, inserts under any node and subtree erases, checked against
+// the pointer tree after every step, with and without compacting.
+template <class Flat, class Add>
+void run_against_oracle(std::uint64_t seed, Add add) {
+  std::mt19937_64 rng(seed);
+  Flat f;
+  oracle o;
+  int next_id = 0;
+
+  for (int step = 0; step < 600; ++step) {
+    const auto rows = o.preorder();
+    const unsigned op = static_cast<unsigned>(rng() % 10);
+    if (rows.empty() || op == 0) {
+      const int id = next_id++;
+      ASSERT_EQ(add(f, Flat::npos, id), rows.size());
+      o.roots.push_back(std::make_unique<tree_node>(tree_node{id, nullptr, {}}));
+    } else if (op < 8) {
+      const auto p = static_cast<std::uint32_t>(rng() % rows.size());
+      const int id = next_id++;
+      ASSERT_EQ(add(f, p, id), p + rows[p].size);
+      tree_node* parent = rows[p].n;
+      parent->kids.push_back(std::make_unique<tree_node>(tree_node{id, parent, {}}));
+    } else {
+      const auto i = static_cast<std::uint32_t>(rng() % rows.size());
+      ASSERT_TRUE(f.erase(i));
+      o.erase(rows[i].n);
+    }
+    if (rng() % 8 == 0) {
+      f.compact();
+      ASSERT_TRUE(f.compacted());
+    }
+    expect_same_shape(f, o, "after edit");
+    if (::testing::Test::HasFatalFailure()) return;
+  }
+  EXPECT_EQ(f.try_erase(f.size()).error(), ec::empty);
+  EXPECT_EQ(add(f, f.size(), -1), Flat::npos);
+}
+
+} // namespace
+
+TEST(FlatCompositeTest, InsertAndEraseMatchPointerTree) {
+  using flat = flat_composite<payload>;
+  for (std::uint64_t seed = 1; seed <= 3; ++seed) {
+    run_against_oracle<flat>(seed, [](flat& f, std::uint32_t parent, int id) {
+      payload p{id, "n" + std::to_string(id)};
+      return parent == flat::npos ? f.append_root(std::move(p)) : f.insert_child(parent, std::move(p));
+    });
+    if (HasFatalFailure()) return;
+  }
+}
+
+TEST(FlatCompositeTest, InsertAndEraseMatchPointerTreeWithHotFields) {
+  using flat = flat_composite<payload, std::int64_t>;
+  for (std::uint64_t seed = 4; seed <= 6; ++seed) {
+    run_against_oracle<flat>(seed, [](flat& f, std::uint32_t parent, int id) {
+      payload p{id, "n" + std::to_string(id)};
+      return parent == flat::npos ? f.append_root(std::move(p), id)
+                                  : f.insert_child(parent, std::move(p), id);
+    });
+    if (HasFatalFailure()) return;
+  }
+}
+
+// Passes over the whole forest and over one subtree agree with recursion on
+// the pointer tree.
+TEST(FlatCompositeTest, PassesMatchPointerTree) {
+  using flat = flat_composite<payload, std::int64_t>;
+  std::mt19937_64 rng(9);
+  flat f;
+  oracle o;
+  for (int id = 0; id < 300; ++id) {
+    const auto rows = o.preorder();
+    if (rows.empty() || rng() % 20 == 0) {
+      ASSERT_NE(f.append_root(payload{id, "n" + std::to_string(id)}, id), flat::npos);
+      o.roots.push_back(std::make_unique<tree_node>(tree_node{id, nullptr, {}}));
+    } else {
+      const auto p = static_cast<std::uint32_t>(rng() % rows.size());
+      ASSERT_NE(f.insert_child(p, payload{id, "n" + std::to_string(id)}, id), flat::npos);
+      rows[p].n->kids.push_back(std::make_unique<tree_node>(tree_node{id, rows[p].n, {}}));
+    }
+  }
+
+  // Bottom-up: every hot value becomes its subtree's sum.
+  f.bottom_up([](std::int64_t& parent, const std::int64_t& child) { parent += child; });
+  const auto rows = o.preorder();
+  for (std::uint32_t i = 0; i < rows.size(); ++i) {
+    ASSERT_EQ(f.hot(i), oracle::subtree_sum(rows[i].n)) << i;
+  }
+
+  // Top-down over one subtree only: depth below its root. The node after the
+  // subtree is left alone.
+  std::uint32_t root = 0;
+  while (f.subtree_size(root) < 10) ++root;
+  const std::uint32_t end = root + f.subtree_size(root);
+  ASSERT_LT(end, f.size());
+  const std::int64_t outside = f.hot(end);
+  f.hot(root) = 0;
+  f.top_down(root, [](const std::int64_t& parent, std::int64_t& child) { child = parent + 1; });
+  for (std::uint32_t i = root + 1; i < end; ++i) {
+    EXPECT_EQ(f.hot(i), static_cast<std::int64_t>(rows[i].depth - rows[root].depth)) << i;
+  }
+  EXPECT_EQ(f.hot(end), outside);
+}
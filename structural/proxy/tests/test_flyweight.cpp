@@ -0,0 +1,186 @@
+// File: tests/test_flyweight.cpp
+
+#include "allocation_budget.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "structural/flyweight/flyweight.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+struct string_hash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+
+using string_table = intern_table<std::string, string_hash, std::equal_to<>>;
+
+// Whether Table looks up and interns K directly.
+template <class Table, class K>
+concept accepts_key = requires(Table& t, const K& k) {
+  t.find(k);
+  t.intern(k);
+};
+
+// Longer than the SSO buffer, so every value owns heap memory.
+std::string key_of(int i) { return "a key long enough to live on the heap #" + std::to_string(i); }
+
+} // namespace
+
+// std::hash<std::uint64_t> is the identity: keys that differ only in their
+// high bits must still spread over shards and slots.
+TEST(FlyweightTest, StridedIntegerKeysInternOnce) {
+  intern_table<std::uint64_t> table(2);
+  std::vector<flyweight<std::uint64_t>> handles;
+  for (std::uint64_t i = 0; i < 4096; ++i) {
+    auto h = table.intern(i << 20);
+    ASSERT_TRUE(h);
+    EXPECT_EQ(*h, i << 20);
+    handles.push_back(h);
+  }
+  EXPECT_EQ(table.size(), 4096u);
+
+  for (std::uint64_t i = 0; i < 4096; ++i) {
+    EXPECT_EQ(table.intern(i << 20), handles[i]);
+    EXPECT_EQ(table.find(i << 20), handles[i]);
+  }
+  EXPECT_FALSE(table.find(std::uint64_t{1}));
+  EXPECT_EQ(table.size(), 4096u);
+}
+
+// Threads intern the same keys in different orders, racing on the same
+// shards while they grow: every thread gets the same handle for a key.
+TEST(FlyweightTest, ConcurrentInternOfOverlappingKeys) {
+  constexpr int threads = 8;
+  constexpr int keys = 3000;
+  string_table table(1);
+  std::vector<std::vector<flyweight<std::string>>> seen(threads, std::vector<flyweight<std::string>>(keys));
+  std::atomic<int> bad{0};
+
+  std::vector<std::thread> ts;
+  for (int t = 0; t < threads; ++t) {
+    ts.emplace_back([&, t] {
+      std::vector<int> order(keys);
+      std::iota(order.begin(), order.end(), 0);
+      std::shuffle(order.begin(), order.end(), std::mt19937(static_cast<unsigned>(t)));
+      for (int k : order) {
+        const std::string key = key_of(k);
+        auto h = table.intern(key);
+        if (!h || *h != key) bad.fetch_add(1);
+        seen[static_cast<std::size_t>(t)][static_cast<std::size_t>(k)] = h;
+        if (table.find(key) != h) bad.fetch_add(1);
+      }
+    });
+  }
+  for (auto& th : ts) th.join();
+
+  EXPECT_EQ(bad.load(), 0);
+  EXPECT_EQ(table.size(), static_cast<std::size_t>(keys));
+  for (int t = 1; t < threads; ++t) EXPECT_EQ(seen[static_cast<std::size_t>(t)], seen[0]) << "thread " << t;
+}
+
+// Growth moves slots, never values: handles taken before a resize stay valid
+// and equal to the handles found after it.
+TEST(FlyweightTest, HandlesSurviveTableGrowth) {
+  string_table table(0); // one shard: every insert lands in the same slot array
+  std::vector<flyweight<std::string>> early;
+  std::vector<const std::string*> addresses;
+  for (int i = 0; i < 20; ++i) {
+    early.push_back(table.intern(key_of(i)));
+    ASSERT_TRUE(early.back());
+    addresses.push_back(&*early.back());
+  }
+  const std::size_t before = table.memory_bytes();
+
+  for (int i = 20; i < 5000; ++i) ASSERT_TRUE(table.intern(key_of(i)));
+  EXPECT_GT(table.memory_bytes(), before);
+  EXPECT_EQ(table.size(), 5000u);
+
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(&*early[static_cast<std::size_t>(i)], addresses[static_cast<std::size_t>(i)]);
+    EXPECT_EQ(*early[static_cast<std::size_t>(i)], key_of(i));
+    EXPECT_EQ(table.find(key_of(i)), early[static_cast<std::size_t>(i)]);
+    EXPECT_EQ(table.intern(key_of(i)), early[static_cast<std::size_t>(i)]);
+  }
+}
+
+// With transparent functors a string_view (or a C string) finds and interns
+// without building a std::string first; otherwise only T is accepted.
+TEST(FlyweightTest, TransparentKeyLookup) {
+  string_table table(2);
+  const std::string_view view = "interned through a view, long enough for the heap";
+  EXPECT_FALSE(table.find(view));
+
+  auto h = table.intern(view);
+  ASSERT_TRUE(h);
+  EXPECT_EQ(*h, view);
+  EXPECT_EQ(table.find(view), h);
+  EXPECT_EQ(table.find(std::string(view)), h);
+  EXPECT_EQ(table.intern(std::string(view)), h);
+  EXPECT_EQ(table.intern(view.data()), h);
+  EXPECT_EQ(table.size(), 1u);
+
+  static_assert(accepts_key<string_table, std::string_view>);
+  static_assert(!accepts_key<intern_table<std::string>, std::string_view>);
+}
+
+// memory_bytes() counts every byte taken from the allocator for values and
+// slot arrays, retired ones included, and nothing else.
+TEST(FlyweightTest, MemoryBytesMatchesTheAllocator) {
+  using table_type = intern_table<std::uint64_t, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>,
+                                  counting_allocator<std::byte>>;
+  allocation_scope scope;
+  {
+    table_type table(1, {}, 4096);
+    const std::size_t shards = scope.stats().bytes_live; // the shard headers only
+    EXPECT_EQ(table.memory_bytes(), 0u);
+
+    ASSERT_TRUE(table.intern(std::uint64_t{1}));
+    EXPECT_EQ(table.memory_bytes(), scope.stats().bytes_live - shards);
+    const std::size_t one = table.memory_bytes();
+    ASSERT_TRUE(table.intern(std::uint64_t{1}));
+    EXPECT_EQ(table.memory_bytes(), one);
+
+    for (std::uint64_t i = 0; i < 10000; ++i) {
+      ASSERT_TRUE(table.intern(i * 7919));
+      if (i % 1000 == 0) {
+        EXPECT_EQ(table.memory_bytes(), scope.stats().bytes_live - shards) << i;
+      }
+    }
+    EXPECT_EQ(table.memory_bytes(), scope.stats().bytes_live - shards);
+
+    // A failed insert takes nothing and adds nothing.
+    const std::size_t size = table.size();
+    const std::size_t bytes = table.memory_bytes();
+    for (std::uint64_t i = 1;; ++i) {
+      scope.fail_at(1);
+      auto r = table.try_intern(~i);
+      if (!r) {
+        EXPECT_EQ(r.error(), ec::alloc_failed);
+        EXPECT_FALSE(table.find(~i));
+        break;
+      }
+      ASSERT_LT(i, 100000u);
+    }
+    scope.fail_at(0);
+    EXPECT_GE(table.size(), size);
+    EXPECT_GE(table.memory_bytes(), bytes);
+    EXPECT_EQ(table.memory_bytes(), scope.stats().bytes_live - shards);
+  }
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+}
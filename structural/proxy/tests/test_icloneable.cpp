@@ -0,0 +1,173 @@
+// File: tests/test_icloneable.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/ICloneable.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+enum class copy_failure { none, bad_alloc, other };
+copy_failure fail_copy = copy_failure::none;
+
+struct widget : ICloneable<widget, counting_allocator<widget>> {
+  std::string name;
+
+  explicit widget(std::string n) : name(std::move(n)) {}
+  widget(const widget& o) : ICloneable(o), name(o.name) {
+    if (fail_copy == copy_failure::bad_alloc) throw std::bad_alloc();
+    if (fail_copy == copy_failure::other) throw std::runtime_error("copy");
+  }
+
+  virtual std::string kind() const { return "widget"; }
+};
+
+// Overrides all three hooks, as every type overriding do_clone() must.
+struct gadget : widget {
+  alignas(64) int power;
+
+  gadget(std::string n, int p) : widget(std::move(n)), power(p) {}
+  gadget(const gadget&) = default;
+
+  std::string kind() const override { return "gadget"; }
+
+protected:
+  std::unique_ptr<widget, Deleter> do_clone(Alloc alloc) const override {
+    using gadget_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<gadget>;
+    using traits       = std::allocator_traits<gadget_alloc>;
+    gadget_alloc ga(alloc);
+    gadget* p = traits::allocate(ga, 1);
+    try {
+      traits::construct(ga, p, *this);
+    } catch (...) {
+      traits::deallocate(ga, p, 1);
+      throw;
+    }
+    return std::unique_ptr<widget, Deleter>(p, Deleter(alloc));
+  }
+  clone_layout do_clone_layout() const noexcept override { return {sizeof(gadget), alignof(gadget)}; }
+  std::expected<widget*, ec> do_clone_into(void* dst) const noexcept override {
+    try {
+      return std::construct_at(static_cast<gadget*>(dst), *this);
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+  }
+};
+
+// Restores fail_copy even when an assertion returns early.
+struct failing_copies {
+  explicit failing_copies(copy_failure f) { fail_copy = f; }
+  ~failing_copies() { fail_copy = copy_failure::none; }
+};
+
+} // namespace
+
+// do_clone() copies the dynamic type, through a base reference, with the
+// given allocator or the stored one.
+TEST(ICloneableTest, CloneCopiesTheDerivedObject) {
+  allocation_scope scope;
+  {
+    const gadget g("g", 9);
+    const widget& w = g;
+
+    auto a = w.clone(counting_allocator<widget>{});
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->kind(), "gadget");
+    EXPECT_EQ(a->name, "g");
+    auto* ag = dynamic_cast<gadget*>(a.get());
+    ASSERT_NE(ag, nullptr);
+    EXPECT_EQ(ag->power, 9);
+    EXPECT_NE(ag, &g);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ag) % alignof(gadget), 0u);
+    EXPECT_EQ(scope.stats().allocations, 1u);
+    EXPECT_EQ(scope.stats().bytes_live, sizeof(gadget));
+
+    auto b = w.try_clone();
+    ASSERT_TRUE(b);
+    EXPECT_EQ((*b)->kind(), "gadget");
+    EXPECT_EQ(scope.stats().allocations, 2u);
+
+    const widget plain("p");
+    const std::size_t before = scope.stats().bytes_live;
+    auto c = plain.clone();
+    EXPECT_EQ(c->kind(), "widget");
+    EXPECT_EQ(c->name, "p");
+    c.reset();
+    EXPECT_EQ(scope.stats().bytes_live, before);
+  }
+  EXPECT_EQ(scope.stats().deallocations, 3u);
+}
+
+TEST(ICloneableTest, CloneSizeAndAlignReportTheDynamicType) {
+  const widget w("w");
+  const gadget g("g", 1);
+  const widget& gw = g;
+  EXPECT_EQ(w.clone_size(), sizeof(widget));
+  EXPECT_EQ(w.clone_align(), alignof(widget));
+  EXPECT_EQ(gw.clone_size(), sizeof(gadget));
+  EXPECT_EQ(gw.clone_align(), alignof(gadget));
+}
+
+// clone_into() checks the buffer against the dynamic type, not the static one.
+TEST(ICloneableTest, CloneIntoRejectsSmallOrMisalignedBuffers) {
+  const gadget g("a name long enough to live on the heap, not inline", 3);
+  const widget& w = g;
+  alignas(64) std::byte buf[2 * sizeof(gadget)];
+
+  EXPECT_EQ(w.clone_into(bytes{buf, sizeof(widget), 64}).error(), ec::alloc_failed);
+  EXPECT_EQ(w.clone_into(bytes{buf, sizeof(gadget) - 1, 64}).error(), ec::alloc_failed);
+  EXPECT_EQ(w.clone_into(bytes{buf, sizeof(buf), alignof(widget)}).error(), ec::alloc_failed);
+  EXPECT_EQ(w.clone_into(bytes{buf + alignof(widget), sizeof(gadget), 64}).error(), ec::alloc_failed);
+  EXPECT_EQ(w.clone_into(bytes{nullptr, sizeof(gadget), 64}).error(), ec::alloc_failed);
+
+  auto r = w.clone_into(bytes{buf, sizeof(gadget), alignof(gadget)});
+  ASSERT_TRUE(r);
+  EXPECT_EQ(static_cast<void*>(*r), static_cast<void*>(buf));
+  EXPECT_EQ((*r)->kind(), "gadget");
+  EXPECT_EQ((*r)->name, g.name);
+  std::destroy_at(*r);
+}
+
+// try_clone() maps bad_alloc, from the allocator or the copy, to
+// alloc_failed and any other exception to construction_failed, leaking
+// nothing. clone_into() has no allocation: every throw is construction_failed.
+TEST(ICloneableTest, FailuresMapToErrorCodes) {
+  allocation_scope scope;
+  const widget w("w");
+  const gadget g("g", 2);
+  const widget& gw = g;
+
+  scope.fail_at(1);
+  EXPECT_EQ(w.try_clone().error(), ec::alloc_failed);
+  scope.fail_at(1);
+  EXPECT_EQ(gw.try_clone(counting_allocator<widget>{}).error(), ec::alloc_failed);
+  {
+    failing_copies guard(copy_failure::bad_alloc);
+    EXPECT_EQ(w.try_clone().error(), ec::alloc_failed);
+    EXPECT_EQ(gw.try_clone().error(), ec::alloc_failed);
+  }
+  {
+    failing_copies guard(copy_failure::other);
+    EXPECT_EQ(w.try_clone().error(), ec::construction_failed);
+    EXPECT_EQ(gw.try_clone().error(), ec::construction_failed);
+    EXPECT_THROW((void)w.clone(), std::runtime_error);
+
+    alignas(64) std::byte buf[sizeof(gadget)];
+    EXPECT_EQ(w.clone_into(bytes{buf, sizeof(buf), 64}).error(), ec::construction_failed);
+    EXPECT_EQ(gw.clone_into(bytes{buf, sizeof(buf), 64}).error(), ec::construction_failed);
+  }
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+}
@@ -0,0 +1,214 @@
+// File: tests/test_memento_store.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "behavioral/memento_store.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+constexpr std::size_t page_bytes = 4096;
+constexpr std::size_t per_page   = page_bytes / sizeof(int);
+
+template <class Arena>
+typename Arena::config arena_config(memento_tracking tracking) {
+  typename Arena::config cfg;
+  cfg.capacity_bytes = 16 * page_bytes;
+  cfg.page_size = page_bytes;
+  cfg.tracking = tracking;
+  return cfg;
+}
+
+// Four pages of ints at the start of the arena: page p holds
+// v[p * per_page, (p + 1) * per_page).
+template <class Arena>
+int* four_pages(Arena& arena) {
+  return static_cast<int*>(arena.allocate(4 * page_bytes, alignof(int)));
+}
+
+template <class Arena>
+void set(Arena& arena, int* v, std::size_t page, int value) {
+  arena.touch(v + page * per_page, page_bytes);
+  for (std::size_t i = 0; i < per_page; ++i) v[page * per_page + i] = value;
+}
+
+bool page_is(const int* v, std::size_t page, int value) {
+  for (std::size_t i = 0; i < per_page; ++i) {
+    if (v[page * per_page + i] != value) return false;
+  }
+  return true;
+}
+
+} // namespace
+
+TEST(MementoStoreTest, RestoresBackwardAndForward) {
+  using arena_type = paged_arena<>;
+  arena_type arena(arena_config<arena_type>(memento_tracking::write_barrier));
+  ASSERT_TRUE(arena.valid());
+  memento_store<> store(arena);
+
+  int* v = four_pages(arena);
+  ASSERT_NE(v, nullptr);
+  for (std::size_t p = 0; p < 4; ++p) set(arena, v, p, 10);
+  const auto s0 = store.snapshot();
+  ASSERT_EQ(s0, 0u);
+  EXPECT_EQ(store.pages_in(s0), 4u);
+
+  set(arena, v, 1, 11);
+  const auto s1 = store.snapshot();
+  EXPECT_EQ(store.pages_in(s1), 1u);
+
+  set(arena, v, 2, 12);
+  int* more = static_cast<int*>(arena.allocate(sizeof(int), alignof(int)));
+  ASSERT_NE(more, nullptr);
+  *more = 42;
+  const auto s2 = store.snapshot();
+  EXPECT_EQ(store.pages_in(s2), 2u);
+  const std::size_t top2 = arena.used_bytes();
+
+  ASSERT_TRUE(store.restore(s0));
+  EXPECT_EQ(store.current(), s0);
+  EXPECT_EQ(arena.used_bytes(), 4 * page_bytes);
+  for (std::size_t p = 0; p < 4; ++p) EXPECT_TRUE(page_is(v, p, 10)) << p;
+  EXPECT_EQ(*more, 0); // not allocated yet in s0
+
+  ASSERT_TRUE(store.restore(s2));
+  EXPECT_EQ(arena.used_bytes(), top2);
+  EXPECT_TRUE(page_is(v, 0, 10));
+  EXPECT_TRUE(page_is(v, 1, 11));
+  EXPECT_TRUE(page_is(v, 2, 12));
+  EXPECT_EQ(*more, 42);
+
+  // Unsnapshotted edits are rolled back too.
+  set(arena, v, 3, 99);
+  ASSERT_TRUE(store.restore(s1));
+  EXPECT_TRUE(page_is(v, 1, 11));
+  EXPECT_TRUE(page_is(v, 2, 10));
+  EXPECT_TRUE(page_is(v, 3, 10));
+
+  EXPECT_EQ(store.try_restore(7).error(), ec::empty);
+  EXPECT_EQ(store.snapshot_count(), 3u);
+}
+
+TEST(MementoStoreTest, SnapshotAfterRestoreDiscardsNewerOnes) {
+  using arena_type = paged_arena<>;
+  arena_type arena(arena_config<arena_type>(memento_tracking::write_barrier));
+  memento_store<> store(arena);
+
+  int* v = four_pages(arena);
+  ASSERT_NE(v, nullptr);
+  for (std::size_t p = 0; p < 4; ++p) set(arena, v, p, 1);
+  ASSERT_EQ(store.snapshot(), 0u);
+  set(arena, v, 0, 2);
+  ASSERT_EQ(store.snapshot(), 1u);
+  set(arena, v, 1, 3);
+  ASSERT_EQ(store.snapshot(), 2u);
+
+  ASSERT_TRUE(store.restore(0));
+  set(arena, v, 2, 4);
+  ASSERT_EQ(store.snapshot(), 1u);
+  EXPECT_EQ(store.snapshot_count(), 2u);
+
+  ASSERT_TRUE(store.restore(0));
+  EXPECT_TRUE(page_is(v, 2, 1));
+  ASSERT_TRUE(store.restore(1));
+  EXPECT_TRUE(page_is(v, 0, 1));
+  EXPECT_TRUE(page_is(v, 1, 1));
+  EXPECT_TRUE(page_is(v, 2, 4));
+}
+
+// A snapshot that fails after a restore to an older one leaves the snapshots
+// after it in place.
+TEST(MementoStoreTest, FailedSnapshotKeepsHistory) {
+  using alloc = counting_allocator<std::byte>;
+  using arena_type = paged_arena<alloc>;
+  arena_type arena(arena_config<arena_type>(memento_tracking::write_barrier));
+  memento_store<alloc> store(arena);
+
+  int* v = four_pages(arena);
+  ASSERT_NE(v, nullptr);
+  for (std::size_t p = 0; p < 4; ++p) set(arena, v, p, 1);
+  ASSERT_EQ(store.snapshot(), 0u);
+  set(arena, v, 0, 2);
+  set(arena, v, 1, 2);
+  ASSERT_EQ(store.snapshot(), 1u);
+  const std::size_t bytes = store.memory_bytes();
+
+  ASSERT_TRUE(store.restore(0));
+  set(arena, v, 2, 3);
+  set(arena, v, 3, 3);
+  {
+    allocation_scope scope;
+    scope.fail_at(3); // the page list, one copy, then the second copy fails
+    auto r = store.try_snapshot();
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error(), ec::alloc_failed);
+    EXPECT_EQ(scope.stats().bytes_live, 0u);
+  }
+  EXPECT_EQ(store.snapshot_count(), 2u);
+  EXPECT_EQ(store.current(), 0u);
+  EXPECT_EQ(store.memory_bytes(), bytes);
+  EXPECT_TRUE(arena.dirty(2));
+  EXPECT_TRUE(arena.dirty(3));
+
+  ASSERT_TRUE(store.restore(1));
+  EXPECT_TRUE(page_is(v, 0, 2));
+  EXPECT_TRUE(page_is(v, 1, 2));
+  EXPECT_TRUE(page_is(v, 2, 1));
+  EXPECT_TRUE(page_is(v, 3, 1));
+}
+
+#if NDOF_MEMENTO_MPROTECT
+
+// Plain writes, no touch(): the first write to a clean page faults once and
+// marks it dirty.
+TEST(MementoStoreTest, MprotectTracksPlainWrites) {
+  using arena_type = paged_arena<>;
+  arena_type arena(arena_config<arena_type>(memento_tracking::mprotect));
+  if (!arena.valid() || arena.page_size() != page_bytes) GTEST_SKIP() << "needs 4 KiB pages";
+  memento_store<> store(arena);
+
+  int* v = four_pages(arena);
+  ASSERT_NE(v, nullptr);
+  for (std::size_t i = 0; i < 4 * per_page; ++i) v[i] = 1;
+  ASSERT_EQ(store.snapshot(), 0u);
+  for (std::size_t p = 0; p < 4; ++p) EXPECT_FALSE(arena.dirty(p));
+
+  v[1 * per_page + 5] = 7;
+  v[3 * per_page] = 8;
+  EXPECT_FALSE(arena.dirty(0));
+  EXPECT_TRUE(arena.dirty(1));
+  EXPECT_FALSE(arena.dirty(2));
+  EXPECT_TRUE(arena.dirty(3));
+
+  ASSERT_EQ(store.snapshot(), 1u);
+  EXPECT_EQ(store.pages_in(1), 2u);
+
+  v[0] = 9; // rolled back below
+  ASSERT_TRUE(store.restore(0));
+  EXPECT_TRUE(page_is(v, 0, 1));
+  EXPECT_TRUE(page_is(v, 1, 1));
+  EXPECT_TRUE(page_is(v, 3, 1));
+
+  // Restored pages are clean and protected again.
+  for (std::size_t p = 0; p < 4; ++p) EXPECT_FALSE(arena.dirty(p));
+  v[2 * per_page] = 5;
+  EXPECT_TRUE(arena.dirty(2));
+
+  ASSERT_TRUE(store.restore(1));
+  EXPECT_EQ(v[1 * per_page + 5], 7);
+  EXPECT_EQ(v[3 * per_page], 8);
+  EXPECT_EQ(v[2 * per_page], 1);
+  EXPECT_EQ(v[0], 1);
+}
+
+#endif // NDOF_MEMENTO_MPROTECT
@@ -0,0 +1,101 @@
+// File: tests/test_object_pool.cpp
+
+#include "allocation_budget.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/object_pool.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+// Counts live instances; the constructor throws while fail_next > 0.
+struct tracked {
+  static inline int live = 0;
+  static inline int fail_next = 0;
+
+  int value{7};
+
+  tracked() {
+    if (fail_next > 0) {
+      --fail_next;
+      throw std::runtime_error("construction failed");
+    }
+    ++live;
+  }
+  ~tracked() { --live; }
+};
+
+using preconstructed_pool = object_pool<tracked, counting_allocator<std::byte>, pool_mode::preconstructed>;
+
+} // namespace
+
+TEST(ObjectPoolTest, TeardownDestroysOnlyConstructedSlots) {
+  tracked::live = 0;
+  {
+    preconstructed_pool pool({.max_objects = 8, .chunk_objects = 4, .magazine_size = 2});
+    ASSERT_TRUE(pool.valid());
+
+    auto a = pool.acquire();
+    tracked::fail_next = 1;
+    auto failed = pool.try_acquire();
+    ASSERT_FALSE(failed);
+    EXPECT_EQ(failed.error(), ec::alloc_failed);
+    EXPECT_EQ(tracked::live, 1);
+
+    // The slot number was handed back: the next acquire constructs into it.
+    auto b = pool.acquire();
+    ASSERT_TRUE(b);
+    EXPECT_EQ(pool.created(), 2u);
+    EXPECT_EQ(tracked::live, 2);
+  }
+  EXPECT_EQ(tracked::live, 0);
+}
+
+TEST(ObjectPoolTest, FailedChunkAllocationGivesTheSlotBack) {
+  tracked::live = 0;
+  {
+    preconstructed_pool pool({.max_objects = 8, .chunk_objects = 2, .magazine_size = 2});
+    ASSERT_TRUE(pool.valid());
+    std::vector<preconstructed_pool::pointer> held;
+    held.push_back(pool.acquire());
+    held.push_back(pool.acquire());
+    ASSERT_TRUE(held[0] && held[1]);
+
+    {
+      allocation_scope scope;
+      scope.fail_at(1); // the second chunk
+      EXPECT_FALSE(pool.acquire());
+      EXPECT_EQ(scope.stats().failures, 1u);
+    }
+    EXPECT_EQ(pool.created(), 2u);
+
+    held.push_back(pool.acquire());
+    ASSERT_TRUE(held.back());
+    EXPECT_EQ(pool.created(), 3u);
+    EXPECT_EQ(tracked::live, 3);
+  }
+  EXPECT_EQ(tracked::live, 0);
+}
+
+TEST(ObjectPoolTest, ExhaustedAcquiresDoNotAdvanceCreated) {
+  object_pool<int> pool({.max_objects = 4, .chunk_objects = 2});
+  std::vector<object_pool<int>::pointer> held;
+  for (int i = 0; i < 4; ++i) held.push_back(pool.acquire(i));
+  for (int i = 0; i < 100; ++i) {
+    auto r = pool.try_acquire(i);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error(), ec::alloc_failed);
+  }
+  EXPECT_EQ(pool.created(), 4u);
+
+  held.pop_back();
+  EXPECT_TRUE(pool.acquire(1));
+  EXPECT_EQ(pool.created(), 4u);
+}
@@ -0,0 +1,165 @@
+// File: tests/test_pipeline.cpp
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <string>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/pipeline.hpp"
+
+using namespace ndof;
+
+namespace {
+
+struct request {
+  int value = 0;
+  bool authorized = true;
+  std::vector<std::string> trace;
+};
+
+} // namespace
+
+TEST(PipelineTest, PlainHandlersRunInOrder) {
+  auto p = make_pipeline<request>(
+      [](request& r) { r.trace.push_back("void"); },
+      [](request& r) -> std::expected<void, ec> {
+        r.trace.push_back("expected");
+        return {};
+      },
+      [](request& r) {
+        r.trace.push_back("bool");
+        return true;
+      },
+      [](request& r) -> std::expected<bool, ec> {
+        r.trace.push_back("expected<bool>");
+        return true;
+      });
+  static_assert(decltype(p)::static_size == 4);
+
+  request r;
+  ASSERT_TRUE(p.run(r));
+  EXPECT_EQ(r.trace, (std::vector<std::string>{"void", "expected", "bool", "expected<bool>"}));
+}
+
+TEST(PipelineTest, FalseStopsSuccessfullyAndErrorsStopWithTheError) {
+  auto p = make_pipeline<request>(
+      [](request& r) { return r.authorized; },
+      [](request& r) -> std::expected<void, ec> {
+        if (r.value < 0) return std::unexpected(ec::type_mismatch);
+        r.trace.push_back("validated");
+        return {};
+      },
+      [](request& r) { r.trace.push_back("handled"); });
+
+  request denied;
+  denied.authorized = false;
+  ASSERT_TRUE(p.try_run(denied));
+  EXPECT_TRUE(denied.trace.empty());
+
+  request bad;
+  bad.value = -1;
+  EXPECT_EQ(p.try_run(bad).error(), ec::type_mismatch);
+  EXPECT_TRUE(bad.trace.empty());
+
+  request ok;
+  ASSERT_TRUE(p.run(ok));
+  EXPECT_EQ(ok.trace, (std::vector<std::string>{"validated", "handled"}));
+}
+
+// Static middleware wraps the rest of the chain, plugins included, and
+// short-circuits it by not calling next.
+TEST(PipelineTest, StaticMiddlewareWrapsAndShortCircuits) {
+  auto p = make_pipeline<request>(
+      [](request& r, auto& next) -> std::expected<void, ec> {
+        r.trace.push_back("before");
+        auto res = next();
+        r.trace.push_back(res ? "after" : "after error");
+        return res;
+      },
+      [](request& r, auto& next) -> std::expected<void, ec> {
+        if (!r.authorized) return std::unexpected(ec::empty);
+        return next();
+      },
+      [](request& r) { r.trace.push_back("handler"); });
+  ASSERT_TRUE(p.push_back([](request& r) { r.trace.push_back("plugin"); }));
+
+  request r;
+  ASSERT_TRUE(p.run(r));
+  EXPECT_EQ(r.trace, (std::vector<std::string>{"before", "handler", "plugin", "after"}));
+
+  request denied;
+  denied.authorized = false;
+  EXPECT_EQ(p.try_run(denied).error(), ec::empty);
+  EXPECT_EQ(denied.trace, (std::vector<std::string>{"before", "after error"}));
+}
+
+// Plugins spill over several chunks and run in insertion order after the
+// static chain; plugin middleware takes next as next_type&.
+TEST(PipelineTest, PluginsRunInOrderAcrossChunks) {
+  using pipe = pipeline<request>;
+  pipe p;
+  for (int i = 0; i < 20; ++i) {
+    if (i == 10) {
+      ASSERT_TRUE(p.push_back([](request& r, pipe::next_type& next) -> std::expected<void, ec> {
+        r.trace.push_back("mw in");
+        auto res = next();
+        r.trace.push_back("mw out");
+        return res;
+      }));
+    }
+    ASSERT_TRUE(p.push_back([i](request& r) { r.trace.push_back(std::to_string(i)); }));
+  }
+  EXPECT_EQ(p.plugin_count(), 21u);
+
+  request r;
+  ASSERT_TRUE(p.run(r));
+  std::vector<std::string> expect;
+  for (int i = 0; i < 20; ++i) {
+    if (i == 10) expect.push_back("mw in");
+    expect.push_back(std::to_string(i));
+  }
+  expect.push_back("mw out");
+  EXPECT_EQ(r.trace, expect);
+
+  p.clear_plugins();
+  EXPECT_EQ(p.plugin_count(), 0u);
+  request empty;
+  ASSERT_TRUE(p.run(empty));
+  EXPECT_TRUE(empty.trace.empty());
+}
+
+TEST(PipelineTest, PluginsShortCircuitAndFail) {
+  using pipe = pipeline<request>;
+  pipe p;
+  ASSERT_TRUE(p.push_back([](request& r, pipe::next_type& next) -> std::expected<void, ec> {
+    if (r.value == 1) return {}; // short-circuit
+    return next();
+  }));
+  ASSERT_TRUE(p.push_back([](request& r) { return r.value != 2; }));
+  ASSERT_TRUE(p.push_back([](request& r) -> std::expected<void, ec> {
+    if (r.value == 3) return std::unexpected(ec::construction_failed);
+    return {};
+  }));
+  ASSERT_TRUE(p.push_back([](request& r) { r.trace.push_back("last"); }));
+
+  for (int v = 0; v <= 3; ++v) {
+    request r;
+    r.value = v;
+    auto res = p.try_run(r);
+    if (v == 3) {
+      ASSERT_FALSE(res);
+      EXPECT_EQ(res.error(), ec::construction_failed);
+    } else {
+      EXPECT_TRUE(res) << v;
+    }
+    EXPECT_EQ(r.trace.size(), v == 0 ? 1u : 0u) << v;
+  }
+}
@@ -0,0 +1,308 @@
+// File: tests/test_prototype_registry.cpp
+
+#include "allocation_budget.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "creational/ICloneable.hpp"
+#include "creational/prototype_registry.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+std::atomic<int> live_shapes{0};
+std::atomic<bool> fail_copies{false};
+
+struct shape : ICloneable<shape> {
+  int id;
+
+  explicit shape(int i) : id(i) { live_shapes.fetch_add(1); }
+  shape(const shape& o) : ICloneable<shape>(o), id(o.id) {
+    if (fail_copies.load()) throw std::runtime_error("copy");
+    live_shapes.fetch_add(1);
+  }
+  ~shape() override { live_shapes.fetch_sub(1); }
+
+  virtual int area() const noexcept { return 0; }
+};
+
+struct padding {
+  std::uint64_t words[3]{7, 7, 7};
+};
+
+// shape is not the first base, so the shape* of a clone is not its slot
+// address: destruction has to recover the most-derived address.
+struct big_shape : padding, shape {
+  alignas(32) int w;
+
+  big_shape(int i, int width) : shape(i), w(width) {}
+  big_shape(const big_shape&) = default;
+
+  int area() const noexcept override { return w * w; }
+
+protected:
+  std::unique_ptr<shape, Deleter> do_clone(Alloc alloc) const override {
+    using big_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<big_shape>;
+    big_alloc ba(alloc);
+    big_shape* p = std::allocator_traits<big_alloc>::allocate(ba, 1);
+    std::construct_at(p, *this);
+    return std::unique_ptr<shape, Deleter>(p, Deleter(alloc));
+  }
+  clone_layout do_clone_layout() const noexcept override { return {sizeof(big_shape), alignof(big_shape)}; }
+  std::expected<shape*, ec> do_clone_into(void* dst) const noexcept override {
+    try {
+      return std::construct_at(static_cast<big_shape*>(dst), *this);
+    } catch (...) {
+      return std::unexpected(ec::construction_failed);
+    }
+  }
+};
+
+using counted_registry = prototype_registry<shape, counting_allocator<std::byte>>;
+using registry         = prototype_registry<shape>;
+
+// Restores fail_copies even when an assertion returns early.
+struct failing_copies {
+  failing_copies() { fail_copies.store(true); }
+  ~failing_copies() { fail_copies.store(false); }
+};
+
+} // namespace
+
+// Each key spawns its own prototype's dynamic type from its own pool.
+TEST(PrototypeRegistryTest, KeysSpawnFromTheirOwnPools) {
+  const int before = live_shapes.load();
+  {
+    registry reg(4, 8);
+    const shape small(1);
+    const big_shape big(2, 3);
+    auto a = reg.try_register(small, 5);
+    auto b = reg.try_register(big);
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(*a, 0u);
+    EXPECT_EQ(*b, 1u);
+    EXPECT_EQ(reg.size(), 2u);
+    EXPECT_EQ(reg.ready(*a), 5u);
+    EXPECT_EQ(reg.ready(*b), 0u);
+
+    auto s = reg.spawn(*a);
+    ASSERT_TRUE(s);
+    EXPECT_EQ(s->id, 1);
+    EXPECT_EQ(s->area(), 0);
+    EXPECT_EQ(reg.ready(*a), 4u);
+
+    // A dry pool refills one batch, then pops.
+    auto t = reg.spawn(*b);
+    ASSERT_TRUE(t);
+    EXPECT_EQ(t->id, 2);
+    EXPECT_EQ(t->area(), 9);
+    EXPECT_NE(dynamic_cast<big_shape*>(t.get()), nullptr);
+    EXPECT_EQ(reg.ready(*b), reg.batch() - 1);
+    EXPECT_EQ(reg.ready(*a), 4u);
+
+    EXPECT_EQ(reg.try_spawn(2).error(), ec::empty);
+    EXPECT_EQ(reg.try_refill(7, 1).error(), ec::empty);
+    EXPECT_EQ(reg.ready(7), 0u);
+    EXPECT_FALSE(reg.spawn(3));
+  }
+  EXPECT_EQ(live_shapes.load(), before);
+}
+
+// Destroying a spawned object puts its slot on the recycle list; refills take
+// recycled slots before carving a new chunk.
+TEST(PrototypeRegistryTest, DestroyedObjectsRecycleTheirSlots) {
+  allocation_scope scope;
+  {
+    counted_registry reg(2, 4);
+    const big_shape proto(1, 2);
+    auto key = reg.try_register(proto, 3); // the first chunk houses the prototype too
+    ASSERT_TRUE(key);
+    const std::size_t chunks = scope.stats().allocations;
+
+    std::set<const void*> first;
+    {
+      std::vector<counted_registry::pointer> objs;
+      for (int i = 0; i < 3; ++i) {
+        objs.push_back(reg.spawn(*key));
+        ASSERT_TRUE(objs.back());
+        first.insert(dynamic_cast<const void*>(objs.back().get()));
+      }
+      EXPECT_EQ(scope.stats().allocations, chunks);
+    }
+
+    // Three slots are back: three refills and spawns need no new chunk.
+    ASSERT_TRUE(reg.try_refill(*key, 3));
+    EXPECT_EQ(scope.stats().allocations, chunks);
+    std::vector<counted_registry::pointer> again;
+    for (int i = 0; i < 3; ++i) {
+      again.push_back(reg.spawn(*key));
+      ASSERT_TRUE(again.back());
+      EXPECT_TRUE(first.count(dynamic_cast<const void*>(again.back().get())));
+      EXPECT_EQ(again.back()->area(), 4);
+    }
+    EXPECT_EQ(scope.stats().allocations, chunks);
+
+    // The next one refills a batch, which needs a second chunk.
+    auto more = reg.spawn(*key);
+    ASSERT_TRUE(more);
+    EXPECT_EQ(scope.stats().allocations, chunks + 1);
+  }
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+}
+
+// A thread_cache takes a batch from the shared pool and gives back what it
+// did not use when it goes.
+TEST(PrototypeRegistryTest, ThreadCacheTakesAndReturnsBatches) {
+  registry reg(1, 4);
+  const shape proto(5);
+  auto key = reg.try_register(proto, 6);
+  ASSERT_TRUE(key);
+  {
+    registry::thread_cache cache(reg);
+    auto a = cache.spawn(*key);
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->id, 5);
+    EXPECT_EQ(reg.ready(*key), 2u); // a batch of 4 moved into the cache
+
+    std::vector<registry::pointer> objs;
+    for (int i = 0; i < 5; ++i) {
+      objs.push_back(cache.spawn(*key));
+      ASSERT_TRUE(objs.back());
+    }
+    EXPECT_EQ(reg.ready(*key), 0u); // the second batch: 2 ready, refilled to 4
+    EXPECT_EQ(cache.try_spawn(1).error(), ec::empty);
+  }
+  EXPECT_EQ(reg.ready(*key), 2u); // the unused clones came back
+}
+
+// Threads spawn through the shared pool and through their own caches, and
+// destroy objects spawned by other threads. Run under TSan and ASan.
+TEST(PrototypeRegistryTest, ConcurrentSpawnAndRecycle) {
+  constexpr int threads = 4;
+  constexpr int rounds = 2000;
+  const int before = live_shapes.load();
+  {
+    registry reg(2, 16);
+    const shape small(1);
+    const big_shape big(2, 2);
+    auto a = reg.try_register(small, 32);
+    auto b = reg.try_register(big);
+    ASSERT_TRUE(a && b);
+
+    // Each thread hands its objects to the next one through a mailbox per key.
+    // The deleters of two seed objects put orphans back into the right pool.
+    registry::pointer seeds[2] = {reg.spawn(*a), reg.spawn(*b)};
+    ASSERT_TRUE(seeds[0] && seeds[1]);
+    std::vector<std::atomic<shape*>> mailbox(2 * threads);
+    for (auto& m : mailbox) m.store(nullptr);
+    std::atomic<int> bad{0};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t) {
+      ts.emplace_back([&, t] {
+        registry::thread_cache cache(reg);
+        for (int i = 0; i < rounds; ++i) {
+          const registry::key_type key = (i + t) % 2 ? *a : *b;
+          auto p = (i % 3 == 0) ? reg.spawn(key) : cache.spawn(key);
+          if (!p || p->id != static_cast<int>(key) + 1) {
+            bad.fetch_add(1);
+            continue;
+          }
+          auto& box = mailbox[static_cast<std::size_t>((t + 1) % threads) * 2 + key];
+          // Destroys what another thread spawned, here.
+          registry::pointer prev(box.exchange(p.release()), p.get_deleter());
+        }
+      });
+    }
+    for (auto& th : ts) th.join();
+    for (std::size_t i = 0; i < mailbox.size(); ++i) {
+      registry::pointer(mailbox[i].exchange(nullptr), seeds[i % 2].get_deleter());
+    }
+    EXPECT_EQ(bad.load(), 0);
+  }
+  EXPECT_EQ(live_shapes.load(), before);
+}
+
+TEST(PrototypeRegistryTest, FailuresLeaveNothingBehind) {
+  allocation_scope scope;
+  const shape proto(1);
+  {
+    counted_registry reg(2, 4);
+    ASSERT_EQ(reg.capacity(), 2u);
+
+    // The first chunk cannot be allocated: nothing is registered.
+    scope.fail_at(1);
+    EXPECT_EQ(reg.try_register(proto).error(), ec::alloc_failed);
+    EXPECT_EQ(reg.size(), 0u);
+
+    // The prewarm needs a second chunk, which fails: the pool goes again.
+    scope.fail_at(2);
+    EXPECT_EQ(reg.try_register(proto, 6).error(), ec::alloc_failed);
+    EXPECT_EQ(reg.size(), 0u);
+
+    {
+      failing_copies guard;
+      EXPECT_EQ(reg.try_register(proto).error(), ec::construction_failed);
+    }
+    EXPECT_EQ(reg.size(), 0u);
+
+    auto key = reg.try_register(proto, 3);
+    ASSERT_TRUE(key);
+
+    // A dry pool that cannot grow, through the registry and through a cache.
+    std::vector<counted_registry::pointer> objs;
+    for (int i = 0; i < 3; ++i) objs.push_back(reg.spawn(*key));
+    scope.fail_at(1);
+    EXPECT_EQ(reg.try_spawn(*key).error(), ec::alloc_failed);
+    {
+      counted_registry::thread_cache cache(reg);
+      scope.fail_at(1);
+      EXPECT_EQ(cache.try_spawn(*key).error(), ec::alloc_failed);
+    }
+
+    // A recycled slot, but the clone throws: the cache reports the refill's
+    // error, not a generic one.
+    objs.pop_back();
+    {
+      failing_copies guard;
+      EXPECT_EQ(reg.try_spawn(*key).error(), ec::construction_failed);
+      counted_registry::thread_cache cache(reg);
+      EXPECT_EQ(cache.try_spawn(*key).error(), ec::construction_failed);
+    }
+
+    // A short refill still hands out what it made.
+    objs.clear();
+    {
+      counted_registry::thread_cache cache(reg);
+      const std::size_t failures = scope.stats().failures;
+      scope.fail_at(1);
+      for (int i = 0; i < 3; ++i) objs.push_back(cache.spawn(*key));
+      for (const auto& o : objs) EXPECT_TRUE(o);
+      EXPECT_EQ(reg.ready(*key), 0u);
+      EXPECT_EQ(scope.stats().failures, failures + 1);
+    }
+    objs.clear();
+
+    const shape other(2);
+    ASSERT_TRUE(reg.try_register(other));
+    EXPECT_EQ(reg.try_register(other).error(), ec::alloc_failed); // full
+  }
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+
+  // The pool table cannot be allocated: no capacity, every register fails.
+  scope.fail_at(1);
+  counted_registry none(4);
+  EXPECT_EQ(none.capacity(), 0u);
+  EXPECT_EQ(none.try_register(proto).error(), ec::alloc_failed);
+}
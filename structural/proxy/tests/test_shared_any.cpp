@@ -0,0 +1,225 @@
+// File: tests/test_shared_any.cpp
+//
+// shared_any over a shared_arena in one memfd region mapped twice, at two
+// different addresses, as two processes would see it.
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "structural/proxy/erasure_common.hpp"
+#include "structural/proxy/offset_storage.hpp"
+#include "structural/proxy/shared_arena.hpp"
+#include "structural/proxy/shared_any.hpp"
+
+using namespace ndof;
+
+namespace {
+
+struct quote {
+  int symbol;
+  double bid;
+  double ask;
+};
+
+// Larger than the default SBO: lives in the arena.
+struct trade {
+  int symbol;
+  double price;
+  long quantity;
+  char venue[64];
+};
+
+using alloc   = shared_arena_allocator<std::byte>;
+using message = shared_any<type_list<quote, trade>, alloc>;
+
+static_assert(sizeof(quote) <= 3 * sizeof(void*));
+static_assert(sizeof(trade) > 3 * sizeof(void*));
+
+constexpr std::size_t region_bytes = 1 << 16;
+
+// One region mapped at two addresses, standing in for two processes.
+class SharedAnyTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+#if defined(__linux__)
+    fd_ = ::memfd_create("ndof_shared_any", 0);
+    ASSERT_GE(fd_, 0);
+    ASSERT_EQ(::ftruncate(fd_, region_bytes), 0);
+    a_ = map();
+    b_ = map();
+    ASSERT_NE(a_, nullptr);
+    ASSERT_NE(b_, nullptr);
+    ASSERT_NE(a_, b_);
+#else
+    GTEST_SKIP() << "needs memfd_create";
+#endif
+  }
+
+  void TearDown() override {
+#if defined(__linux__)
+    if (a_) ::munmap(a_, region_bytes);
+    if (b_) ::munmap(b_, region_bytes);
+    if (fd_ >= 0) ::close(fd_);
+#endif
+  }
+
+  // The same object as seen through the second mapping.
+  template <class T>
+  T* in_b(T* p) const noexcept {
+    return reinterpret_cast<T*>(static_cast<std::byte*>(b_) + (reinterpret_cast<std::byte*>(p) - static_cast<std::byte*>(a_)));
+  }
+
+  static message* make_message(shared_arena& arena) {
+    void* p = arena.allocate(sizeof(message), alignof(message));
+    return p ? std::construct_at(static_cast<message*>(p), alloc(arena)) : nullptr;
+  }
+
+  void* a_{nullptr};
+  void* b_{nullptr};
+
+private:
+#if defined(__linux__)
+  void* map() const noexcept {
+    void* p = ::mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+#endif
+
+  int fd_{-1};
+};
+
+trade make_trade(long quantity) {
+  trade t{7, 101.5, quantity, {}};
+  std::strcpy(t.venue, "XNAS");
+  return t;
+}
+
+} // namespace
+
+TEST_F(SharedAnyTest, CreatedInOneMappingReadAndResetInTheOther) {
+  shared_arena* arena = shared_arena::create(a_, region_bytes);
+  ASSERT_NE(arena, nullptr);
+  message* q = make_message(*arena);
+  message* t = make_message(*arena);
+  ASSERT_TRUE(q && t);
+
+  ASSERT_TRUE(q->try_emplace<quote>(quote{1, 2.0, 3.0}));
+  ASSERT_TRUE(t->try_emplace<trade>(make_trade(300)));
+  const std::size_t used = arena->used();
+
+  shared_arena* other = shared_arena::attach(b_);
+  ASSERT_EQ(other, in_b(arena));
+  message* qb = in_b(q);
+  message* tb = in_b(t);
+
+  EXPECT_EQ(qb->type_index(), message::index_of<quote>);
+  ASSERT_NE(qb->get_if<quote>(), nullptr);
+  EXPECT_EQ(qb->get_if<quote>()->ask, 3.0);
+  EXPECT_EQ(qb->try_get_if<trade>().error(), ec::type_mismatch);
+  // SBO: the object sits inside the message, at its own address in each mapping.
+  EXPECT_EQ(qb->data(), in_b(static_cast<std::byte*>(q->data())));
+
+  const trade* tr = tb->get_if<trade>();
+  ASSERT_NE(tr, nullptr);
+  EXPECT_EQ(tr->quantity, 300);
+  EXPECT_STREQ(tr->venue, "XNAS");
+  EXPECT_EQ(tb->get_allocator().arena(), other);
+
+  // Destroyed from the second mapping: the trade's block goes back to the
+  // arena, and the first mapping sees both messages empty.
+  qb->reset();
+  tb->reset();
+  EXPECT_FALSE(q->has_value());
+  EXPECT_FALSE(t->has_value());
+
+  // Reused from the first mapping: the freed block comes back.
+  ASSERT_TRUE(t->try_emplace<trade>(make_trade(42)));
+  EXPECT_EQ(arena->used(), used);
+  ASSERT_NE(tb->get_if<trade>(), nullptr);
+  EXPECT_EQ(tb->get_if<trade>()->quantity, 42);
+
+  std::destroy_at(q);
+  std::destroy_at(t);
+}
+
+TEST_F(SharedAnyTest, CopyAndMoveStayInTheArena) {
+  shared_arena* arena = shared_arena::create(a_, region_bytes);
+  ASSERT_NE(arena, nullptr);
+  message* src = make_message(*arena);
+  message* dst = make_message(*arena);
+  ASSERT_TRUE(src && dst);
+
+  ASSERT_TRUE(src->try_emplace<trade>(make_trade(5)));
+  ASSERT_TRUE(dst->try_copy_from(*src));
+  ASSERT_NE(dst->get_if<trade>(), nullptr);
+  EXPECT_EQ(dst->get_if<trade>()->quantity, 5);
+  EXPECT_NE(dst->data(), src->data());
+
+  message* moved = make_message(*arena);
+  ASSERT_NE(moved, nullptr);
+  ASSERT_TRUE(moved->try_move_from(std::move(*src)));
+  EXPECT_FALSE(src->has_value());
+  ASSERT_NE(in_b(moved)->get_if<trade>(), nullptr);
+  EXPECT_EQ(in_b(moved)->get_if<trade>()->quantity, 5);
+  EXPECT_EQ(src->try_move_from(std::move(*src)).error(), ec::empty);
+
+  // Value semantics: copy and move assignment between messages in the region.
+  ASSERT_TRUE(src->try_emplace<quote>(quote{2, 1.0, 1.5}));
+  *dst = *src;
+  ASSERT_NE(dst->get_if<quote>(), nullptr);
+  EXPECT_EQ(dst->get_if<quote>()->bid, 1.0);
+  *dst = std::move(*moved);
+  ASSERT_NE(in_b(dst)->get_if<trade>(), nullptr);
+  EXPECT_FALSE(moved->has_value());
+
+  std::destroy_at(src);
+  std::destroy_at(dst);
+  std::destroy_at(moved);
+}
+
+TEST_F(SharedAnyTest, ArenaReusesFreedBlocksBySizeClass) {
+  shared_arena* arena = shared_arena::create(a_, region_bytes);
+  ASSERT_NE(arena, nullptr);
+
+  void* x = arena->allocate(100, 8);
+  void* y = arena->allocate(100, 8);
+  ASSERT_TRUE(x && y);
+  const std::size_t used = arena->used();
+  arena->deallocate(x, 100, 8);
+  arena->deallocate(y, 100, 8);
+
+  // Same class (128 bytes), last freed first; the bump pointer stays put.
+  EXPECT_EQ(arena->allocate(120, 16), y);
+  EXPECT_EQ(in_b(arena)->allocate(128, 8), in_b(x));
+  EXPECT_EQ(arena->used(), used);
+
+  // Another class comes from fresh space.
+  void* z = arena->allocate(200, 8);
+  ASSERT_NE(z, nullptr);
+  EXPECT_GT(arena->used(), used);
+
+  // Exhaustion is an error, not a crash.
+  EXPECT_EQ(arena->try_allocate(region_bytes, 8).error(), ec::alloc_failed);
+}
+
+TEST_F(SharedAnyTest, AttachNeedsAnArena) {
+  EXPECT_EQ(shared_arena::attach(a_), nullptr); // zero-filled: no magic
+  std::memset(a_, 0x5a, 64);
+  EXPECT_EQ(shared_arena::attach(b_), nullptr);
+  EXPECT_EQ(shared_arena::attach(nullptr), nullptr);
+  EXPECT_EQ(shared_arena::attach(static_cast<std::byte*>(a_) + 8), nullptr); // misaligned
+
+  ASSERT_NE(shared_arena::create(a_, region_bytes), nullptr);
+  EXPECT_NE(shared_arena::attach(b_), nullptr);
+  EXPECT_EQ(shared_arena::create(a_, 8), nullptr); // too small for the header
+}
@@ -0,0 +1,85 @@
+// File: tests/test_signal.cpp
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/signal.hpp"
+
+// ndof::signal is spelled out: plain `signal` also finds ::signal from <csignal>.
+using namespace ndof;
+
+template <class Sig>
+using single_threaded_signal = ndof::signal<Sig, std::allocator<std::byte>, signal_mode::single_threaded>;
+
+TEST(SignalTest, SlotsWriteThroughReferenceParameters) {
+  ndof::signal<void(int&)> sig;
+  ASSERT_TRUE(sig.connect([](int& total) { total += 1; }));
+  ASSERT_TRUE(sig.connect([](int& total) { total *= 10; }));
+  int total = 4;
+  sig.emit(total);
+  EXPECT_EQ(total, 50);
+  sig(total);
+  EXPECT_EQ(total, 510);
+}
+
+TEST(SignalTest, ByValueParametersAreCopiedPerSlot) {
+  single_threaded_signal<void(std::string)> sig;
+  std::vector<std::string> seen;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(sig.connect([&seen](std::string s) { seen.push_back(std::move(s)); }));
+  }
+  sig.emit(std::string(64, 'x')); // long enough to leave nothing behind if moved
+  ASSERT_EQ(seen.size(), 3u);
+  for (const auto& s : seen) EXPECT_EQ(s, std::string(64, 'x'));
+}
+
+TEST(SignalTest, MoveOnlyParametersGoToTheSlotsAsRvalues) {
+  single_threaded_signal<void(std::unique_ptr<int>)> sig;
+  int taken = 0;
+  ASSERT_TRUE(sig.connect([&taken](std::unique_ptr<int> p) { taken = p ? *p : -1; }));
+  sig.emit(std::make_unique<int>(7));
+  EXPECT_EQ(taken, 7);
+
+  single_threaded_signal<void(std::unique_ptr<int>&&)> by_ref;
+  std::vector<int> peeked;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(by_ref.connect([&peeked](std::unique_ptr<int>&& p) { peeked.push_back(*p); }));
+  }
+  by_ref(std::make_unique<int>(3)); // neither slot moves from it
+  EXPECT_EQ(peeked, (std::vector<int>{3, 3}));
+}
+
+TEST(SignalTest, NoexceptSignatures) {
+  ndof::signal<void(int&) noexcept> sig;
+  ASSERT_TRUE(sig.connect([](int& x) noexcept { ++x; }));
+  int x = 0;
+  sig.emit(x);
+  EXPECT_EQ(x, 1);
+}
+
+TEST(SignalTest, SlotsMayDisconnectThemselvesDuringEmit) {
+  single_threaded_signal<void(int&)> sig;
+  single_threaded_signal<void(int&)>::connection once;
+  once = sig.connect([&](int& n) {
+    ++n;
+    sig.disconnect(once);
+  });
+  ASSERT_TRUE(sig.connect([](int& n) { n += 10; }));
+  int n = 0;
+  sig.emit(n);
+  sig.emit(n);
+  EXPECT_EQ(n, 21);
+  EXPECT_EQ(sig.size(), 1u);
+  EXPECT_EQ(sig.try_disconnect(once).error(), ec::empty);
+}
@@ -0,0 +1,105 @@
+// File: tests/test_simd_strategy.cpp
+//
+// Every variant of the reference kernels this CPU can run must agree with
+// the scalar one on every tail length: n = 0..63 covers each vector loop
+// with every remainder. Inputs are exact-size vectors, so ASan catches a
+// variant that reads past the end.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+#include "behavioral/simd_kernels.hpp"
+
+using namespace ndof;
+
+namespace {
+
+constexpr simd_level vector_levels[] = {simd_level::sse42, simd_level::avx2, simd_level::avx512};
+
+std::vector<float> make_input(std::size_t n, std::uint32_t seed, bool integral) {
+  std::vector<float> v(n);
+  for (auto& x : v) {
+    seed = seed * 1664525u + 1013904223u;
+    x = integral ? static_cast<float>(static_cast<int>(seed >> 28) - 8)
+                 : static_cast<float>(seed >> 8) / 16777216.0f - 0.5f;
+  }
+  return v;
+}
+
+// Reassociation error bound for adding n terms of magnitude up to mag.
+float tolerance(std::size_t n, float mag) {
+  return 4.0f * static_cast<float>(n + 1) * mag * 1.2e-7f;
+}
+
+} // namespace
+
+TEST(SimdStrategyTest, SumVariantsAgreeWithScalarOnEveryTail) {
+  kernels::sum_strategy s(kernels::sum_variants());
+  ASSERT_TRUE(s.valid());
+  for (simd_level l : vector_levels) {
+    if (!s.available(l)) {
+      EXPECT_FALSE(s.force(l));
+      continue;
+    }
+    ASSERT_TRUE(s.force(l));
+    for (std::size_t n = 0; n < 64; ++n) {
+      // Small integers sum exactly in any order.
+      const auto ints = make_input(n, static_cast<std::uint32_t>(n), true);
+      EXPECT_EQ(s(ints), kernels::detail::sum_scalar(ints)) << to_string(l) << " n=" << n;
+
+      const auto x = make_input(n, static_cast<std::uint32_t>(n) + 100, false);
+      EXPECT_NEAR(s(x), kernels::detail::sum_scalar(x), tolerance(n, 0.5f)) << to_string(l) << " n=" << n;
+    }
+  }
+}
+
+TEST(SimdStrategyTest, DotVariantsAgreeWithScalarOnEveryTail) {
+  kernels::dot_strategy s(kernels::dot_variants());
+  ASSERT_TRUE(s.valid());
+  for (simd_level l : vector_levels) {
+    if (!s.available(l)) continue;
+    ASSERT_TRUE(s.force(l));
+    for (std::size_t n = 0; n < 64; ++n) {
+      const auto a = make_input(n, static_cast<std::uint32_t>(n), true);
+      const auto b = make_input(n, static_cast<std::uint32_t>(n) + 7, true);
+      EXPECT_EQ(s(a, b), kernels::detail::dot_scalar(a, b)) << to_string(l) << " n=" << n;
+
+      const auto c = make_input(n, static_cast<std::uint32_t>(n) + 100, false);
+      const auto d = make_input(n, static_cast<std::uint32_t>(n) + 200, false);
+      EXPECT_NEAR(s(c, d), kernels::detail::dot_scalar(c, d), tolerance(n, 0.25f)) << to_string(l) << " n=" << n;
+
+      // Reads min(a.size(), b.size()).
+      const auto longer = make_input(n + 5, static_cast<std::uint32_t>(n) + 7, true);
+      EXPECT_EQ(s(a, longer), kernels::detail::dot_scalar(a, std::span<const float>(longer).first(n)))
+          << to_string(l) << " n=" << n;
+    }
+  }
+}
+
+TEST(SimdStrategyTest, BindsTheBestAvailableVariant) {
+  kernels::sum_strategy best(kernels::sum_variants());
+  EXPECT_LE(best.level(), cpu_simd_level());
+  EXPECT_TRUE(best.available(best.level()));
+
+  // A CPU capped at sse4.2 never binds or forces anything above it.
+  kernels::sum_strategy capped(kernels::sum_variants(), simd_level::sse42);
+  EXPECT_LE(capped.level(), simd_level::sse42);
+  EXPECT_EQ(capped.try_force(simd_level::avx512).error(),
+            kernels::sum_variants().avx512 ? ec::type_mismatch : ec::empty);
+
+  // Missing variants are skipped over.
+  kernels::sum_strategy sparse({.scalar = &kernels::detail::sum_scalar});
+  EXPECT_EQ(sparse.level(), simd_level::scalar);
+  EXPECT_EQ(sparse.try_force(simd_level::avx2).error(), ec::empty);
+  ASSERT_TRUE(sparse.force(simd_level::scalar));
+
+  kernels::sum_strategy none(kernels::sum_strategy::variants{});
+  EXPECT_FALSE(none.valid());
+}
@@ -0,0 +1,189 @@
+// File: tests/test_state_machine.cpp
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <stdexcept>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/state_machine.hpp"
+
+using namespace ndof;
+
+namespace {
+
+// A door with a lock code.
+struct closed {};
+struct opened {};
+struct locked {};
+struct broken {};
+
+struct push {};
+struct pull {};
+struct lock_ev { int code; };
+struct unlock_ev { int code; };
+struct kick {};
+
+struct door {
+  int code = 0;
+  int opens = 0;
+  int jammed_pulls = 0;
+  bool jam = false;
+  bool fail_lock = false;
+  bool throw_on_kick = false;
+};
+
+struct count_open {
+  void operator()(door& d) const { ++d.opens; }
+};
+
+struct not_jammed {
+  bool operator()(const door& d) const { return !d.jam; }
+};
+
+struct jammed {
+  bool operator()(const door& d) const { return d.jam; }
+};
+
+struct count_jam {
+  void operator()(door& d) const { ++d.jammed_pulls; }
+};
+
+struct remember_code {
+  std::expected<void, ec> operator()(door& d, const lock_ev& e) const {
+    if (d.fail_lock) return std::unexpected(ec::construction_failed);
+    d.code = e.code;
+    return {};
+  }
+};
+
+struct code_matches {
+  bool operator()(const door& d, const unlock_ev& e) const { return d.code == e.code; }
+};
+
+struct maybe_throw {
+  void operator()(door& d) const {
+    if (d.throw_on_kick) throw std::runtime_error("ouch");
+  }
+};
+
+// Two rows for (closed, pull): the first whose guard passes wins.
+using door_table = transition_table<
+    transition<closed, pull, opened, count_open, not_jammed>,
+    transition<closed, pull, closed, count_jam, jammed>,
+    transition<opened, push, closed>,
+    transition<closed, lock_ev, locked, remember_code>,
+    transition<locked, unlock_ev, closed, no_action, code_matches>,
+    transition<closed, kick, broken, maybe_throw>>;
+
+using fixed_door      = state_machine<door, door_table>;
+using extensible_door = state_machine<door, door_table, state_machine_mode::extensible>;
+
+static_assert(fixed_door::state_count == 4 && fixed_door::event_count == 5);
+static_assert(fixed_door::handles<closed, pull> && !fixed_door::handles<opened, pull>);
+
+} // namespace
+
+TEST(StateMachineTest, GuardsPickTheRow) {
+  fixed_door m;
+  EXPECT_TRUE(m.is<closed>());
+
+  ASSERT_TRUE(m.process(pull{}));
+  EXPECT_TRUE(m.is<opened>());
+  EXPECT_EQ(m.context().opens, 1);
+  ASSERT_TRUE(m.process(push{}));
+
+  m.context().jam = true;
+  ASSERT_TRUE(m.process(pull{}));
+  EXPECT_TRUE(m.is<closed>());
+  EXPECT_EQ(m.context().jammed_pulls, 1);
+  EXPECT_EQ(m.context().opens, 1);
+}
+
+TEST(StateMachineTest, RejectedOrUnhandledEventsLeaveTheState) {
+  fixed_door m;
+  EXPECT_EQ(m.try_process(push{}).error(), ec::empty); // no row out of closed
+
+  ASSERT_TRUE(m.process(lock_ev{42}));
+  EXPECT_TRUE(m.is<locked>());
+  EXPECT_EQ(m.try_process(unlock_ev{7}).error(), ec::empty); // guard rejects
+  EXPECT_TRUE(m.is<locked>());
+  ASSERT_TRUE(m.process(unlock_ev{42}));
+  EXPECT_TRUE(m.is<closed>());
+}
+
+TEST(StateMachineTest, FailingActionLeavesTheState) {
+  fixed_door m;
+  m.context().fail_lock = true;
+  EXPECT_EQ(m.try_process(lock_ev{1}).error(), ec::construction_failed);
+  EXPECT_TRUE(m.is<closed>());
+
+#if defined(__cpp_exceptions)
+  m.context().throw_on_kick = true;
+  EXPECT_THROW((void)m.try_process(kick{}), std::runtime_error);
+  EXPECT_TRUE(m.is<closed>());
+#endif
+
+  m.context().throw_on_kick = false;
+  ASSERT_TRUE(m.process(kick{}));
+  EXPECT_TRUE(m.is<broken>());
+  m.reset();
+  EXPECT_TRUE(m.is<closed>());
+}
+
+// Runtime transitions run only when the table does not handle the event,
+// whether because it has no row or because every guard rejected it.
+TEST(StateMachineTest, RuntimeTransitionsAreTheFallback) {
+  extensible_door m;
+  int runtime_calls = 0;
+
+  ASSERT_TRUE((m.add<closed, pull, broken>([&](door&) { ++runtime_calls; })));
+  ASSERT_TRUE(m.process(pull{})); // the table row wins
+  EXPECT_TRUE(m.is<opened>());
+  EXPECT_EQ(runtime_calls, 0);
+
+  ASSERT_TRUE((m.add<opened, pull, closed>([&] { ++runtime_calls; }))); // no table row
+  ASSERT_TRUE(m.process(pull{}));
+  EXPECT_TRUE(m.is<closed>());
+  EXPECT_EQ(runtime_calls, 1);
+
+  // (locked, unlock_ev) exists but its guard rejects a wrong code.
+  ASSERT_TRUE(m.process(lock_ev{5}));
+  ASSERT_TRUE((m.add<locked, unlock_ev, broken>([&](door&, const unlock_ev& e) {
+    ++runtime_calls;
+    return e.code < 0; // bool: false means not handled
+  })));
+  EXPECT_EQ(m.try_process(unlock_ev{3}).error(), ec::empty);
+  EXPECT_TRUE(m.is<locked>());
+  ASSERT_TRUE(m.process(unlock_ev{-1}));
+  EXPECT_TRUE(m.is<broken>());
+  EXPECT_EQ(runtime_calls, 3);
+}
+
+TEST(StateMachineTest, RuntimeTransitionsReplaceAndRemove) {
+  extensible_door m;
+  EXPECT_EQ((m.try_remove<opened, pull>().error()), ec::empty);
+
+  ASSERT_TRUE(m.process(pull{}));
+  ASSERT_TRUE((m.add<opened, pull, locked>([]() -> std::expected<void, ec> {
+    return std::unexpected(ec::type_mismatch);
+  })));
+  EXPECT_EQ(m.try_process(pull{}).error(), ec::type_mismatch);
+  EXPECT_TRUE(m.is<opened>());
+
+  ASSERT_TRUE((m.add<opened, pull, locked>([] {})));
+  ASSERT_TRUE(m.process(pull{}));
+  EXPECT_TRUE(m.is<locked>());
+
+  m.reset();
+  ASSERT_TRUE(m.process(pull{}));
+  ASSERT_TRUE((m.try_remove<opened, pull>()));
+  EXPECT_EQ(m.try_process(pull{}).error(), ec::empty);
+  EXPECT_EQ((m.try_remove<opened, pull>().error()), ec::empty);
+}
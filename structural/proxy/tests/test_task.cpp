@@ -0,0 +1,244 @@
+// File: tests/test_task.cpp
+
+#include "allocation_budget.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/task.hpp"
+
+using namespace ndof;
+using ndof::test::allocation_scope;
+using ndof::test::counting_allocator;
+
+namespace {
+
+using counted_task = task<int, counting_allocator<std::byte>>;
+using pmr_alloc    = std::pmr::polymorphic_allocator<std::byte>;
+
+// Counts blocks in and out from any thread; the destructor checks that every
+// frame was returned before the resource went away.
+class tracking_resource : public std::pmr::memory_resource {
+public:
+  ~tracking_resource() override { EXPECT_EQ(live_.load(), 0) << "frame outlived its resource"; }
+
+  int live() const noexcept { return live_.load(); }
+  int total() const noexcept { return total_.load(); }
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t align) override {
+    live_.fetch_add(1);
+    total_.fetch_add(1);
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    live_.fetch_sub(1);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+
+  std::atomic<int> live_{0};
+  std::atomic<int> total_{0};
+};
+
+counted_task add_one(int x) { co_return x + 1; }
+
+counted_task sum_of_children(int n) {
+  int s = 0;
+  for (int i = 0; i < n; ++i) s += *co_await add_one(i);
+  co_return s;
+}
+
+task<int, pmr_alloc> pmr_child(std::allocator_arg_t, pmr_alloc, int x) { co_return x * 2; }
+
+task<int, pmr_alloc> pmr_parent(std::allocator_arg_t, pmr_alloc a) {
+  auto r = co_await pmr_child(std::allocator_arg, a, 20);
+  co_return *r + 2;
+}
+
+task<std::string> plain_value() { co_return std::string("value"); }
+
+task<std::string> plain_expected(bool ok) {
+  if (!ok) co_return std::expected<std::string, ec>(std::unexpect, ec::type_mismatch);
+  co_return std::expected<std::string, ec>("expected");
+}
+
+task<std::string> plain_unexpected() { co_return std::unexpected(ec::not_copyable); }
+
+task<> nothing() { co_return; }
+
+task<int> chain(int depth) {
+  if (depth == 0) co_return 0;
+  co_return *co_await chain(depth - 1) + 1;
+}
+
+// Suspends and resumes the awaiting coroutine on a new thread. The frame, and
+// this awaiter in it, may be gone as soon as that thread starts.
+struct resume_elsewhere {
+  std::thread* t;
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) {
+    std::thread* out = t;
+    *out = std::thread([h] { h.resume(); });
+  }
+  void await_resume() const noexcept {}
+};
+
+task<int, pmr_alloc> hop(std::allocator_arg_t, pmr_alloc a, std::thread* t, int x) {
+  co_await resume_elsewhere{t};
+  co_return *co_await pmr_child(std::allocator_arg, a, x);
+}
+
+#if defined(__cpp_exceptions)
+task<int> throws() {
+  throw std::runtime_error("body");
+  co_return 0;
+}
+
+task<std::string> catches() {
+  try {
+    (void)co_await throws();
+  } catch (const std::runtime_error& e) {
+    co_return std::string("caught ") + e.what();
+  }
+  co_return std::string("not thrown");
+}
+#endif
+
+} // namespace
+
+TEST(TaskTest, FramesComeFromTheGivenAllocator) {
+  allocation_scope scope;
+  auto r = sync_wait(sum_of_children(5));
+  ASSERT_TRUE(r);
+  EXPECT_EQ(*r, 15);
+  EXPECT_EQ(scope.stats().allocations, 6u); // the parent and five children
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+  EXPECT_EQ(scope.stats().global_allocations, 0u);
+
+  tracking_resource res;
+  auto p = sync_wait(pmr_parent(std::allocator_arg, &res));
+  ASSERT_TRUE(p);
+  EXPECT_EQ(*p, 42);
+  EXPECT_EQ(res.total(), 2);
+  EXPECT_EQ(res.live(), 0);
+}
+
+TEST(TaskTest, AllocationFailureReportsAllocFailed) {
+  allocation_scope scope;
+  {
+    scope.fail_at(1);
+    counted_task t = add_one(1);
+    EXPECT_FALSE(t.valid());
+    EXPECT_TRUE(t.done());
+    EXPECT_EQ(sync_wait(std::move(t)).error(), ec::alloc_failed);
+  }
+  {
+    scope.fail_at(1);
+    counted_task t = add_one(1);
+    bool called = false;
+    EXPECT_EQ(t.try_start([&called](std::expected<int, ec>&&) noexcept { called = true; }).error(),
+              ec::alloc_failed);
+    EXPECT_FALSE(called);
+  }
+
+  // A child that cannot be allocated is an error at its co_await.
+  scope.fail_at(3); // the parent, the first child, then the second child
+  auto r = sync_wait([]() -> counted_task {
+    auto a = co_await add_one(1);
+    auto b = co_await add_one(2);
+    co_return b ? *a + *b : -static_cast<int>(b.error());
+  }());
+  ASSERT_TRUE(r);
+  EXPECT_EQ(*r, -static_cast<int>(ec::alloc_failed));
+  EXPECT_EQ(scope.stats().bytes_live, 0u);
+
+  EXPECT_EQ(sync_wait(counted_task{}).error(), ec::empty);
+}
+
+TEST(TaskTest, CoReturnValueExpectedOrUnexpected) {
+  EXPECT_EQ(sync_wait(plain_value()).value(), "value");
+  EXPECT_EQ(sync_wait(plain_expected(true)).value(), "expected");
+  EXPECT_EQ(sync_wait(plain_expected(false)).error(), ec::type_mismatch);
+  EXPECT_EQ(sync_wait(plain_unexpected()).error(), ec::not_copyable);
+  EXPECT_TRUE(sync_wait(nothing()));
+}
+
+#if defined(__cpp_exceptions)
+TEST(TaskTest, ExceptionsRethrowAtCoAwait) {
+  EXPECT_EQ(sync_wait(catches()).value(), "caught body");
+}
+#endif
+
+// Awaits nest deep, both going down (starting each child) and coming back
+// (resuming each parent), through symmetric transfer. That is a tail call only
+// in optimized builds without ASan or TSan; elsewhere each level takes stack,
+// and the chain is kept shallow.
+TEST(TaskTest, DeepAwaitChainDoesNotGrowTheStack) {
+#if defined(__OPTIMIZE__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+  constexpr int depth = 200000;
+#else
+  constexpr int depth = 1000;
+#endif
+  auto r = sync_wait(chain(depth));
+  ASSERT_TRUE(r);
+  EXPECT_EQ(*r, depth);
+}
+
+// The task finishes on another thread: on_done runs there, after the frames
+// are back in the resource, so the resource may go as soon as it is called.
+TEST(TaskTest, TryStartCompletesOnAnotherThread) {
+  std::thread t;
+  std::atomic<bool> done{false};
+  std::optional<std::expected<int, ec>> out;
+  std::thread::id ran_on;
+  {
+    auto res = std::make_unique<tracking_resource>();
+    tracking_resource* rp = res.get();
+    auto task = hop(std::allocator_arg, rp, &t, 5);
+    ASSERT_TRUE(task.try_start([&, rp](std::expected<int, ec>&& r) noexcept {
+      EXPECT_EQ(rp->live(), 0);
+      out.emplace(std::move(r));
+      ran_on = std::this_thread::get_id();
+      done.store(true);
+    }));
+    EXPECT_FALSE(task.valid()); // detached
+    t.join();
+    ASSERT_TRUE(done.load());
+    EXPECT_EQ(rp->total(), 3); // two frames, and on_done too big for the SBO
+  }
+  ASSERT_TRUE(out && *out);
+  EXPECT_EQ(**out, 10);
+  EXPECT_NE(ran_on, std::this_thread::get_id());
+}
+
+// sync_wait returns only after the frame is freed, even when another thread
+// completes it: destroying the resource right away is fine. Run under TSan.
+TEST(TaskTest, SyncWaitAcrossThreadsFreesTheFrameFirst) {
+  for (int i = 0; i < 200; ++i) {
+    std::thread t;
+    {
+      tracking_resource res;
+      auto r = sync_wait(hop(std::allocator_arg, &res, &t, i));
+      ASSERT_TRUE(r);
+      EXPECT_EQ(*r, 2 * i);
+      EXPECT_EQ(res.live(), 0);
+    }
+    t.join();
+  }
+}
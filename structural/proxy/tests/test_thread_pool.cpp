@@ -0,0 +1,158 @@
+// File: tests/test_thread_pool.cpp
+
+#include "allocation_budget.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/thread_pool.hpp"
+
+using namespace ndof;
+using ndof::test::counting_allocator;
+
+namespace {
+
+using pool_type = thread_pool<>;
+
+pool_type::config small_rings(std::size_t threads) {
+  pool_type::config cfg;
+  cfg.threads = threads;
+  cfg.deque_capacity = 8;   // overflows into the injection ring
+  cfg.inject_capacity = 16; // and makes outside submitters retry
+  return cfg;
+}
+
+} // namespace
+
+// Several outside threads submit into small rings while every task fans out
+// into children on its worker's deque, which idle workers steal.
+TEST(ThreadPoolTest, SubmitAndStealUnderContention) {
+  constexpr int submitters = 4;
+  constexpr int per_submitter = 500;
+  constexpr int children = 4;
+
+  pool_type pool(small_rings(4));
+  ASSERT_TRUE(pool.valid());
+  std::atomic<int> parents{0};
+  std::atomic<int> kids{0};
+  {
+    pool_type::task_group group(pool);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < submitters; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < per_submitter; ++i) {
+          auto parent = [&] {
+            parents.fetch_add(1, std::memory_order_relaxed);
+            for (int c = 0; c < children; ++c) {
+              auto child = [&kids] { kids.fetch_add(1, std::memory_order_relaxed); };
+              // A full ring runs the child here.
+              if (!pool.try_submit(group, child)) child();
+            }
+          };
+          while (!pool.try_submit(group, parent)) std::this_thread::yield();
+        }
+      });
+    }
+    for (auto& th : threads) th.join();
+    ASSERT_TRUE(group.wait());
+  }
+  EXPECT_EQ(parents.load(), submitters * per_submitter);
+  EXPECT_EQ(kids.load(), submitters * per_submitter * children);
+}
+
+TEST(ThreadPoolTest, TaskGroupReportsTheFirstError) {
+  pool_type pool(small_rings(2));
+  pool_type::task_group group(pool);
+  std::atomic<int> ran{0};
+  for (int i = 0; i < 32; ++i) {
+    auto task = [&ran, i]() -> std::expected<void, ec> {
+      ran.fetch_add(1, std::memory_order_relaxed);
+      if (i == 5) return std::unexpected(ec::construction_failed);
+      return {};
+    };
+    while (!pool.try_submit(group, task)) std::this_thread::yield();
+  }
+  auto r = group.wait();
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::construction_failed);
+  EXPECT_TRUE(group.failed());
+  EXPECT_EQ(ran.load(), 32); // an error does not cancel the rest of the group
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+  pool_type pool(small_rings(3));
+  for (std::size_t grain : {std::size_t{0}, std::size_t{1}, std::size_t{7}, std::size_t{1000}}) {
+    constexpr std::size_t first = 3;
+    constexpr std::size_t last = 1003;
+    std::vector<std::atomic<int>> hits(last);
+    auto r = pool.parallel_for(first, last, [&hits](std::size_t i) { hits[i].fetch_add(1); }, grain);
+    ASSERT_TRUE(r);
+    for (std::size_t i = 0; i < last; ++i) EXPECT_EQ(hits[i].load(), i < first ? 0 : 1) << "grain " << grain << ", index " << i;
+  }
+  EXPECT_TRUE(pool.parallel_for(5, 5, [](std::size_t) {}));
+}
+
+TEST(ThreadPoolTest, ParallelForStopsOnError) {
+  pool_type pool(small_rings(2));
+  std::atomic<std::size_t> visited{0};
+  auto r = pool.parallel_for(0, 10000, [&visited](std::size_t i) -> std::expected<void, ec> {
+    visited.fetch_add(1, std::memory_order_relaxed);
+    if (i == 0) return std::unexpected(ec::type_mismatch);
+    return {};
+  }, 10);
+  ASSERT_FALSE(r);
+  EXPECT_EQ(r.error(), ec::type_mismatch);
+  EXPECT_LT(visited.load(), 10000u);
+}
+
+// Many short calls, each with its task_group on the caller's stack: the last
+// task of a group must not touch the group once wait() can return. Run under
+// TSan and ASan.
+TEST(ThreadPoolTest, ShortParallelForsDoNotOutliveTheirGroup) {
+  pool_type pool(small_rings(4));
+  ASSERT_TRUE(pool.valid());
+  std::atomic<std::size_t> sum{0};
+  for (int round = 0; round < 5000; ++round) {
+    auto r = pool.parallel_for(0, 4, [&sum](std::size_t i) { sum.fetch_add(i, std::memory_order_relaxed); }, 1);
+    ASSERT_TRUE(r);
+  }
+  EXPECT_EQ(sum.load(), 5000u * 6u);
+
+  // Groups on other threads finish in between: their wake-ups are shared.
+  std::vector<std::thread> callers;
+  std::atomic<int> failures{0};
+  for (int t = 0; t < 3; ++t) {
+    callers.emplace_back([&] {
+      for (int round = 0; round < 1000; ++round) {
+        if (!pool.parallel_for(0, 3, [](std::size_t) {}, 1)) failures.fetch_add(1);
+      }
+    });
+  }
+  for (auto& c : callers) c.join();
+  EXPECT_EQ(failures.load(), 0);
+}
+
+// Submitting a callable that fits the SBO touches neither the pool's
+// allocator nor the global heap on the submitting thread.
+TEST(ThreadPoolTest, SboSubmitDoesNotAllocate) {
+  thread_pool<counting_allocator<std::byte>> pool({.threads = 2});
+  ASSERT_TRUE(pool.valid());
+  std::atomic<int> ran{0};
+  EXPECT_NO_ALLOCATIONS {
+    for (int i = 0; i < 100; ++i) {
+      while (!pool.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); })) std::this_thread::yield();
+    }
+  }
+  while (ran.load() < 100) std::this_thread::yield();
+}
@@ -0,0 +1,211 @@
+// File: tests/test_timer_wheel.cpp
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/function_with_allocator.hpp"
+#include "behavioral/timer_wheel.hpp"
+
+using namespace ndof;
+
+namespace {
+
+using wheel_type = timer_wheel<>;
+using tick_type  = wheel_type::tick_type;
+
+// (timer, tick it fired at)
+using firing = std::pair<int, tick_type>;
+
+} // namespace
+
+// Delays on both sides of every level boundary cascade down to level 0 and
+// fire exactly on their tick, in expiry order, from a single advance().
+TEST(TimerWheelTest, CascadesToTheExactTick) {
+  wheel_type wheel(5);
+  std::vector<tick_type> delays;
+  for (unsigned shift = 6; shift <= 42; shift += 6) {
+    const tick_type b = tick_type{1} << shift;
+    delays.insert(delays.end(), {b - 6, b - 5, b - 4, b + 1, 3 * b + 7});
+  }
+  delays.push_back(1);
+
+  std::vector<firing> fired;
+  for (std::size_t i = 0; i < delays.size(); ++i) {
+    ASSERT_TRUE(wheel.schedule(delays[i], [&wheel, &fired, i] {
+      fired.emplace_back(static_cast<int>(i), wheel.now());
+    }));
+  }
+  EXPECT_EQ(wheel.size(), delays.size());
+
+  EXPECT_EQ(wheel.advance(std::numeric_limits<tick_type>::max()), delays.size());
+  EXPECT_TRUE(wheel.empty());
+  ASSERT_EQ(fired.size(), delays.size());
+  for (std::size_t k = 0; k < fired.size(); ++k) {
+    EXPECT_EQ(fired[k].second, 5 + delays[fired[k].first]) << "timer " << fired[k].first;
+    if (k) {
+      EXPECT_LE(fired[k - 1].second, fired[k].second);
+    }
+  }
+}
+
+// advance() stops at to without firing anything later, and jumps over empty
+// stretches straight to the next timer.
+TEST(TimerWheelTest, AdvanceStopsAtTarget) {
+  wheel_type wheel;
+  int fired = 0;
+  const tick_type far = (tick_type{1} << 40) + 3;
+  ASSERT_TRUE(wheel.schedule(far, [&] { ++fired; }));
+
+  EXPECT_EQ(wheel.advance(far - 1), 0u);
+  EXPECT_EQ(wheel.now(), far - 1);
+  EXPECT_EQ(fired, 0);
+  EXPECT_EQ(wheel.advance(far), 1u);
+  EXPECT_EQ(fired, 1);
+
+  // Never backwards; a time in the past fires on the next tick.
+  EXPECT_EQ(wheel.advance(10), 0u);
+  EXPECT_EQ(wheel.now(), far);
+  auto id = wheel.try_schedule_at(3, [&] { ++fired; });
+  ASSERT_TRUE(id);
+  EXPECT_EQ(wheel.advance(far + 1), 1u);
+  EXPECT_EQ(fired, 2);
+
+  // Delay 0 counts as 1; the end of the tick range is reachable.
+  ASSERT_TRUE(wheel.schedule(0, [&] { ++fired; }));
+  ASSERT_TRUE(wheel.schedule(std::numeric_limits<tick_type>::max(), [&] { ++fired; }));
+  EXPECT_EQ(wheel.advance(far + 2), 1u);
+  EXPECT_EQ(wheel.advance(std::numeric_limits<tick_type>::max()), 1u);
+  EXPECT_EQ(fired, 4);
+}
+
+TEST(TimerWheelTest, CancelAndStaleIds) {
+  wheel_type wheel;
+  int fired = 0;
+  auto a = wheel.schedule(100, [&] { ++fired; });
+  auto b = wheel.schedule(100, [&] { ++fired; });
+  auto c = wheel.schedule(5000, [&] { ++fired; });
+  ASSERT_TRUE(a && b && c);
+  EXPECT_EQ(wheel.size(), 3u);
+
+  EXPECT_TRUE(wheel.try_cancel(c));
+  EXPECT_EQ(wheel.try_cancel(c).error(), ec::empty);
+  EXPECT_EQ(wheel.try_cancel(wheel_type::timer_id{}).error(), ec::empty);
+  EXPECT_EQ(wheel.size(), 2u);
+
+  EXPECT_EQ(wheel.advance(10000), 2u);
+  EXPECT_EQ(fired, 2);
+  EXPECT_EQ(wheel.try_cancel(a).error(), ec::empty);
+
+  // The recycled node does not answer to the old id.
+  auto d = wheel.schedule(1, [&] { ++fired; });
+  ASSERT_TRUE(d);
+  EXPECT_EQ(wheel.try_cancel(a).error(), ec::empty);
+  EXPECT_EQ(wheel.try_cancel(b).error(), ec::empty);
+  EXPECT_TRUE(wheel.try_cancel(d));
+  EXPECT_TRUE(wheel.empty());
+}
+
+// Callbacks cancel other timers of their own batch and schedule new ones.
+TEST(TimerWheelTest, CallbacksCancelAndSchedule) {
+  wheel_type wheel;
+  std::vector<int> fired;
+  wheel_type::timer_id ids[2];
+  ids[0] = wheel.schedule(7, [&] {
+    fired.push_back(0);
+    wheel.cancel(ids[1]);
+    ASSERT_TRUE(wheel.schedule(7, [&] { fired.push_back(2); }));
+  });
+  ids[1] = wheel.schedule(7, [&] {
+    fired.push_back(1);
+    wheel.cancel(ids[0]);
+  });
+
+  EXPECT_EQ(wheel.advance(7), 1u);
+  ASSERT_EQ(fired.size(), 1u);
+  const bool first_was_0 = fired[0] == 0;
+  EXPECT_EQ(wheel.advance(14), first_was_0 ? 1u : 0u);
+  EXPECT_TRUE(wheel.empty());
+}
+
+#if defined(__cpp_exceptions)
+TEST(TimerWheelTest, ThrowingCallbackParksTheRestOfItsBatch) {
+  wheel_type wheel;
+  int fired = 0;
+  for (int i = 0; i < 3; ++i) ASSERT_TRUE(wheel.schedule(4, [&] { ++fired; }));
+  ASSERT_TRUE(wheel.schedule(4, [] { throw std::runtime_error("boom"); }));
+
+  EXPECT_THROW(wheel.advance(4), std::runtime_error);
+  EXPECT_EQ(wheel.advance(4), static_cast<std::size_t>(3 - fired));
+  EXPECT_EQ(fired, 3);
+  EXPECT_TRUE(wheel.empty());
+}
+#endif
+
+// Random schedules, cancels and advances, checked against a map of the live
+// timers and their expiries.
+TEST(TimerWheelTest, MatchesOrderedMapOracle) {
+  for (std::uint64_t seed = 1; seed <= 4; ++seed) {
+    std::mt19937_64 rng(seed);
+    wheel_type wheel(rng() >> 20, wheel_type::allocator_type{}, 64);
+
+    std::map<int, std::pair<tick_type, wheel_type::timer_id>> live; // timer -> (expiry, id)
+    std::vector<firing> fired;
+    int next = 0;
+
+    auto delay = [&rng]() -> tick_type {
+      const unsigned bits = static_cast<unsigned>(rng() % 30) + 1;
+      return rng() & ((tick_type{1} << bits) - 1);
+    };
+    auto add = [&](tick_type d) {
+      const int t = next++;
+      auto id = wheel.schedule(d, [&fired, &wheel, t] { fired.emplace_back(t, wheel.now()); });
+      ASSERT_TRUE(id);
+      live[t] = {wheel.now() + (d ? d : 1), id};
+    };
+
+    for (int i = 0; i < 500; ++i) add(delay());
+    for (int step = 0; step < 400; ++step) {
+      if (rng() % 4 == 0 && !live.empty()) {
+        auto it = live.begin();
+        std::advance(it, static_cast<long>(rng() % live.size()));
+        EXPECT_TRUE(wheel.try_cancel(it->second.second));
+        live.erase(it);
+      }
+      for (int i = static_cast<int>(rng() % 4); i > 0; --i) add(delay());
+
+      const tick_type to = wheel.now() + delay();
+      fired.clear();
+      const std::size_t n = wheel.advance(to);
+
+      std::vector<firing> expect;
+      for (auto it = live.begin(); it != live.end();) {
+        if (it->second.first <= to) {
+          expect.emplace_back(it->first, it->second.first);
+          it = live.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      ASSERT_EQ(n, expect.size()) << "seed " << seed << " step " << step;
+      // Expiry order; ties in any order.
+      for (std::size_t k = 1; k < fired.size(); ++k) ASSERT_LE(fired[k - 1].second, fired[k].second);
+      std::sort(fired.begin(), fired.end());
+      ASSERT_EQ(fired, expect) << "seed " << seed << " step " << step;
+      ASSERT_EQ(wheel.size(), live.size());
+    }
+  }
+}
@@ -0,0 +1,187 @@
+// File: tests/test_visitor.cpp
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <string>
+#include <type_traits>
+
+#include "structural/proxy/erasure_common.hpp"
+namespace ndof {
+#include "structural/proxy/aligned_storage.hpp"
+}
+#include "structural/proxy/any_with_allocator.hpp"
+#include "behavioral/visitor.hpp"
+
+using namespace ndof;
+
+namespace {
+
+// ---- closed hierarchy ------------------------------------------------------
+//
+// All visitor_table reads from a closed hierarchy: the object's tag, and
+// index_of and npos on the root. closed_cloneable provides these, and
+// test_closed_cloneable dispatches over one; this stand-in has no clone
+// machinery.
+
+struct circle;
+struct square;
+struct triangle;
+
+struct shape {
+  using tag_type = std::uint8_t;
+  static constexpr tag_type npos = 255;
+
+  template <class V>
+  static constexpr tag_type index_of = std::is_same_v<V, circle>   ? 0
+                                       : std::is_same_v<V, square>   ? 1
+                                       : std::is_same_v<V, triangle> ? 2
+                                                                     : npos;
+
+  tag_type type_index() const noexcept { return tag; }
+
+  tag_type tag{npos};
+  int size{0};
+};
+
+template <class Self>
+struct leaf : shape {
+  leaf() noexcept { tag = index_of<Self>; }
+};
+
+struct circle : leaf<circle> {};
+struct square : leaf<square> {};
+struct triangle : leaf<triangle> {};
+
+// ---- plain element types ---------------------------------------------------
+
+struct num {
+  int v;
+};
+
+struct text {
+  std::string s;
+};
+
+struct other {};
+
+// ---- visitors --------------------------------------------------------------
+
+struct namer {
+  std::string operator()(circle&) const { return "circle"; }
+  std::string operator()(square&) const { return "square"; }
+  std::string operator()(triangle&) const { return "triangle"; }
+  std::string operator()(num& n) const { return "num " + std::to_string(n.v); }
+  std::string operator()(text& t) const { return "text " + t.s; }
+};
+
+// No overload for triangle or text.
+struct area {
+  std::expected<std::string, ec> operator()(circle& c) const { return std::to_string(3 * c.size * c.size); }
+  std::expected<std::string, ec> operator()(square& s) const { return std::to_string(s.size * s.size); }
+  std::expected<std::string, ec> operator()(num& n) const {
+    if (n.v < 0) return std::unexpected(ec::construction_failed);
+    return std::to_string(n.v);
+  }
+};
+
+// Catch-all.
+struct counter {
+  int calls{0};
+  template <class E>
+  std::string operator()(E&) {
+    ++calls;
+    return "counted";
+  }
+};
+
+using visitors = type_list<namer, area, counter>;
+
+// Same order as the hierarchy: the tag is the column.
+using in_order  = visitor_table<std::string, visitors, type_list<circle, square, triangle>>;
+// Reordered, with triangle left out: the tag goes through the remap.
+using reordered = visitor_table<std::string, visitors, type_list<square, num, circle>>;
+using plain     = visitor_table<std::string, visitors, type_list<num, text>>;
+
+} // namespace
+
+TEST(VisitorTest, DirectElementsDispatchOnTheStaticType) {
+  namer n;
+  area a;
+  counter c;
+  num x{7};
+  text t{"hi"};
+
+  EXPECT_EQ(*plain::try_visit(n, x), "num 7");
+  EXPECT_EQ(*plain::try_visit(n, t), "text hi");
+  EXPECT_EQ(*plain::try_visit(a, x), "7");
+  EXPECT_EQ(plain::try_visit(a, t).error(), ec::type_mismatch); // no overload
+
+  num bad{-1};
+  EXPECT_EQ(plain::try_visit(a, bad).error(), ec::construction_failed);
+  EXPECT_EQ(plain::visit_or(a, bad, std::string("fallback")), "fallback");
+
+  EXPECT_TRUE(plain::visit(c, x));
+  EXPECT_TRUE(plain::visit(c, t));
+  EXPECT_EQ(c.calls, 2);
+
+  EXPECT_EQ(plain::element_ref(x).id(), plain::element_id<num>);
+  EXPECT_EQ(plain::element_ref(t).id(), 1u);
+}
+
+TEST(VisitorTest, ClosedColumnsFollowTheTag) {
+  namer n;
+  area a;
+  circle ci;
+  ci.size = 2;
+  square sq;
+  sq.size = 3;
+  triangle tr;
+  shape& s0 = ci;
+  shape& s1 = sq;
+  shape& s2 = tr;
+
+  EXPECT_EQ(*in_order::try_visit(n, s0), "circle");
+  EXPECT_EQ(*in_order::try_visit(n, s1), "square");
+  EXPECT_EQ(*in_order::try_visit(n, s2), "triangle");
+  EXPECT_EQ(*in_order::try_visit(a, s0), "12");
+  EXPECT_EQ(in_order::try_visit(a, s2).error(), ec::type_mismatch);
+  EXPECT_EQ(in_order::element_ref(s2).id(), 2u);
+
+  EXPECT_EQ(*reordered::try_visit(n, s0), "circle");
+  EXPECT_EQ(*reordered::try_visit(a, s1), "9");
+  EXPECT_EQ(reordered::element_ref(s0).id(), reordered::element_id<circle>);
+
+  // A leaf that is not listed, and a root that is no leaf at all.
+  EXPECT_EQ(reordered::try_visit(n, s2).error(), ec::type_mismatch);
+  EXPECT_EQ(reordered::element_ref(s2).id(), reordered::element_count);
+  shape bare;
+  EXPECT_EQ(in_order::try_visit(n, bare).error(), ec::type_mismatch);
+  EXPECT_EQ(reordered::try_visit(n, bare).error(), ec::type_mismatch);
+}
+
+TEST(VisitorTest, AnyColumnsFollowTheHeldType) {
+  namer n;
+  area a;
+  any_with_allocator<> x;
+  EXPECT_EQ(plain::try_visit(n, x).error(), ec::empty);
+
+  ASSERT_TRUE(x.try_emplace<num>(num{5}));
+  EXPECT_EQ(*plain::try_visit(n, x), "num 5");
+  EXPECT_EQ(*plain::try_visit(a, x), "5");
+
+  ASSERT_TRUE(x.try_emplace<text>(text{"any"}));
+  EXPECT_EQ(*plain::try_visit(n, x), "text any");
+  EXPECT_EQ(plain::try_visit(a, x).error(), ec::type_mismatch);
+
+  // Held but not listed.
+  ASSERT_TRUE(x.try_emplace<other>());
+  EXPECT_EQ(plain::try_visit(n, x).error(), ec::type_mismatch);
+  EXPECT_EQ(plain::element_ref(x).id(), plain::element_count);
+
+  x.reset();
+  EXPECT_EQ(plain::try_visit(n, x).error(), ec::empty);
+}